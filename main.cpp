@@ -9,9 +9,49 @@
 #include <chrono>
 #include <ctime>
 #include <map>
+#include <set>
 #include <functional>
 #include <sstream>
 #include <iomanip>
+#include <unordered_map>
+#include <random>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <iterator>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/random.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <csignal>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <tuple>
+#include <utility>
+#include <future>
+#include <shared_mutex>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#include <x86intrin.h>
+#include <cpuid.h>
+#define HMS_HAVE_AVX2 1 // AVX2 kernels are compiled in and picked at run time
+#define HMS_HAVE_RDTSC 1 // Metrics time with the time-stamp counter
+#endif
 
 // ------------------------------
 // Interfaces for Cross-Cutting Concerns
@@ -67,6 +107,288 @@ public:
     }
 };
 
+// Discards all messages; used by benchmarks and non-interactive runs
+class NullLogger : public ILogger {
+public:
+    void logInfo(const std::string &) override {}
+    void logError(const std::string &) override {}
+    void logWarning(const std::string &) override {}
+};
+
+// Bounded lock-free multi-producer/multi-consumer ring buffer.
+// Each cell carries a sequence number that tells producers and consumers
+// whether the cell is free for writing or holds a value ready to read.
+template <typename T>
+class BoundedMpmcQueue {
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(64) std::atomic<size_t> enqueuePos;
+    alignas(64) std::atomic<size_t> dequeuePos;
+
+public:
+    explicit BoundedMpmcQueue(size_t capacity)
+        : enqueuePos(0), dequeuePos(0) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        cells.reset(new Cell[size]);
+        mask = size - 1;
+        for (size_t i = 0; i < size; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedMpmcQueue(const BoundedMpmcQueue &) = delete;
+    BoundedMpmcQueue &operator=(const BoundedMpmcQueue &) = delete;
+
+    bool tryPush(T &&value) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = cells[pos & mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.data = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // Queue is full
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T &value) {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = cells[pos & mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = std::move(cell.data);
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // Queue is empty
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool empty() const {
+        return enqueuePos.load(std::memory_order_seq_cst) == dequeuePos.load(std::memory_order_seq_cst);
+    }
+};
+
+// Tuning knobs for the asynchronous logger
+struct AsyncLoggerOptions {
+    size_t queueCapacity = 8192;                      // Records buffered before callers back off
+    size_t flushBatchSize = 256;                      // Flush after this many records are written
+    std::chrono::milliseconds flushInterval{200};     // ...or after this much time has passed
+};
+
+// Asynchronous file logger: callers only enqueue a record, while a background
+// thread keeps the log file open, formats records and writes them in batches.
+class AsyncFileLogger : public ILogger {
+private:
+    enum class Level { Info, Error, Warning };
+
+    struct LogRecord {
+        Level level = Level::Info;
+        std::chrono::system_clock::time_point time;
+        std::string message;
+    };
+
+    std::string logFilePath;
+    AsyncLoggerOptions options;
+    BoundedMpmcQueue<LogRecord> queue;
+
+    std::thread writer;
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable drainedCondition;
+    std::atomic<bool> writerSleeping{false};
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> stopped{false};  // Set by the writer before its final drain
+    std::atomic<int> producers{0};     // Threads inside enqueue
+    std::mutex fileMutex;              // Serialises writes once the writer is finishing
+    std::atomic<uint64_t> enqueuedCount{0};
+    std::atomic<uint64_t> writtenCount{0};
+
+    // The writer thread caches the formatted timestamp for the current second
+    std::time_t cachedSecond = 0;
+    std::string cachedTimestamp;
+
+    static const char *levelTag(Level level) {
+        switch (level) {
+            case Level::Error: return "[ERROR] [";
+            case Level::Warning: return "[WARNING] [";
+            default: return "[INFO] [";
+        }
+    }
+
+    const std::string &formatTimestamp(std::chrono::system_clock::time_point time) {
+        std::time_t timeT = std::chrono::system_clock::to_time_t(time);
+        if (timeT != cachedSecond || cachedTimestamp.empty()) {
+            std::stringstream ss;
+            ss << std::put_time(std::localtime(&timeT), "%Y-%m-%d %H:%M:%S");
+            cachedTimestamp = ss.str();
+            cachedSecond = timeT;
+        }
+        return cachedTimestamp;
+    }
+
+    void writeRecord(std::ofstream &logFile, const LogRecord &record) {
+        logFile << levelTag(record.level) << formatTimestamp(record.time) << "] "
+                << record.message << '\n';
+    }
+
+    void wakeWriter() {
+        if (writerSleeping.load()) {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            wakeCondition.notify_one();
+        }
+    }
+
+    void enqueue(Level level, const std::string &message) {
+        LogRecord record;
+        record.level = level;
+        record.time = std::chrono::system_clock::now();
+        record.message = message;
+
+        // The writer waits for every producer it might have missed before
+        // its final drain; one arriving after that appends the record itself
+        producers.fetch_add(1);
+        if (stopped.load()) {
+            producers.fetch_sub(1);
+            std::lock_guard<std::mutex> lock(fileMutex);
+            std::ofstream logFile(logFilePath, std::ios::app);
+            if (logFile) writeRecord(logFile, record);
+            return;
+        }
+
+        enqueuedCount.fetch_add(1);
+        while (!queue.tryPush(std::move(record))) {
+            // Queue is full: let the writer catch up rather than drop the record
+            wakeWriter();
+            std::this_thread::yield();
+        }
+        producers.fetch_sub(1);
+        wakeWriter();
+    }
+
+    void writerLoop() {
+        std::ofstream logFile(logFilePath, std::ios::app);
+        auto lastFlush = std::chrono::steady_clock::now();
+        size_t unflushed = 0;
+        LogRecord record;
+
+        for (;;) {
+            size_t batch = 0;
+            while (batch < options.flushBatchSize && queue.tryPop(record)) {
+                if (logFile) writeRecord(logFile, record);
+                ++batch;
+            }
+            unflushed += batch;
+            if (batch > 0) writtenCount.fetch_add(batch);
+
+            auto now = std::chrono::steady_clock::now();
+            if (unflushed > 0 && (unflushed >= options.flushBatchSize ||
+                                  now - lastFlush >= options.flushInterval ||
+                                  queue.empty())) {
+                logFile.flush();
+                unflushed = 0;
+                lastFlush = now;
+                std::lock_guard<std::mutex> lock(wakeMutex);
+                drainedCondition.notify_all();
+            }
+
+            if (batch > 0) continue;
+            if (stopping.load()) break;
+
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            writerSleeping.store(true);
+            if (queue.empty() && !stopping.load()) {
+                wakeCondition.wait_for(lock, options.flushInterval);
+            }
+            writerSleeping.store(false);
+        }
+
+        // Turn later records away to the fallback in enqueue, then drain
+        // until no producer is left that may still push
+        std::lock_guard<std::mutex> fileLock(fileMutex);
+        stopped.store(true);
+        for (;;) {
+            if (queue.tryPop(record)) {
+                if (logFile) writeRecord(logFile, record);
+                writtenCount.fetch_add(1);
+            } else if (producers.load() == 0) {
+                if (queue.empty()) break; // Pushed after the failed pop, before leaving
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        logFile.flush();
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        drainedCondition.notify_all();
+    }
+
+public:
+    AsyncFileLogger(const std::string &filePath = "hospital_log.txt",
+                    const AsyncLoggerOptions &opts = AsyncLoggerOptions())
+        : logFilePath(filePath), options(opts), queue(opts.queueCapacity) {
+        if (options.flushBatchSize == 0) options.flushBatchSize = 1;
+        writer = std::thread(&AsyncFileLogger::writerLoop, this);
+    }
+
+    ~AsyncFileLogger() override {
+        shutdown();
+    }
+
+    void logInfo(const std::string &message) override {
+        enqueue(Level::Info, message);
+    }
+
+    void logError(const std::string &message) override {
+        enqueue(Level::Error, message);
+    }
+
+    void logWarning(const std::string &message) override {
+        enqueue(Level::Warning, message);
+    }
+
+    // Block until every record logged before this call has reached the file
+    void flush() {
+        uint64_t target = enqueuedCount.load();
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wakeCondition.notify_one();
+        drainedCondition.wait(lock, [this, target] {
+            return writtenCount.load() >= target || stopped.load();
+        });
+    }
+
+    // Stop the writer thread after draining all queued records
+    void shutdown() {
+        if (stopping.exchange(true)) return;
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            wakeCondition.notify_one();
+        }
+        if (writer.joinable()) writer.join();
+    }
+};
+
 // Display Interface for UI separation (SRP, ISP)
 class IDisplayManager {
 public:
@@ -97,6 +419,46 @@ public:
     }
 };
 
+// Display that shows nothing, for sessions with no console attached
+class SilentDisplayManager : public IDisplayManager {
+public:
+    void displaySuccess(const std::string &) override {}
+    void displayError(const std::string &) override {}
+    void displayInfo(const std::string &) override {}
+    void displayWarning(const std::string &) override {}
+};
+
+// Keeps the outcome of each operation instead of printing it, so code that
+// drives the services without a console can tell success from failure.
+// Messages are also passed on to the echo display, if there is one.
+class RecordingDisplayManager : public IDisplayManager {
+private:
+    size_t errorCount = 0;
+    std::string lastError;
+    std::shared_ptr<IDisplayManager> echo;
+
+public:
+    explicit RecordingDisplayManager(std::shared_ptr<IDisplayManager> echo = nullptr) : echo(echo) {}
+
+    void displaySuccess(const std::string &message) override {
+        if (echo) echo->displaySuccess(message);
+    }
+    void displayError(const std::string &message) override {
+        ++errorCount;
+        lastError = message;
+        if (echo) echo->displayError(message);
+    }
+    void displayInfo(const std::string &message) override {
+        if (echo) echo->displayInfo(message);
+    }
+    void displayWarning(const std::string &message) override {
+        if (echo) echo->displayWarning(message);
+    }
+
+    size_t getErrorCount() const { return errorCount; }
+    const std::string &getLastError() const { return lastError; }
+};
+
 // Validation interface (SRP for input validation)
 class IValidator {
 public:
@@ -106,177 +468,800 @@ public:
 };
 
 // ------------------------------
-// Entity Classes
+// Calendar Helpers
 // ------------------------------
 
-class Patient {
+// The bookable appointment slots, in the order offered by the booking menu
+const int TimeSlotCount = 10;
+const char *const TimeSlots[TimeSlotCount] = {
+    "09:00-09:30", "09:30-10:00", "10:00-10:30", "10:30-11:00", "11:00-11:30",
+    "11:30-12:00", "14:00-14:30", "14:30-15:00", "15:00-15:30", "15:30-16:00"
+};
+
+// Returns the index of a time slot label in TimeSlots, or -1 if unknown
+inline int timeSlotIndex(const std::string &timeSlot) {
+    for (int i = 0; i < TimeSlotCount; ++i) {
+        if (timeSlot == TimeSlots[i]) return i;
+    }
+    return -1;
+}
+
+const int InvalidDay = std::numeric_limits<int>::min();
+
+// Converts a YYYY-MM-DD date to a day number (days since 1970-01-01),
+// or InvalidDay if the text is not a valid calendar date.
+inline int parseDayNumber(const std::string &date) {
+    if (date.size() != 10 || date[4] != '-' || date[7] != '-') return InvalidDay;
+    for (int i : {0, 1, 2, 3, 5, 6, 8, 9}) {
+        if (date[i] < '0' || date[i] > '9') return InvalidDay;
+    }
+    int year = (date[0] - '0') * 1000 + (date[1] - '0') * 100 + (date[2] - '0') * 10 + (date[3] - '0');
+    int month = (date[5] - '0') * 10 + (date[6] - '0');
+    int day = (date[8] - '0') * 10 + (date[9] - '0');
+
+    static const int daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    if (month < 1 || month > 12 || day < 1) return InvalidDay;
+    if (day > daysInMonth[month - 1] + (month == 2 && leap ? 1 : 0)) return InvalidDay;
+
+    // Civil-from-days conversion with March as the first month of the year
+    year -= month <= 2 ? 1 : 0;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    int yearOfEra = year - era * 400;
+    int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+// Today's day number in local time
+inline int todayDayNumber() {
+    std::time_t now = std::time(nullptr);
+    std::tm local;
+    localtime_r(&now, &local);
+    char text[11];
+    std::strftime(text, sizeof(text), "%Y-%m-%d", &local);
+    return parseDayNumber(text);
+}
+
+// Formats a day number back to YYYY-MM-DD; InvalidDay formats as ""
+inline std::string formatDayNumber(int dayNumber) {
+    if (dayNumber == InvalidDay) return std::string();
+    // Days-to-civil conversion, the inverse of parseDayNumber
+    int shifted = dayNumber + 719468;
+    int era = (shifted >= 0 ? shifted : shifted - 146096) / 146097;
+    int dayOfEra = shifted - era * 146097;
+    int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int monthIndex = (5 * dayOfYear + 2) / 153;
+    int day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    int month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    int year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+
+    char text[11] = {
+        static_cast<char>('0' + year / 1000 % 10), static_cast<char>('0' + year / 100 % 10),
+        static_cast<char>('0' + year / 10 % 10), static_cast<char>('0' + year % 10), '-',
+        static_cast<char>('0' + month / 10), static_cast<char>('0' + month % 10), '-',
+        static_cast<char>('0' + day / 10), static_cast<char>('0' + day % 10), '\0'
+    };
+    return std::string(text, 10);
+}
+
+// Label for a slot index, or an empty string if the index is out of range
+inline const std::string &timeSlotLabel(int slot) {
+    static const std::vector<std::string> labels(TimeSlots, TimeSlots + TimeSlotCount);
+    static const std::string none;
+    return slot >= 0 && slot < TimeSlotCount ? labels[slot] : none;
+}
+
+// Booked-slot bitmask per (doctor, day): one bit per entry in TimeSlots, so
+// conflict checks, bookings and cancellations are single bit operations.
+class SlotCalendar {
 private:
-    int id;
-    std::string name;
-    int age;
-    std::string disease;
-    std::string contactNumber;
-    std::string address;
-    std::string bloodGroup;
-    std::vector<int> medicationIds; // Store IDs of prescribed medications
+    std::unordered_map<uint64_t, uint16_t> bookedMasks;
 
-public:
-    Patient(int id, const std::string &name, int age, const std::string &disease,
-            const std::string &contactNumber = "", const std::string &address = "", 
-            const std::string &bloodGroup = "")
-        : id(id), name(name), age(age), disease(disease), 
-          contactNumber(contactNumber), address(address), bloodGroup(bloodGroup) {}
+    static uint64_t key(int doctorId, int day) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(doctorId)) << 32) |
+               static_cast<uint32_t>(day);
+    }
 
-    int getId() const { return id; }
-    std::string getName() const { return name; }
-    int getAge() const { return age; }
-    std::string getDisease() const { return disease; }
-    std::string getContactNumber() const { return contactNumber; }
-    std::string getAddress() const { return address; }
-    std::string getBloodGroup() const { return bloodGroup; }
-    std::vector<int> getMedicationIds() const { return medicationIds; }
+public:
+    bool isBooked(int doctorId, int day, int slot) const {
+        return (bookedMask(doctorId, day) >> slot) & 1u;
+    }
 
-    void setName(const std::string &newName) { name = newName; }
-    void setAge(int newAge) { age = newAge; }
-    void setDisease(const std::string &newDisease) { disease = newDisease; }
-    void setContactNumber(const std::string &newNumber) { contactNumber = newNumber; }
-    void setAddress(const std::string &newAddress) { address = newAddress; }
-    void setBloodGroup(const std::string &newBloodGroup) { bloodGroup = newBloodGroup; }
-    
-    void addMedicationId(int medicationId) {
-        medicationIds.push_back(medicationId);
+    void book(int doctorId, int day, int slot) {
+        bookedMasks[key(doctorId, day)] |= static_cast<uint16_t>(1u << slot);
     }
-    
-    void removeMedicationId(int medicationId) {
-        medicationIds.erase(
-            std::remove(medicationIds.begin(), medicationIds.end(), medicationId),
-            medicationIds.end()
-        );
+
+    void release(int doctorId, int day, int slot) {
+        auto found = bookedMasks.find(key(doctorId, day));
+        if (found == bookedMasks.end()) return;
+        found->second &= static_cast<uint16_t>(~(1u << slot));
+        if (found->second == 0) bookedMasks.erase(found);
     }
 
-    void display() const {
-        std::cout << "Patient ID: " << id << "\nName: " << name 
-                  << "\nAge: " << age << "\nDisease: " << disease;
-        if (!contactNumber.empty()) std::cout << "\nContact: " << contactNumber;
-        if (!address.empty()) std::cout << "\nAddress: " << address;
-        if (!bloodGroup.empty()) std::cout << "\nBlood Group: " << bloodGroup;
-        std::cout << "\n";
+    uint16_t bookedMask(int doctorId, int day) const {
+        auto found = bookedMasks.find(key(doctorId, day));
+        return found != bookedMasks.end() ? found->second : 0;
     }
 };
 
-class Doctor {
+// ------------------------------
+// Symbol Interning
+// ------------------------------
+
+// Small integer naming an interned string
+typedef uint32_t Symbol;
+
+// Process-wide string interner for the small vocabularies entities draw
+// from (statuses, roles, blood groups, ...). Each distinct string is stored
+// once, so an entity field is a 4-byte Symbol and equality is an integer
+// comparison. Only the closed vocabularies below are interned, never text
+// a user makes up. Interning takes a reader-writer lock; reading a name back is
+// lock-free because names live in chunks that never move once published.
+class SymbolTable {
 private:
-    int id;
-    std::string name;
-    std::string specialization;
-    std::string contactNumber;
-    std::string email;
-    double consultationFee;
-    bool isAvailable;
+    static const uint32_t ChunkBits = 8;
+    static const uint32_t ChunkSize = 1u << ChunkBits;
+    static const uint32_t MaxChunks = 4096;
+
+    mutable std::shared_timed_mutex mutex;
+    std::unordered_map<std::string, Symbol> symbolsByName;
+    std::atomic<std::string*> chunks[MaxChunks];
+    uint32_t count = 0;
 
 public:
-    Doctor(int id, const std::string &name, const std::string &specialization,
-           const std::string &contactNumber = "", const std::string &email = "",
-           double consultationFee = 0.0)
-        : id(id), name(name), specialization(specialization), 
-          contactNumber(contactNumber), email(email), 
-          consultationFee(consultationFee), isAvailable(true) {}
+    static const Symbol NoSymbol = UINT32_MAX;
+    static const Symbol EmptySymbol = 0; // The empty string
 
-    int getId() const { return id; }
-    std::string getName() const { return name; }
-    std::string getSpecialization() const { return specialization; }
-    std::string getContactNumber() const { return contactNumber; }
-    std::string getEmail() const { return email; }
-    double getConsultationFee() const { return consultationFee; }
-    bool getAvailability() const { return isAvailable; }
+    SymbolTable() {
+        for (auto &chunk : chunks) chunk.store(nullptr, std::memory_order_relaxed);
+        intern("");
+    }
 
-    void setName(const std::string &newName) { name = newName; }
-    void setSpecialization(const std::string &newSpec) { specialization = newSpec; }
-    void setContactNumber(const std::string &newContact) { contactNumber = newContact; }
-    void setEmail(const std::string &newEmail) { email = newEmail; }
-    void setConsultationFee(double newFee) { consultationFee = newFee; }
-    void setAvailability(bool availability) { isAvailable = availability; }
+    ~SymbolTable() {
+        for (auto &chunk : chunks) delete[] chunk.load(std::memory_order_relaxed);
+    }
 
-    void display() const {
-        std::cout << "Doctor ID: " << id << "\nName: " << name 
-                  << "\nSpecialization: " << specialization;
-        if (!contactNumber.empty()) std::cout << "\nContact: " << contactNumber;
-        if (!email.empty()) std::cout << "\nEmail: " << email;
-        std::cout << "\nConsultation Fee: $" << consultationFee;
-        std::cout << "\nAvailability: " << (isAvailable ? "Available" : "Not Available");
-        std::cout << "\n";
+    SymbolTable(const SymbolTable &) = delete;
+    SymbolTable &operator=(const SymbolTable &) = delete;
+
+    Symbol intern(const std::string &name) {
+        {
+            std::shared_lock<std::shared_timed_mutex> lock(mutex);
+            auto found = symbolsByName.find(name);
+            if (found != symbolsByName.end()) return found->second;
+        }
+        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+        auto found = symbolsByName.find(name);
+        if (found != symbolsByName.end()) return found->second;
+        if (count == ChunkSize * MaxChunks) throw std::length_error("Symbol table is full");
+
+        std::string *names = chunks[count >> ChunkBits].load(std::memory_order_relaxed);
+        if (!names) {
+            names = new std::string[ChunkSize];
+            chunks[count >> ChunkBits].store(names, std::memory_order_release);
+        }
+        names[count & (ChunkSize - 1)] = name;
+        symbolsByName.emplace(name, count);
+        return count++;
+    }
+
+    // Like intern() but never adds; NoSymbol if the string was never seen,
+    // in which case no entity can hold it
+    Symbol lookup(const std::string &name) const {
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
+        auto found = symbolsByName.find(name);
+        return found != symbolsByName.end() ? found->second : NoSymbol;
+    }
+
+    const std::string &name(Symbol symbol) const {
+        return chunks[symbol >> ChunkBits].load(std::memory_order_acquire)[symbol & (ChunkSize - 1)];
     }
 };
 
-// Enhanced appointment with time slots
-class Appointment {
-private:
-    int appointmentId;
-    int patientId;
-    int doctorId;
-    std::string date;  // Format: YYYY-MM-DD
-    std::string timeSlot; // Format: HH:MM-HH:MM (24-hour format)
-    std::string status; // Scheduled, Completed, Cancelled
-    std::string notes;
+inline SymbolTable &symbols() {
+    static SymbolTable table;
+    return table;
+}
 
-public:
-    Appointment(int appointmentId, int patientId, int doctorId, 
-                const std::string &date, const std::string &timeSlot = "09:00-09:30",
-                const std::string &status = "Scheduled", const std::string &notes = "")
-        : appointmentId(appointmentId), patientId(patientId), doctorId(doctorId), 
-          date(date), timeSlot(timeSlot), status(status), notes(notes) {}
+// Symbols the code compares against directly
+struct KnownSymbols {
+    Symbol cancelled = symbols().intern("Cancelled");
+    Symbol admin = symbols().intern("Admin");
+};
 
-    int getAppointmentId() const { return appointmentId; }
-    int getPatientId() const { return patientId; }
-    int getDoctorId() const { return doctorId; }
-    std::string getDate() const { return date; }
-    std::string getTimeSlot() const { return timeSlot; }
-    std::string getStatus() const { return status; }
-    std::string getNotes() const { return notes; }
-
-    void setDate(const std::string &newDate) { date = newDate; }
-    void setTimeSlot(const std::string &newTimeSlot) { timeSlot = newTimeSlot; }
-    void setStatus(const std::string &newStatus) { status = newStatus; }
-    void setNotes(const std::string &newNotes) { notes = newNotes; }
+inline const KnownSymbols &known() {
+    static const KnownSymbols table;
+    return table;
+}
 
-    void display() const {
-        std::cout << "Appointment ID: " << appointmentId 
-                  << "\nPatient ID: " << patientId 
-                  << "\nDoctor ID: " << doctorId 
-                  << "\nDate: " << date
-                  << "\nTime Slot: " << timeSlot
-                  << "\nStatus: " << status;
-        if (!notes.empty()) std::cout << "\nNotes: " << notes;
-        std::cout << "\n";
-    }
+// The closed vocabularies interned fields take their words from
+enum class Vocabulary { BloodGroup, AppointmentStatus, PaymentStatus, PaymentMethod, Role };
+
+struct VocabularyWords {
+    const char *name;
+    std::vector<std::string> words; // An empty word marks the field optional
 };
 
-// New class for medications
-class Medication {
+inline const VocabularyWords &vocabulary(Vocabulary which) {
+    static const VocabularyWords vocabularies[] = {
+        {"blood group", {"", "O+", "O-", "A+", "A-", "B+", "B-", "AB+", "AB-"}},
+        {"appointment status", {"Scheduled", "Completed", "Cancelled"}},
+        {"payment status", {"Pending", "Paid", "Overdue"}},
+        {"payment method", {"", "Cash", "Card", "Insurance"}},
+        {"role", {"Admin", "Doctor", "Reception", "Receptionist"}},
+    };
+    return vocabularies[static_cast<size_t>(which)];
+}
+
+inline bool inVocabulary(Vocabulary which, const std::string &word) {
+    const std::vector<std::string> &words = vocabulary(which).words;
+    return std::find(words.begin(), words.end(), word) != words.end();
+}
+
+// What to tell a user who entered a word outside the vocabulary
+inline std::string vocabularyError(Vocabulary which) {
+    const VocabularyWords &known = vocabulary(which);
+    std::string message = std::string("Invalid ") + known.name + ". Use one of:";
+    bool optional = false;
+    for (const std::string &word : known.words) {
+        if (word.empty()) optional = true;
+        else message += (message.back() == ':' ? " " : ", ") + word;
+    }
+    return message + (optional ? " (or leave it empty)." : ".");
+}
+
+// Interns a word of the vocabulary. Anything else throws rather than
+// growing the table; services check input with inVocabulary first.
+inline Symbol vocabularySymbol(Vocabulary which, const std::string &word) {
+    if (!inVocabulary(which, word)) {
+        throw std::invalid_argument("'" + word + "' is not a " + vocabulary(which).name);
+    }
+    return symbols().intern(word);
+}
+
+// ------------------------------
+// Money
+// ------------------------------
+
+// An amount of currency in whole cents. Sums of cents are exact, so revenue
+// totals come out the same however many bills there are and in whatever
+// order they are added.
+class Money {
 private:
-    int medicationId;
-    std::string name;
-    std::string dosage;
-    double price;
-    std::string manufacturer;
-    std::string description;
+    int64_t cents;
+
+    explicit Money(int64_t cents) : cents(cents) {}
 
 public:
-    Medication(int medicationId, const std::string &name, const std::string &dosage,
-               double price, const std::string &manufacturer = "", const std::string &description = "")
-        : medicationId(medicationId), name(name), dosage(dosage), 
-          price(price), manufacturer(manufacturer), description(description) {}
-          
-    int getMedicationId() const { return medicationId; }
-    std::string getName() const { return name; }
-    std::string getDosage() const { return dosage; }
-    double getPrice() const { return price; }
-    std::string getManufacturer() const { return manufacturer; }
-    std::string getDescription() const { return description; }
-    
-    void setName(const std::string &newName) { name = newName; }
-    void setDosage(const std::string &newDosage) { dosage = newDosage; }
-    void setPrice(double newPrice) { price = newPrice; }
+    Money() : cents(0) {}
+
+    static Money fromCents(int64_t cents) { return Money(cents); }
+
+    // Parses "12", "12.5" or "12.50" exactly. Fails on anything else,
+    // including a third decimal place and a minus sign: every amount that
+    // is typed in is a fee, price or charge, none of which can be negative.
+    static bool parse(const char *text, Money &result) {
+        const char *c = text;
+        if (*c == '+') ++c;
+        int64_t whole = 0;
+        int digits = 0;
+        for (; *c >= '0' && *c <= '9'; ++c, ++digits) {
+            if (digits == 15) return false;
+            whole = whole * 10 + (*c - '0');
+        }
+        int64_t fraction = 0;
+        int decimals = 0;
+        if (*c == '.') {
+            for (++c; *c >= '0' && *c <= '9'; ++c, ++decimals) {
+                if (decimals == 2) return false;
+                fraction = fraction * 10 + (*c - '0');
+            }
+        }
+        if (*c != '\0' || digits + decimals == 0) return false;
+        if (decimals == 1) fraction *= 10;
+        result = Money(whole * 100 + fraction);
+        return true;
+    }
+
+    int64_t getCents() const { return cents; }
+    double toDouble() const { return static_cast<double>(cents) / 100.0; }
+
+    Money &operator+=(Money other) { cents += other.cents; return *this; }
+    Money &operator-=(Money other) { cents -= other.cents; return *this; }
+    friend Money operator+(Money a, Money b) { return a += b; }
+    friend Money operator-(Money a, Money b) { return a -= b; }
+    friend bool operator==(Money a, Money b) { return a.cents == b.cents; }
+    friend bool operator!=(Money a, Money b) { return a.cents != b.cents; }
+    friend bool operator<(Money a, Money b) { return a.cents < b.cents; }
+
+    // Always two decimal places, e.g. "1234.50"
+    std::string toString() const {
+        uint64_t magnitude = cents < 0 ? 0 - static_cast<uint64_t>(cents) : static_cast<uint64_t>(cents);
+        std::string text = cents < 0 ? "-" : "";
+        text += std::to_string(magnitude / 100);
+        text += '.';
+        text += static_cast<char>('0' + magnitude % 100 / 10);
+        text += static_cast<char>('0' + magnitude % 10);
+        return text;
+    }
+};
+
+inline std::ostream &operator<<(std::ostream &out, Money amount) {
+    return out << amount.toString();
+}
+
+// Aggregation kernels over amounts laid out as plain arrays of cents. The
+// loops are branch-free integer adds with no dependency between lanes, so
+// the compiler can vectorize them.
+inline int64_t sumCents(const int64_t *cents, size_t count) {
+    int64_t lanes[4] = {0, 0, 0, 0};
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        lanes[0] += cents[i];
+        lanes[1] += cents[i + 1];
+        lanes[2] += cents[i + 2];
+        lanes[3] += cents[i + 3];
+    }
+    for (; i < count; ++i) lanes[0] += cents[i];
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+// Sums the amounts whose key matches, masking instead of branching
+inline int64_t sumCentsWhere(const int64_t *cents, const uint32_t *keys, uint32_t key, size_t count) {
+    int64_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        total += cents[i] & -static_cast<int64_t>(keys[i] == key);
+    }
+    return total;
+}
+
+// ------------------------------
+// Password Hashing
+// ------------------------------
+
+// SHA-256 as specified in FIPS 180-4
+class Sha256 {
+public:
+    static const size_t DigestSize = 32;
+    static const size_t BlockSize = 64;
+
+private:
+    uint32_t state[8];
+    uint8_t buffer[BlockSize];
+    size_t buffered = 0;
+    uint64_t length = 0; // Bytes hashed so far, including any absorbed before a saved state
+
+    static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    static uint32_t loadBigEndian(const uint8_t *p) {
+        return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 |
+               static_cast<uint32_t>(p[2]) << 8 | p[3];
+    }
+
+public:
+    static void storeBigEndian(uint8_t *p, uint32_t value) {
+        p[0] = static_cast<uint8_t>(value >> 24);
+        p[1] = static_cast<uint8_t>(value >> 16);
+        p[2] = static_cast<uint8_t>(value >> 8);
+        p[3] = static_cast<uint8_t>(value);
+    }
+
+    static void compress(uint32_t h[8], const uint8_t block[BlockSize]) {
+        static const uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) w[i] = loadBigEndian(block + 4 * i);
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t t1 = hh + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            hh = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+        h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+    }
+
+    Sha256() {
+        static const uint32_t initial[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                            0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        std::memcpy(state, initial, sizeof(state));
+    }
+
+    // Resumes from a state saved after absorbing whole blocks
+    Sha256(const uint32_t saved[8], uint64_t absorbed) : length(absorbed) {
+        std::memcpy(state, saved, sizeof(state));
+    }
+
+    void update(const void *data, size_t size) {
+        const uint8_t *bytes = static_cast<const uint8_t*>(data);
+        length += size;
+        while (size > 0) {
+            size_t take = std::min(size, BlockSize - buffered);
+            std::memcpy(buffer + buffered, bytes, take);
+            buffered += take;
+            bytes += take;
+            size -= take;
+            if (buffered == BlockSize) {
+                compress(state, buffer);
+                buffered = 0;
+            }
+        }
+    }
+
+    void finish(uint8_t digest[DigestSize]) {
+        uint64_t bits = length * 8;
+        uint8_t padding[BlockSize + 8] = {0x80};
+        size_t padLength = (buffered < 56 ? 56 : 120) - buffered;
+        for (int i = 0; i < 8; ++i) padding[padLength + i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+        update(padding, padLength + 8);
+        for (int i = 0; i < 8; ++i) storeBigEndian(digest + 4 * i, state[i]);
+    }
+
+    const uint32_t *getState() const { return state; }
+};
+const size_t Sha256::DigestSize;
+const size_t Sha256::BlockSize;
+
+// HMAC-SHA256 under one key. The key's inner and outer pad blocks are
+// hashed once up front, so each message afterwards costs two compressions
+// fewer; PBKDF2 leans on this for every iteration.
+class HmacSha256 {
+private:
+    uint32_t inner[8];
+    uint32_t outer[8];
+
+public:
+    explicit HmacSha256(const std::string &key) {
+        uint8_t block[Sha256::BlockSize] = {0};
+        if (key.size() > Sha256::BlockSize) {
+            Sha256 shortened;
+            shortened.update(key.data(), key.size());
+            shortened.finish(block);
+        } else {
+            std::memcpy(block, key.data(), key.size());
+        }
+        uint8_t pad[Sha256::BlockSize];
+        for (size_t i = 0; i < Sha256::BlockSize; ++i) pad[i] = block[i] ^ 0x36;
+        Sha256 innerHash;
+        innerHash.update(pad, sizeof(pad));
+        std::memcpy(inner, innerHash.getState(), sizeof(inner));
+        for (size_t i = 0; i < Sha256::BlockSize; ++i) pad[i] = block[i] ^ 0x5c;
+        Sha256 outerHash;
+        outerHash.update(pad, sizeof(pad));
+        std::memcpy(outer, outerHash.getState(), sizeof(outer));
+    }
+
+    void mac(const void *data, size_t size, uint8_t out[Sha256::DigestSize]) const {
+        Sha256 innerHash(inner, Sha256::BlockSize);
+        innerHash.update(data, size);
+        uint8_t innerDigest[Sha256::DigestSize];
+        innerHash.finish(innerDigest);
+        Sha256 outerHash(outer, Sha256::BlockSize);
+        outerHash.update(innerDigest, sizeof(innerDigest));
+        outerHash.finish(out);
+    }
+
+    // mac() of a 32-byte message, in exactly two compressions: the message
+    // and its padding fill one block whose layout never changes
+    void macDigest(const uint8_t in[Sha256::DigestSize], uint8_t out[Sha256::DigestSize]) const {
+        uint8_t block[Sha256::BlockSize] = {0};
+        block[Sha256::DigestSize] = 0x80;
+        block[62] = 0x03; // Message length: (64 + 32) * 8 = 768 bits
+        std::memcpy(block, in, Sha256::DigestSize);
+        uint32_t h[8];
+        std::memcpy(h, inner, sizeof(h));
+        Sha256::compress(h, block);
+        for (int i = 0; i < 8; ++i) Sha256::storeBigEndian(block + 4 * i, h[i]);
+        std::memcpy(h, outer, sizeof(h));
+        Sha256::compress(h, block);
+        for (int i = 0; i < 8; ++i) Sha256::storeBigEndian(out + 4 * i, h[i]);
+    }
+};
+
+// Stored passwords look like "pbkdf2-sha256$<iterations>$<salt>$<key>",
+// salt and key in hex: PBKDF2-HMAC-SHA256 (RFC 8018) with a 16-byte random
+// salt and a 32-byte derived key. The iteration count is the work factor.
+// It is kept with each hash, so raising it affects only passwords set
+// afterwards.
+const uint32_t DefaultPasswordIterations = 100000;
+const size_t PasswordSaltSize = 16;
+
+// One 32-byte PBKDF2 block, which is all a SHA-256-sized key needs
+inline void pbkdf2Sha256(const std::string &password, const std::string &salt, uint32_t iterations,
+                         uint8_t key[Sha256::DigestSize]) {
+    HmacSha256 hmac(password);
+    std::string first = salt;
+    first.append("\0\0\0\1", 4); // Block index 1, big-endian
+    uint8_t u[Sha256::DigestSize];
+    hmac.mac(first.data(), first.size(), u);
+    std::memcpy(key, u, sizeof(u));
+    for (uint32_t i = 1; i < iterations; ++i) {
+        hmac.macDigest(u, u);
+        for (size_t j = 0; j < sizeof(u); ++j) key[j] ^= u[j];
+    }
+}
+
+inline std::string toHex(const uint8_t *bytes, size_t size) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(size * 2);
+    for (size_t i = 0; i < size; ++i) {
+        hex.push_back(digits[bytes[i] >> 4]);
+        hex.push_back(digits[bytes[i] & 15]);
+    }
+    return hex;
+}
+
+inline bool fromHex(const std::string &hex, std::string &bytes) {
+    if (hex.size() % 2 != 0) return false;
+    bytes.clear();
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        int value = 0;
+        for (size_t j = i; j < i + 2; ++j) {
+            char c = hex[j];
+            int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+            if (digit < 0) return false;
+            value = value * 16 + digit;
+        }
+        bytes.push_back(static_cast<char>(value));
+    }
+    return true;
+}
+
+// Hashes a password under the given salt; see hashPassword for a fresh one
+inline std::string hashPasswordWithSalt(const std::string &password, const std::string &salt, uint32_t iterations) {
+    iterations = std::max<uint32_t>(iterations, 1);
+    uint8_t key[Sha256::DigestSize];
+    pbkdf2Sha256(password, salt, iterations, key);
+    return "pbkdf2-sha256$" + std::to_string(iterations) + "$" +
+           toHex(reinterpret_cast<const uint8_t*>(salt.data()), salt.size()) + "$" + toHex(key, sizeof(key));
+}
+
+inline std::string hashPassword(const std::string &password, uint32_t iterations = DefaultPasswordIterations) {
+    std::string salt(PasswordSaltSize, '\0');
+    if (::getrandom(&salt[0], salt.size(), 0) != static_cast<ssize_t>(salt.size())) {
+        throw std::runtime_error(std::string("Cannot generate a password salt: ") + std::strerror(errno));
+    }
+    return hashPasswordWithSalt(password, salt, iterations);
+}
+
+inline bool isPasswordHash(const std::string &stored) {
+    return stored.compare(0, 14, "pbkdf2-sha256$") == 0;
+}
+
+// Compares without stopping at the first difference, so the time taken
+// says nothing about how much of a guess was right
+inline bool constantTimeEquals(const std::string &a, const std::string &b) {
+    if (a.size() != b.size()) return false;
+    unsigned char difference = 0;
+    for (size_t i = 0; i < a.size(); ++i) difference |= static_cast<unsigned char>(a[i] ^ b[i]);
+    return difference == 0;
+}
+
+// Checks a password against a stored hash. Records written before hashing
+// existed hold the password itself and are compared as such until the
+// application rehashes them at startup. Malformed hashes never match.
+inline bool verifyPassword(const std::string &password, const std::string &stored) {
+    if (!isPasswordHash(stored)) return constantTimeEquals(password, stored);
+    size_t iterationsEnd = stored.find('$', 14);
+    size_t saltEnd = iterationsEnd == std::string::npos ? std::string::npos : stored.find('$', iterationsEnd + 1);
+    if (saltEnd == std::string::npos) return false;
+    std::string iterationsText = stored.substr(14, iterationsEnd - 14);
+    if (iterationsText.empty() || iterationsText.size() > 9 ||
+        iterationsText.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    std::string salt;
+    if (!fromHex(stored.substr(iterationsEnd + 1, saltEnd - iterationsEnd - 1), salt)) return false;
+    uint32_t iterations = static_cast<uint32_t>(std::stoul(iterationsText));
+    if (iterations == 0) return false;
+    return constantTimeEquals(hashPasswordWithSalt(password, salt, iterations), stored);
+}
+
+// ------------------------------
+// Entity Classes
+// ------------------------------
+
+class Patient {
+private:
+    int id;
+    std::string name;
+    int age;
+    std::string disease;
+    std::string contactNumber;
+    std::string address;
+    Symbol bloodGroup;
+    std::vector<int> medicationIds; // Store IDs of prescribed medications
+
+public:
+    Patient(int id, const std::string &name, int age, const std::string &disease,
+            const std::string &contactNumber = "", const std::string &address = "", 
+            const std::string &bloodGroup = "")
+        : id(id), name(name), age(age), disease(disease), 
+          contactNumber(contactNumber), address(address), bloodGroup(vocabularySymbol(Vocabulary::BloodGroup, bloodGroup)) {}
+
+    int getId() const { return id; }
+    const std::string &getName() const { return name; }
+    int getAge() const { return age; }
+    const std::string &getDisease() const { return disease; }
+    const std::string &getContactNumber() const { return contactNumber; }
+    const std::string &getAddress() const { return address; }
+    const std::string &getBloodGroup() const { return symbols().name(bloodGroup); }
+    Symbol getBloodGroupSymbol() const { return bloodGroup; }
+    const std::vector<int> &getMedicationIds() const { return medicationIds; }
+
+    void setName(const std::string &newName) { name = newName; }
+    void setAge(int newAge) { age = newAge; }
+    void setDisease(const std::string &newDisease) { disease = newDisease; }
+    void setContactNumber(const std::string &newNumber) { contactNumber = newNumber; }
+    void setAddress(const std::string &newAddress) { address = newAddress; }
+    void setBloodGroup(const std::string &newBloodGroup) {
+        bloodGroup = vocabularySymbol(Vocabulary::BloodGroup, newBloodGroup);
+    }
+    
+    void addMedicationId(int medicationId) {
+        medicationIds.push_back(medicationId);
+    }
+    
+    void removeMedicationId(int medicationId) {
+        medicationIds.erase(
+            std::remove(medicationIds.begin(), medicationIds.end(), medicationId),
+            medicationIds.end()
+        );
+    }
+
+    void display() const {
+        std::cout << "Patient ID: " << id << "\nName: " << name 
+                  << "\nAge: " << age << "\nDisease: " << disease;
+        if (!contactNumber.empty()) std::cout << "\nContact: " << contactNumber;
+        if (!address.empty()) std::cout << "\nAddress: " << address;
+        if (bloodGroup != SymbolTable::EmptySymbol) std::cout << "\nBlood Group: " << getBloodGroup();
+        std::cout << "\n";
+    }
+};
+
+class Doctor {
+private:
+    int id;
+    std::string name;
+    std::string specialization;
+    std::string contactNumber;
+    std::string email;
+    Money consultationFee;
+    bool isAvailable;
+
+public:
+    Doctor(int id, const std::string &name, const std::string &specialization,
+           const std::string &contactNumber = "", const std::string &email = "",
+           Money consultationFee = Money())
+        : id(id), name(name), specialization(specialization), 
+          contactNumber(contactNumber), email(email), 
+          consultationFee(consultationFee), isAvailable(true) {}
+
+    int getId() const { return id; }
+    const std::string &getName() const { return name; }
+    const std::string &getSpecialization() const { return specialization; }
+    const std::string &getContactNumber() const { return contactNumber; }
+    const std::string &getEmail() const { return email; }
+    Money getConsultationFee() const { return consultationFee; }
+    bool getAvailability() const { return isAvailable; }
+
+    void setName(const std::string &newName) { name = newName; }
+    void setSpecialization(const std::string &newSpec) { specialization = newSpec; }
+    void setContactNumber(const std::string &newContact) { contactNumber = newContact; }
+    void setEmail(const std::string &newEmail) { email = newEmail; }
+    void setConsultationFee(Money newFee) { consultationFee = newFee; }
+    void setAvailability(bool availability) { isAvailable = availability; }
+
+    void display() const {
+        std::cout << "Doctor ID: " << id << "\nName: " << name 
+                  << "\nSpecialization: " << getSpecialization();
+        if (!contactNumber.empty()) std::cout << "\nContact: " << contactNumber;
+        if (!email.empty()) std::cout << "\nEmail: " << email;
+        std::cout << "\nConsultation Fee: $" << consultationFee;
+        std::cout << "\nAvailability: " << (isAvailable ? "Available" : "Not Available");
+        std::cout << "\n";
+    }
+};
+
+// Enhanced appointment with time slots
+class Appointment {
+private:
+    int appointmentId;
+    int patientId;
+    int doctorId;
+    int day;  // Day number (see parseDayNumber); shown as YYYY-MM-DD
+    int slot; // Index into TimeSlots, or -1
+    Symbol status; // Scheduled, Completed, Cancelled
+    std::string notes;
+
+public:
+    Appointment(int appointmentId, int patientId, int doctorId, int day, int slot,
+                const std::string &status = "Scheduled", const std::string &notes = "")
+        : appointmentId(appointmentId), patientId(patientId), doctorId(doctorId), 
+          day(day), slot(slot), status(vocabularySymbol(Vocabulary::AppointmentStatus, status)), notes(notes) {}
+
+    Appointment(int appointmentId, int patientId, int doctorId, 
+                const std::string &date, const std::string &timeSlot = "09:00-09:30",
+                const std::string &status = "Scheduled", const std::string &notes = "")
+        : Appointment(appointmentId, patientId, doctorId, parseDayNumber(date),
+                      timeSlotIndex(timeSlot), status, notes) {}
+
+    int getAppointmentId() const { return appointmentId; }
+    int getPatientId() const { return patientId; }
+    int getDoctorId() const { return doctorId; }
+    std::string getDate() const { return formatDayNumber(day); }
+    int getDay() const { return day; }
+    const std::string &getTimeSlot() const { return timeSlotLabel(slot); }
+    int getSlot() const { return slot; }
+    const std::string &getStatus() const { return symbols().name(status); }
+    Symbol getStatusSymbol() const { return status; }
+    const std::string &getNotes() const { return notes; }
+
+    void setDate(const std::string &newDate) { day = parseDayNumber(newDate); }
+    void setTimeSlot(const std::string &newTimeSlot) { slot = timeSlotIndex(newTimeSlot); }
+    void setStatus(const std::string &newStatus) { status = vocabularySymbol(Vocabulary::AppointmentStatus, newStatus); }
+    void setNotes(const std::string &newNotes) { notes = newNotes; }
+
+    void display() const {
+        std::cout << "Appointment ID: " << appointmentId 
+                  << "\nPatient ID: " << patientId 
+                  << "\nDoctor ID: " << doctorId 
+                  << "\nDate: " << getDate()
+                  << "\nTime Slot: " << getTimeSlot()
+                  << "\nStatus: " << getStatus();
+        if (!notes.empty()) std::cout << "\nNotes: " << notes;
+        std::cout << "\n";
+    }
+};
+
+// New class for medications
+class Medication {
+private:
+    int medicationId;
+    std::string name;
+    std::string dosage;
+    Money price;
+    std::string manufacturer;
+    std::string description;
+
+public:
+    Medication(int medicationId, const std::string &name, const std::string &dosage,
+               Money price, const std::string &manufacturer = "", const std::string &description = "")
+        : medicationId(medicationId), name(name), dosage(dosage), 
+          price(price), manufacturer(manufacturer), description(description) {}
+          
+    int getMedicationId() const { return medicationId; }
+    const std::string &getName() const { return name; }
+    const std::string &getDosage() const { return dosage; }
+    Money getPrice() const { return price; }
+    const std::string &getManufacturer() const { return manufacturer; }
+    const std::string &getDescription() const { return description; }
+    
+    void setName(const std::string &newName) { name = newName; }
+    void setDosage(const std::string &newDosage) { dosage = newDosage; }
+    void setPrice(Money newPrice) { price = newPrice; }
     void setManufacturer(const std::string &newManufacturer) { manufacturer = newManufacturer; }
     void setDescription(const std::string &newDescription) { description = newDescription; }
     
@@ -297,22 +1282,27 @@ private:
     int prescriptionId;
     int patientId;
     int doctorId;
-    std::string date;
+    int day; // Day number (see parseDayNumber)
     std::vector<int> medicationIds;
     std::string instructions;
 
 public:
-    Prescription(int prescriptionId, int patientId, int doctorId, const std::string &date,
+    Prescription(int prescriptionId, int patientId, int doctorId, int day,
                  const std::vector<int> &medicationIds = {}, const std::string &instructions = "")
         : prescriptionId(prescriptionId), patientId(patientId), doctorId(doctorId),
-          date(date), medicationIds(medicationIds), instructions(instructions) {}
+          day(day), medicationIds(medicationIds), instructions(instructions) {}
+
+    Prescription(int prescriptionId, int patientId, int doctorId, const std::string &date,
+                 const std::vector<int> &medicationIds = {}, const std::string &instructions = "")
+        : Prescription(prescriptionId, patientId, doctorId, parseDayNumber(date), medicationIds, instructions) {}
           
     int getPrescriptionId() const { return prescriptionId; }
     int getPatientId() const { return patientId; }
     int getDoctorId() const { return doctorId; }
-    std::string getDate() const { return date; }
-    std::vector<int> getMedicationIds() const { return medicationIds; }
-    std::string getInstructions() const { return instructions; }
+    std::string getDate() const { return formatDayNumber(day); }
+    int getDay() const { return day; }
+    const std::vector<int> &getMedicationIds() const { return medicationIds; }
+    const std::string &getInstructions() const { return instructions; }
     
     void addMedicationId(int medicationId) {
         medicationIds.push_back(medicationId);
@@ -325,13 +1315,14 @@ public:
         );
     }
     
+    void setMedicationIds(const std::vector<int> &newMedicationIds) { medicationIds = newMedicationIds; }
     void setInstructions(const std::string &newInstructions) { instructions = newInstructions; }
     
     void display() const {
         std::cout << "Prescription ID: " << prescriptionId
                   << "\nPatient ID: " << patientId
                   << "\nDoctor ID: " << doctorId
-                  << "\nDate: " << date
+                  << "\nDate: " << getDate()
                   << "\nMedication IDs: ";
         if (medicationIds.empty()) {
             std::cout << "None";
@@ -351,52 +1342,66 @@ class Bill {
 private:
     int billId;
     int patientId;
-    std::string date;
-    double consultationFee;
-    double medicationCharges;
-    double otherCharges;
-    std::string paymentStatus; // "Paid", "Pending", "Overdue"
-    std::string paymentMethod; // "Cash", "Card", "Insurance"
+    int day; // Day number (see parseDayNumber)
+    Money consultationFee;
+    Money medicationCharges;
+    Money otherCharges;
+    Symbol paymentStatus; // "Paid", "Pending", "Overdue"
+    Symbol paymentMethod; // "Cash", "Card", "Insurance"
 
 public:
-    Bill(int billId, int patientId, const std::string &date,
-         double consultationFee = 0.0, double medicationCharges = 0.0,
-         double otherCharges = 0.0, const std::string &paymentStatus = "Pending",
+    Bill(int billId, int patientId, int day,
+         Money consultationFee = Money(), Money medicationCharges = Money(),
+         Money otherCharges = Money(), const std::string &paymentStatus = "Pending",
          const std::string &paymentMethod = "")
-        : billId(billId), patientId(patientId), date(date),
+        : billId(billId), patientId(patientId), day(day),
           consultationFee(consultationFee), medicationCharges(medicationCharges),
-          otherCharges(otherCharges), paymentStatus(paymentStatus),
-          paymentMethod(paymentMethod) {}
+          otherCharges(otherCharges), paymentStatus(vocabularySymbol(Vocabulary::PaymentStatus, paymentStatus)),
+          paymentMethod(vocabularySymbol(Vocabulary::PaymentMethod, paymentMethod)) {}
+
+    Bill(int billId, int patientId, const std::string &date,
+         Money consultationFee = Money(), Money medicationCharges = Money(),
+         Money otherCharges = Money(), const std::string &paymentStatus = "Pending",
+         const std::string &paymentMethod = "")
+        : Bill(billId, patientId, parseDayNumber(date), consultationFee, medicationCharges,
+               otherCharges, paymentStatus, paymentMethod) {}
           
     int getBillId() const { return billId; }
     int getPatientId() const { return patientId; }
-    std::string getDate() const { return date; }
-    double getConsultationFee() const { return consultationFee; }
-    double getMedicationCharges() const { return medicationCharges; }
-    double getOtherCharges() const { return otherCharges; }
-    std::string getPaymentStatus() const { return paymentStatus; }
-    std::string getPaymentMethod() const { return paymentMethod; }
-    
-    double getTotalAmount() const {
+    std::string getDate() const { return formatDayNumber(day); }
+    int getDay() const { return day; }
+    Money getConsultationFee() const { return consultationFee; }
+    Money getMedicationCharges() const { return medicationCharges; }
+    Money getOtherCharges() const { return otherCharges; }
+    const std::string &getPaymentStatus() const { return symbols().name(paymentStatus); }
+    const std::string &getPaymentMethod() const { return symbols().name(paymentMethod); }
+    Symbol getPaymentStatusSymbol() const { return paymentStatus; }
+    Symbol getPaymentMethodSymbol() const { return paymentMethod; }
+    
+    Money getTotalAmount() const {
         return consultationFee + medicationCharges + otherCharges;
     }
     
-    void setConsultationFee(double fee) { consultationFee = fee; }
-    void setMedicationCharges(double charges) { medicationCharges = charges; }
-    void setOtherCharges(double charges) { otherCharges = charges; }
-    void setPaymentStatus(const std::string &status) { paymentStatus = status; }
-    void setPaymentMethod(const std::string &method) { paymentMethod = method; }
+    void setConsultationFee(Money fee) { consultationFee = fee; }
+    void setMedicationCharges(Money charges) { medicationCharges = charges; }
+    void setOtherCharges(Money charges) { otherCharges = charges; }
+    void setPaymentStatus(const std::string &status) {
+        paymentStatus = vocabularySymbol(Vocabulary::PaymentStatus, status);
+    }
+    void setPaymentMethod(const std::string &method) {
+        paymentMethod = vocabularySymbol(Vocabulary::PaymentMethod, method);
+    }
     
     void display() const {
         std::cout << "Bill ID: " << billId
                   << "\nPatient ID: " << patientId
-                  << "\nDate: " << date
+                  << "\nDate: " << getDate()
                   << "\nConsultation Fee: $" << consultationFee
                   << "\nMedication Charges: $" << medicationCharges
                   << "\nOther Charges: $" << otherCharges
                   << "\nTotal Amount: $" << getTotalAmount()
-                  << "\nPayment Status: " << paymentStatus;
-        if (!paymentMethod.empty()) std::cout << "\nPayment Method: " << paymentMethod;
+                  << "\nPayment Status: " << getPaymentStatus();
+        if (paymentMethod != SymbolTable::EmptySymbol) std::cout << "\nPayment Method: " << getPaymentMethod();
         std::cout << "\n";
     }
 };
@@ -406,1789 +1411,7181 @@ class User {
 private:
     int userId;
     std::string username;
-    std::string passwordHash; // In a real system, you'd store a hashed password
-    std::string role; // "Admin", "Doctor", "Receptionist", etc.
+    std::string passwordHash; // See hashPassword
+    Symbol role; // "Admin", "Doctor", "Receptionist", etc.
     bool isActive;
 
 public:
     User(int userId, const std::string &username, const std::string &passwordHash,
          const std::string &role, bool isActive = true)
         : userId(userId), username(username), passwordHash(passwordHash),
-          role(role), isActive(isActive) {}
+          role(vocabularySymbol(Vocabulary::Role, role)), isActive(isActive) {}
           
     int getUserId() const { return userId; }
-    std::string getUsername() const { return username; }
-    std::string getRole() const { return role; }
+    const std::string &getUsername() const { return username; }
+    const std::string &getPasswordHash() const { return passwordHash; }
+    const std::string &getRole() const { return symbols().name(role); }
+    Symbol getRoleSymbol() const { return role; }
     bool getIsActive() const { return isActive; }
     
     void setUsername(const std::string &newUsername) { username = newUsername; }
     void setPasswordHash(const std::string &newHash) { passwordHash = newHash; }
-    void setRole(const std::string &newRole) { role = newRole; }
+    void setRole(const std::string &newRole) { role = vocabularySymbol(Vocabulary::Role, newRole); }
     void setIsActive(bool active) { isActive = active; }
     
     bool checkPassword(const std::string &passwordToCheck) const {
-        // In a real system, you'd hash the input password and compare with stored hash
-        return passwordToCheck == passwordHash;
+        return verifyPassword(passwordToCheck, passwordHash);
     }
     
     void display() const {
         std::cout << "User ID: " << userId
                   << "\nUsername: " << username
-                  << "\nRole: " << role
+                  << "\nRole: " << getRole()
                   << "\nStatus: " << (isActive ? "Active" : "Inactive")
                   << "\n";
     }
 };
 
+// Usernames are matched without regard to ASCII case, so "Admin" and
+// "admin" name the same account; the name is stored as it was typed.
+inline unsigned char foldUsernameChar(char c) {
+    unsigned char u = static_cast<unsigned char>(c);
+    return u >= 'A' && u <= 'Z' ? static_cast<unsigned char>(u + ('a' - 'A')) : u;
+}
+
+inline bool sameUsername(const std::string &a, const std::string &b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (foldUsernameChar(a[i]) != foldUsernameChar(b[i])) return false;
+    }
+    return true;
+}
+
+// 64-bit hash of a username, case folded as sameUsername compares. The
+// bits are well mixed, so any slice of them can pick a bucket.
+inline uint64_t usernameHash(const std::string &username) {
+    uint64_t hash = 14695981039346656037ull; // FNV-1a
+    for (char c : username) {
+        hash ^= foldUsernameChar(c);
+        hash *= 1099511628211ull;
+    }
+    hash ^= hash >> 33; // Finalizer from MurmurHash3
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
 // ------------------------------
-// Repository Interfaces (Abstraction)
+// Binary Serialization
 // ------------------------------
 
-// Base repository interface with common operations (ISP)
-template <typename T, typename IdType = int>
-class IRepository {
-public:
-    virtual ~IRepository() {}
-    virtual void add(const T &item) = 0;
-    virtual bool remove(IdType id) = 0;
-    virtual T* getById(IdType id) = 0;
-    virtual std::vector<T> getAll() const = 0;
-};
+// Appends fixed-width little-endian values and length-prefixed strings
+class BinaryWriter {
+private:
+    std::string &buffer;
 
-// Patient-specific repository interface (ISP)
-class IPatientRepository : public IRepository<Patient> {
-public:
-    virtual std::vector<Patient> findByDisease(const std::string &disease) const = 0;
-    virtual std::vector<Patient> findByAgeRange(int minAge, int maxAge) const = 0;
-};
+    template <typename V>
+    void writeRaw(V value) {
+        char bytes[sizeof(V)];
+        std::memcpy(bytes, &value, sizeof(V));
+        buffer.append(bytes, sizeof(V));
+    }
 
-// Doctor-specific repository interface (ISP)
-class IDoctorRepository : public IRepository<Doctor> {
 public:
-    virtual std::vector<Doctor> findBySpecialization(const std::string &specialization) const = 0;
-    virtual std::vector<Doctor> findAvailableDoctors() const = 0;
-};
+    explicit BinaryWriter(std::string &out) : buffer(out) {}
 
-// Appointment-specific repository interface (ISP)
-class IAppointmentRepository : public IRepository<Appointment> {
-public:
-    virtual std::vector<Appointment> findByPatientId(int patientId) const = 0;
-    virtual std::vector<Appointment> findByDoctorId(int doctorId) const = 0;
-    virtual std::vector<Appointment> findByDate(const std::string &date) const = 0;
-    virtual std::vector<Appointment> findByStatus(const std::string &status) const = 0;
-};
-
-// Medication repository interface (ISP)
-class IMedicationRepository : public IRepository<Medication> {
-public:
-    virtual Medication* findByName(const std::string &name) = 0;
-};
+    void writeUInt8(uint8_t value) { writeRaw(value); }
+    void writeUInt32(uint32_t value) { writeRaw(value); }
+    void writeInt32(int32_t value) { writeRaw(value); }
+    void writeInt64(int64_t value) { writeRaw(value); }
+    void writeDouble(double value) { writeRaw(value); }
+    void writeMoney(Money value) { writeInt64(value.getCents()); }
+    void writeBool(bool value) { writeUInt8(value ? 1 : 0); }
 
-// Prescription repository interface (ISP)
-class IPrescriptionRepository : public IRepository<Prescription> {
-public:
-    virtual std::vector<Prescription> findByPatientId(int patientId) const = 0;
-    virtual std::vector<Prescription> findByDoctorId(int doctorId) const = 0;
-};
+    void writeString(const std::string &value) {
+        writeUInt32(static_cast<uint32_t>(value.size()));
+        buffer.append(value);
+    }
 
-// Bill repository interface (ISP)
-class IBillRepository : public IRepository<Bill> {
-public:
-    virtual std::vector<Bill> findByPatientId(int patientId) const = 0;
-    virtual std::vector<Bill> findByPaymentStatus(const std::string &status) const = 0;
-    virtual double getTotalRevenue() const = 0;
+    void writeIntList(const std::vector<int> &values) {
+        writeUInt32(static_cast<uint32_t>(values.size()));
+        for (int value : values) writeInt32(value);
+    }
 };
 
-// User repository interface (ISP)
-class IUserRepository : public IRepository<User> {
-public:
-    virtual User* findByUsername(const std::string &username) = 0;
-    virtual std::vector<User> findByRole(const std::string &role) const = 0;
-};
+// Reads values written by BinaryWriter; throws std::runtime_error on truncation
+class BinaryReader {
+private:
+    const char *cursor;
+    const char *end;
 
-// ------------------------------
-// In-Memory Repository Implementations
-// ------------------------------
+    template <typename V>
+    V readRaw() {
+        if (static_cast<size_t>(end - cursor) < sizeof(V)) {
+            throw std::runtime_error("Truncated binary record");
+        }
+        V value;
+        std::memcpy(&value, cursor, sizeof(V));
+        cursor += sizeof(V);
+        return value;
+    }
 
-class InMemoryPatientRepository : public IPatientRepository {
-private:
-    std::vector<Patient> patients;
 public:
-    void add(const Patient &patient) override {
-        patients.push_back(patient);
-    }
+    BinaryReader(const char *data, size_t size) : cursor(data), end(data + size) {}
 
-    bool remove(int id) override {
-        auto it = std::remove_if(patients.begin(), patients.end(),
-            [id](const Patient &p){ return p.getId() == id; });
-        if (it != patients.end()) {
-            patients.erase(it, patients.end());
-            return true;
+    uint8_t readUInt8() { return readRaw<uint8_t>(); }
+    uint32_t readUInt32() { return readRaw<uint32_t>(); }
+    int32_t readInt32() { return readRaw<int32_t>(); }
+    int64_t readInt64() { return readRaw<int64_t>(); }
+    double readDouble() { return readRaw<double>(); }
+    Money readMoney() { return Money::fromCents(readInt64()); }
+    bool readBool() { return readUInt8() != 0; }
+
+    std::string readString() {
+        uint32_t size = readUInt32();
+        if (static_cast<size_t>(end - cursor) < size) {
+            throw std::runtime_error("Truncated binary record");
         }
-        return false;
+        std::string value(cursor, size);
+        cursor += size;
+        return value;
     }
 
-    Patient* getById(int id) override {
-        for (auto &p : patients)
-            if (p.getId() == id)
-                return &p;
-        return nullptr;
+    std::vector<int> readIntList() {
+        uint32_t count = readUInt32();
+        std::vector<int> values;
+        values.reserve(std::min<size_t>(count, static_cast<size_t>(end - cursor) / sizeof(int32_t)));
+        for (uint32_t i = 0; i < count; ++i) values.push_back(readInt32());
+        return values;
     }
 
-    std::vector<Patient> getAll() const override {
-        return patients;
-    }
+    size_t remaining() const { return static_cast<size_t>(end - cursor); }
+};
 
-    std::vector<Patient> findByDisease(const std::string &disease) const override {
-        std::vector<Patient> result;
-        for (const auto &p : patients) {
-            if (p.getDisease() == disease) {
-                result.push_back(p);
-            }
+// CRC-32 (IEEE polynomial) used to detect torn or corrupt records. Uses the
+// slicing-by-8 table method so large snapshots verify at memory speed.
+inline uint32_t crc32(const char *data, size_t size, uint32_t crc = 0) {
+    static const std::vector<uint32_t> table = [] {
+        std::vector<uint32_t> t(8 * 256);
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
         }
-        return result;
-    }
-
-    std::vector<Patient> findByAgeRange(int minAge, int maxAge) const override {
-        std::vector<Patient> result;
-        for (const auto &p : patients) {
-            if (p.getAge() >= minAge && p.getAge() <= maxAge) {
-                result.push_back(p);
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int slice = 1; slice < 8; ++slice) {
+                uint32_t prev = t[(slice - 1) * 256 + i];
+                t[slice * 256 + i] = (prev >> 8) ^ t[prev & 0xFF];
             }
         }
-        return result;
+        return t;
+    }();
+    const uint32_t *t = table.data();
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(data);
+    crc = ~crc;
+    while (size >= 8) {
+        uint32_t low, high;
+        std::memcpy(&low, bytes, 4);
+        std::memcpy(&high, bytes + 4, 4);
+        low ^= crc;
+        crc = t[7 * 256 + (low & 0xFF)] ^ t[6 * 256 + ((low >> 8) & 0xFF)] ^
+              t[5 * 256 + ((low >> 16) & 0xFF)] ^ t[4 * 256 + (low >> 24)] ^
+              t[3 * 256 + (high & 0xFF)] ^ t[2 * 256 + ((high >> 8) & 0xFF)] ^
+              t[1 * 256 + ((high >> 16) & 0xFF)] ^ t[high >> 24];
+        bytes += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = t[(crc ^ *bytes++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// Identifies which repository a persisted record belongs to
+enum class EntityKind : uint8_t {
+    Patient = 1, Doctor, Appointment, Medication, Prescription, Bill, User
+};
+
+// Per-entity binary encoding used by the write-ahead log
+template <typename T> struct EntityCodec;
+
+template <> struct EntityCodec<Patient> {
+    static const EntityKind kind = EntityKind::Patient;
+    static int id(const Patient &p) { return p.getId(); }
+    static void encode(BinaryWriter &out, const Patient &p) {
+        out.writeInt32(p.getId());
+        out.writeString(p.getName());
+        out.writeInt32(p.getAge());
+        out.writeString(p.getDisease());
+        out.writeString(p.getContactNumber());
+        out.writeString(p.getAddress());
+        out.writeString(p.getBloodGroup());
+        out.writeIntList(p.getMedicationIds());
+    }
+    static Patient decode(BinaryReader &in) {
+        int id = in.readInt32();
+        std::string name = in.readString();
+        int age = in.readInt32();
+        std::string disease = in.readString();
+        std::string contact = in.readString();
+        std::string address = in.readString();
+        std::string bloodGroup = in.readString();
+        Patient p(id, name, age, disease, contact, address, bloodGroup);
+        for (int medId : in.readIntList()) p.addMedicationId(medId);
+        return p;
     }
 };
 
-class InMemoryDoctorRepository : public IDoctorRepository {
-private:
-    std::vector<Doctor> doctors;
-public:
-    void add(const Doctor &doctor) override {
-        doctors.push_back(doctor);
+template <> struct EntityCodec<Doctor> {
+    static const EntityKind kind = EntityKind::Doctor;
+    static int id(const Doctor &d) { return d.getId(); }
+    static void encode(BinaryWriter &out, const Doctor &d) {
+        out.writeInt32(d.getId());
+        out.writeString(d.getName());
+        out.writeString(d.getSpecialization());
+        out.writeString(d.getContactNumber());
+        out.writeString(d.getEmail());
+        out.writeMoney(d.getConsultationFee());
+        out.writeBool(d.getAvailability());
+    }
+    static Doctor decode(BinaryReader &in) {
+        int id = in.readInt32();
+        std::string name = in.readString();
+        std::string specialization = in.readString();
+        std::string contact = in.readString();
+        std::string email = in.readString();
+        Money fee = in.readMoney();
+        Doctor d(id, name, specialization, contact, email, fee);
+        d.setAvailability(in.readBool());
+        return d;
     }
+};
 
-    bool remove(int id) override {
-        auto it = std::remove_if(doctors.begin(), doctors.end(),
-            [id](const Doctor &d){ return d.getId() == id; });
-        if (it != doctors.end()) {
-            doctors.erase(it, doctors.end());
-            return true;
-        }
-        return false;
+template <> struct EntityCodec<Appointment> {
+    static const EntityKind kind = EntityKind::Appointment;
+    static int id(const Appointment &a) { return a.getAppointmentId(); }
+    static void encode(BinaryWriter &out, const Appointment &a) {
+        out.writeInt32(a.getAppointmentId());
+        out.writeInt32(a.getPatientId());
+        out.writeInt32(a.getDoctorId());
+        out.writeInt32(a.getDay());
+        out.writeInt32(a.getSlot());
+        out.writeString(a.getStatus());
+        out.writeString(a.getNotes());
+    }
+    static Appointment decode(BinaryReader &in) {
+        int id = in.readInt32();
+        int patientId = in.readInt32();
+        int doctorId = in.readInt32();
+        int day = in.readInt32();
+        int slot = in.readInt32();
+        std::string status = in.readString();
+        std::string notes = in.readString();
+        return Appointment(id, patientId, doctorId, day, slot, status, notes);
     }
+};
 
-    Doctor* getById(int id) override {
-        for (auto &d : doctors)
-            if (d.getId() == id)
-                return &d;
-        return nullptr;
+template <> struct EntityCodec<Medication> {
+    static const EntityKind kind = EntityKind::Medication;
+    static int id(const Medication &m) { return m.getMedicationId(); }
+    static void encode(BinaryWriter &out, const Medication &m) {
+        out.writeInt32(m.getMedicationId());
+        out.writeString(m.getName());
+        out.writeString(m.getDosage());
+        out.writeMoney(m.getPrice());
+        out.writeString(m.getManufacturer());
+        out.writeString(m.getDescription());
+    }
+    static Medication decode(BinaryReader &in) {
+        int id = in.readInt32();
+        std::string name = in.readString();
+        std::string dosage = in.readString();
+        Money price = in.readMoney();
+        std::string manufacturer = in.readString();
+        std::string description = in.readString();
+        return Medication(id, name, dosage, price, manufacturer, description);
     }
+};
 
-    std::vector<Doctor> getAll() const override {
-        return doctors;
+template <> struct EntityCodec<Prescription> {
+    static const EntityKind kind = EntityKind::Prescription;
+    static int id(const Prescription &p) { return p.getPrescriptionId(); }
+    static void encode(BinaryWriter &out, const Prescription &p) {
+        out.writeInt32(p.getPrescriptionId());
+        out.writeInt32(p.getPatientId());
+        out.writeInt32(p.getDoctorId());
+        out.writeInt32(p.getDay());
+        out.writeIntList(p.getMedicationIds());
+        out.writeString(p.getInstructions());
+    }
+    static Prescription decode(BinaryReader &in) {
+        int id = in.readInt32();
+        int patientId = in.readInt32();
+        int doctorId = in.readInt32();
+        int day = in.readInt32();
+        std::vector<int> medicationIds = in.readIntList();
+        std::string instructions = in.readString();
+        return Prescription(id, patientId, doctorId, day, medicationIds, instructions);
     }
+};
 
-    std::vector<Doctor> findBySpecialization(const std::string &specialization) const override {
-        std::vector<Doctor> result;
-        for (const auto &d : doctors) {
-            if (d.getSpecialization() == specialization) {
-                result.push_back(d);
-            }
-        }
-        return result;
+template <> struct EntityCodec<Bill> {
+    static const EntityKind kind = EntityKind::Bill;
+    static int id(const Bill &b) { return b.getBillId(); }
+    static void encode(BinaryWriter &out, const Bill &b) {
+        out.writeInt32(b.getBillId());
+        out.writeInt32(b.getPatientId());
+        out.writeInt32(b.getDay());
+        out.writeMoney(b.getConsultationFee());
+        out.writeMoney(b.getMedicationCharges());
+        out.writeMoney(b.getOtherCharges());
+        out.writeString(b.getPaymentStatus());
+        out.writeString(b.getPaymentMethod());
+    }
+    static Bill decode(BinaryReader &in) {
+        int id = in.readInt32();
+        int patientId = in.readInt32();
+        int day = in.readInt32();
+        Money consultationFee = in.readMoney();
+        Money medicationCharges = in.readMoney();
+        Money otherCharges = in.readMoney();
+        std::string status = in.readString();
+        std::string method = in.readString();
+        return Bill(id, patientId, day, consultationFee, medicationCharges, otherCharges, status, method);
     }
+};
 
-    std::vector<Doctor> findAvailableDoctors() const override {
-        std::vector<Doctor> result;
-        for (const auto &d : doctors) {
-            if (d.getAvailability()) {
-                result.push_back(d);
-            }
-        }
-        return result;
+template <> struct EntityCodec<User> {
+    static const EntityKind kind = EntityKind::User;
+    static int id(const User &u) { return u.getUserId(); }
+    static void encode(BinaryWriter &out, const User &u) {
+        out.writeInt32(u.getUserId());
+        out.writeString(u.getUsername());
+        out.writeString(u.getPasswordHash());
+        out.writeString(u.getRole());
+        out.writeBool(u.getIsActive());
+    }
+    static User decode(BinaryReader &in) {
+        int id = in.readInt32();
+        std::string username = in.readString();
+        std::string passwordHash = in.readString();
+        std::string role = in.readString();
+        bool active = in.readBool();
+        return User(id, username, passwordHash, role, active);
     }
 };
 
-class InMemoryAppointmentRepository : public IAppointmentRepository {
-private:
-    std::vector<Appointment> appointments;
+// Receives every mutation a repository applies (DIP: repositories do not
+// know whether, or how, their changes are persisted)
+class IJournal {
 public:
-    void add(const Appointment &appt) override {
-        appointments.push_back(appt);
-    }
+    virtual ~IJournal() {}
+    virtual void recordPut(EntityKind kind, const std::string &payload) = 0;
+    virtual void recordRemove(EntityKind kind, int id) = 0;
+};
 
-    bool remove(int id) override {
-        auto it = std::remove_if(appointments.begin(), appointments.end(),
-            [id](const Appointment &a){ return a.getAppointmentId() == id; });
-        if (it != appointments.end()) {
-            appointments.erase(it, appointments.end());
-            return true;
-        }
-        return false;
-    }
+// ------------------------------
+// Repository Interfaces (Abstraction)
+// ------------------------------
 
-    Appointment* getById(int id) override {
-        for (auto &a : appointments)
-            if (a.getAppointmentId() == id)
-                return &a;
-        return nullptr;
-    }
+// Generational handle to an item in a repository. Unlike a raw pointer it
+// never dangles: once the item is removed the handle resolves to nullptr.
+struct SlotHandle {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
 
-    std::vector<Appointment> getAll() const override {
-        return appointments;
-    }
+    bool isNull() const { return index == UINT32_MAX; }
+};
 
-    std::vector<Appointment> findByPatientId(int patientId) const override {
-        std::vector<Appointment> result;
-        for (const auto &a : appointments) {
-            if (a.getPatientId() == patientId) {
-                result.push_back(a);
-            }
-        }
-        return result;
+// Base repository interface with common operations (ISP)
+template <typename T, typename IdType = int>
+class IRepository {
+public:
+    // Receives items by const reference; it must not modify the repository
+    typedef std::function<void(const T &)> Visitor;
+
+    virtual ~IRepository() {}
+    virtual void add(const T &item) = 0;
+    virtual bool remove(IdType id) = 0;
+    virtual T* getById(IdType id) = 0;
+    virtual std::vector<T> getAll() const = 0;
+
+    // Visits every item in place, without copying
+    virtual void forEach(const Visitor &visitor) const = 0;
+    // How many items are held, counted without visiting them
+    virtual size_t size() const = 0;
+    virtual SlotHandle getHandle(IdType id) const = 0;
+    virtual T* resolve(SlotHandle handle) = 0;
+
+    // Sends every subsequent add/remove/update to the journal
+    virtual void attachJournal(std::shared_ptr<IJournal> journal) = 0;
+
+    // Mutates an item in place. Repositories that keep derived indexes
+    // override this so the indexes see both the old and the new state, so
+    // callers should prefer it over writing through getById().
+    virtual bool update(IdType id, const std::function<void(T &)> &mutator) {
+        T* item = getById(id);
+        if (!item) return false;
+        mutator(*item);
+        return true;
     }
 
-    std::vector<Appointment> findByDoctorId(int doctorId) const override {
-        std::vector<Appointment> result;
-        for (const auto &a : appointments) {
-            if (a.getDoctorId() == doctorId) {
-                result.push_back(a);
-            }
-        }
-        return result;
+    // Runs a read-only callback against an item. Concurrent repositories hold
+    // the item's lock for the duration, which a pointer from getById() cannot.
+    virtual bool inspect(IdType id, const std::function<void(const T &)> &reader) {
+        T* item = getById(id);
+        if (!item) return false;
+        reader(*item);
+        return true;
     }
 
-    std::vector<Appointment> findByDate(const std::string &date) const override {
-        std::vector<Appointment> result;
-        for (const auto &a : appointments) {
-            if (a.getDate() == date) {
-                result.push_back(a);
-            }
-        }
-        return result;
+    // A copy of the item taken under its lock, or null; unlike a pointer from
+    // getById() it stays valid whatever other sessions do
+    std::unique_ptr<T> copyById(IdType id) {
+        std::unique_ptr<T> copy;
+        inspect(id, [&](const T &item) { copy.reset(new T(item)); });
+        return copy;
     }
 
-    std::vector<Appointment> findByStatus(const std::string &status) const override {
-        std::vector<Appointment> result;
-        for (const auto &a : appointments) {
-            if (a.getStatus() == status) {
-                result.push_back(a);
-            }
-        }
+protected:
+    // Copies whatever a visitor-based query yields; backs the find* methods
+    // that return vectors
+    template <typename Query>
+    static std::vector<T> collect(Query query) {
+        std::vector<T> result;
+        query([&](const T &item) { result.push_back(item); });
         return result;
     }
 };
 
-class InMemoryMedicationRepository : public IMedicationRepository {
-private:
-    std::vector<Medication> medications;
+// Patient-specific repository interface (ISP)
+class IPatientRepository : public IRepository<Patient> {
 public:
-    void add(const Medication &medication) override {
-        medications.push_back(medication);
-    }
+    virtual void forEachByDisease(const std::string &disease, const Visitor &visitor) const = 0;
+    // Visits patients in ascending age order
+    virtual void forEachInAgeRange(int minAge, int maxAge, const Visitor &visitor) const = 0;
+    virtual size_t countByAgeRange(int minAge, int maxAge) const = 0;
 
-    bool remove(int id) override {
-        auto it = std::remove_if(medications.begin(), medications.end(),
-            [id](const Medication &m){ return m.getMedicationId() == id; });
-        if (it != medications.end()) {
-            medications.erase(it, medications.end());
-            return true;
-        }
-        return false;
+    std::vector<Patient> findByDisease(const std::string &disease) const {
+        return collect([&](const Visitor &v) { forEachByDisease(disease, v); });
     }
-
-    Medication* getById(int id) override {
-        for (auto &m : medications)
-            if (m.getMedicationId() == id)
-                return &m;
-        return nullptr;
+    std::vector<Patient> findByAgeRange(int minAge, int maxAge) const {
+        return collect([&](const Visitor &v) { forEachInAgeRange(minAge, maxAge, v); });
     }
+};
 
-    std::vector<Medication> getAll() const override {
-        return medications;
-    }
+// Doctor-specific repository interface (ISP)
+class IDoctorRepository : public IRepository<Doctor> {
+public:
+    virtual void forEachBySpecialization(const std::string &specialization, const Visitor &visitor) const = 0;
+    virtual void forEachAvailable(const Visitor &visitor) const = 0;
 
-    Medication* findByName(const std::string &name) override {
-        for (auto &m : medications)
-            if (m.getName() == name)
-                return &m;
-        return nullptr;
+    std::vector<Doctor> findBySpecialization(const std::string &specialization) const {
+        return collect([&](const Visitor &v) { forEachBySpecialization(specialization, v); });
+    }
+    std::vector<Doctor> findAvailableDoctors() const {
+        return collect([&](const Visitor &v) { forEachAvailable(v); });
     }
 };
 
-class InMemoryPrescriptionRepository : public IPrescriptionRepository {
-private:
-    std::vector<Prescription> prescriptions;
+// Appointment-specific repository interface (ISP)
+class IAppointmentRepository : public IRepository<Appointment> {
 public:
-    void add(const Prescription &prescription) override {
-        prescriptions.push_back(prescription);
-    }
+    virtual void forEachByPatientId(int patientId, const Visitor &visitor) const = 0;
+    virtual void forEachByDoctorId(int doctorId, const Visitor &visitor) const = 0;
+    virtual void forEachByDate(const std::string &date, const Visitor &visitor) const = 0;
+    virtual void forEachByStatus(const std::string &status, const Visitor &visitor) const = 0;
+    virtual bool isSlotBooked(int doctorId, const std::string &date, const std::string &timeSlot) const = 0;
+    virtual std::vector<std::string> findFreeSlots(int doctorId, const std::string &date) const = 0;
+    // Adds the appointment only if its doctor's slot is still free, checking
+    // and booking as one step so two sessions cannot take the same slot
+    virtual bool addIfSlotFree(const Appointment &appt) = 0;
+    // Applies the change only if the appointment's new slot is free (its own
+    // slot counts as free), checking and booking as one step; false if the
+    // appointment is missing or the slot is taken. Plain update() and add()
+    // do not check, so log replay can restore any state.
+    virtual bool updateIfSlotFree(int id, const std::function<void(Appointment &)> &mutator) = 0;
+    // Visits appointments dated fromDay..toDay inclusive, by day then ID
+    virtual void forEachInDateRange(int fromDay, int toDay, const Visitor &visitor) const = 0;
+    // Removes every appointment dated before the given day, visiting each
+    // one before it goes; returns how many were removed
+    virtual size_t archiveDaysBefore(int day, const Visitor &archive) = 0;
 
-    bool remove(int id) override {
-        auto it = std::remove_if(prescriptions.begin(), prescriptions.end(),
-            [id](const Prescription &p){ return p.getPrescriptionId() == id; });
-        if (it != prescriptions.end()) {
-            prescriptions.erase(it, prescriptions.end());
-            return true;
-        }
-        return false;
+    std::vector<Appointment> findByPatientId(int patientId) const {
+        return collect([&](const Visitor &v) { forEachByPatientId(patientId, v); });
     }
-
-    Prescription* getById(int id) override {
-        for (auto &p : prescriptions)
-            if (p.getPrescriptionId() == id)
-                return &p;
-        return nullptr;
+    std::vector<Appointment> findByDoctorId(int doctorId) const {
+        return collect([&](const Visitor &v) { forEachByDoctorId(doctorId, v); });
+    }
+    std::vector<Appointment> findByDate(const std::string &date) const {
+        return collect([&](const Visitor &v) { forEachByDate(date, v); });
     }
+    std::vector<Appointment> findByStatus(const std::string &status) const {
+        return collect([&](const Visitor &v) { forEachByStatus(status, v); });
+    }
+    std::vector<Appointment> findByDateRange(int fromDay, int toDay) const {
+        return collect([&](const Visitor &v) { forEachInDateRange(fromDay, toDay, v); });
+    }
+};
+
+// Medication repository interface (ISP)
+class IMedicationRepository : public IRepository<Medication> {
+public:
+    virtual Medication* findByName(const std::string &name) = 0;
+    // Runs a read-only callback against the medication with this name,
+    // holding its lock in concurrent repositories; false if there is none
+    virtual bool inspectByName(const std::string &name, const std::function<void(const Medication &)> &reader) = 0;
+    // Adds the medication only if no other has its name, checking and
+    // adding as one step so two sessions cannot add the same name
+    virtual bool addIfNameFree(const Medication &medication) = 0;
+    // Applies the change only if the medication's new name is not held by
+    // another one, checking and storing as one step; false if the
+    // medication is missing or the name is taken
+    virtual bool updateIfNameFree(int id, const std::function<void(Medication &)> &mutator) = 0;
+};
+
+// Prescription repository interface (ISP)
+class IPrescriptionRepository : public IRepository<Prescription> {
+public:
+    virtual void forEachByPatientId(int patientId, const Visitor &visitor) const = 0;
+    virtual void forEachByDoctorId(int doctorId, const Visitor &visitor) const = 0;
 
-    std::vector<Prescription> getAll() const override {
-        return prescriptions;
+    std::vector<Prescription> findByPatientId(int patientId) const {
+        return collect([&](const Visitor &v) { forEachByPatientId(patientId, v); });
+    }
+    std::vector<Prescription> findByDoctorId(int doctorId) const {
+        return collect([&](const Visitor &v) { forEachByDoctorId(doctorId, v); });
     }
+};
 
-    std::vector<Prescription> findByPatientId(int patientId) const override {
-        std::vector<Prescription> result;
-        for (const auto &p : prescriptions) {
-            if (p.getPatientId() == patientId) {
-                result.push_back(p);
-            }
-        }
-        return result;
+// Number and total amount of a group of bills
+struct RevenueTotal {
+    size_t bills = 0;
+    Money amount;
+
+    RevenueTotal &operator+=(const RevenueTotal &other) {
+        bills += other.bills;
+        amount += other.amount;
+        return *this;
     }
+};
 
-    std::vector<Prescription> findByDoctorId(int doctorId) const override {
-        std::vector<Prescription> result;
-        for (const auto &p : prescriptions) {
-            if (p.getDoctorId() == doctorId) {
-                result.push_back(p);
-            }
-        }
-        return result;
+// Bill repository interface (ISP)
+class IBillRepository : public IRepository<Bill> {
+public:
+    virtual void forEachByPatientId(int patientId, const Visitor &visitor) const = 0;
+    virtual void forEachByPaymentStatus(const std::string &status, const Visitor &visitor) const = 0;
+    virtual Money getTotalRevenue() const = 0;
+    // Revenue totals are kept up to date as bills change, so these cost the
+    // same however many bills are held
+    virtual RevenueTotal getRevenueForPaymentStatus(const std::string &status) const = 0;
+    virtual std::map<std::string, RevenueTotal> getRevenueByPaymentStatus() const = 0;
+    virtual std::map<std::string, RevenueTotal> getRevenueByPaymentMethod() const = 0;
+    // Costs time proportional to the number of billed days in the range
+    virtual RevenueTotal getRevenueForDateRange(int fromDay, int toDay) const = 0;
+    // Scans over a columnar copy of the bills. An empty status matches
+    // every status. Aging bucket i holds bills aged ageBounds[i] up to
+    // ageBounds[i + 1] - 1 days as of asOfDay; the last bucket is open-ended.
+    virtual RevenueTotal getRevenueWhere(const std::string &status, int fromDay, int toDay) const = 0;
+    virtual std::vector<RevenueTotal> getAging(const std::string &status, int asOfDay,
+                                               const std::vector<int> &ageBounds) const = 0;
+    // Visits bills dated fromDay..toDay inclusive, by day then ID
+    virtual void forEachInDateRange(int fromDay, int toDay, const Visitor &visitor) const = 0;
+
+    std::vector<Bill> findByPatientId(int patientId) const {
+        return collect([&](const Visitor &v) { forEachByPatientId(patientId, v); });
+    }
+    std::vector<Bill> findByPaymentStatus(const std::string &status) const {
+        return collect([&](const Visitor &v) { forEachByPaymentStatus(status, v); });
+    }
+    std::vector<Bill> findByDateRange(int fromDay, int toDay) const {
+        return collect([&](const Visitor &v) { forEachInDateRange(fromDay, toDay, v); });
     }
 };
 
-class InMemoryBillRepository : public IBillRepository {
-private:
-    std::vector<Bill> bills;
+// User repository interface (ISP)
+class IUserRepository : public IRepository<User> {
 public:
-    void add(const Bill &bill) override {
-        bills.push_back(bill);
+    virtual User* findByUsername(const std::string &username) = 0;
+    // Runs a read-only callback against the user with this name, holding
+    // the user's lock in concurrent repositories; false if there is none
+    virtual bool inspectByUsername(const std::string &username, const std::function<void(const User &)> &reader) = 0;
+    // Adds the user only if no account has the name in any case, checking
+    // and adding as one step so two sessions cannot register it twice.
+    // Plain add() does not check, so log replay can restore any state.
+    virtual bool addIfUsernameFree(const User &user) = 0;
+    virtual void forEachByRole(const std::string &role, const Visitor &visitor) const = 0;
+
+    std::vector<User> findByRole(const std::string &role) const {
+        return collect([&](const Visitor &v) { forEachByRole(role, v); });
     }
+};
 
-    bool remove(int id) override {
-        auto it = std::remove_if(bills.begin(), bills.end(),
-            [id](const Bill &b){ return b.getBillId() == id; });
-        if (it != bills.end()) {
-            bills.erase(it, bills.end());
-            return true;
+// ------------------------------
+// Columnar Bill Store
+// ------------------------------
+
+// Read-only view of the bill columns: row i of each array is one bill
+struct BillColumnView {
+    const int32_t *days;
+    const int64_t *cents;
+    const uint32_t *statuses;
+    size_t count;
+};
+
+// Rows match when (status & mask) == value; a zero mask matches every status
+struct StatusSelect {
+    uint32_t mask;
+    uint32_t value;
+
+    static StatusSelect any() { return StatusSelect{0, 0}; }
+    static StatusSelect only(Symbol status) { return StatusSelect{~0u, status}; }
+};
+
+struct DayRange {
+    int32_t from, to; // Inclusive
+};
+
+struct ColumnTotal {
+    int64_t count;
+    int64_t cents;
+};
+
+// Filtered sums and counts over the bill columns: for each day range, the
+// number and total of the rows whose status matches and whose day falls in
+// it. One range gives a filtered sum; several give a histogram in one pass.
+// The scalar kernel is branch-free; the AVX2 kernel does four rows a step.
+inline void sumByDayRangesScalar(const BillColumnView &view, StatusSelect select,
+                                 const DayRange *ranges, size_t rangeCount, ColumnTotal *out) {
+    for (size_t r = 0; r < rangeCount; ++r) out[r] = ColumnTotal{0, 0};
+    for (size_t i = 0; i < view.count; ++i) {
+        bool statusMatches = (view.statuses[i] & select.mask) == select.value;
+        int32_t day = view.days[i];
+        for (size_t r = 0; r < rangeCount; ++r) {
+            int64_t hit = statusMatches & (day >= ranges[r].from) & (day <= ranges[r].to);
+            out[r].count += hit;
+            out[r].cents += view.cents[i] & -hit;
         }
-        return false;
     }
+}
 
-    Bill* getById(int id) override {
-        for (auto &b : bills)
-            if (b.getBillId() == id)
-                return &b;
-        return nullptr;
-    }
+#ifdef HMS_HAVE_AVX2
+const size_t MaxAvx2DayRanges = 8; // Accumulators kept in registers per call
 
-    std::vector<Bill> getAll() const override {
-        return bills;
+__attribute__((target("avx2")))
+inline void sumByDayRangesAvx2(const BillColumnView &view, StatusSelect select,
+                               const DayRange *ranges, size_t rangeCount, ColumnTotal *out) {
+    const __m128i statusMask = _mm_set1_epi32(static_cast<int>(select.mask));
+    const __m128i statusValue = _mm_set1_epi32(static_cast<int>(select.value));
+    __m128i from[MaxAvx2DayRanges], to[MaxAvx2DayRanges];
+    __m256i sums[MaxAvx2DayRanges], counts[MaxAvx2DayRanges];
+    for (size_t r = 0; r < rangeCount; ++r) {
+        from[r] = _mm_set1_epi32(ranges[r].from);
+        to[r] = _mm_set1_epi32(ranges[r].to);
+        sums[r] = _mm256_setzero_si256();
+        counts[r] = _mm256_setzero_si256();
     }
 
-    std::vector<Bill> findByPatientId(int patientId) const override {
-        std::vector<Bill> result;
-        for (const auto &b : bills) {
-            if (b.getPatientId() == patientId) {
-                result.push_back(b);
-            }
+    size_t i = 0;
+    for (; i + 4 <= view.count; i += 4) {
+        __m128i status = _mm_loadu_si128(reinterpret_cast<const __m128i*>(view.statuses + i));
+        __m128i day = _mm_loadu_si128(reinterpret_cast<const __m128i*>(view.days + i));
+        __m256i cents = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(view.cents + i));
+        __m128i statusMatches = _mm_cmpeq_epi32(_mm_and_si128(status, statusMask), statusValue);
+        for (size_t r = 0; r < rangeCount; ++r) {
+            __m128i outside = _mm_or_si128(_mm_cmpgt_epi32(from[r], day), _mm_cmpgt_epi32(day, to[r]));
+            __m256i hit = _mm256_cvtepi32_epi64(_mm_andnot_si128(outside, statusMatches));
+            sums[r] = _mm256_add_epi64(sums[r], _mm256_and_si256(hit, cents));
+            counts[r] = _mm256_sub_epi64(counts[r], hit); // hit lanes are -1
         }
-        return result;
     }
 
-    std::vector<Bill> findByPaymentStatus(const std::string &status) const override {
-        std::vector<Bill> result;
-        for (const auto &b : bills) {
-            if (b.getPaymentStatus() == status) {
-                result.push_back(b);
-            }
-        }
-        return result;
+    BillColumnView tail = {view.days + i, view.cents + i, view.statuses + i, view.count - i};
+    sumByDayRangesScalar(tail, select, ranges, rangeCount, out);
+    for (size_t r = 0; r < rangeCount; ++r) {
+        alignas(32) int64_t lanes[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), sums[r]);
+        out[r].cents += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), counts[r]);
+        out[r].count += lanes[0] + lanes[1] + lanes[2] + lanes[3];
     }
+}
 
-    double getTotalRevenue() const override {
-        double total = 0.0;
-        for (const auto &b : bills) {
-            total += b.getTotalAmount();
+inline bool cpuHasAvx2() {
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    return hasAvx2;
+}
+#endif
+
+// Runs the fastest kernel this CPU supports
+inline void sumByDayRanges(const BillColumnView &view, StatusSelect select,
+                           const DayRange *ranges, size_t rangeCount, ColumnTotal *out) {
+#ifdef HMS_HAVE_AVX2
+    if (cpuHasAvx2()) {
+        for (size_t r = 0; r < rangeCount; r += MaxAvx2DayRanges) {
+            sumByDayRangesAvx2(view, select, ranges + r, std::min(MaxAvx2DayRanges, rangeCount - r), out + r);
         }
-        return total;
+        return;
     }
-};
+#endif
+    sumByDayRangesScalar(view, select, ranges, rangeCount, out);
+}
+
+inline StatusSelect selectStatus(const std::string &status) {
+    return status.empty() ? StatusSelect::any() : StatusSelect::only(symbols().lookup(status));
+}
+
+// Day ranges for aging buckets; ages are counted back from asOfDay
+inline std::vector<DayRange> agingRanges(int asOfDay, const std::vector<int> &ageBounds) {
+    const int32_t earliest = InvalidDay + 1; // Bills without a valid date are never aged
+    std::vector<DayRange> ranges;
+    for (size_t i = 0; i < ageBounds.size(); ++i) {
+        int32_t newest = asOfDay - ageBounds[i];
+        int32_t oldest = i + 1 < ageBounds.size() ? asOfDay - ageBounds[i + 1] + 1 : earliest;
+        ranges.push_back(DayRange{oldest, newest});
+    }
+    return ranges;
+}
+
+inline RevenueTotal toRevenueTotal(const ColumnTotal &total) {
+    RevenueTotal result;
+    result.bills = static_cast<size_t>(total.count);
+    result.amount = Money::fromCents(total.cents);
+    return result;
+}
 
-class InMemoryUserRepository : public IUserRepository {
+// Struct-of-arrays copy of the fields finance queries scan: patient, day,
+// total amount and payment status, one array each. Rows are kept dense by
+// moving the last row into a removed one. Bill IDs are small positive
+// counters, so a row is found through a table indexed by ID.
+class BillColumns {
 private:
-    std::vector<User> users;
+    static const uint32_t NoRow = std::numeric_limits<uint32_t>::max();
+
+    std::vector<int32_t> patientIds;
+    std::vector<int32_t> days;
+    std::vector<int64_t> cents;
+    std::vector<uint32_t> statuses;
+    std::vector<int32_t> billIds;
+    std::vector<uint32_t> rowOfId;
+
+    uint32_t rowOf(int billId) const {
+        return billId >= 0 && static_cast<size_t>(billId) < rowOfId.size() ? rowOfId[billId] : NoRow;
+    }
+
 public:
-    void add(const User &user) override {
-        users.push_back(user);
+    void reserve(size_t rows) {
+        patientIds.reserve(rows);
+        days.reserve(rows);
+        cents.reserve(rows);
+        statuses.reserve(rows);
+        billIds.reserve(rows);
     }
 
-    bool remove(int id) override {
-        auto it = std::remove_if(users.begin(), users.end(),
-            [id](const User &u){ return u.getUserId() == id; });
-        if (it != users.end()) {
-            users.erase(it, users.end());
-            return true;
+    void upsert(const Bill &bill) {
+        int id = bill.getBillId();
+        if (id < 0) throw std::invalid_argument("Bill IDs must not be negative");
+        uint32_t row = rowOf(id);
+        if (row == NoRow) {
+            if (static_cast<size_t>(id) >= rowOfId.size()) {
+                rowOfId.resize(std::max<size_t>(id + 1, rowOfId.size() * 2), NoRow);
+            }
+            row = static_cast<uint32_t>(billIds.size());
+            rowOfId[id] = row;
+            patientIds.push_back(0);
+            days.push_back(0);
+            cents.push_back(0);
+            statuses.push_back(0);
+            billIds.push_back(id);
         }
-        return false;
+        patientIds[row] = bill.getPatientId();
+        days[row] = bill.getDay();
+        cents[row] = bill.getTotalAmount().getCents();
+        statuses[row] = bill.getPaymentStatusSymbol();
     }
 
-    User* getById(int id) override {
-        for (auto &u : users)
-            if (u.getUserId() == id)
-                return &u;
-        return nullptr;
+    void erase(int billId) {
+        uint32_t row = rowOf(billId);
+        if (row == NoRow) return;
+        uint32_t last = static_cast<uint32_t>(billIds.size() - 1);
+        if (row != last) {
+            patientIds[row] = patientIds[last];
+            days[row] = days[last];
+            cents[row] = cents[last];
+            statuses[row] = statuses[last];
+            billIds[row] = billIds[last];
+            rowOfId[billIds[row]] = row;
+        }
+        patientIds.pop_back();
+        days.pop_back();
+        cents.pop_back();
+        statuses.pop_back();
+        billIds.pop_back();
+        rowOfId[billId] = NoRow;
     }
 
-    std::vector<User> getAll() const override {
-        return users;
-    }
+    size_t size() const { return billIds.size(); }
 
-    User* findByUsername(const std::string &username) override {
-        for (auto &u : users)
-            if (u.getUsername() == username)
-                return &u;
-        return nullptr;
+    BillColumnView view() const {
+        return BillColumnView{days.data(), cents.data(), statuses.data(), billIds.size()};
     }
 
-    std::vector<User> findByRole(const std::string &role) const override {
-        std::vector<User> result;
-        for (const auto &u : users) {
-            if (u.getRole() == role) {
-                result.push_back(u);
-            }
+    // IDs of one patient's bills in ID order, found by scanning one column
+    std::vector<int> idsForPatient(int patientId) const {
+        std::vector<int> ids;
+        for (size_t row = 0; row < patientIds.size(); ++row) {
+            if (patientIds[row] == patientId) ids.push_back(billIds[row]);
         }
-        return result;
+        std::sort(ids.begin(), ids.end());
+        return ids;
     }
 };
 
+const uint32_t BillColumns::NoRow;
+
 // ------------------------------
-// Service Classes (Business Logic)
+// In-Memory Repository Implementations
 // ------------------------------
 
-// Authentication service
-class AuthenticationService {
+// Slot map: items live in fixed-size chunks that never move, so references
+// stay valid until the item is erased. Erased slots go on a free list and are
+// reused; each reuse bumps the slot's generation so stale handles resolve to
+// nullptr instead of aliasing the new occupant.
+template <typename T>
+class SlotMap {
 private:
-    std::shared_ptr<IUserRepository> userRepo;
-    std::shared_ptr<ILogger> logger;
-    int nextUserId = 1;
-    User* currentUser = nullptr;
+    static const size_t ChunkSize = 1024;
+    static const uint32_t NoFreeSlot = UINT32_MAX;
+
+    struct Slot {
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+        uint32_t generation = 0;
+        uint32_t nextFree = NoFreeSlot;
+        bool occupied = false;
+
+        T &value() { return *reinterpret_cast<T*>(&storage); }
+        const T &value() const { return *reinterpret_cast<const T*>(&storage); }
+    };
+
+    std::vector<std::unique_ptr<Slot[]>> chunks;
+    uint32_t slotCount = 0;
+    uint32_t freeHead = NoFreeSlot;
+    size_t liveCount = 0;
+
+    Slot &slotAt(uint32_t index) { return chunks[index / ChunkSize][index % ChunkSize]; }
+    const Slot &slotAt(uint32_t index) const { return chunks[index / ChunkSize][index % ChunkSize]; }
 
 public:
-    AuthenticationService(std::shared_ptr<IUserRepository> repo, std::shared_ptr<ILogger> log)
-        : userRepo(repo), logger(log) {}
-    
-    bool login(const std::string &username, const std::string &password) {
-        User* user = userRepo->findByUsername(username);
-        if (user && user->checkPassword(password) && user->getIsActive()) {
-            currentUser = user;
-            logger->logInfo("User logged in: " + username);
-            return true;
+    class const_iterator {
+    private:
+        const SlotMap *map;
+        uint32_t index;
+
+        void skipFree() {
+            while (index < map->slotCount && !map->slotAt(index).occupied) ++index;
+        }
+
+    public:
+        const_iterator(const SlotMap *m, uint32_t i) : map(m), index(i) { skipFree(); }
+        const T &operator*() const { return map->slotAt(index).value(); }
+        const T *operator->() const { return &map->slotAt(index).value(); }
+        const_iterator &operator++() { ++index; skipFree(); return *this; }
+        bool operator==(const const_iterator &other) const { return index == other.index; }
+        bool operator!=(const const_iterator &other) const { return index != other.index; }
+    };
+
+    SlotMap() = default;
+    SlotMap(const SlotMap &) = delete;
+    SlotMap &operator=(const SlotMap &) = delete;
+
+    ~SlotMap() {
+        for (uint32_t i = 0; i < slotCount; ++i) {
+            Slot &slot = slotAt(i);
+            if (slot.occupied) slot.value().~T();
         }
-        logger->logWarning("Failed login attempt for username: " + username);
-        return false;
     }
-    
-    void logout() {
-        if (currentUser) {
-            logger->logInfo("User logged out: " + currentUser->getUsername());
-            currentUser = nullptr;
+
+    SlotHandle insert(const T &item) {
+        uint32_t index;
+        if (freeHead != NoFreeSlot) {
+            index = freeHead;
+            freeHead = slotAt(index).nextFree;
+        } else {
+            if (slotCount % ChunkSize == 0) {
+                chunks.emplace_back(new Slot[ChunkSize]);
+            }
+            index = slotCount++;
         }
+        Slot &slot = slotAt(index);
+        new (&slot.storage) T(item);
+        slot.occupied = true;
+        ++liveCount;
+        return SlotHandle{index, slot.generation};
     }
-    
-    User* getCurrentUser() const {
-        return currentUser;
-    }
-    
-    bool isLoggedIn() const {
-        return currentUser != nullptr;
-    }
-    
-    bool hasRole(const std::string &role) const {
-        return isLoggedIn() && currentUser->getRole() == role;
-    }
-    
-    bool registerUser(const std::string &username, const std::string &password, const std::string &role) {
-        if (userRepo->findByUsername(username)) {
-            logger->logWarning("Failed to register: Username already exists: " + username);
-            return false; // Username already exists
-        }
-        
-        User user(nextUserId++, username, password, role);
-        userRepo->add(user);
-        logger->logInfo("New user registered: " + username + " with role: " + role);
+
+    bool erase(SlotHandle handle) {
+        if (!get(handle)) return false;
+        Slot &slot = slotAt(handle.index);
+        slot.value().~T();
+        slot.occupied = false;
+        ++slot.generation;
+        slot.nextFree = freeHead;
+        freeHead = handle.index;
+        --liveCount;
         return true;
     }
-    
-    bool updateUserStatus(int userId, bool isActive) {
-        User* user = userRepo->getById(userId);
-        if (user) {
-            user->setIsActive(isActive);
-            logger->logInfo("User status updated: " + user->getUsername() + " is now " + 
-                           (isActive ? "active" : "inactive"));
-            return true;
-        }
-        return false;
+
+    T* get(SlotHandle handle) {
+        if (handle.index >= slotCount) return nullptr;
+        Slot &slot = slotAt(handle.index);
+        return (slot.occupied && slot.generation == handle.generation) ? &slot.value() : nullptr;
     }
-    
-    std::vector<User> getAllUsers() const {
-        return userRepo->getAll();
+
+    const T* get(SlotHandle handle) const {
+        if (handle.index >= slotCount) return nullptr;
+        const Slot &slot = slotAt(handle.index);
+        return (slot.occupied && slot.generation == handle.generation) ? &slot.value() : nullptr;
     }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, slotCount); }
+    size_t size() const { return liveCount; }
 };
 
-class PatientService {
+// Slot-map item storage with a hash index on the primary key, shared by the
+// in-memory repositories: O(1) getById, stable references and O(1) removal.
+template <typename T>
+class IdIndexedStore {
 private:
-    std::shared_ptr<IPatientRepository> patientRepo;
-    std::shared_ptr<ILogger> logger;
-    std::shared_ptr<IDisplayManager> display;
-    int nextPatientId = 1;
-
-public:
-    PatientService(std::shared_ptr<IPatientRepository> repo, 
-                  std::shared_ptr<ILogger> log,
-                  std::shared_ptr<IDisplayManager> disp)
-        : patientRepo(repo), logger(log), display(disp) {}
+    SlotMap<T> items;
+    std::unordered_map<int, SlotHandle> handleById;
+    std::shared_ptr<IJournal> journal;
 
-    void addPatient(const std::string &name, int age, const std::string &disease,
-                   const std::string &contactNumber = "", const std::string &address = "",
-                   const std::string &bloodGroup = "") {
-        Patient p(nextPatientId++, name, age, disease, contactNumber, address, bloodGroup);
-        patientRepo->add(p);
-        logger->logInfo("Added patient: " + name + " (ID: " + std::to_string(p.getId()) + ")");
-        display->displaySuccess("Patient added successfully with ID: " + std::to_string(p.getId()));
+    void journalPut(const T &item) {
+        if (!journal) return;
+        std::string payload;
+        BinaryWriter out(payload);
+        EntityCodec<T>::encode(out, item);
+        journal->recordPut(EntityCodec<T>::kind, payload);
     }
 
-    void updatePatient(int id, const std::string &name, int age, const std::string &disease,
-                      const std::string &contactNumber = "", const std::string &address = "",
-                      const std::string &bloodGroup = "") {
-        Patient* p = patientRepo->getById(id);
-        if (p) {
-            p->setName(name);
-            p->setAge(age);
-            p->setDisease(disease);
-            p->setContactNumber(contactNumber);
-            p->setAddress(address);
-            p->setBloodGroup(bloodGroup);
-            logger->logInfo("Updated patient with ID: " + std::to_string(id));
-            display->displaySuccess("Patient updated successfully.");
+public:
+    void attachJournal(std::shared_ptr<IJournal> j) { journal = j; }
+
+    // Adds the item, replacing any existing item with the same ID
+    void add(int id, const T &item) {
+        auto found = handleById.find(id);
+        if (found != handleById.end()) {
+            *items.get(found->second) = item;
         } else {
-            logger->logWarning("Failed to update: Patient not found with ID: " + std::to_string(id));
-            display->displayError("Patient not found.");
+            handleById.emplace(id, items.insert(item));
         }
+        journalPut(item);
     }
 
-    void removePatient(int id) {
-        if (patientRepo->remove(id)) {
-            logger->logInfo("Removed patient with ID: " + std::to_string(id));
-            display->displaySuccess("Patient removed successfully.");
-        } else {
-            logger->logWarning("Failed to remove: Patient not found with ID: " + std::to_string(id));
-            display->displayError("Patient not found.");
-        }
+    bool remove(int id) {
+        auto found = handleById.find(id);
+        if (found == handleById.end()) return false;
+        items.erase(found->second);
+        handleById.erase(found);
+        if (journal) journal->recordRemove(EntityCodec<T>::kind, id);
+        return true;
     }
 
-    void listPatients() const {
-        auto patients = patientRepo->getAll();
-        if (patients.empty()) {
-            display->displayInfo("No patients registered.");
-            return;
-        }
-        display->displayInfo("List of all patients:");
-        for (const auto &p : patients) {
-            p.display();
-            std::cout << "-------------------------\n";
-        }
+    // Applies a mutation and journals the resulting state of the item
+    bool modify(int id, const std::function<void(T &)> &mutator) {
+        T* item = find(id);
+        if (!item) return false;
+        mutator(*item);
+        journalPut(*item);
+        return true;
     }
-    
-    void findPatientsByDisease(const std::string &disease) const {
-        auto patients = patientRepo->findByDisease(disease);
-        if (patients.empty()) {
-            display->displayInfo("No patients found with disease: " + disease);
-            return;
-        }
-        display->displayInfo("Patients with disease '" + disease + "':");
-        for (const auto &p : patients) {
-            p.display();
-            std::cout << "-------------------------\n";
-        }
+
+    T* find(int id) {
+        auto found = handleById.find(id);
+        return found != handleById.end() ? items.get(found->second) : nullptr;
     }
-    
-    void findPatientsByAgeRange(int minAge, int maxAge) const {
-        auto patients = patientRepo->findByAgeRange(minAge, maxAge);
-        if (patients.empty()) {
-            display->displayInfo("No patients found in age range " + 
-                               std::to_string(minAge) + " to " + std::to_string(maxAge));
-            return;
-        }
-        display->displayInfo("Patients in age range " + std::to_string(minAge) + 
-                           " to " + std::to_string(maxAge) + ":");
-        for (const auto &p : patients) {
-            p.display();
-            std::cout << "-------------------------\n";
-        }
+
+    const T* find(int id) const {
+        auto found = handleById.find(id);
+        return found != handleById.end() ? items.get(found->second) : nullptr;
     }
 
-    Patient* getPatientById(int id) {
-        return patientRepo->getById(id);
+    SlotHandle handleOf(int id) const {
+        auto found = handleById.find(id);
+        return found != handleById.end() ? found->second : SlotHandle();
+    }
+
+    T* resolve(SlotHandle handle) { return items.get(handle); }
+
+    std::vector<T> toVector() const {
+        std::vector<T> result;
+        result.reserve(items.size());
+        for (const auto &item : items) result.push_back(item);
+        return result;
     }
+
+    typename SlotMap<T>::const_iterator begin() const { return items.begin(); }
+    typename SlotMap<T>::const_iterator end() const { return items.end(); }
+    size_t size() const { return items.size(); }
 };
 
-class DoctorService {
+// Hash multimap from an attribute value to the IDs of the items that have
+// it. IDs are kept ordered so results come back in ID order, and lookups
+// cost time proportional to the result size rather than the table size.
+template <typename Key>
+class SecondaryIndex {
 private:
-    std::shared_ptr<IDoctorRepository> doctorRepo;
-    std::shared_ptr<ILogger> logger;
-    std::shared_ptr<IDisplayManager> display;
-    int nextDoctorId = 1;
+    std::unordered_map<Key, std::set<int>> idsByKey;
+    static const std::set<int> &emptySet() {
+        static const std::set<int> empty;
+        return empty;
+    }
 
 public:
-    DoctorService(std::shared_ptr<IDoctorRepository> repo,
-                 std::shared_ptr<ILogger> log,
-                 std::shared_ptr<IDisplayManager> disp)
-        : doctorRepo(repo), logger(log), display(disp) {}
+    void insert(const Key &key, int id) { idsByKey[key].insert(id); }
 
-    void addDoctor(const std::string &name, const std::string &specialization,
-                  const std::string &contactNumber = "", const std::string &email = "",
-                  double consultationFee = 0.0) {
-        Doctor d(nextDoctorId++, name, specialization, contactNumber, email, consultationFee);
-        doctorRepo->add(d);
-        logger->logInfo("Added doctor: " + name + " (ID: " + std::to_string(d.getId()) + ")");
-        display->displaySuccess("Doctor added successfully with ID: " + std::to_string(d.getId()));
+    void erase(const Key &key, int id) {
+        auto found = idsByKey.find(key);
+        if (found == idsByKey.end()) return;
+        found->second.erase(id);
+        if (found->second.empty()) idsByKey.erase(found);
     }
 
-    void updateDoctor(int id, const std::string &name, const std::string &specialization,
-                     const std::string &contactNumber = "", const std::string &email = "",
-                     double consultationFee = 0.0) {
-        Doctor* d = doctorRepo->getById(id);
-        if (d) {
-            d->setName(name);
-            d->setSpecialization(specialization);
-            d->setContactNumber(contactNumber);
-            d->setEmail(email);
-            d->setConsultationFee(consultationFee);
-            logger->logInfo("Updated doctor with ID: " + std::to_string(id));
-            display->displaySuccess("Doctor updated successfully.");
-        } else {
-            logger->logWarning("Failed to update: Doctor not found with ID: " + std::to_string(id));
-            display->displayError("Doctor not found.");
-        }
+    const std::set<int> &find(const Key &key) const {
+        auto found = idsByKey.find(key);
+        return found != idsByKey.end() ? found->second : emptySet();
     }
 
-    void removeDoctor(int id) {
-        if (doctorRepo->remove(id)) {
-            logger->logInfo("Removed doctor with ID: " + std::to_string(id));
-            display->displaySuccess("Doctor removed successfully.");
-        } else {
-            logger->logWarning("Failed to remove: Doctor not found with ID: " + std::to_string(id));
-            display->displayError("Doctor not found.");
-        }
+    size_t keyCount() const { return idsByKey.size(); }
+
+    template <typename Fn>
+    void forEachKey(Fn fn) const {
+        for (const auto &entry : idsByKey) fn(entry.first);
     }
+};
 
-    void listDoctors() const {
-        auto doctors = doctorRepo->getAll();
-        if (doctors.empty()) {
-            display->displayInfo("No doctors registered.");
-            return;
-        }
-        display->displayInfo("List of all doctors:");
-        for (const auto &d : doctors) {
-            d.display();
-            std::cout << "-------------------------\n";
-        }
+// Set membership for 64-bit hashes that answers "definitely not" or
+// "maybe". Each key sets one bit in each word of one 8-word block, so a
+// check reads 64 contiguous bytes, with about 16 bits per expected key
+// (roughly one false "maybe" in 200). Keys cannot be taken out; the owner
+// rebuilds the filter when it outgrows its size or holds many stale keys.
+class BloomFilter {
+private:
+    static const size_t BlockWords = 8;
+    std::vector<uint64_t> words;
+    uint64_t blockMask = 0;
+    size_t capacity = 0;
+    size_t keys = 0;
+
+    // Bit to set in word w of the key's block, from the hash's high half
+    static uint64_t bitFor(uint64_t hash, size_t w) {
+        static const uint32_t salts[BlockWords] = {0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+                                                   0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u};
+        uint32_t product = static_cast<uint32_t>(hash >> 32) * salts[w];
+        return 1ull << (product >> 26);
     }
-    
-    void listAvailableDoctors() const {
-        auto doctors = doctorRepo->findAvailableDoctors();
-        if (doctors.empty()) {
-            display->displayInfo("No available doctors found.");
-            return;
-        }
-        display->displayInfo("List of available doctors:");
-        for (const auto &d : doctors) {
-            d.display();
-            std::cout << "-------------------------\n";
-        }
+
+public:
+    explicit BloomFilter(size_t expectedKeys = 1024) { reset(expectedKeys); }
+
+    // Empties the filter and sizes it for expectedKeys
+    void reset(size_t expectedKeys) {
+        size_t blocks = 1;
+        while (blocks * BlockWords * 64 < expectedKeys * 16) blocks *= 2;
+        words.assign(blocks * BlockWords, 0);
+        blockMask = blocks - 1;
+        capacity = expectedKeys;
+        keys = 0;
     }
-    
-    void findDoctorsBySpecialization(const std::string &specialization) const {
-        auto doctors = doctorRepo->findBySpecialization(specialization);
-        if (doctors.empty()) {
-            display->displayInfo("No doctors found with specialization: " + specialization);
-            return;
-        }
-        display->displayInfo("Doctors with specialization '" + specialization + "':");
-        for (const auto &d : doctors) {
-            d.display();
-            std::cout << "-------------------------\n";
-        }
+
+    void insert(uint64_t hash) {
+        uint64_t *block = &words[(hash & blockMask) * BlockWords];
+        for (size_t w = 0; w < BlockWords; ++w) block[w] |= bitFor(hash, w);
+        ++keys;
     }
-    
-    void setDoctorAvailability(int id, bool isAvailable) {
-        Doctor* d = doctorRepo->getById(id);
-        if (d) {
-            d->setAvailability(isAvailable);
-            logger->logInfo("Updated doctor availability: Doctor ID " + std::to_string(id) + 
-                          " is now " + (isAvailable ? "available" : "unavailable"));
-            display->displaySuccess("Doctor availability updated successfully.");
-        } else {
-            logger->logWarning("Failed to update availability: Doctor not found with ID: " + std::to_string(id));
-            display->displayError("Doctor not found.");
+
+    bool mayContain(uint64_t hash) const {
+        const uint64_t *block = &words[(hash & blockMask) * BlockWords];
+        for (size_t w = 0; w < BlockWords; ++w) {
+            if ((block[w] & bitFor(hash, w)) == 0) return false;
         }
+        return true;
     }
 
-    Doctor* getDoctorById(int id) {
-        return doctorRepo->getById(id);
-    }
+    size_t size() const { return keys; } // Insertions since the last reset
+    size_t getCapacity() const { return capacity; }
 };
+const size_t BloomFilter::BlockWords;
 
-class AppointmentService {
+// Records partitioned by day number. Partitions are kept in day order, so a
+// date range visits only the days inside it and old days can be dropped
+// whole from the front.
+class DayPartitions {
 private:
-    std::shared_ptr<IAppointmentRepository> apptRepo;
-    PatientService &patientService;
-    DoctorService &doctorService;
-    std::shared_ptr<ILogger> logger;
-    std::shared_ptr<IDisplayManager> display;
-    int nextAppointmentId = 1;
+    std::map<int, std::set<int>> idsByDay;
 
 public:
-    AppointmentService(std::shared_ptr<IAppointmentRepository> repo,
-                       PatientService &ps, DoctorService &ds,
-                       std::shared_ptr<ILogger> log,
-                       std::shared_ptr<IDisplayManager> disp)
-        : apptRepo(repo), patientService(ps), doctorService(ds), 
-          logger(log), display(disp) {}
+    void insert(int day, int id) { idsByDay[day].insert(id); }
 
-    void bookAppointment(int patientId, int doctorId, const std::string &date, 
-                         const std::string &timeSlot = "09:00-09:30") {
-        // Validate existence of patient and doctor
-        Patient* patient = patientService.getPatientById(patientId);
-        if (!patient) {
-            logger->logWarning("Failed to book appointment: Invalid Patient ID: " + std::to_string(patientId));
-            display->displayError("Invalid Patient ID.");
-            return;
-        }
-        
-        Doctor* doctor = doctorService.getDoctorById(doctorId);
-        if (!doctor) {
-            logger->logWarning("Failed to book appointment: Invalid Doctor ID: " + std::to_string(doctorId));
-            display->displayError("Invalid Doctor ID.");
-            return;
-        }
-        
-        // Check if doctor is available
-        if (!doctor->getAvailability()) {
-            logger->logWarning("Failed to book appointment: Doctor is not available: " + std::to_string(doctorId));
-            display->displayError("Doctor is not available for appointments.");
-            return;
+    void erase(int day, int id) {
+        auto found = idsByDay.find(day);
+        if (found == idsByDay.end()) return;
+        found->second.erase(id);
+        if (found->second.empty()) idsByDay.erase(found);
+    }
+
+    const std::set<int> &find(int day) const {
+        static const std::set<int> empty;
+        auto found = idsByDay.find(day);
+        return found != idsByDay.end() ? found->second : empty;
+    }
+
+    // Visits IDs dated fromDay..toDay inclusive, by day then ID
+    template <typename Visit>
+    void forEachInRange(int fromDay, int toDay, Visit visit) const {
+        if (fromDay > toDay) return;
+        for (auto it = idsByDay.lower_bound(fromDay); it != idsByDay.end() && it->first <= toDay; ++it) {
+            for (int id : it->second) visit(id);
         }
-        
-        // Check for conflicts in the same time slot
-        auto appointments = apptRepo->findByDate(date);
-        for (const auto &a : appointments) {
-            if (a.getDoctorId() == doctorId && a.getTimeSlot() == timeSlot) {
-                logger->logWarning("Failed to book appointment: Time slot is already booked.");
-                display->displayError("The selected time slot is already booked for this doctor.");
-                return;
-            }
+    }
+
+    // IDs of every record dated before the given day, by day then ID
+    std::vector<int> idsBefore(int day) const {
+        std::vector<int> ids;
+        for (auto it = idsByDay.begin(); it != idsByDay.end() && it->first < day; ++it) {
+            ids.insert(ids.end(), it->second.begin(), it->second.end());
         }
-        
-        Appointment a(nextAppointmentId++, patientId, doctorId, date, timeSlot);
-        apptRepo->add(a);
-        
-        logger->logInfo("Booked appointment: Patient ID " + std::to_string(patientId) + 
-                       " with Doctor ID " + std::to_string(doctorId) + 
-                       " on " + date + " at " + timeSlot);
-        display->displaySuccess("Appointment booked successfully with ID: " + 
-                              std::to_string(a.getAppointmentId()));
+        return ids;
     }
+};
 
-    void updateAppointmentDetails(int apptId, const std::string &newDate, 
-                                 const std::string &newTimeSlot, 
-                                 const std::string &newStatus,
-                                 const std::string &notes) {
-        Appointment* a = apptRepo->getById(apptId);
-        if (a) {
-            a->setDate(newDate);
-            a->setTimeSlot(newTimeSlot);
-            a->setStatus(newStatus);
-            a->setNotes(notes);
-            
-            logger->logInfo("Updated appointment: ID " + std::to_string(apptId) + 
-                           " to " + newDate + " at " + newTimeSlot + 
-                           " (Status: " + newStatus + ")");
-            display->displaySuccess("Appointment updated successfully.");
-        } else {
-            logger->logWarning("Failed to update: Appointment not found with ID: " + std::to_string(apptId));
-            display->displayError("Appointment not found.");
+// Ordered index on patient age. Ages are bounded, so each age gets its own
+// bucket of IDs plus a Fenwick tree of bucket sizes: range queries cost
+// O(buckets + k) and range counts O(log MaxAge). Out-of-range ages fall
+// back to an ordered multimap.
+class AgeIndex {
+private:
+    enum : int { MaxAge = 150 }; // An enumerator, so std::min and std::max never need it defined out of class
+    std::vector<std::set<int>> buckets;
+    std::vector<int64_t> fenwick; // 1-based prefix counts over buckets
+    std::set<std::pair<int, int>> outliers; // (age, ID) for ages outside 0..MaxAge
+
+    void adjustCount(int age, int delta) {
+        for (int i = age + 1; i <= MaxAge + 1; i += i & -i) {
+            fenwick[i] += delta;
         }
     }
 
-    void updateAppointmentStatus(int apptId, const std::string &newStatus) {
-        Appointment* a = apptRepo->getById(apptId);
-        if (a) {
-            a->setStatus(newStatus);
-            logger->logInfo("Updated appointment status: ID " + std::to_string(apptId) + 
-                           " to " + newStatus);
-            display->displaySuccess("Appointment status updated successfully.");
-        } else {
-            logger->logWarning("Failed to update status: Appointment not found with ID: " + std::to_string(apptId));
-            display->displayError("Appointment not found.");
+    int64_t prefixCount(int age) const { // Number of IDs with age <= given age
+        int64_t total = 0;
+        for (int i = age + 1; i > 0; i -= i & -i) {
+            total += fenwick[i];
         }
+        return total;
     }
 
-    void cancelAppointment(int apptId) {
-        Appointment* a = apptRepo->getById(apptId);
-        if (a) {
-            a->setStatus("Cancelled");
-            logger->logInfo("Cancelled appointment: ID " + std::to_string(apptId));
-            display->displaySuccess("Appointment marked as cancelled.");
-        } else if (apptRepo->remove(apptId)) {
-            logger->logInfo("Removed appointment: ID " + std::to_string(apptId));
-            display->displaySuccess("Appointment removed completely.");
+    static bool inBucketRange(int age) { return age >= 0 && age <= MaxAge; }
+
+    // First outlier with at least the given age
+    std::set<std::pair<int, int>>::const_iterator firstOutlierFrom(int age) const {
+        return outliers.lower_bound(std::make_pair(age, std::numeric_limits<int>::min()));
+    }
+
+public:
+    AgeIndex() : buckets(MaxAge + 1), fenwick(MaxAge + 2, 0) {}
+
+    void insert(int age, int id) {
+        if (inBucketRange(age)) {
+            if (buckets[age].insert(id).second) adjustCount(age, 1);
         } else {
-            logger->logWarning("Failed to cancel: Appointment not found with ID: " + std::to_string(apptId));
-            display->displayError("Appointment not found.");
+            outliers.emplace(age, id);
         }
     }
 
-    void listAllAppointments() const {
-        auto appointments = apptRepo->getAll();
-        if (appointments.empty()) {
-            display->displayInfo("No appointments found.");
+    void erase(int age, int id) {
+        if (inBucketRange(age)) {
+            if (buckets[age].erase(id)) adjustCount(age, -1);
             return;
         }
-        display->displayInfo("List of all appointments:");
-        for (const auto &a : appointments) {
-            a.display();
-            std::cout << "-------------------------\n";
-        }
+        outliers.erase(std::make_pair(age, id));
     }
-    
-    void listAppointmentsByPatient(int patientId) const {
-        auto appointments = apptRepo->findByPatientId(patientId);
-        if (appointments.empty()) {
-            display->displayInfo("No appointments found for patient ID: " + std::to_string(patientId));
-            return;
-        }
-        display->displayInfo("Appointments for patient ID " + std::to_string(patientId) + ":");
-        for (const auto &a : appointments) {
-            a.display();
-            std::cout << "-------------------------\n";
+
+    // IDs with minAge <= age <= maxAge, ordered by age then ID
+    template <typename Fn>
+    void forEachInRange(int minAge, int maxAge, Fn &&fn) const {
+        if (minAge > maxAge) return;
+        auto outlier = firstOutlierFrom(minAge);
+        for (; outlier != outliers.end() && outlier->first < 0 && outlier->first <= maxAge; ++outlier) {
+            fn(outlier->second);
         }
-    }
-    
-    void listAppointmentsByDoctor(int doctorId) const {
-        auto appointments = apptRepo->findByDoctorId(doctorId);
-        if (appointments.empty()) {
-            display->displayInfo("No appointments found for doctor ID: " + std::to_string(doctorId));
-            return;
+        for (int age = std::max(minAge, 0); age <= std::min<int>(maxAge, MaxAge); ++age) {
+            for (int id : buckets[age]) fn(id);
         }
-        display->displayInfo("Appointments for doctor ID " + std::to_string(doctorId) + ":");
-        for (const auto &a : appointments) {
-            a.display();
-            std::cout << "-------------------------\n";
+        for (outlier = firstOutlierFrom(std::max(minAge, MaxAge + 1));
+             outlier != outliers.end() && outlier->first <= maxAge; ++outlier) {
+            fn(outlier->second);
         }
     }
-    
-    void listAppointmentsByDate(const std::string &date) const {
-        auto appointments = apptRepo->findByDate(date);
-        if (appointments.empty()) {
-            display->displayInfo("No appointments found for date: " + date);
-            return;
+
+    size_t countInRange(int minAge, int maxAge) const {
+        if (minAge > maxAge) return 0;
+        size_t total = 0;
+        int low = std::max(minAge, 0);
+        int high = std::min<int>(maxAge, MaxAge);
+        if (low <= high) {
+            total += static_cast<size_t>(prefixCount(high) - (low > 0 ? prefixCount(low - 1) : 0));
         }
-        display->displayInfo("Appointments for date " + date + ":");
-        for (const auto &a : appointments) {
-            a.display();
-            std::cout << "-------------------------\n";
+        if (!outliers.empty()) {
+            total += std::distance(firstOutlierFrom(minAge),
+                                   outliers.upper_bound(std::make_pair(maxAge, std::numeric_limits<int>::max())));
         }
+        return total;
     }
-    
-    void listAppointmentsByStatus(const std::string &status) const {
-        auto appointments = apptRepo->findByStatus(status);
-        if (appointments.empty()) {
-            display->displayInfo("No appointments found with status: " + status);
-            return;
-        }
-        display->displayInfo("Appointments with status '" + status + "':");
-        for (const auto &a : appointments) {
-            a.display();
-            std::cout << "-------------------------\n";
-        }
+};
+
+// Primary key of an entity: the ID the write-ahead log records it under
+template <typename T>
+struct EntityId {
+    static int of(const T &item) { return EntityCodec<T>::id(item); }
+};
+
+// Index policies keep one derived structure in step with a repository's
+// items. Each provides insert(id, item) and erase(id, item) for items that
+// arrive and leave, and for items changed in place (or replaced by add) a
+// Snapshot of whatever it needs from the old state, taken by snapshot(item)
+// beforehand and handed to update(id, before, item) afterwards.
+//
+// KeyedIndex is the common case: one attribute, read by KeyOfItem::of and
+// looked up through a container with insert(key, id)/erase(key, id). Items
+// whose key did not change are left alone on update.
+template <typename T, typename KeyOfItem, typename Container = SecondaryIndex<typename KeyOfItem::Key>>
+class KeyedIndex {
+private:
+    Container container;
+
+public:
+    typedef typename KeyOfItem::Key Snapshot;
+
+    Snapshot snapshot(const T &item) const { return KeyOfItem::of(item); }
+    void insert(int id, const T &item) { container.insert(KeyOfItem::of(item), id); }
+    void erase(int id, const T &item) { container.erase(KeyOfItem::of(item), id); }
+
+    void update(int id, const Snapshot &before, const T &item) {
+        const Snapshot &after = KeyOfItem::of(item);
+        if (after == before) return;
+        container.erase(before, id);
+        container.insert(after, id);
     }
+
+    const Container &get() const { return container; }
 };
 
-class MedicationService {
+// A fixed list of index policies that behaves as one. Every hook is expanded
+// over the members at compile time, in order, so there is no per-index
+// dispatch, and the empty set's hooks do nothing at all.
+template <typename... Indexes>
+class IndexSet {
 private:
-    std::shared_ptr<IMedicationRepository> medRepo;
-    std::shared_ptr<ILogger> logger;
-    std::shared_ptr<IDisplayManager> display;
-    int nextMedicationId = 1;
+    std::tuple<Indexes...> indexes;
+    typedef int Expand[]; // Runs a pack expansion left to right
 
 public:
-    MedicationService(std::shared_ptr<IMedicationRepository> repo,
-                     std::shared_ptr<ILogger> log,
-                     std::shared_ptr<IDisplayManager> disp)
-        : medRepo(repo), logger(log), display(disp) {}
-        
-    void addMedication(const std::string &name, const std::string &dosage, double price,
-                      const std::string &manufacturer = "", const std::string &description = "") {
-        if (medRepo->findByName(name)) {
-            logger->logWarning("Failed to add: Medication with name '" + name + "' already exists");
-            display->displayError("Medication with this name already exists.");
-            return;
-        }
-        
-        Medication m(nextMedicationId++, name, dosage, price, manufacturer, description);
-        medRepo->add(m);
-        logger->logInfo("Added medication: " + name + " (ID: " + std::to_string(m.getMedicationId()) + ")");
-        display->displaySuccess("Medication added successfully with ID: " + std::to_string(m.getMedicationId()));
+    typedef std::tuple<typename Indexes::Snapshot...> Snapshot;
+
+private:
+    template <typename T, size_t... I>
+    void updateEach(int id, const Snapshot &before, const T &item, std::index_sequence<I...>) {
+        (void)Expand{0, (std::get<I>(indexes).update(id, std::get<I>(before), item), 0)...};
     }
-    
-    void updateMedication(int id, const std::string &name, const std::string &dosage, double price,
-                         const std::string &manufacturer = "", const std::string &description = "") {
-        Medication* m = medRepo->getById(id);
-        if (!m) {
-            logger->logWarning("Failed to update: Medication not found with ID: " + std::to_string(id));
-            display->displayError("Medication not found.");
-            return;
-        }
-        
-        // Check if the new name conflicts with an existing medication (only if name is changing)
-        if (name != m->getName()) {
-            Medication* existing = medRepo->findByName(name);
-            if (existing && existing->getMedicationId() != id) {
-                logger->logWarning("Failed to update: Medication name '" + name + "' already in use");
-                display->displayError("A medication with this name already exists.");
-                return;
-            }
-        }
-        
-        m->setName(name);
-        m->setDosage(dosage);
-        m->setPrice(price);
-        m->setManufacturer(manufacturer);
-        m->setDescription(description);
-        
-        logger->logInfo("Updated medication: ID " + std::to_string(id));
-        display->displaySuccess("Medication updated successfully.");
+
+public:
+    template <typename T>
+    Snapshot snapshot(const T &item) const {
+        return Snapshot(std::get<Indexes>(indexes).snapshot(item)...);
     }
-    
-    void removeMedication(int id) {
-        if (medRepo->remove(id)) {
-            logger->logInfo("Removed medication with ID: " + std::to_string(id));
-            display->displaySuccess("Medication removed successfully.");
+
+    template <typename T>
+    void insert(int id, const T &item) {
+        (void)Expand{0, (std::get<Indexes>(indexes).insert(id, item), 0)...};
+    }
+
+    template <typename T>
+    void erase(int id, const T &item) {
+        (void)Expand{0, (std::get<Indexes>(indexes).erase(id, item), 0)...};
+    }
+
+    template <typename T>
+    void update(int id, const Snapshot &before, const T &item) {
+        updateEach(id, before, item, std::index_sequence_for<Indexes...>());
+    }
+
+    template <typename Index> const Index &get() const { return std::get<Index>(indexes); }
+};
+
+// Repositories without indexes
+template <>
+class IndexSet<> {
+public:
+    struct Snapshot {};
+
+    template <typename T> Snapshot snapshot(const T &) const { return Snapshot(); }
+    template <typename T> void insert(int, const T &) {}
+    template <typename T> void erase(int, const T &) {}
+    template <typename T> void update(int, const Snapshot &, const T &) {}
+};
+
+// The in-memory repository, assembled from policies: the entity, the
+// interface it serves, the indexes kept beside the items, how an item's ID
+// is read and the storage that holds them. The CRUD half of every interface
+// is written once here and keeps all the indexes current, so each entity
+// only adds its queries; a new index or storage backend is a change of
+// template argument. The overrides are final and every entity repository is
+// a final class, so calls on the concrete type - which is how the sharded
+// wrappers make them - are bound statically and can be inlined.
+template <typename T, typename Interface, typename Indexes = IndexSet<>,
+          typename KeyOf = EntityId<T>, template <typename> class Storage = IdIndexedStore>
+class InMemoryRepository : public Interface {
+protected:
+    Storage<T> items;
+    Indexes indexes;
+
+    template <typename Index>
+    const Index &index() const { return indexes.template get<Index>(); }
+
+public:
+    typedef typename Interface::Visitor Visitor;
+
+    // Replacing an item counts as an update, so indexes see its old state
+    void add(const T &item) final {
+        int id = KeyOf::of(item);
+        if (const T* existing = items.find(id)) {
+            typename Indexes::Snapshot before = indexes.snapshot(*existing);
+            items.add(id, item);
+            indexes.update(id, before, item);
         } else {
-            logger->logWarning("Failed to remove: Medication not found with ID: " + std::to_string(id));
-            display->displayError("Medication not found.");
+            items.add(id, item);
+            indexes.insert(id, item);
         }
     }
-    
-    void listAllMedications() const {
-        auto medications = medRepo->getAll();
-        if (medications.empty()) {
-            display->displayInfo("No medications available.");
-            return;
-        }
-        display->displayInfo("List of all medications:");
-        for (const auto &m : medications) {
-            m.display();
-            std::cout << "-------------------------\n";
-        }
+
+    bool remove(int id) final {
+        const T* existing = items.find(id);
+        if (!existing) return false;
+        indexes.erase(id, *existing);
+        return items.remove(id);
     }
-    
-    Medication* getMedicationById(int id) {
-        return medRepo->getById(id);
+
+    bool update(int id, const std::function<void(T &)> &mutator) final {
+        return items.modify(id, [&](T &item) {
+            typename Indexes::Snapshot before = indexes.snapshot(item);
+            mutator(item);
+            indexes.update(id, before, item);
+        });
     }
-    
-    Medication* getMedicationByName(const std::string &name) {
-        return medRepo->findByName(name);
+
+    bool inspect(int id, const std::function<void(const T &)> &reader) final {
+        const T* item = items.find(id);
+        if (!item) return false;
+        reader(*item);
+        return true;
+    }
+
+    T* getById(int id) final {
+        return items.find(id);
+    }
+
+    std::vector<T> getAll() const final {
+        return items.toVector();
+    }
+
+    void forEach(const Visitor &visitor) const final {
+        for (const auto &item : items) visitor(item);
+    }
+
+    size_t size() const final {
+        return items.size();
+    }
+
+    SlotHandle getHandle(int id) const final {
+        return items.handleOf(id);
+    }
+
+    T* resolve(SlotHandle handle) final {
+        return items.resolve(handle);
+    }
+
+    void attachJournal(std::shared_ptr<IJournal> journal) final {
+        items.attachJournal(journal);
     }
 };
 
-class PrescriptionService {
-private:
-    std::shared_ptr<IPrescriptionRepository> prescRepo;
-    PatientService &patientService;
-    DoctorService &doctorService;
-    MedicationService &medicationService;
-    std::shared_ptr<ILogger> logger;
-    std::shared_ptr<IDisplayManager> display;
-    int nextPrescriptionId = 1;
+struct PatientDisease {
+    typedef std::string Key;
+    static const std::string &of(const Patient &patient) { return patient.getDisease(); }
+};
+
+struct PatientAge {
+    typedef int Key;
+    static int of(const Patient &patient) { return patient.getAge(); }
+};
+
+typedef KeyedIndex<Patient, PatientDisease> PatientDiseaseIndex;
+typedef KeyedIndex<Patient, PatientAge, AgeIndex> PatientAgeIndex;
 
+class InMemoryPatientRepository final
+    : public InMemoryRepository<Patient, IPatientRepository, IndexSet<PatientDiseaseIndex, PatientAgeIndex>> {
 public:
-    PrescriptionService(std::shared_ptr<IPrescriptionRepository> repo,
-                       PatientService &ps, DoctorService &ds, MedicationService &ms,
-                       std::shared_ptr<ILogger> log,
-                       std::shared_ptr<IDisplayManager> disp)
-        : prescRepo(repo), patientService(ps), doctorService(ds), 
-          medicationService(ms), logger(log), display(disp) {}
-          
-    void createPrescription(int patientId, int doctorId, const std::string &date,
-                           const std::vector<int> &medicationIds, const std::string &instructions = "") {
-        // Validate patient and doctor
-        if (!patientService.getPatientById(patientId)) {
-            logger->logWarning("Failed to create prescription: Invalid Patient ID: " + std::to_string(patientId));
-            display->displayError("Invalid Patient ID.");
-            return;
+    void forEachByDisease(const std::string &disease, const Visitor &visitor) const override {
+        for (int id : index<PatientDiseaseIndex>().get().find(disease)) {
+            visitor(*items.find(id));
         }
-        
-        if (!doctorService.getDoctorById(doctorId)) {
-            logger->logWarning("Failed to create prescription: Invalid Doctor ID: " + std::to_string(doctorId));
-            display->displayError("Invalid Doctor ID.");
-            return;
+    }
+
+    void forEachInAgeRange(int minAge, int maxAge, const Visitor &visitor) const override {
+        index<PatientAgeIndex>().get().forEachInRange(minAge, maxAge, [&](int id) {
+            visitor(*items.find(id));
+        });
+    }
+
+    size_t countByAgeRange(int minAge, int maxAge) const override {
+        return index<PatientAgeIndex>().get().countInRange(minAge, maxAge);
+    }
+};
+
+struct DoctorSpecialization {
+    typedef std::string Key;
+    static const std::string &of(const Doctor &doctor) { return doctor.getSpecialization(); }
+};
+
+typedef KeyedIndex<Doctor, DoctorSpecialization> DoctorSpecializationIndex;
+
+class InMemoryDoctorRepository final
+    : public InMemoryRepository<Doctor, IDoctorRepository, IndexSet<DoctorSpecializationIndex>> {
+public:
+    void forEachBySpecialization(const std::string &specialization, const Visitor &visitor) const override {
+        for (int id : index<DoctorSpecializationIndex>().get().find(specialization)) {
+            visitor(*items.find(id));
         }
-        
-        // Validate all medications
-        for (int medId : medicationIds) {
-            if (!medicationService.getMedicationById(medId)) {
-                logger->logWarning("Failed to create prescription: Invalid Medication ID: " + std::to_string(medId));
-                display->displayError("Invalid Medication ID: " + std::to_string(medId));
-                return;
+    }
+
+    void forEachAvailable(const Visitor &visitor) const override {
+        for (const auto &d : items) {
+            if (d.getAvailability()) {
+                visitor(d);
             }
         }
-        
-        Prescription p(nextPrescriptionId++, patientId, doctorId, date, medicationIds, instructions);
-        prescRepo->add(p);
-        
-        // Update patient's medication list
-        Patient* patient = patientService.getPatientById(patientId);
-        for (int medId : medicationIds) {
-            patient->addMedicationId(medId);
-        }
-        
-        logger->logInfo("Created prescription for Patient ID " + std::to_string(patientId) + 
-                       " by Doctor ID " + std::to_string(doctorId));
-        display->displaySuccess("Prescription created successfully with ID: " + std::to_string(p.getPrescriptionId()));
     }
-    
-    void updatePrescription(int prescriptionId, const std::vector<int> &medicationIds, 
-                           const std::string &instructions) {
-        Prescription* p = prescRepo->getById(prescriptionId);
-        if (!p) {
-            logger->logWarning("Failed to update: Prescription not found with ID: " + std::to_string(prescriptionId));
-            display->displayError("Prescription not found.");
-            return;
-        }
-        
-        // Validate all medications
-        for (int medId : medicationIds) {
-            if (!medicationService.getMedicationById(medId)) {
-                logger->logWarning("Failed to update prescription: Invalid Medication ID: " + std::to_string(medId));
-                display->displayError("Invalid Medication ID: " + std::to_string(medId));
-                return;
-            }
+};
+
+struct AppointmentStatus {
+    typedef Symbol Key;
+    static Symbol of(const Appointment &appt) { return appt.getStatusSymbol(); }
+};
+
+struct AppointmentDay {
+    typedef int Key;
+    static int of(const Appointment &appt) { return appt.getDay(); }
+};
+
+// Index policy for the doctor/day/slot calendar. Cancelled appointments and
+// ones outside the standard slots hold no slot.
+class BookedSlots {
+private:
+    SlotCalendar calendar;
+
+public:
+    struct Snapshot {
+        int doctorId;
+        int day;
+        int slot; // Negative when the appointment holds no slot
+    };
+
+private:
+    void setBooked(const Snapshot &booking, bool booked) {
+        if (booking.slot < 0) return;
+        if (booked) {
+            calendar.book(booking.doctorId, booking.day, booking.slot);
+        } else {
+            calendar.release(booking.doctorId, booking.day, booking.slot);
         }
-        
-        // Update the patient's medication list
-        Patient* patient = patientService.getPatientById(p->getPatientId());
-        if (patient) {
-            // Remove old medications
-            for (int medId : p->getMedicationIds()) {
-                patient->removeMedicationId(medId);
-            }
-            
-            // Add new medications
-            for (int medId : medicationIds) {
-                patient->addMedicationId(medId);
+    }
+
+public:
+    Snapshot snapshot(const Appointment &appt) const {
+        Snapshot booking = {appt.getDoctorId(), appt.getDay(), appt.getSlot()};
+        if (appt.getStatusSymbol() == known().cancelled || booking.day == InvalidDay) booking.slot = -1;
+        return booking;
+    }
+
+    void insert(int, const Appointment &appt) { setBooked(snapshot(appt), true); }
+    void erase(int, const Appointment &appt) { setBooked(snapshot(appt), false); }
+
+    void update(int, const Snapshot &before, const Appointment &appt) {
+        setBooked(before, false);
+        setBooked(snapshot(appt), true);
+    }
+
+    // Whether wanted is a slot held by some appointment other than the one
+    // whose booking is own
+    bool heldByOther(const Snapshot &wanted, const Snapshot &own) const {
+        if (wanted.slot < 0) return false;
+        if (own.slot == wanted.slot && own.day == wanted.day && own.doctorId == wanted.doctorId) return false;
+        return calendar.isBooked(wanted.doctorId, wanted.day, wanted.slot);
+    }
+
+    const SlotCalendar &get() const { return calendar; }
+};
+
+typedef KeyedIndex<Appointment, AppointmentStatus> AppointmentStatusIndex;
+typedef KeyedIndex<Appointment, AppointmentDay, DayPartitions> AppointmentDayIndex;
+
+class InMemoryAppointmentRepository final
+    : public InMemoryRepository<Appointment, IAppointmentRepository,
+                                IndexSet<AppointmentStatusIndex, AppointmentDayIndex, BookedSlots>> {
+public:
+    void forEachByPatientId(int patientId, const Visitor &visitor) const override {
+        for (const auto &a : items) {
+            if (a.getPatientId() == patientId) {
+                visitor(a);
             }
         }
-        
-        // Update prescription with new medications and instructions
-        p->getMedicationIds() = medicationIds;
-        p->setInstructions(instructions);
-        
-        logger->logInfo("Updated prescription with ID: " + std::to_string(prescriptionId));
-        display->displaySuccess("Prescription updated successfully.");
     }
-    
-    void removePrescription(int prescriptionId) {
-        Prescription* p = prescRepo->getById(prescriptionId);
-        if (!p) {
-            logger->logWarning("Failed to remove: Prescription not found with ID: " + std::to_string(prescriptionId));
-            display->displayError("Prescription not found.");
-            return;
-        }
-        
-        // Remove medications from patient's list
-        Patient* patient = patientService.getPatientById(p->getPatientId());
-        if (patient) {
-            for (int medId : p->getMedicationIds()) {
-                patient->removeMedicationId(medId);
+
+    void forEachByDoctorId(int doctorId, const Visitor &visitor) const override {
+        for (const auto &a : items) {
+            if (a.getDoctorId() == doctorId) {
+                visitor(a);
             }
         }
-        
-        if (prescRepo->remove(prescriptionId)) {
-            logger->logInfo("Removed prescription with ID: " + std::to_string(prescriptionId));
-            display->displaySuccess("Prescription removed successfully.");
+    }
+
+    void forEachByDate(const std::string &date, const Visitor &visitor) const override {
+        int day = parseDayNumber(date);
+        if (day == InvalidDay) return;
+        for (int id : index<AppointmentDayIndex>().get().find(day)) {
+            visitor(*items.find(id));
         }
     }
-    
-    void listAllPrescriptions() const {
-        auto prescriptions = prescRepo->getAll();
-        if (prescriptions.empty()) {
-            display->displayInfo("No prescriptions found.");
-            return;
+
+    void forEachByStatus(const std::string &status, const Visitor &visitor) const override {
+        for (int id : index<AppointmentStatusIndex>().get().find(symbols().lookup(status))) {
+            visitor(*items.find(id));
         }
-        display->displayInfo("List of all prescriptions:");
-        for (const auto &p : prescriptions) {
-            p.display();
-            std::cout << "-------------------------\n";
+    }
+
+    void forEachInDateRange(int fromDay, int toDay, const Visitor &visitor) const override {
+        index<AppointmentDayIndex>().get().forEachInRange(fromDay, toDay, [&](int id) {
+            visitor(*items.find(id));
+        });
+    }
+
+    size_t archiveDaysBefore(int day, const Visitor &archive) override {
+        std::vector<int> ids = index<AppointmentDayIndex>().get().idsBefore(day);
+        for (int id : ids) {
+            archive(*items.find(id));
+            remove(id);
         }
+        return ids.size();
     }
-    
-    void listPrescriptionsByPatient(int patientId) const {
-        auto prescriptions = prescRepo->findByPatientId(patientId);
-        if (prescriptions.empty()) {
-            display->displayInfo("No prescriptions found for patient ID: " + std::to_string(patientId));
-            return;
+
+    bool isSlotBooked(int doctorId, const std::string &date, const std::string &timeSlot) const override {
+        int day = parseDayNumber(date);
+        int slot = timeSlotIndex(timeSlot);
+        return day != InvalidDay && slot >= 0 && index<BookedSlots>().get().isBooked(doctorId, day, slot);
+    }
+
+    std::vector<std::string> findFreeSlots(int doctorId, const std::string &date) const override {
+        std::vector<std::string> result;
+        int day = parseDayNumber(date);
+        if (day == InvalidDay) return result;
+        uint16_t booked = index<BookedSlots>().get().bookedMask(doctorId, day);
+        for (int slot = 0; slot < TimeSlotCount; ++slot) {
+            if (!((booked >> slot) & 1u)) result.push_back(TimeSlots[slot]);
         }
-        display->displayInfo("Prescriptions for patient ID " + std::to_string(patientId) + ":");
-        for (const auto &p : prescriptions) {
-            p.display();
-            std::cout << "-------------------------\n";
+        return result;
+    }
+
+    bool addIfSlotFree(const Appointment &appt) override {
+        if (appt.getStatusSymbol() != known().cancelled &&
+            isSlotBooked(appt.getDoctorId(), appt.getDate(), appt.getTimeSlot())) {
+            return false;
         }
+        add(appt);
+        return true;
     }
-    
-    void listPrescriptionsByDoctor(int doctorId) const {
-        auto prescriptions = prescRepo->findByDoctorId(doctorId);
-        if (prescriptions.empty()) {
-            display->displayInfo("No prescriptions found for doctor ID: " + std::to_string(doctorId));
-            return;
-        }
-        display->displayInfo("Prescriptions by doctor ID " + std::to_string(doctorId) + ":");
-        for (const auto &p : prescriptions) {
-            p.display();
-            std::cout << "-------------------------\n";
-        }
-    }
-    
-    Prescription* getPrescriptionById(int id) {
-        return prescRepo->getById(id);
+
+    bool updateIfSlotFree(int id, const std::function<void(Appointment &)> &mutator) override {
+        const Appointment* current = items.find(id);
+        if (!current) return false;
+        Appointment next(*current);
+        mutator(next);
+        const BookedSlots &slots = index<BookedSlots>();
+        if (slots.heldByOther(slots.snapshot(next), slots.snapshot(*current))) return false;
+        return update(id, [&](Appointment &appt) { appt = next; });
     }
 };
 
-class BillingService {
-private:
-    std::shared_ptr<IBillRepository> billRepo;
-    PatientService &patientService;
-    DoctorService &doctorService;
-    std::shared_ptr<ILogger> logger;
-    std::shared_ptr<IDisplayManager> display;
-    int nextBillId = 1;
+class InMemoryMedicationRepository final : public InMemoryRepository<Medication, IMedicationRepository> {
+public:
+    Medication* findByName(const std::string &name) override {
+        for (const auto &m : items)
+            if (m.getName() == name)
+                return items.find(m.getMedicationId());
+        return nullptr;
+    }
+
+    bool inspectByName(const std::string &name, const std::function<void(const Medication &)> &reader) override {
+        Medication* medication = findByName(name);
+        if (!medication) return false;
+        reader(*medication);
+        return true;
+    }
+
+    bool addIfNameFree(const Medication &medication) override {
+        if (findByName(medication.getName())) return false;
+        add(medication);
+        return true;
+    }
 
+    bool updateIfNameFree(int id, const std::function<void(Medication &)> &mutator) override {
+        const Medication* current = items.find(id);
+        if (!current) return false;
+        Medication next(*current);
+        mutator(next);
+        Medication* holder = findByName(next.getName());
+        if (holder && holder->getMedicationId() != id) return false;
+        return update(id, [&](Medication &medication) { medication = next; });
+    }
+};
+
+class InMemoryPrescriptionRepository final : public InMemoryRepository<Prescription, IPrescriptionRepository> {
 public:
-    BillingService(std::shared_ptr<IBillRepository> repo,
-                  PatientService &ps, DoctorService &ds,
-                  std::shared_ptr<ILogger> log,
-                  std::shared_ptr<IDisplayManager> disp)
-        : billRepo(repo), patientService(ps), doctorService(ds), 
-          logger(log), display(disp) {}
-          
-    void generateBill(int patientId, const std::string &date, double consultationFee,
-                     double medicationCharges = 0.0, double otherCharges = 0.0) {
-        // Validate patient
-        if (!patientService.getPatientById(patientId)) {
-            logger->logWarning("Failed to generate bill: Invalid Patient ID: " + std::to_string(patientId));
-            display->displayError("Invalid Patient ID.");
-            return;
+    void forEachByPatientId(int patientId, const Visitor &visitor) const override {
+        for (const auto &p : items) {
+            if (p.getPatientId() == patientId) {
+                visitor(p);
+            }
         }
-        
-        Bill bill(nextBillId++, patientId, date, consultationFee, medicationCharges, otherCharges);
-        billRepo->add(bill);
-        
-        logger->logInfo("Generated bill for Patient ID " + std::to_string(patientId) + 
-                       " with total amount: $" + std::to_string(bill.getTotalAmount()));
-        display->displaySuccess("Bill generated successfully with ID: " + 
-                              std::to_string(bill.getBillId()) + 
-                              " (Total: $" + std::to_string(bill.getTotalAmount()) + ")");
     }
-    
-    void updateBillPaymentStatus(int billId, const std::string &status, const std::string &paymentMethod = "") {
-        Bill* bill = billRepo->getById(billId);
-        if (!bill) {
-            logger->logWarning("Failed to update: Bill not found with ID: " + std::to_string(billId));
-            display->displayError("Bill not found.");
-            return;
-        }
-        
-        bill->setPaymentStatus(status);
-        if (!paymentMethod.empty()) {
-            bill->setPaymentMethod(paymentMethod);
+
+    void forEachByDoctorId(int doctorId, const Visitor &visitor) const override {
+        for (const auto &p : items) {
+            if (p.getDoctorId() == doctorId) {
+                visitor(p);
+            }
         }
-        
-        logger->logInfo("Updated bill payment status: ID " + std::to_string(billId) + 
-                       " to " + status + 
-                       (paymentMethod.empty() ? "" : " (Method: " + paymentMethod + ")"));
-        display->displaySuccess("Bill payment status updated successfully.");
     }
-    
-    void listAllBills() const {
-        auto bills = billRepo->getAll();
-        if (bills.empty()) {
-            display->displayInfo("No bills found.");
-            return;
-        }
-        display->displayInfo("List of all bills:");
-        for (const auto &b : bills) {
-            b.display();
-            std::cout << "-------------------------\n";
+};
+
+// Running revenue totals over a set of bills, grouped by payment status,
+// payment method and day. A group is dropped when its last bill leaves.
+// Kept current as a bill repository's index policy.
+class RevenueLedger {
+public:
+    // The parts of a bill the ledger counts
+    struct Snapshot {
+        Money amount;
+        Symbol status;
+        Symbol method;
+        int day;
+    };
+
+private:
+    RevenueTotal overall;
+    std::unordered_map<Symbol, RevenueTotal> byStatus;
+    std::unordered_map<Symbol, RevenueTotal> byMethod;
+    std::map<int, RevenueTotal> byDay;
+
+    static void apply(RevenueTotal &total, Money amount, bool insert) {
+        if (insert) {
+            ++total.bills;
+            total.amount += amount;
+        } else {
+            --total.bills;
+            total.amount -= amount;
         }
     }
-    
-    void listBillsByPatient(int patientId) const {
-        auto bills = billRepo->findByPatientId(patientId);
-        if (bills.empty()) {
-            display->displayInfo("No bills found for patient ID: " + std::to_string(patientId));
-            return;
-        }
-        display->displayInfo("Bills for patient ID " + std::to_string(patientId) + ":");
-        for (const auto &b : bills) {
-            b.display();
-            std::cout << "-------------------------\n";
+
+    template <typename Map, typename Key>
+    static void applyTo(Map &groups, const Key &key, Money amount, bool insert) {
+        auto found = groups.find(key);
+        if (found == groups.end()) {
+            if (!insert) return;
+            found = groups.emplace(key, RevenueTotal()).first;
         }
+        apply(found->second, amount, insert);
+        if (found->second.bills == 0) groups.erase(found);
     }
-    
-    void listBillsByPaymentStatus(const std::string &status) const {
-        auto bills = billRepo->findByPaymentStatus(status);
-        if (bills.empty()) {
-            display->displayInfo("No bills found with payment status: " + status);
-            return;
-        }
-        display->displayInfo("Bills with payment status '" + status + "':");
-        for (const auto &b : bills) {
-            b.display();
-            std::cout << "-------------------------\n";
-        }
+
+    template <typename Map>
+    static void addNamed(const Map &groups, std::map<std::string, RevenueTotal> &result) {
+        for (const auto &group : groups) result[symbols().name(group.first)] += group.second;
     }
-    
-    double getTotalRevenue() const {
-        double total = billRepo->getTotalRevenue();
-        display->displayInfo("Total revenue: $" + std::to_string(total));
-        return total;
+
+    void record(const Snapshot &bill, bool insert) {
+        apply(overall, bill.amount, insert);
+        applyTo(byStatus, bill.status, bill.amount, insert);
+        applyTo(byMethod, bill.method, bill.amount, insert);
+        applyTo(byDay, bill.day, bill.amount, insert);
     }
-    
-    Bill* getBillById(int id) {
-        return billRepo->getById(id);
+
+public:
+    Snapshot snapshot(const Bill &bill) const {
+        return Snapshot{bill.getTotalAmount(), bill.getPaymentStatusSymbol(), bill.getPaymentMethodSymbol(),
+                        bill.getDay()};
+    }
+
+    void insert(int, const Bill &bill) { record(snapshot(bill), true); }
+    void erase(int, const Bill &bill) { record(snapshot(bill), false); }
+
+    void update(int, const Snapshot &before, const Bill &bill) {
+        record(before, false);
+        record(snapshot(bill), true);
+    }
+
+    const RevenueTotal &total() const { return overall; }
+
+    RevenueTotal forPaymentStatus(Symbol status) const {
+        auto found = byStatus.find(status);
+        return found != byStatus.end() ? found->second : RevenueTotal();
     }
+
+    RevenueTotal forDateRange(int fromDay, int toDay) const {
+        RevenueTotal result;
+        if (fromDay > toDay) return result;
+        for (auto it = byDay.lower_bound(fromDay); it != byDay.end() && it->first <= toDay; ++it) {
+            result += it->second;
+        }
+        return result;
+    }
+
+    // Totals are added into result, so shards can share one map
+    void addByPaymentStatus(std::map<std::string, RevenueTotal> &result) const { addNamed(byStatus, result); }
+    void addByPaymentMethod(std::map<std::string, RevenueTotal> &result) const { addNamed(byMethod, result); }
 };
 
-// ------------------------------
-// Application / User Interface
-// ------------------------------
+// Index policy that mirrors bills into BillColumns; a row always holds the
+// bill's latest state
+class BillColumnIndex {
+private:
+    BillColumns columns;
 
-class HospitalManagementApp {
+public:
+    struct Snapshot {};
+
+    Snapshot snapshot(const Bill &) const { return Snapshot(); }
+    void insert(int, const Bill &bill) { columns.upsert(bill); }
+    void erase(int id, const Bill &) { columns.erase(id); }
+    void update(int, const Snapshot &, const Bill &bill) { columns.upsert(bill); }
+
+    const BillColumns &get() const { return columns; }
+};
+
+struct BillPaymentStatus {
+    typedef Symbol Key;
+    static Symbol of(const Bill &bill) { return bill.getPaymentStatusSymbol(); }
+};
+
+struct BillDay {
+    typedef int Key;
+    static int of(const Bill &bill) { return bill.getDay(); }
+};
+
+typedef KeyedIndex<Bill, BillPaymentStatus> BillPaymentStatusIndex;
+typedef KeyedIndex<Bill, BillDay, DayPartitions> BillDayIndex;
+
+class InMemoryBillRepository final
+    : public InMemoryRepository<Bill, IBillRepository,
+                                IndexSet<BillPaymentStatusIndex, BillDayIndex, RevenueLedger, BillColumnIndex>> {
 private:
-    // Cross-cutting concerns
-    std::shared_ptr<ILogger> logger;
-    std::shared_ptr<IDisplayManager> display;
-    
-    // Repositories
-    std::shared_ptr<IPatientRepository> patientRepo;
-    std::shared_ptr<IDoctorRepository> doctorRepo;
-    std::shared_ptr<IAppointmentRepository> appointmentRepo;
-    std::shared_ptr<IMedicationRepository> medicationRepo;
-    std::shared_ptr<IPrescriptionRepository> prescriptionRepo;
-    std::shared_ptr<IBillRepository> billRepo;
-    std::shared_ptr<IUserRepository> userRepo;
-    
-    // Services
-    AuthenticationService authService;
-    PatientService patientService;
-    DoctorService doctorService;
-    AppointmentService appointmentService;
-    MedicationService medicationService;
-    PrescriptionService prescriptionService;
-    BillingService billingService;
-    
-    bool isLoggedIn = false;
+    const RevenueLedger &revenue() const { return index<RevenueLedger>(); }
+    const BillColumns &columns() const { return index<BillColumnIndex>().get(); }
 
-    // Helper function to read a line of text
-    std::string readLine() {
-        std::string input;
-        std::getline(std::cin, input);
-        return input;
+public:
+    void forEachByPatientId(int patientId, const Visitor &visitor) const override {
+        for (int id : columns().idsForPatient(patientId)) {
+            visitor(*items.find(id));
+        }
     }
 
-    // Helper function to read an integer
-    int readInt() {
-        int value;
-        while (!(std::cin >> value)) {
-            std::cin.clear();
-            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-            display->displayError("Invalid input. Please enter a number.");
-            std::cout << "Enter a number: ";
+    void forEachByPaymentStatus(const std::string &status, const Visitor &visitor) const override {
+        for (int id : index<BillPaymentStatusIndex>().get().find(symbols().lookup(status))) {
+            visitor(*items.find(id));
         }
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-        return value;
     }
-    
-    // Helper function to read a double
-    double readDouble() {
-        double value;
-        while (!(std::cin >> value)) {
-            std::cin.clear();
-            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-            display->displayError("Invalid input. Please enter a number.");
-            std::cout << "Enter a number: ";
-        }
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-        return value;
+
+    void forEachInDateRange(int fromDay, int toDay, const Visitor &visitor) const override {
+        index<BillDayIndex>().get().forEachInRange(fromDay, toDay, [&](int id) {
+            visitor(*items.find(id));
+        });
     }
-    
-    // Helper function to get date input
-    std::string getDateInput(const std::string &prompt = "Enter Date (YYYY-MM-DD): ") {
-        std::cout << prompt;
-        return readLine();
+
+    Money getTotalRevenue() const override {
+        return revenue().total().amount;
     }
-    
-    // Helper function to get time slot input
-    std::string getTimeSlotInput() {
-        std::cout << "Available time slots:\n";
-        std::cout << "1. 09:00-09:30\n";
-        std::cout << "2. 09:30-10:00\n";
-        std::cout << "3. 10:00-10:30\n";
-        std::cout << "4. 10:30-11:00\n";
-        std::cout << "5. 11:00-11:30\n";
-        std::cout << "6. 11:30-12:00\n";
-        std::cout << "7. 14:00-14:30\n";
-        std::cout << "8. 14:30-15:00\n";
-        std::cout << "9. 15:00-15:30\n";
-        std::cout << "10. 15:30-16:00\n";
-        std::cout << "Enter your choice (1-10): ";
-        
-        int choice = readInt();
-        std::string timeSlot;
-        
-        switch (choice) {
-            case 1: timeSlot = "09:00-09:30"; break;
-            case 2: timeSlot = "09:30-10:00"; break;
-            case 3: timeSlot = "10:00-10:30"; break;
-            case 4: timeSlot = "10:30-11:00"; break;
-            case 5: timeSlot = "11:00-11:30"; break;
-            case 6: timeSlot = "11:30-12:00"; break;
-            case 7: timeSlot = "14:00-14:30"; break;
-            case 8: timeSlot = "14:30-15:00"; break;
-            case 9: timeSlot = "15:00-15:30"; break;
-            case 10: timeSlot = "15:30-16:00"; break;
-            default: timeSlot = "09:00-09:30"; break;
-        }
-        
-        return timeSlot;
+
+    RevenueTotal getRevenueForPaymentStatus(const std::string &status) const override {
+        return revenue().forPaymentStatus(symbols().lookup(status));
     }
 
-    void displayLoginMenu() {
-        std::cout << "\n----- Hospital Management System Login -----\n";
-        std::cout << "1. Login\n";
-        std::cout << "2. Exit\n";
-        std::cout << "Enter your choice: ";
+    std::map<std::string, RevenueTotal> getRevenueByPaymentStatus() const override {
+        std::map<std::string, RevenueTotal> result;
+        revenue().addByPaymentStatus(result);
+        return result;
     }
 
-    void displayMainMenu() {
-        std::cout << "\n----- Hospital Management System Menu -----\n";
-        
-        // Only show admin options if user has admin role
-        if (authService.hasRole("Admin")) {
-            std::cout << "==== Admin Functions ====\n";
-            std::cout << "1. User Management\n";
-            std::cout << "2. View System Logs\n";
-            std::cout << "3. Financial Reports\n";
-        }
-        
-        std::cout << "==== Patient Management ====\n";
-        std::cout << "4. Add Patient\n";
-        std::cout << "5. Update Patient\n";
-        std::cout << "6. Remove Patient\n";
-        std::cout << "7. List All Patients\n";
-        std::cout << "8. Find Patients by Disease\n";
-        std::cout << "9. Find Patients by Age Range\n";
-        
-        std::cout << "==== Doctor Management ====\n";
-        std::cout << "10. Add Doctor\n";
-        std::cout << "11. Update Doctor\n";
-        std::cout << "12. Remove Doctor\n";
-        std::cout << "13. List All Doctors\n";
-        std::cout << "14. List Available Doctors\n";
-        std::cout << "15. Find Doctors by Specialization\n";
-        std::cout << "16. Set Doctor Availability\n";
-        
-        std::cout << "==== Appointment Management ====\n";
-        std::cout << "17. Book Appointment\n";
-        std::cout << "18. Update Appointment\n";
-        std::cout << "19. Cancel Appointment\n";
-        std::cout << "20. List All Appointments\n";
-        std::cout << "21. List Appointments by Patient\n";
-        std::cout << "22. List Appointments by Doctor\n";
-        std::cout << "23. List Appointments by Date\n";
-        
-        std::cout << "==== Medication Management ====\n";
-        std::cout << "24. Add Medication\n";
-        std::cout << "25. Update Medication\n";
-        std::cout << "26. Remove Medication\n";
-        std::cout << "27. List All Medications\n";
-        
-        std::cout << "==== Prescription Management ====\n";
-        std::cout << "28. Create Prescription\n";
-        std::cout << "29. Update Prescription\n";
-        std::cout << "30. Remove Prescription\n";
-        std::cout << "31. List Prescriptions by Patient\n";
-        
-        std::cout << "==== Billing Management ====\n";
-        std::cout << "32. Generate Bill\n";
-        std::cout << "33. Update Payment Status\n";
-        std::cout << "34. List Bills by Patient\n";
-        std::cout << "35. List Bills by Payment Status\n";
-        
-        std::cout << "==== System ====\n";
-        std::cout << "36. Logout\n";
-        std::cout << "37. Exit\n";
-        
-        std::cout << "Enter your choice: ";
+    std::map<std::string, RevenueTotal> getRevenueByPaymentMethod() const override {
+        std::map<std::string, RevenueTotal> result;
+        revenue().addByPaymentMethod(result);
+        return result;
     }
 
-    bool login() {
-        std::cout << "Enter username: ";
-        std::string username = readLine();
-        std::cout << "Enter password: ";
-        std::string password = readLine();
-        
-        if (authService.login(username, password)) {
-            display->displaySuccess("Login successful. Welcome, " + username + "!");
-            isLoggedIn = true;
-            return true;
+    RevenueTotal getRevenueForDateRange(int fromDay, int toDay) const override {
+        return revenue().forDateRange(fromDay, toDay);
+    }
+
+    RevenueTotal getRevenueWhere(const std::string &status, int fromDay, int toDay) const override {
+        DayRange range = {fromDay, toDay};
+        ColumnTotal total;
+        sumByDayRanges(columns().view(), selectStatus(status), &range, 1, &total);
+        return toRevenueTotal(total);
+    }
+
+    std::vector<RevenueTotal> getAging(const std::string &status, int asOfDay,
+                                       const std::vector<int> &ageBounds) const override {
+        std::vector<DayRange> ranges = agingRanges(asOfDay, ageBounds);
+        std::vector<ColumnTotal> totals(ranges.size());
+        sumByDayRanges(columns().view(), selectStatus(status), ranges.data(), ranges.size(), totals.data());
+        std::vector<RevenueTotal> result;
+        for (const auto &total : totals) result.push_back(toRevenueTotal(total));
+        return result;
+    }
+
+    // Exposed so sharded wrappers can merge totals without copying maps
+    const RevenueLedger &getRevenueLedger() const { return revenue(); }
+};
+
+// Users are found by name through a hash index on the case-folded name,
+// fronted by a Bloom filter so that names nobody has (mistyped logins, new
+// accounts being registered) are usually turned away without touching the
+// index at all.
+class UsernameIndex {
+private:
+    SecondaryIndex<uint64_t> idsByHash; // More than one ID only on a collision
+    BloomFilter knownNames;
+    size_t staleNames = 0; // Names removed or renamed since the filter was built
+
+    void indexName(uint64_t hash, int id) {
+        idsByHash.insert(hash, id);
+        if (knownNames.size() >= knownNames.getCapacity()) {
+            rebuildFilter(); // Includes this name, which is already indexed
         } else {
-            display->displayError("Login failed. Invalid username or password.");
-            return false;
+            knownNames.insert(hash);
         }
     }
-    
-    void logout() {
-        authService.logout();
-        isLoggedIn = false;
-        display->displayInfo("You have been logged out.");
+
+    void rebuildFilter() {
+        knownNames.reset(std::max<size_t>(1024, idsByHash.keyCount() * 2));
+        idsByHash.forEachKey([&](uint64_t hash) { knownNames.insert(hash); });
+        staleNames = 0;
     }
-    
-    void setupTestData() {
-        // Create an admin user
-        authService.registerUser("admin", "admin123", "Admin");
-        authService.registerUser("doctor", "doctor123", "Doctor");
-        authService.registerUser("reception", "reception123", "Reception");
-        
-        // Add some sample doctors
-        doctorService.addDoctor("Dr. John Smith", "Cardiology", "123-456-7890", "john@hospital.com", 100.0);
-        doctorService.addDoctor("Dr. Jane Doe", "Neurology", "987-654-3210", "jane@hospital.com", 150.0);
-        doctorService.addDoctor("Dr. Robert Johnson", "Pediatrics", "555-123-4567", "robert@hospital.com", 80.0);
-        
-        // Add some sample patients
-        patientService.addPatient("Alice Brown", 35, "Hypertension", "111-222-3333", "123 Main St", "O+");
-        patientService.addPatient("Bob Wilson", 42, "Diabetes", "444-555-6666", "456 Oak Ave", "A-");
-        patientService.addPatient("Carol Martinez", 28, "Asthma", "777-888-9999", "789 Pine Blvd", "B+");
-        
-        // Add some medications
-        medicationService.addMedication("Aspirin", "100mg", 5.99, "Bayer", "Pain reliever and anti-inflammatory");
-        medicationService.addMedication("Amoxicillin", "500mg", 15.50, "Generic", "Antibiotic");
-        medicationService.addMedication("Lisinopril", "10mg", 8.75, "Generic", "Blood pressure medication");
-        
-        logger->logInfo("Test data has been set up successfully.");
+
+public:
+    typedef std::string Snapshot;
+
+    Snapshot snapshot(const User &user) const { return user.getUsername(); }
+
+    void insert(int id, const User &user) { indexName(usernameHash(user.getUsername()), id); }
+
+    void erase(int id, const User &user) {
+        idsByHash.erase(usernameHash(user.getUsername()), id);
+        // A removed name only costs false "maybe"s; rebuild once they could add up
+        if (++staleNames > knownNames.getCapacity() / 2) rebuildFilter();
+    }
+
+    void update(int id, const Snapshot &before, const User &user) {
+        if (user.getUsername() == before) return;
+        idsByHash.erase(usernameHash(before), id);
+        ++staleNames;
+        indexName(usernameHash(user.getUsername()), id);
     }
 
+    bool mayContain(uint64_t hash) const { return knownNames.mayContain(hash); }
+    const std::set<int> &find(uint64_t hash) const { return idsByHash.find(hash); }
+};
+
+class InMemoryUserRepository final
+    : public InMemoryRepository<User, IUserRepository, IndexSet<UsernameIndex>> {
 public:
-    HospitalManagementApp()
-        : // Initialize cross-cutting concerns
-          logger(std::make_shared<FileLogger>()),
-          display(std::make_shared<ConsoleDisplayManager>()),
-          
-          // Initialize repositories
-          patientRepo(std::make_shared<InMemoryPatientRepository>()),
-          doctorRepo(std::make_shared<InMemoryDoctorRepository>()),
-          appointmentRepo(std::make_shared<InMemoryAppointmentRepository>()),
-          medicationRepo(std::make_shared<InMemoryMedicationRepository>()),
-          prescriptionRepo(std::make_shared<InMemoryPrescriptionRepository>()),
-          billRepo(std::make_shared<InMemoryBillRepository>()),
-          userRepo(std::make_shared<InMemoryUserRepository>()),
-          
-          // Initialize services
-          authService(userRepo, logger),
-          patientService(patientRepo, logger, display),
-          doctorService(doctorRepo, logger, display),
-          appointmentService(appointmentRepo, patientService, doctorService, logger, display),
-          medicationService(medicationRepo, logger, display),
-          prescriptionService(prescriptionRepo, patientService, doctorService, medicationService, logger, display),
-          billingService(billRepo, patientService, doctorService, logger, display) {
-        
-        // Setup test data
-        setupTestData();
+    User* findByUsername(const std::string &username) override {
+        return findByUsername(username, usernameHash(username));
     }
 
-    void run() {
-        // First handle login
-        bool exitProgram = false;
-        while (!exitProgram && !isLoggedIn) {
-            displayLoginMenu();
-            int choice = readInt();
-            
-            switch (choice) {
-                case 1:
-                    if (login()) {
-                        runMainApplication();
-                    }
-                    break;
-                case 2:
-                    exitProgram = true;
-                    display->displayInfo("Exiting program. Goodbye!");
-                    break;
-                default:
-                    display->displayError("Invalid choice. Please try again.");
+    // For callers that look the same name up in several repositories
+    User* findByUsername(const std::string &username, uint64_t hash) {
+        const UsernameIndex &names = index<UsernameIndex>();
+        if (!names.mayContain(hash)) return nullptr;
+        for (int id : names.find(hash)) {
+            User* user = items.find(id);
+            if (sameUsername(user->getUsername(), username)) return user;
+        }
+        return nullptr;
+    }
+
+    bool inspectByUsername(const std::string &username, const std::function<void(const User &)> &reader) override {
+        User* user = findByUsername(username);
+        if (!user) return false;
+        reader(*user);
+        return true;
+    }
+
+    bool addIfUsernameFree(const User &user) override {
+        if (findByUsername(user.getUsername())) return false;
+        add(user);
+        return true;
+    }
+
+    void forEachByRole(const std::string &role, const Visitor &visitor) const override {
+        Symbol wanted = symbols().lookup(role);
+        for (const auto &u : items) {
+            if (u.getRoleSymbol() == wanted) {
+                visitor(u);
             }
         }
     }
+};
 
-    void runMainApplication() {
-        int choice = 0;
-        while (isLoggedIn && choice != 37) {
-            displayMainMenu();
-            choice = readInt();
-            
-            // Process the menu choice
-            processMenuChoice(choice);
+// ------------------------------
+// Concurrent Repository Implementations
+// ------------------------------
+
+// Splits a repository into independently locked shards keyed by ID so that
+// sessions working on different records do not contend. Each shard is an
+// ordinary in-memory repository behind a reader-writer lock: lookups take it
+// shared and mutations exclusive. Copying queries lock one shard at a time;
+// visitors read-lock every shard for the duration of the visit, always in
+// shard order, and since writers only ever hold one lock this cannot deadlock.
+//
+// Pointers from getById()/resolve() are not protected once the call returns;
+// code that may run alongside writers should go through inspect()/update().
+template <typename T, typename Interface, typename Inner>
+class ShardedRepository : public Interface {
+protected:
+    static const uint32_t ShardCount = 16;
+
+    struct Shard {
+        mutable std::shared_timed_mutex mutex;
+        Inner repo;
+    };
+    Shard shards[ShardCount];
+
+    typedef std::shared_lock<std::shared_timed_mutex> ReadLock;
+    typedef std::unique_lock<std::shared_timed_mutex> WriteLock;
+
+    static uint32_t shardOf(int id) { return static_cast<uint32_t>(id) % ShardCount; }
+
+    // Collects a per-shard query from every shard and restores ID order
+    template <typename Query>
+    std::vector<T> gather(Query query) const {
+        std::vector<T> result;
+        for (const Shard &shard : shards) {
+            ReadLock lock(shard.mutex);
+            std::vector<T> part = query(shard.repo);
+            result.insert(result.end(), std::make_move_iterator(part.begin()),
+                          std::make_move_iterator(part.end()));
         }
+        std::sort(result.begin(), result.end(), [](const T &a, const T &b) {
+            return EntityCodec<T>::id(a) < EntityCodec<T>::id(b);
+        });
+        return result;
     }
-    
-    void processMenuChoice(int choice) {
-        // Admin functions (1-3)
-        if (choice >= 1 && choice <= 3 && !authService.hasRole("Admin")) {
-            display->displayError("Access denied. Admin privileges required.");
-            return;
+
+    static bool idLess(const T &a, const T &b) {
+        return EntityCodec<T>::id(a) < EntityCodec<T>::id(b);
+    }
+
+    // Copies the items a per-shard visit yields with every shard read-locked,
+    // so they all come from one moment, then lets the locks go before handing
+    // the copies to the visitor in the given order. A slow visitor holds up
+    // no writer, and one that calls back into the repository cannot deadlock.
+    template <typename Visit, typename Less>
+    void visitInOrder(Visit visit, Less less, const std::function<void(const T &)> &visitor) const {
+        std::vector<T> items;
+        {
+            std::vector<ReadLock> locks;
+            locks.reserve(ShardCount);
+            for (const Shard &shard : shards) {
+                locks.emplace_back(shard.mutex);
+                visit(shard.repo, [&](const T &item) { items.push_back(item); });
+            }
         }
-        
-        switch (choice) {
-            // Admin Functions
-            case 1: manageUsers(); break;
-            case 2: viewSystemLogs(); break;
-            case 3: generateFinancialReports(); break;
-            
-            // Patient Management
-            case 4: addPatient(); break;
-            case 5: updatePatient(); break;
-            case 6: removePatient(); break;
-            case 7: listAllPatients(); break;
-            case 8: findPatientsByDisease(); break;
-            case 9: findPatientsByAgeRange(); break;
-            
-            // Doctor Management
-            case 10: addDoctor(); break;
-            case 11: updateDoctor(); break;
-            case 12: removeDoctor(); break;
-            case 13: listAllDoctors(); break;
-            case 14: listAvailableDoctors(); break;
-            case 15: findDoctorsBySpecialization(); break;
-            case 16: setDoctorAvailability(); break;
-            
-            // Appointment Management
-            case 17: bookAppointment(); break;
-            case 18: updateAppointment(); break;
-            case 19: cancelAppointment(); break;
-            case 20: listAllAppointments(); break;
-            case 21: listAppointmentsByPatient(); break;
-            case 22: listAppointmentsByDoctor(); break;
-            case 23: listAppointmentsByDate(); break;
-            
-            // Medication Management
-            case 24: addMedication(); break;
-            case 25: updateMedication(); break;
-            case 26: removeMedication(); break;
-            case 27: listAllMedications(); break;
-            
-            // Prescription Management
-            case 28: createPrescription(); break;
-            case 29: updatePrescription(); break;
-            case 30: removePrescription(); break;
-            case 31: listPrescriptionsByPatient(); break;
-            
-            // Billing Management
-            case 32: generateBill(); break;
-            case 33: updateBillPaymentStatus(); break;
-            case 34: listBillsByPatient(); break;
-            case 35: listBillsByPaymentStatus(); break;
-            
-            // System
-            case 36: logout(); break;
-            case 37: 
-                logout();
-                display->displayInfo("Exiting application. Goodbye!");
-                break;
-            default:
-                display->displayError("Invalid choice. Please try again.");
+        std::sort(items.begin(), items.end(), less);
+        for (const T &item : items) visitor(item);
+    }
+
+    // Finds the first item matching a per-shard lookup, in shard order
+    template <typename Lookup>
+    T* findFirst(Lookup lookup) {
+        for (Shard &shard : shards) {
+            ReadLock lock(shard.mutex);
+            if (T* item = lookup(shard.repo)) return item;
         }
+        return nullptr;
     }
-    
-    // Admin Functions
-    void manageUsers() {
-        std::cout << "\n----- User Management -----\n";
-        std::cout << "1. Add User\n";
-        std::cout << "2. List All Users\n";
-        std::cout << "3. Enable/Disable User\n";
-        std::cout << "4. Back to Main Menu\n";
-        std::cout << "Enter your choice: ";
-        
-        int choice = readInt();
-        switch (choice) {
-            case 1: {
-                std::cout << "Enter username: ";
-                std::string username = readLine();
-                std::cout << "Enter password: ";
-                std::string password = readLine();
-                std::cout << "Enter role (Admin, Doctor, Reception): ";
-                std::string role = readLine();
-                
-                if (authService.registerUser(username, password, role)) {
-                    display->displaySuccess("User added successfully.");
-                } else {
-                    display->displayError("Failed to add user. Username may already exist.");
-                }
-                break;
-            }
-            case 2: {
-                auto users = authService.getAllUsers();
-                if (users.empty()) {
-                    display->displayInfo("No users registered.");
-                    return;
-                }
-                display->displayInfo("List of all users:");
-                for (const auto &u : users) {
-                    u.display();
-                    std::cout << "-------------------------\n";
-                }
-                break;
-            }
-            case 3: {
-                std::cout << "Enter user ID: ";
-                int userId = readInt();
-                std::cout << "Enable user? (1: Yes, 0: No): ";
-                int enable = readInt();
-                
-                if (authService.updateUserStatus(userId, enable == 1)) {
-                    display->displaySuccess("User status updated successfully.");
-                } else {
-                    display->displayError("Failed to update user status. User not found.");
-                }
-                break;
+
+    // Runs reader on the first item matching a per-shard lookup, in shard
+    // order, while its shard is still locked
+    template <typename Lookup>
+    bool inspectFirst(Lookup lookup, const std::function<void(const T &)> &reader) {
+        for (Shard &shard : shards) {
+            ReadLock lock(shard.mutex);
+            if (const T* item = lookup(shard.repo)) {
+                reader(*item);
+                return true;
             }
-            case 4:
-                return;
-            default:
-                display->displayError("Invalid choice. Please try again.");
         }
+        return false;
     }
-    
-    void viewSystemLogs() {
-        std::cout << "System logs are stored in hospital_log.txt\n";
-        display->displayInfo("Please check the log file for detailed system logs.");
+
+public:
+    void add(const T &item) override {
+        Shard &shard = shards[shardOf(EntityCodec<T>::id(item))];
+        WriteLock lock(shard.mutex);
+        shard.repo.add(item);
     }
-    
-    void generateFinancialReports() {
-        std::cout << "\n----- Financial Reports -----\n";
-        std::cout << "1. Total Revenue\n";
-        std::cout << "2. Pending Payments\n";
-        std::cout << "3. Back to Main Menu\n";
-        std::cout << "Enter your choice: ";
-        
-        int choice = readInt();
-        switch (choice) {
-            case 1:
-                billingService.getTotalRevenue();
-                break;
-            case 2:
-                billingService.listBillsByPaymentStatus("Pending");
-                break;
-            case 3:
-                return;
-            default:
-                display->displayError("Invalid choice. Please try again.");
-        }
+
+    bool remove(int id) override {
+        Shard &shard = shards[shardOf(id)];
+        WriteLock lock(shard.mutex);
+        return shard.repo.remove(id);
     }
-    
-    // Patient Management
-    void addPatient() {
-        std::cout << "Enter Patient Name: ";
-        std::string name = readLine();
-        std::cout << "Enter Age: ";
-        int age = readInt();
-        std::cout << "Enter Disease: ";
-        std::string disease = readLine();
-        std::cout << "Enter Contact Number (optional): ";
-        std::string contact = readLine();
-        std::cout << "Enter Address (optional): ";
-        std::string address = readLine();
-        std::cout << "Enter Blood Group (optional): ";
-        std::string bloodGroup = readLine();
-        
-        patientService.addPatient(name, age, disease, contact, address, bloodGroup);
+
+    bool update(int id, const std::function<void(T &)> &mutator) override {
+        Shard &shard = shards[shardOf(id)];
+        WriteLock lock(shard.mutex);
+        return shard.repo.update(id, mutator);
     }
-    
-    void updatePatient() {
-        std::cout << "Enter Patient ID to update: ";
-        int id = readInt();
-        std::cout << "Enter new Name: ";
-        std::string name = readLine();
-        std::cout << "Enter new Age: ";
-        int age = readInt();
-        std::cout << "Enter new Disease: ";
-        std::string disease = readLine();
-        std::cout << "Enter new Contact Number (optional): ";
-        std::string contact = readLine();
-        std::cout << "Enter new Address (optional): ";
-        std::string address = readLine();
-        std::cout << "Enter new Blood Group (optional): ";
-        std::string bloodGroup = readLine();
-        
-        patientService.updatePatient(id, name, age, disease, contact, address, bloodGroup);
+
+    bool inspect(int id, const std::function<void(const T &)> &reader) override {
+        Shard &shard = shards[shardOf(id)];
+        ReadLock lock(shard.mutex);
+        return shard.repo.inspect(id, reader);
     }
-    
-    void removePatient() {
-        std::cout << "Enter Patient ID to remove: ";
-        int id = readInt();
-        patientService.removePatient(id);
+
+    T* getById(int id) override {
+        Shard &shard = shards[shardOf(id)];
+        ReadLock lock(shard.mutex);
+        return shard.repo.getById(id);
     }
-    
-    void listAllPatients() {
-        patientService.listPatients();
+
+    std::vector<T> getAll() const override {
+        return gather([](const Inner &repo) { return repo.getAll(); });
     }
-    
-    void findPatientsByDisease() {
-        std::cout << "Enter disease to search for: ";
-        std::string disease = readLine();
-        patientService.findPatientsByDisease(disease);
+
+    void forEach(const std::function<void(const T &)> &visitor) const override {
+        visitInOrder([](const Inner &repo, const std::function<void(const T &)> &v) { repo.forEach(v); },
+                     idLess, visitor);
     }
-    
-    void findPatientsByAgeRange() {
-        std::cout << "Enter minimum age: ";
-        int minAge = readInt();
-        std::cout << "Enter maximum age: ";
-        int maxAge = readInt();
-        patientService.findPatientsByAgeRange(minAge, maxAge);
+
+    size_t size() const override {
+        size_t total = 0;
+        for (const Shard &shard : shards) {
+            ReadLock lock(shard.mutex);
+            total += shard.repo.size();
+        }
+        return total;
     }
-    
-    // Doctor Management
-    void addDoctor() {
-        std::cout << "Enter Doctor Name: ";
-        std::string name = readLine();
-        std::cout << "Enter Specialization: ";
-        std::string spec = readLine();
-        std::cout << "Enter Contact Number (optional): ";
+
+    // Handles carry the shard in their low bits
+    SlotHandle getHandle(int id) const override {
+        uint32_t shardIndex = shardOf(id);
+        const Shard &shard = shards[shardIndex];
+        ReadLock lock(shard.mutex);
+        SlotHandle handle = shard.repo.getHandle(id);
+        if (!handle.isNull()) handle.index = handle.index * ShardCount + shardIndex;
+        return handle;
+    }
+
+    T* resolve(SlotHandle handle) override {
+        if (handle.isNull()) return nullptr;
+        Shard &shard = shards[handle.index % ShardCount];
+        handle.index /= ShardCount;
+        ReadLock lock(shard.mutex);
+        return shard.repo.resolve(handle);
+    }
+
+    void attachJournal(std::shared_ptr<IJournal> journal) override {
+        for (Shard &shard : shards) {
+            WriteLock lock(shard.mutex);
+            shard.repo.attachJournal(journal);
+        }
+    }
+};
+
+class ConcurrentPatientRepository
+    : public ShardedRepository<Patient, IPatientRepository, InMemoryPatientRepository> {
+public:
+    void forEachByDisease(const std::string &disease, const Visitor &visitor) const override {
+        visitInOrder([&](const InMemoryPatientRepository &repo, const Visitor &v) {
+            repo.forEachByDisease(disease, v);
+        }, idLess, visitor);
+    }
+
+    void forEachInAgeRange(int minAge, int maxAge, const Visitor &visitor) const override {
+        visitInOrder([&](const InMemoryPatientRepository &repo, const Visitor &v) {
+            repo.forEachInAgeRange(minAge, maxAge, v);
+        }, [](const Patient &a, const Patient &b) {
+            return a.getAge() != b.getAge() ? a.getAge() < b.getAge() : a.getId() < b.getId();
+        }, visitor);
+    }
+
+    size_t countByAgeRange(int minAge, int maxAge) const override {
+        size_t count = 0;
+        for (const Shard &shard : shards) {
+            ReadLock lock(shard.mutex);
+            count += shard.repo.countByAgeRange(minAge, maxAge);
+        }
+        return count;
+    }
+};
+
+class ConcurrentDoctorRepository
+    : public ShardedRepository<Doctor, IDoctorRepository, InMemoryDoctorRepository> {
+public:
+    void forEachBySpecialization(const std::string &specialization, const Visitor &visitor) const override {
+        visitInOrder([&](const InMemoryDoctorRepository &repo, const Visitor &v) {
+            repo.forEachBySpecialization(specialization, v);
+        }, idLess, visitor);
+    }
+
+    void forEachAvailable(const Visitor &visitor) const override {
+        visitInOrder([](const InMemoryDoctorRepository &repo, const Visitor &v) {
+            repo.forEachAvailable(v);
+        }, idLess, visitor);
+    }
+};
+
+// Appointments are sharded by appointment ID, but slot conflicts are per
+// doctor, so the booked-slot calendar is kept here, sharded by doctor ID.
+// Every change holds the appointment's shard lock while it locks the
+// calendar shards involved, so a record and its slot always change together
+// and a slot check and the booking it guards are one step. Locks are only
+// ever taken data first, then calendar shards in ascending order.
+class ConcurrentAppointmentRepository
+    : public ShardedRepository<Appointment, IAppointmentRepository, InMemoryAppointmentRepository> {
+private:
+    struct CalendarShard {
+        mutable std::mutex mutex;
+        SlotCalendar calendar;
+    };
+    CalendarShard calendars[ShardCount];
+
+    // Holds the calendar shards of up to two doctors
+    class CalendarLock {
+    private:
+        std::unique_lock<std::mutex> first, second;
+
+    public:
+        CalendarLock(CalendarShard *calendars, int doctorA, int doctorB) {
+            uint32_t a = shardOf(doctorA), b = shardOf(doctorB);
+            if (a > b) std::swap(a, b);
+            first = std::unique_lock<std::mutex>(calendars[a].mutex);
+            if (b != a) second = std::unique_lock<std::mutex>(calendars[b].mutex);
+        }
+    };
+
+    // Day and slot of a booking that holds a slot, or false if it holds none
+    static bool slotOf(const Appointment &appt, int &day, int &slot) {
+        if (appt.getStatusSymbol() == known().cancelled) return false;
+        day = appt.getDay();
+        slot = appt.getSlot();
+        return day != InvalidDay && slot >= 0;
+    }
+
+    static bool dayLess(const Appointment &a, const Appointment &b) {
+        if (a.getDay() != b.getDay()) return a.getDay() < b.getDay();
+        return a.getAppointmentId() < b.getAppointmentId();
+    }
+
+    CalendarShard &calendarFor(int doctorId) { return calendars[shardOf(doctorId)]; }
+    const CalendarShard &calendarFor(int doctorId) const { return calendars[shardOf(doctorId)]; }
+
+    // The caller holds the doctor's calendar lock
+    void setSlotBooked(const Appointment &appt, bool booked) {
+        int day, slot;
+        if (!slotOf(appt, day, slot)) return;
+        SlotCalendar &calendar = calendarFor(appt.getDoctorId()).calendar;
+        if (booked) {
+            calendar.book(appt.getDoctorId(), day, slot);
+        } else {
+            calendar.release(appt.getDoctorId(), day, slot);
+        }
+    }
+
+    // Whether next would take a slot some appointment other than previous
+    // holds; the caller holds next's doctor's calendar lock
+    bool slotTaken(const Appointment &next, const Appointment *previous) const {
+        int day, slot;
+        if (!slotOf(next, day, slot)) return false;
+        int heldDay, heldSlot;
+        if (previous && slotOf(*previous, heldDay, heldSlot) && previous->getDoctorId() == next.getDoctorId() &&
+            heldDay == day && heldSlot == slot) {
+            return false;
+        }
+        return calendarFor(next.getDoctorId()).calendar.isBooked(next.getDoctorId(), day, slot);
+    }
+
+    // Stores next in place of previous (null if there is none) and moves the
+    // booked slot to match. The caller holds the shard's write lock. With
+    // checkSlot, nothing changes and false is returned if next's slot is
+    // taken; an update may keep the slot it already holds, an add may not.
+    bool replace(Shard &shard, const Appointment *previous, const Appointment &next, bool checkSlot,
+                 bool keepsOwnSlot) {
+        CalendarLock lock(calendars, previous ? previous->getDoctorId() : next.getDoctorId(), next.getDoctorId());
+        if (checkSlot && slotTaken(next, keepsOwnSlot ? previous : nullptr)) return false;
+        if (previous) setSlotBooked(*previous, false); // Before add() overwrites it
+        setSlotBooked(next, true);
+        shard.repo.add(next);
+        return true;
+    }
+
+    bool store(const Appointment &appt, bool checkSlot) {
+        Shard &shard = shards[shardOf(appt.getAppointmentId())];
+        WriteLock lock(shard.mutex);
+        return replace(shard, shard.repo.getById(appt.getAppointmentId()), appt, checkSlot, false);
+    }
+
+    // The mutator works on a copy, which replaces the stored appointment
+    bool change(int id, const std::function<void(Appointment &)> &mutator, bool checkSlot) {
+        Shard &shard = shards[shardOf(id)];
+        WriteLock lock(shard.mutex);
+        const Appointment* current = shard.repo.getById(id);
+        if (!current) return false;
+        Appointment next(*current);
+        mutator(next);
+        return replace(shard, current, next, checkSlot, true);
+    }
+
+public:
+    void add(const Appointment &appt) override {
+        store(appt, false);
+    }
+
+    bool addIfSlotFree(const Appointment &appt) override {
+        return store(appt, true);
+    }
+
+    bool remove(int id) override {
+        Shard &shard = shards[shardOf(id)];
+        WriteLock lock(shard.mutex);
+        const Appointment* existing = shard.repo.getById(id);
+        if (!existing) return false;
+        {
+            CalendarLock calendarLock(calendars, existing->getDoctorId(), existing->getDoctorId());
+            setSlotBooked(*existing, false);
+        }
+        return shard.repo.remove(id);
+    }
+
+    bool update(int id, const std::function<void(Appointment &)> &mutator) override {
+        return change(id, mutator, false);
+    }
+
+    bool updateIfSlotFree(int id, const std::function<void(Appointment &)> &mutator) override {
+        return change(id, mutator, true);
+    }
+
+    void forEachByPatientId(int patientId, const Visitor &visitor) const override {
+        visitInOrder([&](const InMemoryAppointmentRepository &repo, const Visitor &v) {
+            repo.forEachByPatientId(patientId, v);
+        }, idLess, visitor);
+    }
+
+    void forEachByDoctorId(int doctorId, const Visitor &visitor) const override {
+        visitInOrder([&](const InMemoryAppointmentRepository &repo, const Visitor &v) {
+            repo.forEachByDoctorId(doctorId, v);
+        }, idLess, visitor);
+    }
+
+    void forEachByDate(const std::string &date, const Visitor &visitor) const override {
+        visitInOrder([&](const InMemoryAppointmentRepository &repo, const Visitor &v) {
+            repo.forEachByDate(date, v);
+        }, idLess, visitor);
+    }
+
+    void forEachByStatus(const std::string &status, const Visitor &visitor) const override {
+        visitInOrder([&](const InMemoryAppointmentRepository &repo, const Visitor &v) {
+            repo.forEachByStatus(status, v);
+        }, idLess, visitor);
+    }
+
+    void forEachInDateRange(int fromDay, int toDay, const Visitor &visitor) const override {
+        visitInOrder([&](const InMemoryAppointmentRepository &repo, const Visitor &v) {
+            repo.forEachInDateRange(fromDay, toDay, v);
+        }, dayLess, visitor);
+    }
+
+    // Each shard drops its old days and their slots under its own write
+    // lock; the archive is visited once the shard locks are gone
+    size_t archiveDaysBefore(int day, const Visitor &archive) override {
+        std::vector<Appointment> removed;
+        for (Shard &shard : shards) {
+            WriteLock lock(shard.mutex);
+            shard.repo.archiveDaysBefore(day, [&](const Appointment &appt) {
+                CalendarLock calendarLock(calendars, appt.getDoctorId(), appt.getDoctorId());
+                setSlotBooked(appt, false);
+                removed.push_back(appt);
+            });
+        }
+        std::sort(removed.begin(), removed.end(), dayLess);
+        for (const Appointment &appt : removed) archive(appt);
+        return removed.size();
+    }
+
+    bool isSlotBooked(int doctorId, const std::string &date, const std::string &timeSlot) const override {
+        int day = parseDayNumber(date);
+        int slot = timeSlotIndex(timeSlot);
+        if (day == InvalidDay || slot < 0) return false;
+        const CalendarShard &shard = calendarFor(doctorId);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.calendar.isBooked(doctorId, day, slot);
+    }
+
+    std::vector<std::string> findFreeSlots(int doctorId, const std::string &date) const override {
+        std::vector<std::string> result;
+        int day = parseDayNumber(date);
+        if (day == InvalidDay) return result;
+        uint16_t booked;
+        {
+            const CalendarShard &shard = calendarFor(doctorId);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            booked = shard.calendar.bookedMask(doctorId, day);
+        }
+        for (int slot = 0; slot < TimeSlotCount; ++slot) {
+            if (!((booked >> slot) & 1u)) result.push_back(TimeSlots[slot]);
+        }
+        return result;
+    }
+};
+
+class ConcurrentMedicationRepository
+    : public ShardedRepository<Medication, IMedicationRepository, InMemoryMedicationRepository> {
+private:
+    std::mutex namesMutex; // A name may be in any shard, so adds and renames take turns
+
+public:
+    Medication* findByName(const std::string &name) override {
+        return findFirst([&](InMemoryMedicationRepository &repo) { return repo.findByName(name); });
+    }
+
+    bool inspectByName(const std::string &name, const std::function<void(const Medication &)> &reader) override {
+        return inspectFirst([&](InMemoryMedicationRepository &repo) { return repo.findByName(name); }, reader);
+    }
+
+    bool addIfNameFree(const Medication &medication) override {
+        std::lock_guard<std::mutex> lock(namesMutex);
+        if (findByName(medication.getName())) return false;
+        add(medication);
+        return true;
+    }
+
+    // The mutator works on a copy, which replaces the stored medication
+    bool updateIfNameFree(int id, const std::function<void(Medication &)> &mutator) override {
+        std::lock_guard<std::mutex> lock(namesMutex);
+        std::unique_ptr<Medication> next = copyById(id);
+        if (!next) return false;
+        mutator(*next);
+        int holderId = 0;
+        inspectByName(next->getName(), [&](const Medication &holder) { holderId = holder.getMedicationId(); });
+        if (holderId != 0 && holderId != id) return false;
+        return update(id, [&](Medication &medication) { medication = *next; });
+    }
+};
+
+class ConcurrentPrescriptionRepository
+    : public ShardedRepository<Prescription, IPrescriptionRepository, InMemoryPrescriptionRepository> {
+public:
+    void forEachByPatientId(int patientId, const Visitor &visitor) const override {
+        visitInOrder([&](const InMemoryPrescriptionRepository &repo, const Visitor &v) {
+            repo.forEachByPatientId(patientId, v);
+        }, idLess, visitor);
+    }
+
+    void forEachByDoctorId(int doctorId, const Visitor &visitor) const override {
+        visitInOrder([&](const InMemoryPrescriptionRepository &repo, const Visitor &v) {
+            repo.forEachByDoctorId(doctorId, v);
+        }, idLess, visitor);
+    }
+};
+
+class ConcurrentBillRepository
+    : public ShardedRepository<Bill, IBillRepository, InMemoryBillRepository> {
+public:
+    void forEachByPatientId(int patientId, const Visitor &visitor) const override {
+        visitInOrder([&](const InMemoryBillRepository &repo, const Visitor &v) {
+            repo.forEachByPatientId(patientId, v);
+        }, idLess, visitor);
+    }
+
+    void forEachByPaymentStatus(const std::string &status, const Visitor &visitor) const override {
+        visitInOrder([&](const InMemoryBillRepository &repo, const Visitor &v) {
+            repo.forEachByPaymentStatus(status, v);
+        }, idLess, visitor);
+    }
+
+    void forEachInDateRange(int fromDay, int toDay, const Visitor &visitor) const override {
+        visitInOrder([&](const InMemoryBillRepository &repo, const Visitor &v) {
+            repo.forEachInDateRange(fromDay, toDay, v);
+        }, [](const Bill &a, const Bill &b) {
+            if (a.getDay() != b.getDay()) return a.getDay() < b.getDay();
+            return a.getBillId() < b.getBillId();
+        }, visitor);
+    }
+
+    Money getTotalRevenue() const override {
+        Money total;
+        for (const Shard &shard : shards) {
+            ReadLock lock(shard.mutex);
+            total += shard.repo.getTotalRevenue();
+        }
+        return total;
+    }
+
+    RevenueTotal getRevenueForPaymentStatus(const std::string &status) const override {
+        Symbol symbol = symbols().lookup(status);
+        RevenueTotal total;
+        for (const Shard &shard : shards) {
+            ReadLock lock(shard.mutex);
+            total += shard.repo.getRevenueLedger().forPaymentStatus(symbol);
+        }
+        return total;
+    }
+
+    std::map<std::string, RevenueTotal> getRevenueByPaymentStatus() const override {
+        std::map<std::string, RevenueTotal> result;
+        for (const Shard &shard : shards) {
+            ReadLock lock(shard.mutex);
+            shard.repo.getRevenueLedger().addByPaymentStatus(result);
+        }
+        return result;
+    }
+
+    std::map<std::string, RevenueTotal> getRevenueByPaymentMethod() const override {
+        std::map<std::string, RevenueTotal> result;
+        for (const Shard &shard : shards) {
+            ReadLock lock(shard.mutex);
+            shard.repo.getRevenueLedger().addByPaymentMethod(result);
+        }
+        return result;
+    }
+
+    RevenueTotal getRevenueForDateRange(int fromDay, int toDay) const override {
+        RevenueTotal total;
+        for (const Shard &shard : shards) {
+            ReadLock lock(shard.mutex);
+            total += shard.repo.getRevenueLedger().forDateRange(fromDay, toDay);
+        }
+        return total;
+    }
+
+    RevenueTotal getRevenueWhere(const std::string &status, int fromDay, int toDay) const override {
+        RevenueTotal total;
+        for (const Shard &shard : shards) {
+            ReadLock lock(shard.mutex);
+            total += shard.repo.getRevenueWhere(status, fromDay, toDay);
+        }
+        return total;
+    }
+
+    std::vector<RevenueTotal> getAging(const std::string &status, int asOfDay,
+                                       const std::vector<int> &ageBounds) const override {
+        std::vector<RevenueTotal> result(ageBounds.size());
+        for (const Shard &shard : shards) {
+            ReadLock lock(shard.mutex);
+            std::vector<RevenueTotal> part = shard.repo.getAging(status, asOfDay, ageBounds);
+            for (size_t i = 0; i < part.size(); ++i) result[i] += part[i];
+        }
+        return result;
+    }
+};
+
+class ConcurrentUserRepository
+    : public ShardedRepository<User, IUserRepository, InMemoryUserRepository> {
+private:
+    std::mutex registrationMutex; // A name may be in any shard, so registrations take turns
+
+public:
+    User* findByUsername(const std::string &username) override {
+        uint64_t hash = usernameHash(username);
+        return findFirst([&](InMemoryUserRepository &repo) { return repo.findByUsername(username, hash); });
+    }
+
+    bool inspectByUsername(const std::string &username, const std::function<void(const User &)> &reader) override {
+        uint64_t hash = usernameHash(username);
+        return inspectFirst([&](InMemoryUserRepository &repo) { return repo.findByUsername(username, hash); }, reader);
+    }
+
+    bool addIfUsernameFree(const User &user) override {
+        std::lock_guard<std::mutex> lock(registrationMutex);
+        if (findByUsername(user.getUsername())) return false;
+        add(user);
+        return true;
+    }
+
+    void forEachByRole(const std::string &role, const Visitor &visitor) const override {
+        visitInOrder([&](const InMemoryUserRepository &repo, const Visitor &v) {
+            repo.forEachByRole(role, v);
+        }, idLess, visitor);
+    }
+};
+
+// Picks the sharded repository when several sessions may share the store
+template <typename Interface, typename Concurrent, typename Plain>
+std::shared_ptr<Interface> makeRepository(bool concurrent) {
+    if (concurrent) return std::make_shared<Concurrent>();
+    return std::make_shared<Plain>();
+}
+
+// ------------------------------
+// Write-Ahead Log
+// ------------------------------
+
+enum class WalOp : uint8_t { Put = 1, Remove = 2 };
+
+// When a committed record is forced to stable storage
+enum class FsyncPolicy {
+    Always,   // Each commit waits for fdatasync; concurrent commits share one sync
+    Interval, // A background thread writes and syncs every syncInterval
+    Never     // Records are written in the background; the OS decides when to sync
+};
+
+struct WalOptions {
+    FsyncPolicy policy = FsyncPolicy::Interval;
+    std::chrono::milliseconds syncInterval{50};
+    size_t writeThreshold = 1 << 16; // Wake the background writer at this many buffered bytes
+};
+
+// Append-only log of repository mutations. Each record is
+//   [u32 payload length][u32 CRC-32][u8 entity kind][u8 op][payload]
+// and the file starts with a magic/version header. Commits append to an
+// in-memory buffer; whoever flushes takes the whole buffer, so concurrent
+// commits are written (and synced) as one group.
+class WriteAheadLog : public IJournal {
+private:
+    static const char *magic() { return "HMSWAL"; }
+    // 2: dates and slots as integers; 3: amounts as int64 cents
+    static const uint32_t FormatVersion = 3;
+    static const size_t HeaderSize = 10;     // 6-byte magic + u32 version
+    static const size_t RecordHeaderSize = 10;
+
+    std::string path;
+    WalOptions options;
+    int fd = -1;
+
+    std::mutex mutex;
+    std::condition_variable flushed;
+    std::condition_variable wakeWriter;
+    std::string pending;
+    uint64_t appendedLsn = 0;
+    uint64_t durableLsn = 0;
+    bool flushInProgress = false;
+    bool stopping = false;
+    bool ioFailed = false;
+    std::thread writer;
+
+    static std::string header() {
+        std::string h(magic(), 6);
+        BinaryWriter out(h);
+        out.writeUInt32(FormatVersion);
+        return h;
+    }
+
+    bool writeFully(const std::string &data) {
+        size_t offset = 0;
+        while (offset < data.size()) {
+            ssize_t written = ::write(fd, data.data() + offset, data.size() - offset);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            offset += static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    // Called with the lock held; writes everything buffered so far as one
+    // group and optionally syncs it, releasing the lock during the I/O
+    void flushLocked(std::unique_lock<std::mutex> &lock, bool sync) {
+        while (flushInProgress) flushed.wait(lock);
+        if (durableLsn == appendedLsn) return;
+        flushInProgress = true;
+        std::string batch;
+        batch.swap(pending);
+        uint64_t batchLsn = appendedLsn;
+        lock.unlock();
+
+        bool ok = writeFully(batch);
+        if (ok && sync) ok = ::fdatasync(fd) == 0;
+
+        lock.lock();
+        if (!ok && !ioFailed) {
+            ioFailed = true;
+            std::cerr << "Write-ahead log I/O error on " << path << ": " << std::strerror(errno) << std::endl;
+        }
+        flushInProgress = false;
+        durableLsn = batchLsn;
+        flushed.notify_all();
+    }
+
+    void writerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            wakeWriter.wait_for(lock, options.syncInterval);
+            flushLocked(lock, options.policy == FsyncPolicy::Interval);
+        }
+    }
+
+    void append(EntityKind kind, WalOp op, const std::string &payload) {
+        std::string body;
+        body.reserve(payload.size() + 2);
+        body.push_back(static_cast<char>(kind));
+        body.push_back(static_cast<char>(op));
+        body.append(payload);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (ioFailed) throw std::runtime_error("Write-ahead log is unavailable: " + path);
+        BinaryWriter out(pending);
+        out.writeUInt32(static_cast<uint32_t>(payload.size()));
+        out.writeUInt32(crc32(body.data(), body.size()));
+        pending.append(body);
+        uint64_t lsn = ++appendedLsn;
+
+        if (options.policy == FsyncPolicy::Always) {
+            while (durableLsn < lsn) flushLocked(lock, true);
+            if (ioFailed) throw std::runtime_error("Write-ahead log commit failed: " + path);
+        } else if (pending.size() >= options.writeThreshold) {
+            wakeWriter.notify_one();
+        }
+    }
+
+public:
+    WriteAheadLog(const std::string &filePath, const WalOptions &opts = WalOptions())
+        : path(filePath), options(opts) {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open write-ahead log " + path + ": " + std::strerror(errno));
+        }
+        if (::lseek(fd, 0, SEEK_END) == 0 && !writeFully(header())) {
+            ::close(fd);
+            throw std::runtime_error("Cannot initialize write-ahead log " + path);
+        }
+        if (options.policy != FsyncPolicy::Always) {
+            writer = std::thread(&WriteAheadLog::writerLoop, this);
+        }
+    }
+
+    ~WriteAheadLog() override {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stopping = true;
+            wakeWriter.notify_one();
+        }
+        if (writer.joinable()) writer.join();
+        std::unique_lock<std::mutex> lock(mutex);
+        flushLocked(lock, options.policy != FsyncPolicy::Never);
+        ::close(fd);
+    }
+
+    void recordPut(EntityKind kind, const std::string &payload) override {
+        append(kind, WalOp::Put, payload);
+    }
+
+    void recordRemove(EntityKind kind, int id) override {
+        std::string payload;
+        BinaryWriter out(payload);
+        out.writeInt32(id);
+        append(kind, WalOp::Remove, payload);
+    }
+
+    // Blocks until every record committed so far is written and synced
+    void sync() {
+        std::unique_lock<std::mutex> lock(mutex);
+        flushLocked(lock, true);
+    }
+
+    // Discards all records after a checkpoint has captured their effects.
+    // Replay is idempotent, so a crash before this runs only means the old
+    // records are replayed on top of the snapshot.
+    void reset() {
+        std::unique_lock<std::mutex> lock(mutex);
+        flushLocked(lock, true);
+        if (::ftruncate(fd, static_cast<off_t>(HeaderSize)) != 0 || ::fdatasync(fd) != 0) {
+            throw std::runtime_error("Cannot reset write-ahead log " + path);
+        }
+    }
+
+    // Feeds every intact record in the log to apply(), in commit order.
+    // A torn or corrupt tail (e.g. from a crash mid-write) is truncated
+    // away. Returns the number of records replayed.
+    static size_t replay(const std::string &filePath,
+                         const std::function<void(EntityKind, WalOp, BinaryReader &)> &apply) {
+        std::ifstream in(filePath, std::ios::binary);
+        if (!in) return 0;
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        if (data.empty()) return 0;
+
+        if (data.size() < HeaderSize || data.compare(0, 6, magic()) != 0) {
+            throw std::runtime_error(filePath + " is not a write-ahead log");
+        }
+        BinaryReader headerReader(data.data() + 6, 4);
+        if (headerReader.readUInt32() != FormatVersion) {
+            throw std::runtime_error(filePath + " has an unsupported write-ahead log version");
+        }
+
+        size_t offset = HeaderSize;
+        size_t replayed = 0;
+        while (data.size() - offset >= RecordHeaderSize) {
+            BinaryReader recordHeader(data.data() + offset, 8);
+            uint32_t payloadSize = recordHeader.readUInt32();
+            uint32_t checksum = recordHeader.readUInt32();
+            size_t bodySize = 2 + static_cast<size_t>(payloadSize);
+            if (data.size() - offset - 8 < bodySize) break;
+            const char *body = data.data() + offset + 8;
+            if (crc32(body, bodySize) != checksum) break;
+
+            BinaryReader payload(body + 2, payloadSize);
+            apply(static_cast<EntityKind>(body[0]), static_cast<WalOp>(body[1]), payload);
+            offset += 8 + bodySize;
+            ++replayed;
+        }
+
+        if (offset < data.size() && ::truncate(filePath.c_str(), static_cast<off_t>(offset)) != 0) {
+            throw std::runtime_error("Cannot truncate damaged tail of " + filePath);
+        }
+        return replayed;
+    }
+};
+
+// Applies one replayed log record to a repository; returns the affected ID
+template <typename T>
+int applyJournalRecord(IRepository<T> &repo, WalOp op, BinaryReader &in) {
+    if (op == WalOp::Put) {
+        T item = EntityCodec<T>::decode(in);
+        repo.add(item);
+        return EntityCodec<T>::id(item);
+    }
+    int id = in.readInt32();
+    repo.remove(id);
+    return id;
+}
+
+// ------------------------------
+// Binary Snapshots
+// ------------------------------
+
+// A snapshot is a versioned, checksummed image of all seven repositories
+// that can be mmap'ed and read in place:
+//   [SnapshotHeader][SnapshotTableEntry x 7][per table: records | string heap]
+// Records are fixed-size PODs sorted by ID; variable-length fields are
+// (offset, length) references into the table's heap.
+struct SnapshotString {
+    uint32_t offset;
+    uint32_t length; // Bytes for strings, element count for ID lists
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t tableCount;
+    int32_t nextIds[8];   // Service ID counters, indexed by EntityKind
+    uint32_t checksum;    // CRC-32 of header (with this field zeroed) and table entries
+    uint32_t reserved;
+};
+
+struct SnapshotTableEntry {
+    uint32_t kind;
+    uint32_t recordSize;
+    uint64_t recordCount;
+    uint64_t recordsOffset;
+    uint64_t heapOffset;
+    uint64_t heapSize;
+    uint32_t checksum;    // CRC-32 of the records and heap
+    uint32_t reserved;
+};
+
+const char SnapshotMagic[8] = {'H', 'M', 'S', 'S', 'N', 'A', 'P', '\0'};
+// 2: dates and slots as integers; 3: amounts as int64 cents
+const uint32_t SnapshotVersion = 3;
+
+struct PatientRecord {
+    int32_t id;
+    int32_t age;
+    SnapshotString name, disease, contactNumber, address, bloodGroup, medicationIds;
+};
+
+struct DoctorRecord {
+    int32_t id;
+    uint32_t available;
+    int64_t consultationFee; // Cents
+    SnapshotString name, specialization, contactNumber, email;
+};
+
+struct AppointmentRecord {
+    int32_t id, patientId, doctorId, day, slot;
+    uint32_t reserved;
+    SnapshotString status, notes;
+};
+
+struct MedicationRecord {
+    int32_t id;
+    uint32_t reserved;
+    int64_t price; // Cents
+    SnapshotString name, dosage, manufacturer, description;
+};
+
+struct PrescriptionRecord {
+    int32_t id, patientId, doctorId, day;
+    SnapshotString medicationIds, instructions;
+};
+
+struct BillRecord {
+    int32_t id, patientId, day;
+    uint32_t reserved;
+    int64_t consultationFee, medicationCharges, otherCharges; // Cents
+    SnapshotString paymentStatus, paymentMethod;
+};
+
+struct UserRecord {
+    int32_t id;
+    uint32_t active;
+    SnapshotString username, passwordHash, role;
+};
+
+// Builds a table's string heap while records are being laid out
+class SnapshotHeapBuilder {
+private:
+    std::string heap;
+
+public:
+    SnapshotString addString(const std::string &value) {
+        SnapshotString ref{static_cast<uint32_t>(heap.size()), static_cast<uint32_t>(value.size())};
+        heap.append(value);
+        return ref;
+    }
+
+    SnapshotString addIntList(const std::vector<int> &values) {
+        while (heap.size() % alignof(int32_t) != 0) heap.push_back('\0');
+        SnapshotString ref{static_cast<uint32_t>(heap.size()), static_cast<uint32_t>(values.size())};
+        for (int value : values) {
+            int32_t v = value;
+            heap.append(reinterpret_cast<const char*>(&v), sizeof(v));
+        }
+        return ref;
+    }
+
+    const std::string &bytes() const { return heap; }
+};
+
+// Read access to one table's heap inside a mapped snapshot
+class SnapshotHeapView {
+private:
+    const char *base;
+    uint64_t size;
+
+    // Every reference is checked against the heap, whether or not the table
+    // checksums were verified, so a damaged record cannot read past it
+    const char *at(SnapshotString ref, uint64_t elementSize) const {
+        if (ref.offset > size || ref.length * elementSize > size - ref.offset) {
+            throw std::runtime_error("Invalid snapshot: record refers past the end of its table's heap");
+        }
+        return base + ref.offset;
+    }
+
+public:
+    SnapshotHeapView(const char *heapBase, uint64_t heapSize) : base(heapBase), size(heapSize) {}
+
+    std::string getString(SnapshotString ref) const {
+        return std::string(at(ref, 1), ref.length);
+    }
+
+    std::vector<int> getIntList(SnapshotString ref) const {
+        const char *bytes = at(ref, sizeof(int32_t));
+        std::vector<int> values(ref.length);
+        for (uint32_t i = 0; i < ref.length; ++i) {
+            int32_t value;
+            std::memcpy(&value, bytes + i * sizeof(int32_t), sizeof(value));
+            values[i] = value;
+        }
+        return values;
+    }
+};
+
+// Maps each entity to its fixed snapshot record and back
+template <typename T> struct SnapshotLayout;
+
+template <> struct SnapshotLayout<Patient> {
+    typedef PatientRecord Record;
+    static Record toRecord(const Patient &p, SnapshotHeapBuilder &heap) {
+        Record r;
+        r.id = p.getId();
+        r.age = p.getAge();
+        r.name = heap.addString(p.getName());
+        r.disease = heap.addString(p.getDisease());
+        r.contactNumber = heap.addString(p.getContactNumber());
+        r.address = heap.addString(p.getAddress());
+        r.bloodGroup = heap.addString(p.getBloodGroup());
+        r.medicationIds = heap.addIntList(p.getMedicationIds());
+        return r;
+    }
+    static Patient fromRecord(const Record &r, const SnapshotHeapView &heap) {
+        Patient p(r.id, heap.getString(r.name), r.age, heap.getString(r.disease),
+                  heap.getString(r.contactNumber), heap.getString(r.address), heap.getString(r.bloodGroup));
+        for (int medId : heap.getIntList(r.medicationIds)) p.addMedicationId(medId);
+        return p;
+    }
+};
+
+template <> struct SnapshotLayout<Doctor> {
+    typedef DoctorRecord Record;
+    static Record toRecord(const Doctor &d, SnapshotHeapBuilder &heap) {
+        Record r;
+        r.id = d.getId();
+        r.available = d.getAvailability() ? 1 : 0;
+        r.consultationFee = d.getConsultationFee().getCents();
+        r.name = heap.addString(d.getName());
+        r.specialization = heap.addString(d.getSpecialization());
+        r.contactNumber = heap.addString(d.getContactNumber());
+        r.email = heap.addString(d.getEmail());
+        return r;
+    }
+    static Doctor fromRecord(const Record &r, const SnapshotHeapView &heap) {
+        Doctor d(r.id, heap.getString(r.name), heap.getString(r.specialization),
+                 heap.getString(r.contactNumber), heap.getString(r.email),
+                 Money::fromCents(r.consultationFee));
+        d.setAvailability(r.available != 0);
+        return d;
+    }
+};
+
+template <> struct SnapshotLayout<Appointment> {
+    typedef AppointmentRecord Record;
+    static Record toRecord(const Appointment &a, SnapshotHeapBuilder &heap) {
+        Record r;
+        r.id = a.getAppointmentId();
+        r.patientId = a.getPatientId();
+        r.doctorId = a.getDoctorId();
+        r.day = a.getDay();
+        r.slot = a.getSlot();
+        r.reserved = 0;
+        r.status = heap.addString(a.getStatus());
+        r.notes = heap.addString(a.getNotes());
+        return r;
+    }
+    static Appointment fromRecord(const Record &r, const SnapshotHeapView &heap) {
+        return Appointment(r.id, r.patientId, r.doctorId, r.day, r.slot,
+                           heap.getString(r.status), heap.getString(r.notes));
+    }
+};
+
+template <> struct SnapshotLayout<Medication> {
+    typedef MedicationRecord Record;
+    static Record toRecord(const Medication &m, SnapshotHeapBuilder &heap) {
+        Record r;
+        r.id = m.getMedicationId();
+        r.reserved = 0;
+        r.price = m.getPrice().getCents();
+        r.name = heap.addString(m.getName());
+        r.dosage = heap.addString(m.getDosage());
+        r.manufacturer = heap.addString(m.getManufacturer());
+        r.description = heap.addString(m.getDescription());
+        return r;
+    }
+    static Medication fromRecord(const Record &r, const SnapshotHeapView &heap) {
+        return Medication(r.id, heap.getString(r.name), heap.getString(r.dosage), Money::fromCents(r.price),
+                          heap.getString(r.manufacturer), heap.getString(r.description));
+    }
+};
+
+template <> struct SnapshotLayout<Prescription> {
+    typedef PrescriptionRecord Record;
+    static Record toRecord(const Prescription &p, SnapshotHeapBuilder &heap) {
+        Record r;
+        r.id = p.getPrescriptionId();
+        r.patientId = p.getPatientId();
+        r.doctorId = p.getDoctorId();
+        r.day = p.getDay();
+        r.medicationIds = heap.addIntList(p.getMedicationIds());
+        r.instructions = heap.addString(p.getInstructions());
+        return r;
+    }
+    static Prescription fromRecord(const Record &r, const SnapshotHeapView &heap) {
+        return Prescription(r.id, r.patientId, r.doctorId, r.day,
+                            heap.getIntList(r.medicationIds), heap.getString(r.instructions));
+    }
+};
+
+template <> struct SnapshotLayout<Bill> {
+    typedef BillRecord Record;
+    static Record toRecord(const Bill &b, SnapshotHeapBuilder &heap) {
+        Record r;
+        r.id = b.getBillId();
+        r.patientId = b.getPatientId();
+        r.day = b.getDay();
+        r.reserved = 0;
+        r.consultationFee = b.getConsultationFee().getCents();
+        r.medicationCharges = b.getMedicationCharges().getCents();
+        r.otherCharges = b.getOtherCharges().getCents();
+        r.paymentStatus = heap.addString(b.getPaymentStatus());
+        r.paymentMethod = heap.addString(b.getPaymentMethod());
+        return r;
+    }
+    static Bill fromRecord(const Record &r, const SnapshotHeapView &heap) {
+        return Bill(r.id, r.patientId, r.day, Money::fromCents(r.consultationFee),
+                    Money::fromCents(r.medicationCharges), Money::fromCents(r.otherCharges),
+                    heap.getString(r.paymentStatus), heap.getString(r.paymentMethod));
+    }
+};
+
+template <> struct SnapshotLayout<User> {
+    typedef UserRecord Record;
+    static Record toRecord(const User &u, SnapshotHeapBuilder &heap) {
+        Record r;
+        r.id = u.getUserId();
+        r.active = u.getIsActive() ? 1 : 0;
+        r.username = heap.addString(u.getUsername());
+        r.passwordHash = heap.addString(u.getPasswordHash());
+        r.role = heap.addString(u.getRole());
+        return r;
+    }
+    static User fromRecord(const Record &r, const SnapshotHeapView &heap) {
+        return User(r.id, heap.getString(r.username), heap.getString(r.passwordHash),
+                    heap.getString(r.role), r.active != 0);
+    }
+};
+
+// Makes a rename or file creation in path's directory durable
+inline void syncParentDirectory(const std::string &path) {
+    size_t slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0 || ::fsync(fd) != 0) {
+        int error = errno;
+        if (fd >= 0) ::close(fd);
+        throw std::runtime_error("Cannot sync directory " + directory + ": " + std::strerror(error));
+    }
+    ::close(fd);
+}
+
+// Writes a snapshot to a temporary file, syncs it and renames it into
+// place, so a crash mid-checkpoint leaves the previous snapshot intact
+class SnapshotWriter {
+private:
+    struct Table {
+        SnapshotTableEntry entry;
+        std::string records;
+        std::string heap;
+    };
+
+    std::vector<Table> tables;
+    int32_t nextIds[8] = {0};
+
+public:
+    template <typename T>
+    void addTable(const std::vector<T> &items) {
+        typedef typename SnapshotLayout<T>::Record Record;
+        std::vector<const T*> sorted;
+        sorted.reserve(items.size());
+        for (const auto &item : items) sorted.push_back(&item);
+        std::sort(sorted.begin(), sorted.end(), [](const T *a, const T *b) {
+            return EntityCodec<T>::id(*a) < EntityCodec<T>::id(*b);
+        });
+
+        SnapshotHeapBuilder heap;
+        Table table;
+        table.records.resize(sorted.size() * sizeof(Record));
+        char *out = &table.records[0];
+        for (size_t i = 0; i < sorted.size(); ++i) {
+            Record record = SnapshotLayout<T>::toRecord(*sorted[i], heap);
+            std::memcpy(out + i * sizeof(Record), &record, sizeof(Record));
+        }
+        table.heap = heap.bytes();
+        std::memset(&table.entry, 0, sizeof(table.entry));
+        table.entry.kind = static_cast<uint32_t>(EntityCodec<T>::kind);
+        table.entry.recordSize = sizeof(Record);
+        table.entry.recordCount = sorted.size();
+        tables.push_back(std::move(table));
+    }
+
+    void setNextId(EntityKind kind, int nextId) {
+        nextIds[static_cast<int>(kind)] = nextId;
+    }
+
+    void write(const std::string &path) {
+        SnapshotHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, SnapshotMagic, sizeof(header.magic));
+        header.version = SnapshotVersion;
+        header.tableCount = static_cast<uint32_t>(tables.size());
+        std::memcpy(header.nextIds, nextIds, sizeof(nextIds));
+
+        auto align = [](uint64_t offset) { return (offset + 7) & ~uint64_t(7); };
+        uint64_t offset = sizeof(SnapshotHeader) + tables.size() * sizeof(SnapshotTableEntry);
+        for (auto &table : tables) {
+            offset = align(offset);
+            table.entry.recordsOffset = offset;
+            offset += table.records.size();
+            table.entry.heapOffset = offset;
+            table.entry.heapSize = table.heap.size();
+            offset += table.heap.size();
+            uint32_t crc = crc32(table.records.data(), table.records.size());
+            table.entry.checksum = crc32(table.heap.data(), table.heap.size(), crc);
+        }
+
+        std::string directory;
+        for (const auto &table : tables) {
+            directory.append(reinterpret_cast<const char*>(&table.entry), sizeof(SnapshotTableEntry));
+        }
+        uint32_t crc = crc32(reinterpret_cast<const char*>(&header), sizeof(header));
+        header.checksum = crc32(directory.data(), directory.size(), crc);
+
+        std::string tempPath = path + ".tmp";
+        {
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+            if (!out) throw std::runtime_error("Cannot create snapshot " + tempPath);
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(directory.data(), directory.size());
+            uint64_t written = sizeof(header) + directory.size();
+            for (const auto &table : tables) {
+                while (written < table.entry.recordsOffset) { out.put('\0'); ++written; }
+                out.write(table.records.data(), table.records.size());
+                out.write(table.heap.data(), table.heap.size());
+                written += table.records.size() + table.heap.size();
+            }
+            if (!out) throw std::runtime_error("Failed writing snapshot " + tempPath);
+        }
+        int fd = ::open(tempPath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0 || ::fsync(fd) != 0) {
+            int error = errno;
+            if (fd >= 0) ::close(fd);
+            throw std::runtime_error("Cannot sync snapshot " + tempPath + ": " + std::strerror(error));
+        }
+        if (::close(fd) != 0) {
+            throw std::runtime_error("Cannot close snapshot " + tempPath + ": " + std::strerror(errno));
+        }
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("Cannot move snapshot into place: " + path + ": " + std::strerror(errno));
+        }
+        syncParentDirectory(path); // Until the rename is durable a crash may bring back the old snapshot
+    }
+};
+
+// A read-only, memory-mapped snapshot. Opening it only validates the
+// header; records are read in place, and tables can be searched by ID
+// without materializing anything else.
+class MappedSnapshot {
+private:
+    const char *base = nullptr;
+    size_t size = 0;
+    const SnapshotHeader *header = nullptr;
+    const SnapshotTableEntry *entries = nullptr;
+
+    const SnapshotTableEntry *tableFor(EntityKind kind) const {
+        for (uint32_t i = 0; i < header->tableCount; ++i) {
+            if (entries[i].kind == static_cast<uint32_t>(kind)) return &entries[i];
+        }
+        return nullptr;
+    }
+
+    void fail(const std::string &path, const std::string &reason) {
+        close();
+        throw std::runtime_error("Invalid snapshot " + path + ": " + reason);
+    }
+
+    void close() {
+        if (base) ::munmap(const_cast<char*>(base), size);
+        base = nullptr;
+    }
+
+public:
+    MappedSnapshot(const std::string &path, bool verifyTableChecksums = true) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) throw std::runtime_error("Cannot open snapshot " + path);
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(SnapshotHeader))) {
+            ::close(fd);
+            throw std::runtime_error("Invalid snapshot " + path + ": file too small");
+        }
+        size = static_cast<size_t>(info.st_size);
+        void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) throw std::runtime_error("Cannot map snapshot " + path);
+        base = static_cast<const char*>(mapping);
+
+        header = reinterpret_cast<const SnapshotHeader*>(base);
+        if (std::memcmp(header->magic, SnapshotMagic, sizeof(SnapshotMagic)) != 0) fail(path, "bad magic");
+        if (header->version != SnapshotVersion) fail(path, "unsupported version");
+        size_t directorySize = header->tableCount * sizeof(SnapshotTableEntry);
+        if (header->tableCount > 16 || sizeof(SnapshotHeader) + directorySize > size) fail(path, "bad directory");
+        entries = reinterpret_cast<const SnapshotTableEntry*>(base + sizeof(SnapshotHeader));
+
+        SnapshotHeader copy = *header;
+        copy.checksum = 0;
+        uint32_t crc = crc32(reinterpret_cast<const char*>(&copy), sizeof(copy));
+        if (crc32(reinterpret_cast<const char*>(entries), directorySize, crc) != header->checksum) {
+            fail(path, "header checksum mismatch");
+        }
+
+        for (uint32_t i = 0; i < header->tableCount; ++i) {
+            const SnapshotTableEntry &entry = entries[i];
+            if (entry.recordSize != 0 && entry.recordCount > size / entry.recordSize) {
+                fail(path, "table extends past end of file");
+            }
+            uint64_t recordBytes = entry.recordCount * entry.recordSize;
+            if (entry.recordsOffset > size || recordBytes > size - entry.recordsOffset ||
+                entry.heapOffset > size || entry.heapSize > size - entry.heapOffset) {
+                fail(path, "table extends past end of file");
+            }
+            if (verifyTableChecksums) {
+                uint32_t tableCrc = crc32(base + entry.recordsOffset, static_cast<size_t>(recordBytes));
+                tableCrc = crc32(base + entry.heapOffset, static_cast<size_t>(entry.heapSize), tableCrc);
+                if (tableCrc != entry.checksum) fail(path, "table checksum mismatch");
+            }
+        }
+    }
+
+    ~MappedSnapshot() { close(); }
+    MappedSnapshot(const MappedSnapshot &) = delete;
+    MappedSnapshot &operator=(const MappedSnapshot &) = delete;
+
+    int nextId(EntityKind kind) const { return header->nextIds[static_cast<int>(kind)]; }
+
+    template <typename T>
+    size_t count() const {
+        const SnapshotTableEntry *entry = tableFor(EntityCodec<T>::kind);
+        return entry ? static_cast<size_t>(entry->recordCount) : 0;
+    }
+
+    template <typename T>
+    const typename SnapshotLayout<T>::Record *records() const {
+        const SnapshotTableEntry *entry = tableFor(EntityCodec<T>::kind);
+        if (!entry || entry->recordSize != sizeof(typename SnapshotLayout<T>::Record)) return nullptr;
+        return reinterpret_cast<const typename SnapshotLayout<T>::Record*>(base + entry->recordsOffset);
+    }
+
+    template <typename T>
+    SnapshotHeapView heap() const {
+        const SnapshotTableEntry *entry = tableFor(EntityCodec<T>::kind);
+        return entry ? SnapshotHeapView(base + entry->heapOffset, entry->heapSize) : SnapshotHeapView(base, 0);
+    }
+
+    // Binary search over the ID-sorted records; materializes only the match
+    template <typename T>
+    bool findById(int id, std::unique_ptr<T> &out) const {
+        const auto *begin = records<T>();
+        if (!begin) return false;
+        const auto *end = begin + count<T>();
+        const auto *found = std::lower_bound(begin, end, id,
+            [](const typename SnapshotLayout<T>::Record &r, int key) { return r.id < key; });
+        if (found == end || found->id != id) return false;
+        out.reset(new T(SnapshotLayout<T>::fromRecord(*found, heap<T>())));
+        return true;
+    }
+
+    // Materializes every record of a table into a repository
+    template <typename T>
+    size_t loadInto(IRepository<T> &repo) const {
+        const auto *rows = records<T>();
+        if (!rows) return 0;
+        size_t n = count<T>();
+        SnapshotHeapView view = heap<T>();
+        for (size_t i = 0; i < n; ++i) {
+            repo.add(SnapshotLayout<T>::fromRecord(rows[i], view));
+        }
+        return n;
+    }
+};
+
+// ------------------------------
+// Metrics
+// ------------------------------
+
+// Latency histogram in the HDR style: log-linear buckets, each power of two
+// split into 2^(SubBucketBits - 1) sub-buckets, from 1 ns up to about 18
+// minutes. Recording is a shift and an increment; histograms from several
+// threads merge by adding counts.
+template <int SubBucketBits>
+class BasicLatencyHistogram {
+public:
+    static const int SubBucketHalf = 1 << (SubBucketBits - 1);
+    static const int Buckets = 34;  // Values up to 2^40 ns
+    static const size_t Slots = (Buckets + 1) * SubBucketHalf;
+
+    static size_t slotOf(uint64_t value) {
+        int msb = value ? 63 - __builtin_clzll(value) : 0;
+        int bucket = std::max(msb - (SubBucketBits - 1), 0);
+        return std::min(static_cast<size_t>(bucket) * SubBucketHalf + static_cast<size_t>(value >> bucket),
+                        Slots - 1);
+    }
+
+private:
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+    uint64_t maxValue = 0;
+    double sum = 0.0;
+
+    // Largest value that lands in the slot
+    static uint64_t highestValueAt(size_t slot) {
+        size_t bucket = slot < 2 * SubBucketHalf ? 0 : slot / SubBucketHalf - 1;
+        uint64_t sub = slot - bucket * SubBucketHalf;
+        return ((sub + 1) << bucket) - 1;
+    }
+
+public:
+    BasicLatencyHistogram() : counts(Slots, 0) {}
+
+    void record(uint64_t nanoseconds) {
+        ++counts[slotOf(nanoseconds)];
+        ++total;
+        maxValue = std::max(maxValue, nanoseconds);
+        sum += static_cast<double>(nanoseconds);
+    }
+
+    // Adds counts kept elsewhere in the same slot layout
+    void addSlot(size_t slot, uint64_t count) {
+        counts[slot] += count;
+        total += count;
+    }
+
+    void addTotals(double valueSum, uint64_t max) {
+        sum += valueSum;
+        maxValue = std::max(maxValue, max);
+    }
+
+    void merge(const BasicLatencyHistogram &other) {
+        for (size_t i = 0; i < counts.size(); ++i) counts[i] += other.counts[i];
+        total += other.total;
+        maxValue = std::max(maxValue, other.maxValue);
+        sum += other.sum;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return maxValue; }
+    double valueSum() const { return sum; }
+    double mean() const { return total ? sum / total : 0.0; }
+
+    // Smallest bucket bound at or above the given fraction (0..1] of values
+    uint64_t percentile(double fraction) const {
+        if (total == 0) return 0;
+        uint64_t wanted = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * total)));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            seen += counts[i];
+            if (seen >= wanted) return std::min(highestValueAt(i), maxValue);
+        }
+        return maxValue;
+    }
+};
+
+template <int SubBucketBits> const int BasicLatencyHistogram<SubBucketBits>::SubBucketHalf;
+template <int SubBucketBits> const int BasicLatencyHistogram<SubBucketBits>::Buckets;
+template <int SubBucketBits> const size_t BasicLatencyHistogram<SubBucketBits>::Slots;
+
+// 64 sub-buckets: within 1.6% of the true value, 18 KB of counts
+typedef BasicLatencyHistogram<7> LatencyHistogram;
+// 8 sub-buckets: within 12.5%, small enough to keep one per operation per thread
+typedef BasicLatencyHistogram<4> CompactLatencyHistogram;
+
+// Every instrumented service method, in menu order
+enum class ServiceOperation {
+    AddPatient, UpdatePatient, RemovePatient, ListPatients, FindPatientsByDisease, FindPatientsByAgeRange,
+    GetPatientById, PatientExists, ModifyPatient,
+    AddDoctor, UpdateDoctor, RemoveDoctor, ListDoctors, ListAvailableDoctors, FindDoctorsBySpecialization,
+    SetDoctorAvailability, GetDoctorById, DoctorExists, InspectDoctor,
+    BookAppointment, UpdateAppointmentDetails, UpdateAppointmentStatus, CancelAppointment, ListFreeSlots,
+    ListAllAppointments, ListAppointmentsByPatient, ListAppointmentsByDoctor, ListAppointmentsByDate,
+    ListAppointmentsByStatus, ListAppointmentsInDateRange, ArchiveAppointmentsBefore,
+    AddMedication, UpdateMedication, RemoveMedication, ListAllMedications, GetMedicationById, GetMedicationByName,
+    CreatePrescription, UpdatePrescription, RemovePrescription, ListAllPrescriptions, ListPrescriptionsByPatient,
+    ListPrescriptionsByDoctor, GetPrescriptionById,
+    GenerateBill, UpdateBillPaymentStatus, ListAllBills, ListBillsByPatient, ListBillsByPaymentStatus,
+    GetTotalRevenue, ReportRevenueBreakdown, ReportPendingAging, GetPendingPayments, GetRevenueInDateRange,
+    GetBillById,
+    Count
+};
+
+const size_t ServiceOperationCount = static_cast<size_t>(ServiceOperation::Count);
+
+inline const char *serviceOperationName(ServiceOperation op) {
+    static const char *const names[] = {
+        "PatientService.addPatient", "PatientService.updatePatient", "PatientService.removePatient",
+        "PatientService.listPatients", "PatientService.findPatientsByDisease",
+        "PatientService.findPatientsByAgeRange", "PatientService.getPatientById", "PatientService.patientExists",
+        "PatientService.modifyPatient",
+        "DoctorService.addDoctor", "DoctorService.updateDoctor", "DoctorService.removeDoctor",
+        "DoctorService.listDoctors", "DoctorService.listAvailableDoctors",
+        "DoctorService.findDoctorsBySpecialization", "DoctorService.setDoctorAvailability",
+        "DoctorService.getDoctorById", "DoctorService.doctorExists", "DoctorService.inspectDoctor",
+        "AppointmentService.bookAppointment", "AppointmentService.updateAppointmentDetails",
+        "AppointmentService.updateAppointmentStatus", "AppointmentService.cancelAppointment",
+        "AppointmentService.listFreeSlots", "AppointmentService.listAllAppointments",
+        "AppointmentService.listAppointmentsByPatient", "AppointmentService.listAppointmentsByDoctor",
+        "AppointmentService.listAppointmentsByDate", "AppointmentService.listAppointmentsByStatus",
+        "AppointmentService.listAppointmentsInDateRange", "AppointmentService.archiveAppointmentsBefore",
+        "MedicationService.addMedication", "MedicationService.updateMedication",
+        "MedicationService.removeMedication", "MedicationService.listAllMedications",
+        "MedicationService.getMedicationById", "MedicationService.getMedicationByName",
+        "PrescriptionService.createPrescription", "PrescriptionService.updatePrescription",
+        "PrescriptionService.removePrescription", "PrescriptionService.listAllPrescriptions",
+        "PrescriptionService.listPrescriptionsByPatient", "PrescriptionService.listPrescriptionsByDoctor",
+        "PrescriptionService.getPrescriptionById",
+        "BillingService.generateBill", "BillingService.updateBillPaymentStatus", "BillingService.listAllBills",
+        "BillingService.listBillsByPatient", "BillingService.listBillsByPaymentStatus",
+        "BillingService.getTotalRevenue", "BillingService.reportRevenueBreakdown",
+        "BillingService.reportPendingAging", "BillingService.getPendingPayments",
+        "BillingService.getRevenueInDateRange", "BillingService.getBillById"};
+    static_assert(sizeof(names) / sizeof(names[0]) == ServiceOperationCount, "one name per service operation");
+    return names[static_cast<int>(op)];
+}
+
+// Whether the time-stamp counter runs at a constant rate across cores,
+// frequency changes and power states (CPUID.80000007H:EDX[8], "invariant
+// TSC"). Older CPUs, and some hypervisors, do not promise it.
+inline bool hasInvariantTsc() {
+#ifdef HMS_HAVE_RDTSC
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007) return false;
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx >> 8) & 1;
+#else
+    return false;
+#endif
+}
+
+inline bool metricsUseTsc() {
+    static const bool invariant = hasInvariantTsc();
+    return invariant;
+}
+
+// Timestamps for the metrics hot path. The x86 time-stamp counter reads in
+// a few nanoseconds against about 25 for steady_clock, which matters when
+// every service call is timed. Ticks are converted to nanoseconds only when
+// metrics are read (see MetricsRegistry::nanosecondsPerTick). Without an
+// invariant counter, ticks are steady_clock nanoseconds.
+inline uint64_t metricTicks() {
+#ifdef HMS_HAVE_RDTSC
+    if (metricsUseTsc()) return __rdtsc();
+#endif
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Calls and latencies of service methods, plus gauges read on demand.
+//
+// Each thread records into its own block, so recording takes no lock and
+// shares no cache line with other threads: a relaxed load and store on
+// counters only that thread writes. Readers sum every block when asked.
+// Blocks outlive their threads so totals never go backward.
+class MetricsRegistry {
+private:
+    typedef CompactLatencyHistogram Histogram;
+
+    struct OperationCounters {
+        std::atomic<uint64_t> slots[Histogram::Slots];
+        std::atomic<uint64_t> totalTicks;
+        std::atomic<uint64_t> maxTicks;
+    };
+
+    struct ThreadCounters {
+        OperationCounters operations[ServiceOperationCount];
+
+        ThreadCounters() {
+            for (OperationCounters &op : operations) {
+                for (auto &slot : op.slots) slot.store(0, std::memory_order_relaxed);
+                op.totalTicks.store(0, std::memory_order_relaxed);
+                op.maxTicks.store(0, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    struct Gauge {
+        std::string name;  // May carry labels, e.g. records{repository="patients"}
+        std::string help;
+        std::function<double()> read;
+    };
+
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadCounters>> threads;
+    std::vector<Gauge> gauges;
+    const uint64_t startTicks = metricTicks();
+    const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+    ThreadCounters &local() {
+        static thread_local ThreadCounters *counters = nullptr;
+        if (!counters) {
+            std::unique_ptr<ThreadCounters> created(new ThreadCounters());
+            counters = created.get();
+            std::lock_guard<std::mutex> lock(mutex);
+            threads.push_back(std::move(created));
+        }
+        return *counters;
+    }
+
+    static void bump(std::atomic<uint64_t> &counter, uint64_t by) {
+        counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    static std::string family(const std::string &name) { return name.substr(0, name.find('{')); }
+
+public:
+    void record(ServiceOperation op, uint64_t ticks) {
+        OperationCounters &counters = local().operations[static_cast<int>(op)];
+        bump(counters.slots[Histogram::slotOf(ticks)], 1);
+        bump(counters.totalTicks, ticks);
+        if (ticks > counters.maxTicks.load(std::memory_order_relaxed)) {
+            counters.maxTicks.store(ticks, std::memory_order_relaxed);
+        }
+    }
+
+    // Tick length measured over the whole run against steady_clock
+    double nanosecondsPerTick() const {
+        if (!metricsUseTsc()) return 1.0;
+        // A short baseline would make a poor estimate; give it a millisecond
+        while (std::chrono::steady_clock::now() - startTime < std::chrono::milliseconds(1)) {
+        }
+        double ticks = static_cast<double>(metricTicks() - startTicks);
+        double ns = static_cast<double>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count());
+        return ns / ticks;
+    }
+
+    // Sums every thread's counters for one operation, in ticks
+    Histogram read(ServiceOperation op) const {
+        Histogram merged;
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &thread : threads) {
+            const OperationCounters &counters = thread->operations[static_cast<int>(op)];
+            for (size_t slot = 0; slot < Histogram::Slots; ++slot) {
+                if (uint64_t count = counters.slots[slot].load(std::memory_order_relaxed)) merged.addSlot(slot, count);
+            }
+            merged.addTotals(static_cast<double>(counters.totalTicks.load(std::memory_order_relaxed)),
+                             counters.maxTicks.load(std::memory_order_relaxed));
+        }
+        return merged;
+    }
+
+    // Registers a value read whenever metrics are shown; a gauge of the same
+    // name is replaced
+    void setGauge(const std::string &name, const std::string &help, std::function<double()> read) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (Gauge &gauge : gauges) {
+            if (gauge.name == name) {
+                gauge.help = help;
+                gauge.read = std::move(read);
+                return;
+            }
+        }
+        gauges.push_back(Gauge{name, help, std::move(read)});
+    }
+
+    // Human-readable table of the operations called so far and the gauges
+    void writeSummary(std::ostream &out) const {
+        out << std::left << std::setw(46) << "operation" << std::right << std::setw(9) << "calls"
+            << std::setw(11) << "mean us" << std::setw(11) << "p50 us" << std::setw(11) << "p99 us"
+            << std::setw(11) << "max us" << "\n";
+        const double usPerTick = nanosecondsPerTick() / 1000.0;
+        for (size_t i = 0; i < ServiceOperationCount; ++i) {
+            ServiceOperation op = static_cast<ServiceOperation>(i);
+            Histogram h = read(op);
+            if (h.count() == 0) continue;
+            out << std::left << std::setw(46) << serviceOperationName(op) << std::right << std::setw(9) << h.count()
+                << std::fixed << std::setprecision(1) << std::setw(11) << h.mean() * usPerTick << std::setw(11)
+                << h.percentile(0.5) * usPerTick << std::setw(11) << h.percentile(0.99) * usPerTick
+                << std::setw(11) << h.max() * usPerTick << "\n";
+        }
+        out << std::defaultfloat << std::setprecision(6);
+        for (const Gauge &gauge : snapshotGauges()) out << gauge.name << " " << gauge.read() << "\n";
+    }
+
+    // Prometheus text exposition format: a latency summary per operation
+    // and one line per gauge
+    void writePrometheus(std::ostream &out) const {
+        out << "# HELP hms_service_latency_seconds Latency of service method calls.\n"
+            << "# TYPE hms_service_latency_seconds summary\n";
+        out << std::setprecision(9);
+        const double secondsPerTick = nanosecondsPerTick() / 1e9;
+        for (size_t i = 0; i < ServiceOperationCount; ++i) {
+            ServiceOperation op = static_cast<ServiceOperation>(i);
+            Histogram h = read(op);
+            std::string label = std::string("operation=\"") + serviceOperationName(op) + "\"";
+            for (double quantile : {0.5, 0.9, 0.99, 0.999}) {
+                out << "hms_service_latency_seconds{" << label << ",quantile=\"" << quantile << "\"} ";
+                // Prometheus reports the quantiles of an empty summary as NaN
+                if (h.count()) out << h.percentile(quantile) * secondsPerTick << "\n";
+                else out << "NaN\n";
+            }
+            out << "hms_service_latency_seconds_sum{" << label << "} " << h.valueSum() * secondsPerTick << "\n"
+                << "hms_service_latency_seconds_count{" << label << "} " << h.count() << "\n";
+        }
+        std::string lastFamily;
+        for (const Gauge &gauge : snapshotGauges()) {
+            if (family(gauge.name) != lastFamily) {
+                lastFamily = family(gauge.name);
+                out << "# HELP " << lastFamily << " " << gauge.help << "\n# TYPE " << lastFamily << " gauge\n";
+            }
+            out << gauge.name << " " << gauge.read() << "\n";
+        }
+    }
+
+private:
+    // Gauges are read outside the lock; a gauge may itself take locks
+    std::vector<Gauge> snapshotGauges() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<Gauge> copy = gauges;
+        std::stable_sort(copy.begin(), copy.end(),
+                         [](const Gauge &a, const Gauge &b) { return family(a.name) < family(b.name); });
+        return copy;
+    }
+};
+
+inline MetricsRegistry &metrics() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+// Writes the metrics in Prometheus text format beside the target and
+// renames the file over it, so a scraper never reads half a file
+inline bool writeMetricsFile(const std::string &path, std::string &error) {
+    std::string partial = path + ".tmp";
+    {
+        std::ofstream out(partial);
+        metrics().writePrometheus(out);
+        if (!out.flush()) {
+            error = "Failed to write " + partial;
+            return false;
+        }
+    }
+    if (std::rename(partial.c_str(), path.c_str()) != 0) {
+        error = "Failed to write " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+// Shows the service call table and gauges, a display line per row
+inline void displayMetricsSummary(IDisplayManager &display) {
+    display.displayInfo("Service calls and latencies since startup:");
+    std::ostringstream summary;
+    metrics().writeSummary(summary);
+    std::istringstream rows(summary.str());
+    for (std::string row; std::getline(rows, row);) display.displayInfo(row);
+}
+
+// Times the enclosing scope and records it against a service operation
+class OperationTimer {
+private:
+    ServiceOperation op;
+    uint64_t start;
+
+public:
+    explicit OperationTimer(ServiceOperation op) : op(op), start(metricTicks()) {}
+    OperationTimer(const OperationTimer &) = delete;
+    OperationTimer &operator=(const OperationTimer &) = delete;
+
+    ~OperationTimer() { metrics().record(op, metricTicks() - start); }
+};
+
+// ------------------------------
+// Sessions
+// ------------------------------
+
+// What a signed-in user may do. Roles map to a set of these when the
+// session opens, so an authorization check is a single bit test.
+enum class Permission : uint32_t {
+    FrontDesk,      // Patients, doctors, appointments, medications, prescriptions, bills
+    ManageUsers,
+    ViewLogsAndMetrics,
+    ViewFinances,
+    ArchiveRecords,
+    Count
+};
+
+class PermissionSet {
+private:
+    uint32_t bits;
+
+    static uint32_t bit(Permission permission) { return 1u << static_cast<uint32_t>(permission); }
+
+public:
+    PermissionSet() : bits(0) {}
+
+    PermissionSet with(Permission permission) const {
+        PermissionSet result;
+        result.bits = bits | bit(permission);
+        return result;
+    }
+
+    bool allows(Permission permission) const { return (bits & bit(permission)) != 0; }
+
+    // Admins may do everything; every other role works the front desk
+    static PermissionSet forRole(Symbol role) {
+        PermissionSet permissions = PermissionSet().with(Permission::FrontDesk);
+        if (role == known().admin) {
+            for (uint32_t p = 0; p < static_cast<uint32_t>(Permission::Count); ++p) {
+                permissions = permissions.with(static_cast<Permission>(p));
+            }
+        }
+        return permissions;
+    }
+};
+static_assert(static_cast<uint32_t>(Permission::Count) <= 32, "PermissionSet holds one bit per permission");
+
+// An opaque, unguessable session identifier: 128 bits from getrandom. The all-zero token means "no session".
+struct SessionToken {
+    uint64_t high = 0;
+    uint64_t low = 0;
+
+    bool isNull() const { return high == 0 && low == 0; }
+    bool operator==(const SessionToken &other) const { return high == other.high && low == other.low; }
+    bool operator!=(const SessionToken &other) const { return !(*this == other); }
+
+    static SessionToken generate() {
+        SessionToken token;
+        while (token.isNull()) {
+            ssize_t n = ::getrandom(&token, sizeof(token), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n != static_cast<ssize_t>(sizeof(token))) {
+                throw std::runtime_error(std::string("Cannot generate a session token: ") + std::strerror(errno));
+            }
+        }
+        return token;
+    }
+
+    std::string toString() const {
+        char text[33];
+        std::snprintf(text, sizeof(text), "%016llx%016llx", static_cast<unsigned long long>(high),
+                      static_cast<unsigned long long>(low));
+        return text;
+    }
+};
+
+struct SessionTokenHash {
+    size_t operator()(const SessionToken &token) const { return static_cast<size_t>(token.low); }
+};
+
+// What a session caches about its user when it opens
+struct SessionInfo {
+    SlotHandle user; // Resolves to nullptr if the user is removed
+    int userId = 0;
+    std::string username;
+    Symbol role{};
+    PermissionSet permissions;
+};
+
+// Every open session, keyed by token. Sessions are split across shards by
+// token, each behind its own mutex, so sessions on different terminals
+// rarely contend. Each use of a session pushes its idle deadline back.
+//
+// Idle sessions are closed by a timer wheel per shard: one slot per second,
+// and a session sits in the slot its deadline falls in. Whenever a shard is
+// used, the wheel is advanced to the current second and the sessions in the
+// slots passed over are checked. Only those whose deadline has really
+// passed are closed; the rest were used since (or have a timeout longer
+// than one turn of the wheel) and move to the slot of their new deadline.
+// A session is never looked for in the wheel when it is used, so staying
+// active costs nothing but a store of the new deadline.
+class SessionStore {
+public:
+    static const uint32_t ShardCount = 16;
+    static const uint32_t WheelSlots = 256; // Seconds per turn of the wheel
+
+private:
+    struct Entry {
+        SessionInfo info;
+        int64_t deadline; // Second, counted from the store's epoch, after which the session is closed
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<SessionToken, Entry, SessionTokenHash> sessions;
+        std::vector<SessionToken> wheel[WheelSlots];
+        int64_t wheelSecond = 0; // Slots up to and including this second have been checked
+    };
+
+    Shard shards[ShardCount];
+    int64_t idleSeconds;
+    int64_t epoch;
+    std::atomic<size_t> openCount{0};
+    std::atomic<size_t> expiredCount{0};
+    std::mutex revokedMutex;
+    std::unordered_map<int, uint64_t> revoked; // Times closeAllFor has run for each user
+
+    Shard &shardOf(const SessionToken &token) { return shards[token.high % ShardCount]; }
+
+    // Deadlines only need whole seconds, so the coarse clock (read without
+    // leaving user space, a few ns) is plenty
+    static int64_t monotonicSecond() {
+        timespec now;
+        ::clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+        return now.tv_sec;
+    }
+
+    int64_t currentSecond() const { return monotonicSecond() - epoch; }
+
+    // Checks the wheel slots passed over since the shard was last advanced.
+    // Called with the shard locked.
+    void advance(Shard &shard, int64_t now) {
+        int64_t slots = std::min<int64_t>(now - shard.wheelSecond, WheelSlots);
+        for (int64_t i = 1; i <= slots; ++i) {
+            std::vector<SessionToken> &slot = shard.wheel[(shard.wheelSecond + i) % WheelSlots];
+            std::vector<SessionToken> due;
+            due.swap(slot);
+            for (const SessionToken &token : due) {
+                auto found = shard.sessions.find(token);
+                if (found == shard.sessions.end()) continue; // Closed already
+                if (found->second.deadline <= now) {
+                    shard.sessions.erase(found);
+                    --openCount;
+                    ++expiredCount;
+                } else {
+                    shard.wheel[found->second.deadline % WheelSlots].push_back(token);
+                }
+            }
+        }
+        if (now > shard.wheelSecond) shard.wheelSecond = now;
+    }
+
+    // Finds an open session and pushes its deadline back. A session past
+    // its deadline counts as closed even if the wheel has not reached it.
+    // Called with the shard locked.
+    Entry *use(Shard &shard, const SessionToken &token) {
+        int64_t now = currentSecond();
+        advance(shard, now);
+        auto found = shard.sessions.find(token);
+        if (found == shard.sessions.end()) return nullptr;
+        if (found->second.deadline <= now) {
+            shard.sessions.erase(found);
+            --openCount;
+            ++expiredCount;
+            return nullptr;
+        }
+        found->second.deadline = now + idleSeconds;
+        return &found->second;
+    }
+
+    // Adds a session. Called with the shard locked.
+    void insert(Shard &shard, const SessionToken &token, const SessionInfo &info, int64_t now) {
+        advance(shard, now);
+        Entry &entry = shard.sessions[token];
+        entry.info = info;
+        entry.deadline = now + idleSeconds;
+        shard.wheel[entry.deadline % WheelSlots].push_back(token);
+        ++openCount;
+    }
+
+public:
+    explicit SessionStore(std::chrono::seconds idleTimeout = std::chrono::minutes(30))
+        : idleSeconds(std::max<int64_t>(idleTimeout.count(), 1)), epoch(monotonicSecond()) {}
+
+    SessionStore(const SessionStore &) = delete;
+    SessionStore &operator=(const SessionStore &) = delete;
+
+    SessionToken open(const SessionInfo &info) {
+        SessionToken token = SessionToken::generate();
+        Shard &shard = shardOf(token);
+        int64_t now = currentSecond();
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        insert(shard, token, info, now);
+        return token;
+    }
+
+    // How many times closeAllFor has run for the user. A login reads it
+    // before checking the password and hands it to open.
+    uint64_t revocations(int userId) {
+        std::lock_guard<std::mutex> lock(revokedMutex);
+        auto found = revoked.find(userId);
+        return found == revoked.end() ? 0 : found->second;
+    }
+
+    // Opens a session unless closeAllFor has run for the user since
+    // revocations() returned seen; returns the null token if it has. A
+    // closeAllFor that starts later closes the session, so an account
+    // disabled while its password was being checked is never left logged in.
+    SessionToken open(const SessionInfo &info, uint64_t seen) {
+        SessionToken token = SessionToken::generate();
+        Shard &shard = shardOf(token);
+        int64_t now = currentSecond();
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (revocations(info.userId) != seen) return SessionToken();
+        insert(shard, token, info, now);
+        return token;
+    }
+
+    // Returns false if the session was not open (or had expired)
+    bool close(const SessionToken &token, SessionInfo *info = nullptr) {
+        if (token.isNull()) return false;
+        Shard &shard = shardOf(token);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto found = shard.sessions.find(token);
+        if (found == shard.sessions.end()) return false;
+        if (info) *info = found->second.info;
+        shard.sessions.erase(found); // Its wheel entry is dropped when the wheel reaches it
+        --openCount;
+        return true;
+    }
+
+    // Closes every session of a user, e.g. when the account is disabled
+    size_t closeAllFor(int userId) {
+        {
+            std::lock_guard<std::mutex> lock(revokedMutex);
+            ++revoked[userId]; // Before the sweep, so logins in flight see it
+        }
+        size_t closed = 0;
+        for (Shard &shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (auto it = shard.sessions.begin(); it != shard.sessions.end();) {
+                if (it->second.info.userId == userId) {
+                    it = shard.sessions.erase(it);
+                    ++closed;
+                } else {
+                    ++it;
+                }
+            }
+        }
+        openCount -= closed;
+        return closed;
+    }
+
+    // Copies the session's details and marks it used. Returns false if the
+    // session is not open.
+    bool touch(const SessionToken &token, SessionInfo *info = nullptr) {
+        if (token.isNull()) return false;
+        Shard &shard = shardOf(token);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        Entry *entry = use(shard, token);
+        if (!entry) return false;
+        if (info) *info = entry->info;
+        return true;
+    }
+
+    // Whether the session is open and its role grants the permission
+    bool allows(const SessionToken &token, Permission permission) {
+        if (token.isNull()) return false;
+        Shard &shard = shardOf(token);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        Entry *entry = use(shard, token);
+        return entry && entry->info.permissions.allows(permission);
+    }
+
+    // Advances every shard's wheel, closing idle sessions even on shards
+    // nobody has used lately
+    void expireIdle() {
+        int64_t now = currentSecond();
+        for (Shard &shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            advance(shard, now);
+        }
+    }
+
+    size_t openSessions() const { return openCount.load(std::memory_order_relaxed); }
+    size_t expiredSessions() const { return expiredCount.load(std::memory_order_relaxed); }
+};
+const uint32_t SessionStore::ShardCount;
+const uint32_t SessionStore::WheelSlots;
+
+// ------------------------------
+// Service Classes (Business Logic)
+// ------------------------------
+
+// Lifts an ID counter to at least minNext without ever lowering it, so
+// concurrent sessions allocating IDs are never handed a duplicate
+inline void raiseIdCounter(std::atomic<int> &counter, int minNext) {
+    int current = counter.load();
+    while (current < minNext && !counter.compare_exchange_weak(current, minNext)) {
+    }
+}
+
+// Displays the records a repository visit yields under a heading, or the
+// empty message if there are none. Records are shown in place, never copied.
+template <typename T, typename Visit>
+void displayRecords(IDisplayManager &display, Visit visit,
+                    const std::string &heading, const std::string &emptyMessage) {
+    bool any = false;
+    visit([&](const T &record) {
+        if (!any) {
+            display.displayInfo(heading);
+            any = true;
+        }
+        record.display();
+        std::cout << "-------------------------\n";
+    });
+    if (!any) display.displayInfo(emptyMessage);
+}
+
+// How logins are checked and how long they last
+struct AuthenticationOptions {
+    std::chrono::seconds sessionTimeout = std::chrono::minutes(30); // Idle time before a login lapses
+    uint32_t passwordIterations = DefaultPasswordIterations;         // PBKDF2 work factor for new passwords
+    size_t verifierThreads = 0; // Password check workers; 0 picks half the cores, at least one
+    size_t verifierQueue = 0;   // Checks allowed to wait for a worker; 0 allows 16 per worker
+};
+
+// Runs password checks, and the hashing of new passwords, on a fixed set
+// of threads fed by a bounded queue. Deriving a key is slow on purpose, so
+// it is kept off the threads that book and bill, and however many logins
+// arrive at once they can occupy only these workers: once the queue is
+// full, further work is turned away at once rather than waiting behind it.
+class PasswordVerifier {
+public:
+    typedef std::function<void(bool matched)> Callback;
+    typedef std::function<void(std::string hash)> HashCallback;
+
+private:
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::function<void()>> queue;
+    size_t queueLimit;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+    std::atomic<uint64_t> verifiedCount{0};
+    std::atomic<uint64_t> refusedCount{0};
+    std::once_flag decoyOnce;
+    std::string decoyHash;
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [&] { return stopping || !queue.empty(); });
+            if (queue.empty()) return; // Stopping, and all queued work has been done
+            std::function<void()> task = std::move(queue.front());
+            queue.pop_front();
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+
+    bool enqueue(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (queue.size() >= queueLimit) {
+                refusedCount.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            queue.push_back(std::move(task));
+        }
+        wake.notify_one();
+        return true;
+    }
+
+    // A hash that no password is checked against for real, as costly as a
+    // stored one; made by the first check that needs it
+    const std::string &decoy(uint32_t iterations) {
+        std::call_once(decoyOnce, [&] { decoyHash = hashPassword("decoy", iterations); });
+        return decoyHash;
+    }
+
+public:
+    PasswordVerifier(size_t threads, size_t queueLimit) {
+        if (threads == 0) threads = std::max(std::thread::hardware_concurrency() / 2, 1u);
+        this->queueLimit = queueLimit > 0 ? queueLimit : threads * 16;
+        for (size_t i = 0; i < threads; ++i) workers.emplace_back(&PasswordVerifier::work, this);
+    }
+
+    PasswordVerifier(const PasswordVerifier &) = delete;
+    PasswordVerifier &operator=(const PasswordVerifier &) = delete;
+
+    ~PasswordVerifier() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &worker : workers) worker.join();
+    }
+
+    // Queues a check; done runs on a worker thread. Returns false, without
+    // calling done, when the queue is full. The same holds for the other
+    // submissions below.
+    bool submit(const std::string &password, const std::string &stored, Callback done) {
+        return enqueue([this, password, stored, done] {
+            bool matched = verifyPassword(password, stored);
+            verifiedCount.fetch_add(1, std::memory_order_relaxed);
+            done(matched);
+        });
+    }
+
+    // Queues a check that takes as long as a real one but never matches,
+    // for logins with no account to check against
+    bool submitDecoy(const std::string &password, uint32_t iterations, Callback done) {
+        return enqueue([this, password, iterations, done] {
+            verifyPassword(password, decoy(iterations));
+            verifiedCount.fetch_add(1, std::memory_order_relaxed);
+            done(false);
+        });
+    }
+
+    // Queues the hashing of a new password
+    bool submitHash(const std::string &password, uint32_t iterations, HashCallback done) {
+        return enqueue([password, iterations, done] { done(hashPassword(password, iterations)); });
+    }
+
+    size_t threadCount() const { return workers.size(); }
+    size_t getQueueLimit() const { return queueLimit; }
+    uint64_t verified() const { return verifiedCount.load(std::memory_order_relaxed); }
+    uint64_t refused() const { return refusedCount.load(std::memory_order_relaxed); }
+};
+
+enum class LoginFailure { None, BadCredentials, Busy };
+
+// Authentication service
+// Checks credentials and keeps the sessions they open. One instance serves
+// every terminal and connection; each holds the token its login returned.
+// Passwords are checked on the verification pool, never on the caller's
+// thread.
+class AuthenticationService {
+public:
+    typedef std::function<void(SessionToken token, LoginFailure failure)> LoginCallback;
+
+private:
+    std::shared_ptr<IUserRepository> userRepo;
+    std::shared_ptr<ILogger> logger;
+    std::atomic<int> nextUserId{1};
+    uint32_t passwordIterations;
+    SessionStore sessions;
+    PasswordVerifier verifier; // Last, so its workers stop before what they use is destroyed
+
+public:
+    AuthenticationService(std::shared_ptr<IUserRepository> repo, std::shared_ptr<ILogger> log,
+                          const AuthenticationOptions &options = AuthenticationOptions())
+        : userRepo(repo), logger(log), passwordIterations(std::max<uint32_t>(options.passwordIterations, 1)),
+          sessions(options.sessionTimeout), verifier(options.verifierThreads, options.verifierQueue) {}
+
+    // Continue ID allocation after IDs restored from persistent storage
+    void resumeIdsAfter(int maxId) {
+        raiseIdCounter(nextUserId, maxId + 1);
+    }
+
+    int peekNextId() const { return nextUserId.load(); }
+    
+    // Looks the user up on the calling thread, checks the password on the
+    // verification pool, and calls done once with the outcome: from a pool
+    // thread after a check, or straight away if the pool has no room. An
+    // unknown or disabled account is refused only after a check as slow as
+    // a real one, so the delay does not tell which usernames exist.
+    void loginAsync(const std::string &username, const std::string &password, LoginCallback done) {
+        // Read under the user's lock: another session may disable, rehash
+        // or remove the account at any time. The revocation count is read
+        // there too, so a disable that lands after this read also closes
+        // the session the login opens.
+        SessionInfo info;
+        bool active = false;
+        std::string passwordHash;
+        uint64_t revocations = 0;
+        bool found = userRepo->inspectByUsername(username, [&](const User &user) {
+            active = user.getIsActive();
+            info.userId = user.getUserId();
+            info.username = user.getUsername();
+            info.role = user.getRoleSymbol();
+            passwordHash = user.getPasswordHash();
+            revocations = sessions.revocations(info.userId);
+        });
+        bool queued;
+        if (!found || !active) {
+            queued = verifier.submitDecoy(password, passwordIterations, [this, username, done](bool) {
+                logger->logWarning("Failed login attempt for username: " + username);
+                done(SessionToken(), LoginFailure::BadCredentials);
+            });
+        } else {
+            info.user = userRepo->getHandle(info.userId);
+            info.permissions = PermissionSet::forRole(info.role);
+            queued = verifier.submit(password, passwordHash,
+                                     [this, info, revocations, done](bool matched) {
+                if (!matched) {
+                    logger->logWarning("Failed login attempt for username: " + info.username);
+                    done(SessionToken(), LoginFailure::BadCredentials);
+                    return;
+                }
+                SessionToken token;
+                try {
+                    token = sessions.open(info, revocations);
+                } catch (const std::exception &e) {
+                    logger->logError("Login failed for " + info.username + ": " + e.what());
+                    done(SessionToken(), LoginFailure::BadCredentials);
+                    return;
+                }
+                if (token.isNull()) {
+                    logger->logWarning("Login refused, account disabled during the check: " + info.username);
+                    done(SessionToken(), LoginFailure::BadCredentials);
+                    return;
+                }
+                logger->logInfo("User logged in: " + info.username);
+                done(token, LoginFailure::None);
+            });
+        }
+        if (!queued) {
+            logger->logWarning("Login turned away, password checks all busy: " + username);
+            done(SessionToken(), LoginFailure::Busy);
+        }
+    }
+
+    // Opens a session, or returns the null token if the login is refused.
+    // Waits for the verification pool.
+    SessionToken login(const std::string &username, const std::string &password,
+                       LoginFailure *failure = nullptr) {
+        auto outcome = std::make_shared<std::promise<std::pair<SessionToken, LoginFailure>>>();
+        std::future<std::pair<SessionToken, LoginFailure>> result = outcome->get_future();
+        loginAsync(username, password, [outcome](SessionToken token, LoginFailure why) {
+            outcome->set_value(std::make_pair(token, why));
+        });
+        std::pair<SessionToken, LoginFailure> settled = result.get();
+        if (failure) *failure = settled.second;
+        return settled.first;
+    }
+    
+    void logout(const SessionToken &token) {
+        SessionInfo info;
+        if (sessions.close(token, &info)) {
+            logger->logInfo("User logged out: " + info.username);
+        }
+    }
+    
+    // A copy of the session's user, or null; taken under the user's lock
+    std::unique_ptr<User> getUser(const SessionToken &token) {
+        SessionInfo info;
+        return sessions.touch(token, &info) ? userRepo->copyById(info.userId) : nullptr;
+    }
+
+    // Fills in the session's cached details; false if it is not open
+    bool getSession(const SessionToken &token, SessionInfo &info) {
+        return sessions.touch(token, &info);
+    }
+    
+    bool isLoggedIn(const SessionToken &token) {
+        return sessions.touch(token);
+    }
+    
+    bool allows(const SessionToken &token, Permission permission) {
+        return sessions.allows(token, permission);
+    }
+
+    SessionStore &sessionStore() { return sessions; }
+    PasswordVerifier &passwordVerifier() { return verifier; }
+
+    // Logins match names without regard to case, so accounts restored from
+    // disk must differ by more than case; throws naming the first pair that
+    // does not
+    void requireDistinctUsernames() {
+        std::unordered_map<uint64_t, std::vector<std::string>> namesByHash;
+        userRepo->forEach([&](const User &user) {
+            std::vector<std::string> &names = namesByHash[usernameHash(user.getUsername())];
+            for (const auto &name : names) {
+                if (sameUsername(name, user.getUsername())) {
+                    throw std::runtime_error("Stored usernames differ only in case: " + name + " and " +
+                                             user.getUsername());
+                }
+            }
+            names.push_back(user.getUsername());
+        });
+    }
+
+    // Hashes passwords still stored as typed by builds that predate hashing
+    size_t upgradeLegacyPasswords() {
+        std::vector<int> legacy;
+        userRepo->forEach([&](const User &user) {
+            if (!isPasswordHash(user.getPasswordHash())) legacy.push_back(user.getUserId());
+        });
+        for (int id : legacy) {
+            userRepo->update(id, [&](User &user) {
+                user.setPasswordHash(hashPassword(user.getPasswordHash(), passwordIterations));
+            });
+        }
+        if (!legacy.empty()) logger->logInfo("Hashed " + std::to_string(legacy.size()) + " stored passwords");
+        return legacy.size();
+    }
+    
+    bool registerUser(const std::string &username, const std::string &password, const std::string &role) {
+        if (!canRegister(username, role)) return false; // Checked first to save hashing the password
+        return registerHashedUser(username, hashPassword(password, passwordIterations), role);
+    }
+
+    // Hashes a new password on the verification pool, so a caller serving
+    // others need not wait for it; done runs on a pool thread. Returns
+    // false, without calling done, when the pool has no room.
+    bool hashPasswordAsync(const std::string &password, PasswordVerifier::HashCallback done) {
+        return verifier.submitHash(password, passwordIterations, std::move(done));
+    }
+
+    // Adds a user whose password hashPasswordAsync has hashed. Callers
+    // check the role is in the vocabulary first.
+    bool registerHashedUser(const std::string &username, const std::string &passwordHash, const std::string &role) {
+        if (!canRegister(username, role)) return false;
+        // Another session may register the name between the check and the
+        // insert, so the repository re-checks as it stores the account
+        User user(nextUserId++, username, passwordHash, role);
+        if (!userRepo->addIfUsernameFree(user)) {
+            logger->logWarning("Failed to register: Username already exists: " + username);
+            return false;
+        }
+        logger->logInfo("New user registered: " + username + " with role: " + role);
+        return true;
+    }
+
+    // Logs the refusal when it is
+    bool usernameTaken(const std::string &username) {
+        if (!userRepo->findByUsername(username)) return false;
+        logger->logWarning("Failed to register: Username already exists: " + username);
+        return true;
+    }
+
+    bool canRegister(const std::string &username, const std::string &role) {
+        if (!inVocabulary(Vocabulary::Role, role)) {
+            logger->logWarning("Failed to register " + username + ": Invalid role: " + role);
+            return false;
+        }
+        return !usernameTaken(username);
+    }
+    
+    bool updateUserStatus(int userId, bool isActive) {
+        std::string username;
+        bool updated = userRepo->update(userId, [&](User &user) {
+            user.setIsActive(isActive);
+            username = user.getUsername();
+        });
+        if (updated) {
+            logger->logInfo("User status updated: " + username + " is now " + 
+                           (isActive ? "active" : "inactive"));
+            if (!isActive) {
+                size_t closed = sessions.closeAllFor(userId);
+                if (closed > 0) logger->logInfo("Closed " + std::to_string(closed) + " sessions of " + username);
+            }
+        }
+        return updated;
+    }
+    
+    void forEachUser(const IUserRepository::Visitor &visitor) const {
+        userRepo->forEach(visitor);
+    }
+};
+
+class PatientService {
+private:
+    std::shared_ptr<IPatientRepository> patientRepo;
+    std::shared_ptr<ILogger> logger;
+    std::shared_ptr<IDisplayManager> display;
+    std::atomic<int> nextPatientId{1};
+
+public:
+    PatientService(std::shared_ptr<IPatientRepository> repo, 
+                  std::shared_ptr<ILogger> log,
+                  std::shared_ptr<IDisplayManager> disp)
+        : patientRepo(repo), logger(log), display(disp) {}
+
+    // Continue ID allocation after IDs restored from persistent storage
+    void resumeIdsAfter(int maxId) {
+        raiseIdCounter(nextPatientId, maxId + 1);
+    }
+
+    int peekNextId() const { return nextPatientId.load(); }
+
+    void addPatient(const std::string &name, int age, const std::string &disease,
+                   const std::string &contactNumber = "", const std::string &address = "",
+                   const std::string &bloodGroup = "") {
+        OperationTimer timer(ServiceOperation::AddPatient);
+        if (!inVocabulary(Vocabulary::BloodGroup, bloodGroup)) {
+            logger->logWarning("Failed to add patient: Invalid blood group: " + bloodGroup);
+            display->displayError(vocabularyError(Vocabulary::BloodGroup));
+            return;
+        }
+        Patient p(nextPatientId++, name, age, disease, contactNumber, address, bloodGroup);
+        patientRepo->add(p);
+        logger->logInfo("Added patient: " + name + " (ID: " + std::to_string(p.getId()) + ")");
+        display->displaySuccess("Patient added successfully with ID: " + std::to_string(p.getId()));
+    }
+
+    void updatePatient(int id, const std::string &name, int age, const std::string &disease,
+                      const std::string &contactNumber = "", const std::string &address = "",
+                      const std::string &bloodGroup = "") {
+        OperationTimer timer(ServiceOperation::UpdatePatient);
+        if (!inVocabulary(Vocabulary::BloodGroup, bloodGroup)) {
+            logger->logWarning("Failed to update patient: Invalid blood group: " + bloodGroup);
+            display->displayError(vocabularyError(Vocabulary::BloodGroup));
+            return;
+        }
+        bool updated = patientRepo->update(id, [&](Patient &p) {
+            p.setName(name);
+            p.setAge(age);
+            p.setDisease(disease);
+            p.setContactNumber(contactNumber);
+            p.setAddress(address);
+            p.setBloodGroup(bloodGroup);
+        });
+        if (updated) {
+            logger->logInfo("Updated patient with ID: " + std::to_string(id));
+            display->displaySuccess("Patient updated successfully.");
+        } else {
+            logger->logWarning("Failed to update: Patient not found with ID: " + std::to_string(id));
+            display->displayError("Patient not found.");
+        }
+    }
+
+    void removePatient(int id) {
+        OperationTimer timer(ServiceOperation::RemovePatient);
+        if (patientRepo->remove(id)) {
+            logger->logInfo("Removed patient with ID: " + std::to_string(id));
+            display->displaySuccess("Patient removed successfully.");
+        } else {
+            logger->logWarning("Failed to remove: Patient not found with ID: " + std::to_string(id));
+            display->displayError("Patient not found.");
+        }
+    }
+
+    void listPatients() const {
+        OperationTimer timer(ServiceOperation::ListPatients);
+        displayRecords<Patient>(*display, [&](const auto &v) { patientRepo->forEach(v); },
+                           "List of all patients:",
+                           "No patients registered.");
+    }
+    
+    void findPatientsByDisease(const std::string &disease) const {
+        OperationTimer timer(ServiceOperation::FindPatientsByDisease);
+        displayRecords<Patient>(*display, [&](const auto &v) { patientRepo->forEachByDisease(disease, v); },
+                           "Patients with disease '" + disease + "':",
+                           "No patients found with disease: " + disease);
+    }
+    
+    void findPatientsByAgeRange(int minAge, int maxAge) const {
+        OperationTimer timer(ServiceOperation::FindPatientsByAgeRange);
+        size_t count = patientRepo->countByAgeRange(minAge, maxAge);
+        if (count == 0) {
+            display->displayInfo("No patients found in age range " + 
+                               std::to_string(minAge) + " to " + std::to_string(maxAge));
+            return;
+        }
+        display->displayInfo(std::to_string(count) + " patient(s) in age range " + std::to_string(minAge) + 
+                           " to " + std::to_string(maxAge) + ":");
+        patientRepo->forEachInAgeRange(minAge, maxAge, [](const Patient &p) {
+            p.display();
+            std::cout << "-------------------------\n";
+        });
+    }
+
+    std::unique_ptr<Patient> getPatientById(int id) {
+        OperationTimer timer(ServiceOperation::GetPatientById);
+        return patientRepo->copyById(id);
+    }
+
+    bool patientExists(int id) {
+        OperationTimer timer(ServiceOperation::PatientExists);
+        return patientRepo->inspect(id, [](const Patient &) {});
+    }
+
+    // Applies a change to a patient record through the repository so its
+    // indexes stay in sync; returns false if the patient does not exist
+    bool modifyPatient(int id, const std::function<void(Patient &)> &mutator) {
+        OperationTimer timer(ServiceOperation::ModifyPatient);
+        return patientRepo->update(id, mutator);
+    }
+};
+
+class DoctorService {
+private:
+    std::shared_ptr<IDoctorRepository> doctorRepo;
+    std::shared_ptr<ILogger> logger;
+    std::shared_ptr<IDisplayManager> display;
+    std::atomic<int> nextDoctorId{1};
+
+public:
+    DoctorService(std::shared_ptr<IDoctorRepository> repo,
+                 std::shared_ptr<ILogger> log,
+                 std::shared_ptr<IDisplayManager> disp)
+        : doctorRepo(repo), logger(log), display(disp) {}
+
+    // Continue ID allocation after IDs restored from persistent storage
+    void resumeIdsAfter(int maxId) {
+        raiseIdCounter(nextDoctorId, maxId + 1);
+    }
+
+    int peekNextId() const { return nextDoctorId.load(); }
+
+    void addDoctor(const std::string &name, const std::string &specialization,
+                  const std::string &contactNumber = "", const std::string &email = "",
+                  Money consultationFee = Money()) {
+        OperationTimer timer(ServiceOperation::AddDoctor);
+        Doctor d(nextDoctorId++, name, specialization, contactNumber, email, consultationFee);
+        doctorRepo->add(d);
+        logger->logInfo("Added doctor: " + name + " (ID: " + std::to_string(d.getId()) + ")");
+        display->displaySuccess("Doctor added successfully with ID: " + std::to_string(d.getId()));
+    }
+
+    void updateDoctor(int id, const std::string &name, const std::string &specialization,
+                     const std::string &contactNumber = "", const std::string &email = "",
+                     Money consultationFee = Money()) {
+        OperationTimer timer(ServiceOperation::UpdateDoctor);
+        bool updated = doctorRepo->update(id, [&](Doctor &d) {
+            d.setName(name);
+            d.setSpecialization(specialization);
+            d.setContactNumber(contactNumber);
+            d.setEmail(email);
+            d.setConsultationFee(consultationFee);
+        });
+        if (updated) {
+            logger->logInfo("Updated doctor with ID: " + std::to_string(id));
+            display->displaySuccess("Doctor updated successfully.");
+        } else {
+            logger->logWarning("Failed to update: Doctor not found with ID: " + std::to_string(id));
+            display->displayError("Doctor not found.");
+        }
+    }
+
+    void removeDoctor(int id) {
+        OperationTimer timer(ServiceOperation::RemoveDoctor);
+        if (doctorRepo->remove(id)) {
+            logger->logInfo("Removed doctor with ID: " + std::to_string(id));
+            display->displaySuccess("Doctor removed successfully.");
+        } else {
+            logger->logWarning("Failed to remove: Doctor not found with ID: " + std::to_string(id));
+            display->displayError("Doctor not found.");
+        }
+    }
+
+    void listDoctors() const {
+        OperationTimer timer(ServiceOperation::ListDoctors);
+        displayRecords<Doctor>(*display, [&](const auto &v) { doctorRepo->forEach(v); },
+                           "List of all doctors:",
+                           "No doctors registered.");
+    }
+    
+    void listAvailableDoctors() const {
+        OperationTimer timer(ServiceOperation::ListAvailableDoctors);
+        displayRecords<Doctor>(*display, [&](const auto &v) { doctorRepo->forEachAvailable(v); },
+                           "List of available doctors:",
+                           "No available doctors found.");
+    }
+    
+    void findDoctorsBySpecialization(const std::string &specialization) const {
+        OperationTimer timer(ServiceOperation::FindDoctorsBySpecialization);
+        displayRecords<Doctor>(*display, [&](const auto &v) { doctorRepo->forEachBySpecialization(specialization, v); },
+                           "Doctors with specialization '" + specialization + "':",
+                           "No doctors found with specialization: " + specialization);
+    }
+    
+    void setDoctorAvailability(int id, bool isAvailable) {
+        OperationTimer timer(ServiceOperation::SetDoctorAvailability);
+        if (doctorRepo->update(id, [&](Doctor &d) { d.setAvailability(isAvailable); })) {
+            logger->logInfo("Updated doctor availability: Doctor ID " + std::to_string(id) + 
+                          " is now " + (isAvailable ? "available" : "unavailable"));
+            display->displaySuccess("Doctor availability updated successfully.");
+        } else {
+            logger->logWarning("Failed to update availability: Doctor not found with ID: " + std::to_string(id));
+            display->displayError("Doctor not found.");
+        }
+    }
+
+    std::unique_ptr<Doctor> getDoctorById(int id) {
+        OperationTimer timer(ServiceOperation::GetDoctorById);
+        return doctorRepo->copyById(id);
+    }
+
+    bool doctorExists(int id) {
+        OperationTimer timer(ServiceOperation::DoctorExists);
+        return doctorRepo->inspect(id, [](const Doctor &) {});
+    }
+
+    // Reads a doctor under the repository's lock; false if not found
+    bool inspectDoctor(int id, const std::function<void(const Doctor &)> &reader) {
+        OperationTimer timer(ServiceOperation::InspectDoctor);
+        return doctorRepo->inspect(id, reader);
+    }
+};
+
+class AppointmentService {
+private:
+    std::shared_ptr<IAppointmentRepository> apptRepo;
+    PatientService &patientService;
+    DoctorService &doctorService;
+    std::shared_ptr<ILogger> logger;
+    std::shared_ptr<IDisplayManager> display;
+    std::atomic<int> nextAppointmentId{1};
+
+    bool validateDateAndSlot(const std::string &date, const std::string &timeSlot,
+                             const std::string &failurePrefix) {
+        if (parseDayNumber(date) == InvalidDay) {
+            logger->logWarning(failurePrefix + ": Invalid date: " + date);
+            display->displayError("Invalid date. Please use the YYYY-MM-DD format.");
+            return false;
+        }
+        if (timeSlotIndex(timeSlot) < 0) {
+            logger->logWarning(failurePrefix + ": Invalid time slot: " + timeSlot);
+            display->displayError("Invalid time slot.");
+            return false;
+        }
+        return true;
+    }
+
+    // True if moving the appointment into this date/slot/status would collide
+    // with a different booking for the same doctor
+    bool conflictsWithOtherBooking(const Appointment &current, const std::string &date,
+                                   const std::string &timeSlot, const std::string &status) const {
+        if (status == "Cancelled") return false;
+        bool sameSlot = current.getDate() == date && current.getTimeSlot() == timeSlot &&
+                        current.getStatusSymbol() != known().cancelled;
+        return !sameSlot && apptRepo->isSlotBooked(current.getDoctorId(), date, timeSlot);
+    }
+
+public:
+    AppointmentService(std::shared_ptr<IAppointmentRepository> repo,
+                       PatientService &ps, DoctorService &ds,
+                       std::shared_ptr<ILogger> log,
+                       std::shared_ptr<IDisplayManager> disp)
+        : apptRepo(repo), patientService(ps), doctorService(ds), 
+          logger(log), display(disp) {}
+
+    // Continue ID allocation after IDs restored from persistent storage
+    void resumeIdsAfter(int maxId) {
+        raiseIdCounter(nextAppointmentId, maxId + 1);
+    }
+
+    int peekNextId() const { return nextAppointmentId.load(); }
+
+    void bookAppointment(int patientId, int doctorId, const std::string &date, 
+                         const std::string &timeSlot = "09:00-09:30") {
+        OperationTimer timer(ServiceOperation::BookAppointment);
+        // Validate existence of patient and doctor
+        if (!patientService.patientExists(patientId)) {
+            logger->logWarning("Failed to book appointment: Invalid Patient ID: " + std::to_string(patientId));
+            display->displayError("Invalid Patient ID.");
+            return;
+        }
+        
+        bool doctorAvailable = false;
+        if (!doctorService.inspectDoctor(doctorId, [&](const Doctor &d) { doctorAvailable = d.getAvailability(); })) {
+            logger->logWarning("Failed to book appointment: Invalid Doctor ID: " + std::to_string(doctorId));
+            display->displayError("Invalid Doctor ID.");
+            return;
+        }
+        
+        // Check if doctor is available
+        if (!doctorAvailable) {
+            logger->logWarning("Failed to book appointment: Doctor is not available: " + std::to_string(doctorId));
+            display->displayError("Doctor is not available for appointments.");
+            return;
+        }
+        
+        if (!validateDateAndSlot(date, timeSlot, "Failed to book appointment")) {
+            return;
+        }
+        
+        // Check for conflicts in the same time slot
+        if (apptRepo->isSlotBooked(doctorId, date, timeSlot)) {
+            logger->logWarning("Failed to book appointment: Time slot is already booked.");
+            display->displayError("The selected time slot is already booked for this doctor.");
+            return;
+        }
+        
+        // Another session may take the slot between the check and the insert,
+        // so the repository re-checks as it stores the booking
+        Appointment a(nextAppointmentId++, patientId, doctorId, date, timeSlot);
+        if (!apptRepo->addIfSlotFree(a)) {
+            logger->logWarning("Failed to book appointment: Time slot was booked by another session.");
+            display->displayError("The selected time slot is already booked for this doctor.");
+            return;
+        }
+        
+        logger->logInfo("Booked appointment: Patient ID " + std::to_string(patientId) + 
+                       " with Doctor ID " + std::to_string(doctorId) + 
+                       " on " + date + " at " + timeSlot);
+        display->displaySuccess("Appointment booked successfully with ID: " + 
+                              std::to_string(a.getAppointmentId()));
+    }
+
+    void updateAppointmentDetails(int apptId, const std::string &newDate, 
+                                 const std::string &newTimeSlot, 
+                                 const std::string &newStatus,
+                                 const std::string &notes) {
+        OperationTimer timer(ServiceOperation::UpdateAppointmentDetails);
+        std::unique_ptr<Appointment> a = apptRepo->copyById(apptId);
+        if (!a) {
+            logger->logWarning("Failed to update: Appointment not found with ID: " + std::to_string(apptId));
+            display->displayError("Appointment not found.");
+            return;
+        }
+        
+        if (!validateDateAndSlot(newDate, newTimeSlot, "Failed to update appointment")) {
+            return;
+        }
+
+        if (!inVocabulary(Vocabulary::AppointmentStatus, newStatus)) {
+            logger->logWarning("Failed to update appointment: Invalid status: " + newStatus);
+            display->displayError(vocabularyError(Vocabulary::AppointmentStatus));
+            return;
+        }
+        
+        if (conflictsWithOtherBooking(*a, newDate, newTimeSlot, newStatus)) {
+            logger->logWarning("Failed to update appointment: Time slot is already booked.");
+            display->displayError("The selected time slot is already booked for this doctor.");
+            return;
+        }
+        
+        bool stored = apptRepo->updateIfSlotFree(apptId, [&](Appointment &appt) {
+            appt.setDate(newDate);
+            appt.setTimeSlot(newTimeSlot);
+            appt.setStatus(newStatus);
+            appt.setNotes(notes);
+        });
+        if (!stored) {
+            logger->logWarning("Failed to update appointment: Time slot was booked by another session.");
+            display->displayError("The selected time slot is already booked for this doctor.");
+            return;
+        }
+        
+        logger->logInfo("Updated appointment: ID " + std::to_string(apptId) + 
+                       " to " + newDate + " at " + newTimeSlot + 
+                       " (Status: " + newStatus + ")");
+        display->displaySuccess("Appointment updated successfully.");
+    }
+
+    void updateAppointmentStatus(int apptId, const std::string &newStatus) {
+        OperationTimer timer(ServiceOperation::UpdateAppointmentStatus);
+        std::unique_ptr<Appointment> a = apptRepo->copyById(apptId);
+        if (!a) {
+            logger->logWarning("Failed to update status: Appointment not found with ID: " + std::to_string(apptId));
+            display->displayError("Appointment not found.");
+            return;
+        }
+
+        if (!inVocabulary(Vocabulary::AppointmentStatus, newStatus)) {
+            logger->logWarning("Failed to update status: Invalid status: " + newStatus);
+            display->displayError(vocabularyError(Vocabulary::AppointmentStatus));
+            return;
+        }
+        
+        if (conflictsWithOtherBooking(*a, a->getDate(), a->getTimeSlot(), newStatus)) {
+            logger->logWarning("Failed to update status: Time slot has been booked by another appointment.");
+            display->displayError("The time slot has since been booked by another appointment.");
+            return;
+        }
+        
+        if (!apptRepo->updateIfSlotFree(apptId, [&](Appointment &appt) { appt.setStatus(newStatus); })) {
+            logger->logWarning("Failed to update status: Time slot has been booked by another appointment.");
+            display->displayError("The time slot has since been booked by another appointment.");
+            return;
+        }
+        logger->logInfo("Updated appointment status: ID " + std::to_string(apptId) + 
+                       " to " + newStatus);
+        display->displaySuccess("Appointment status updated successfully.");
+    }
+
+    void cancelAppointment(int apptId) {
+        OperationTimer timer(ServiceOperation::CancelAppointment);
+        if (apptRepo->update(apptId, [](Appointment &appt) { appt.setStatus("Cancelled"); })) {
+            logger->logInfo("Cancelled appointment: ID " + std::to_string(apptId));
+            display->displaySuccess("Appointment marked as cancelled.");
+        } else if (apptRepo->remove(apptId)) {
+            logger->logInfo("Removed appointment: ID " + std::to_string(apptId));
+            display->displaySuccess("Appointment removed completely.");
+        } else {
+            logger->logWarning("Failed to cancel: Appointment not found with ID: " + std::to_string(apptId));
+            display->displayError("Appointment not found.");
+        }
+    }
+
+    void listFreeSlots(int doctorId, const std::string &date) const {
+        OperationTimer timer(ServiceOperation::ListFreeSlots);
+        if (parseDayNumber(date) == InvalidDay) {
+            display->displayError("Invalid date. Please use the YYYY-MM-DD format.");
+            return;
+        }
+        auto slots = apptRepo->findFreeSlots(doctorId, date);
+        if (slots.empty()) {
+            display->displayInfo("No free slots for doctor ID " + std::to_string(doctorId) + " on " + date);
+            return;
+        }
+        display->displayInfo("Free slots for doctor ID " + std::to_string(doctorId) + " on " + date + ":");
+        for (const auto &slot : slots) {
+            std::cout << "  " << slot << "\n";
+        }
+    }
+
+    void listAllAppointments() const {
+        OperationTimer timer(ServiceOperation::ListAllAppointments);
+        displayRecords<Appointment>(*display, [&](const auto &v) { apptRepo->forEach(v); },
+                           "List of all appointments:",
+                           "No appointments found.");
+    }
+    
+    void listAppointmentsByPatient(int patientId) const {
+        OperationTimer timer(ServiceOperation::ListAppointmentsByPatient);
+        displayRecords<Appointment>(*display, [&](const auto &v) { apptRepo->forEachByPatientId(patientId, v); },
+                           "Appointments for patient ID " + std::to_string(patientId) + ":",
+                           "No appointments found for patient ID: " + std::to_string(patientId));
+    }
+    
+    void listAppointmentsByDoctor(int doctorId) const {
+        OperationTimer timer(ServiceOperation::ListAppointmentsByDoctor);
+        displayRecords<Appointment>(*display, [&](const auto &v) { apptRepo->forEachByDoctorId(doctorId, v); },
+                           "Appointments for doctor ID " + std::to_string(doctorId) + ":",
+                           "No appointments found for doctor ID: " + std::to_string(doctorId));
+    }
+    
+    void listAppointmentsByDate(const std::string &date) const {
+        OperationTimer timer(ServiceOperation::ListAppointmentsByDate);
+        displayRecords<Appointment>(*display, [&](const auto &v) { apptRepo->forEachByDate(date, v); },
+                           "Appointments for date " + date + ":",
+                           "No appointments found for date: " + date);
+    }
+    
+    void listAppointmentsByStatus(const std::string &status) const {
+        OperationTimer timer(ServiceOperation::ListAppointmentsByStatus);
+        displayRecords<Appointment>(*display, [&](const auto &v) { apptRepo->forEachByStatus(status, v); },
+                           "Appointments with status '" + status + "':",
+                           "No appointments found with status: " + status);
+    }
+
+    void listAppointmentsInDateRange(const std::string &fromDate, const std::string &toDate) const {
+        OperationTimer timer(ServiceOperation::ListAppointmentsInDateRange);
+        int fromDay = parseDayNumber(fromDate);
+        int toDay = parseDayNumber(toDate);
+        if (fromDay == InvalidDay || toDay == InvalidDay) {
+            display->displayError("Invalid date. Please use the YYYY-MM-DD format.");
+            return;
+        }
+        displayRecords<Appointment>(*display, [&](const auto &v) { apptRepo->forEachInDateRange(fromDay, toDay, v); },
+                           "Appointments from " + fromDate + " to " + toDate + ":",
+                           "No appointments found from " + fromDate + " to " + toDate);
+    }
+
+    // Moves every appointment dated before the given date out of the live
+    // store into a snapshot-format file. The archive is written and synced
+    // before anything is removed, so a crash in between leaves the
+    // appointments live (and archived twice) rather than lost.
+    void archiveAppointmentsBefore(const std::string &date, const std::string &archivePath) {
+        OperationTimer timer(ServiceOperation::ArchiveAppointmentsBefore);
+        int day = parseDayNumber(date);
+        if (day == InvalidDay) {
+            logger->logWarning("Failed to archive: Invalid date: " + date);
+            display->displayError("Invalid date. Please use the YYYY-MM-DD format.");
+            return;
+        }
+        // An existing archive is added to, never replaced; one that cannot
+        // be read is left alone and nothing is archived
+        InMemoryAppointmentRepository earlier;
+        struct stat existing;
+        if (::stat(archivePath.c_str(), &existing) == 0) {
+            try {
+                MappedSnapshot(archivePath).loadInto(earlier);
+            } catch (const std::exception &e) {
+                logger->logError("Refusing to overwrite " + archivePath + ": " + e.what());
+                display->displayError(archivePath + " exists and is not a readable archive; choose another file.");
+                return;
+            }
+        }
+        std::vector<Appointment> archived;
+        apptRepo->forEachInDateRange(std::numeric_limits<int>::min(), day - 1,
+                                     [&](const Appointment &appt) { archived.push_back(appt); });
+        if (archived.empty()) {
+            display->displayInfo("No appointments dated before " + date + ".");
+            return;
+        }
+        std::unordered_map<int, std::string> archivedRecords;
+        try {
+            for (const Appointment &appt : archived) {
+                earlier.add(appt); // Replaces any copy archived before
+                BinaryWriter out(archivedRecords[appt.getAppointmentId()]);
+                EntityCodec<Appointment>::encode(out, appt);
+            }
+            SnapshotWriter writer;
+            writer.addTable(earlier.getAll());
+            writer.write(archivePath);
+        } catch (const std::exception &e) {
+            logger->logError("Failed to archive appointments to " + archivePath + ": " + e.what());
+            display->displayError("Could not write archive: " + std::string(e.what()));
+            return;
+        }
+        // Another session may have booked or changed an old appointment since
+        // it was copied; any that do not match the archive stay live
+        std::vector<Appointment> changed;
+        apptRepo->archiveDaysBefore(day, [&](const Appointment &appt) {
+            std::string record;
+            BinaryWriter out(record);
+            EntityCodec<Appointment>::encode(out, appt);
+            auto found = archivedRecords.find(appt.getAppointmentId());
+            if (found == archivedRecords.end() || found->second != record) changed.push_back(appt);
+        });
+        for (const Appointment &appt : changed) apptRepo->add(appt);
+        logger->logInfo("Archived " + std::to_string(archived.size()) + " appointments dated before " +
+                        date + " to " + archivePath);
+        display->displaySuccess("Archived " + std::to_string(archived.size()) + " appointments to " + archivePath);
+    }
+};
+
+class MedicationService {
+private:
+    std::shared_ptr<IMedicationRepository> medRepo;
+    std::shared_ptr<ILogger> logger;
+    std::shared_ptr<IDisplayManager> display;
+    std::atomic<int> nextMedicationId{1};
+
+public:
+    MedicationService(std::shared_ptr<IMedicationRepository> repo,
+                     std::shared_ptr<ILogger> log,
+                     std::shared_ptr<IDisplayManager> disp)
+        : medRepo(repo), logger(log), display(disp) {}
+
+    // Continue ID allocation after IDs restored from persistent storage
+    void resumeIdsAfter(int maxId) {
+        raiseIdCounter(nextMedicationId, maxId + 1);
+    }
+
+    int peekNextId() const { return nextMedicationId.load(); }
+        
+    void addMedication(const std::string &name, const std::string &dosage, Money price,
+                      const std::string &manufacturer = "", const std::string &description = "") {
+        OperationTimer timer(ServiceOperation::AddMedication);
+        if (medRepo->findByName(name)) {
+            logger->logWarning("Failed to add: Medication with name '" + name + "' already exists");
+            display->displayError("Medication with this name already exists.");
+            return;
+        }
+        
+        // Another session may add the name between the check and the
+        // insert, so the repository re-checks as it stores the medication
+        Medication m(nextMedicationId++, name, dosage, price, manufacturer, description);
+        if (!medRepo->addIfNameFree(m)) {
+            logger->logWarning("Failed to add: Medication with name '" + name + "' already exists");
+            display->displayError("Medication with this name already exists.");
+            return;
+        }
+        logger->logInfo("Added medication: " + name + " (ID: " + std::to_string(m.getMedicationId()) + ")");
+        display->displaySuccess("Medication added successfully with ID: " + std::to_string(m.getMedicationId()));
+    }
+    
+    void updateMedication(int id, const std::string &name, const std::string &dosage, Money price,
+                         const std::string &manufacturer = "", const std::string &description = "") {
+        OperationTimer timer(ServiceOperation::UpdateMedication);
+        // The new name must not belong to another medication; the
+        // repository checks and stores in one step
+        bool stored = medRepo->updateIfNameFree(id, [&](Medication &med) {
+            med.setName(name);
+            med.setDosage(dosage);
+            med.setPrice(price);
+            med.setManufacturer(manufacturer);
+            med.setDescription(description);
+        });
+        if (!stored) {
+            if (!medRepo->inspect(id, [](const Medication &) {})) {
+                logger->logWarning("Failed to update: Medication not found with ID: " + std::to_string(id));
+                display->displayError("Medication not found.");
+            } else {
+                logger->logWarning("Failed to update: Medication name '" + name + "' already in use");
+                display->displayError("A medication with this name already exists.");
+            }
+            return;
+        }
+        
+        logger->logInfo("Updated medication: ID " + std::to_string(id));
+        display->displaySuccess("Medication updated successfully.");
+    }
+    
+    void removeMedication(int id) {
+        OperationTimer timer(ServiceOperation::RemoveMedication);
+        if (medRepo->remove(id)) {
+            logger->logInfo("Removed medication with ID: " + std::to_string(id));
+            display->displaySuccess("Medication removed successfully.");
+        } else {
+            logger->logWarning("Failed to remove: Medication not found with ID: " + std::to_string(id));
+            display->displayError("Medication not found.");
+        }
+    }
+    
+    void listAllMedications() const {
+        OperationTimer timer(ServiceOperation::ListAllMedications);
+        displayRecords<Medication>(*display, [&](const auto &v) { medRepo->forEach(v); },
+                           "List of all medications:",
+                           "No medications available.");
+    }
+    
+    std::unique_ptr<Medication> getMedicationById(int id) {
+        OperationTimer timer(ServiceOperation::GetMedicationById);
+        return medRepo->copyById(id);
+    }
+    
+    // A copy taken under the medication's lock, or null
+    std::unique_ptr<Medication> getMedicationByName(const std::string &name) {
+        OperationTimer timer(ServiceOperation::GetMedicationByName);
+        std::unique_ptr<Medication> copy;
+        medRepo->inspectByName(name, [&](const Medication &medication) { copy.reset(new Medication(medication)); });
+        return copy;
+    }
+};
+
+class PrescriptionService {
+private:
+    std::shared_ptr<IPrescriptionRepository> prescRepo;
+    PatientService &patientService;
+    DoctorService &doctorService;
+    MedicationService &medicationService;
+    std::shared_ptr<ILogger> logger;
+    std::shared_ptr<IDisplayManager> display;
+    std::atomic<int> nextPrescriptionId{1};
+
+public:
+    PrescriptionService(std::shared_ptr<IPrescriptionRepository> repo,
+                       PatientService &ps, DoctorService &ds, MedicationService &ms,
+                       std::shared_ptr<ILogger> log,
+                       std::shared_ptr<IDisplayManager> disp)
+        : prescRepo(repo), patientService(ps), doctorService(ds), 
+          medicationService(ms), logger(log), display(disp) {}
+
+    // Continue ID allocation after IDs restored from persistent storage
+    void resumeIdsAfter(int maxId) {
+        raiseIdCounter(nextPrescriptionId, maxId + 1);
+    }
+
+    int peekNextId() const { return nextPrescriptionId.load(); }
+          
+    void createPrescription(int patientId, int doctorId, const std::string &date,
+                           const std::vector<int> &medicationIds, const std::string &instructions = "") {
+        OperationTimer timer(ServiceOperation::CreatePrescription);
+        // Validate patient and doctor
+        if (!patientService.patientExists(patientId)) {
+            logger->logWarning("Failed to create prescription: Invalid Patient ID: " + std::to_string(patientId));
+            display->displayError("Invalid Patient ID.");
+            return;
+        }
+        
+        if (!doctorService.doctorExists(doctorId)) {
+            logger->logWarning("Failed to create prescription: Invalid Doctor ID: " + std::to_string(doctorId));
+            display->displayError("Invalid Doctor ID.");
+            return;
+        }
+
+        if (parseDayNumber(date) == InvalidDay) {
+            logger->logWarning("Failed to create prescription: Invalid date: " + date);
+            display->displayError("Invalid date. Please use the YYYY-MM-DD format.");
+            return;
+        }
+        
+        // Validate all medications
+        for (int medId : medicationIds) {
+            if (!medicationService.getMedicationById(medId)) {
+                logger->logWarning("Failed to create prescription: Invalid Medication ID: " + std::to_string(medId));
+                display->displayError("Invalid Medication ID: " + std::to_string(medId));
+                return;
+            }
+        }
+        
+        Prescription p(nextPrescriptionId++, patientId, doctorId, date, medicationIds, instructions);
+        prescRepo->add(p);
+        
+        // Update patient's medication list
+        patientService.modifyPatient(patientId, [&](Patient &patient) {
+            for (int medId : medicationIds) {
+                patient.addMedicationId(medId);
+            }
+        });
+        
+        logger->logInfo("Created prescription for Patient ID " + std::to_string(patientId) + 
+                       " by Doctor ID " + std::to_string(doctorId));
+        display->displaySuccess("Prescription created successfully with ID: " + std::to_string(p.getPrescriptionId()));
+    }
+    
+    void updatePrescription(int prescriptionId, const std::vector<int> &medicationIds, 
+                           const std::string &instructions) {
+        OperationTimer timer(ServiceOperation::UpdatePrescription);
+        std::unique_ptr<Prescription> p = prescRepo->copyById(prescriptionId);
+        if (!p) {
+            logger->logWarning("Failed to update: Prescription not found with ID: " + std::to_string(prescriptionId));
+            display->displayError("Prescription not found.");
+            return;
+        }
+        
+        // Validate all medications
+        for (int medId : medicationIds) {
+            if (!medicationService.getMedicationById(medId)) {
+                logger->logWarning("Failed to update prescription: Invalid Medication ID: " + std::to_string(medId));
+                display->displayError("Invalid Medication ID: " + std::to_string(medId));
+                return;
+            }
+        }
+        
+        // Update the patient's medication list
+        std::vector<int> oldMedicationIds = p->getMedicationIds();
+        patientService.modifyPatient(p->getPatientId(), [&](Patient &patient) {
+            // Remove old medications
+            for (int medId : oldMedicationIds) {
+                patient.removeMedicationId(medId);
+            }
+            
+            // Add new medications
+            for (int medId : medicationIds) {
+                patient.addMedicationId(medId);
+            }
+        });
+        
+        // Update prescription with new medications and instructions
+        prescRepo->update(prescriptionId, [&](Prescription &presc) {
+            presc.setMedicationIds(medicationIds);
+            presc.setInstructions(instructions);
+        });
+        
+        logger->logInfo("Updated prescription with ID: " + std::to_string(prescriptionId));
+        display->displaySuccess("Prescription updated successfully.");
+    }
+    
+    void removePrescription(int prescriptionId) {
+        OperationTimer timer(ServiceOperation::RemovePrescription);
+        std::unique_ptr<Prescription> p = prescRepo->copyById(prescriptionId);
+        if (!p) {
+            logger->logWarning("Failed to remove: Prescription not found with ID: " + std::to_string(prescriptionId));
+            display->displayError("Prescription not found.");
+            return;
+        }
+        
+        // Remove medications from patient's list
+        std::vector<int> medicationIds = p->getMedicationIds();
+        patientService.modifyPatient(p->getPatientId(), [&](Patient &patient) {
+            for (int medId : medicationIds) {
+                patient.removeMedicationId(medId);
+            }
+        });
+        
+        if (prescRepo->remove(prescriptionId)) {
+            logger->logInfo("Removed prescription with ID: " + std::to_string(prescriptionId));
+            display->displaySuccess("Prescription removed successfully.");
+        }
+    }
+    
+    void listAllPrescriptions() const {
+        OperationTimer timer(ServiceOperation::ListAllPrescriptions);
+        displayRecords<Prescription>(*display, [&](const auto &v) { prescRepo->forEach(v); },
+                           "List of all prescriptions:",
+                           "No prescriptions found.");
+    }
+    
+    void listPrescriptionsByPatient(int patientId) const {
+        OperationTimer timer(ServiceOperation::ListPrescriptionsByPatient);
+        displayRecords<Prescription>(*display, [&](const auto &v) { prescRepo->forEachByPatientId(patientId, v); },
+                           "Prescriptions for patient ID " + std::to_string(patientId) + ":",
+                           "No prescriptions found for patient ID: " + std::to_string(patientId));
+    }
+    
+    void listPrescriptionsByDoctor(int doctorId) const {
+        OperationTimer timer(ServiceOperation::ListPrescriptionsByDoctor);
+        displayRecords<Prescription>(*display, [&](const auto &v) { prescRepo->forEachByDoctorId(doctorId, v); },
+                           "Prescriptions by doctor ID " + std::to_string(doctorId) + ":",
+                           "No prescriptions found for doctor ID: " + std::to_string(doctorId));
+    }
+    
+    std::unique_ptr<Prescription> getPrescriptionById(int id) {
+        OperationTimer timer(ServiceOperation::GetPrescriptionById);
+        return prescRepo->copyById(id);
+    }
+};
+
+class BillingService {
+private:
+    std::shared_ptr<IBillRepository> billRepo;
+    PatientService &patientService;
+    DoctorService &doctorService;
+    std::shared_ptr<ILogger> logger;
+    std::shared_ptr<IDisplayManager> display;
+    std::atomic<int> nextBillId{1};
+
+public:
+    BillingService(std::shared_ptr<IBillRepository> repo,
+                  PatientService &ps, DoctorService &ds,
+                  std::shared_ptr<ILogger> log,
+                  std::shared_ptr<IDisplayManager> disp)
+        : billRepo(repo), patientService(ps), doctorService(ds), 
+          logger(log), display(disp) {}
+
+    // Continue ID allocation after IDs restored from persistent storage
+    void resumeIdsAfter(int maxId) {
+        raiseIdCounter(nextBillId, maxId + 1);
+    }
+
+    int peekNextId() const { return nextBillId.load(); }
+          
+    void generateBill(int patientId, const std::string &date, Money consultationFee,
+                     Money medicationCharges = Money(), Money otherCharges = Money()) {
+        OperationTimer timer(ServiceOperation::GenerateBill);
+        // Validate patient
+        if (!patientService.patientExists(patientId)) {
+            logger->logWarning("Failed to generate bill: Invalid Patient ID: " + std::to_string(patientId));
+            display->displayError("Invalid Patient ID.");
+            return;
+        }
+
+        if (parseDayNumber(date) == InvalidDay) {
+            logger->logWarning("Failed to generate bill: Invalid date: " + date);
+            display->displayError("Invalid date. Please use the YYYY-MM-DD format.");
+            return;
+        }
+        
+        Bill bill(nextBillId++, patientId, date, consultationFee, medicationCharges, otherCharges);
+        billRepo->add(bill);
+        
+        logger->logInfo("Generated bill for Patient ID " + std::to_string(patientId) + 
+                       " with total amount: $" + bill.getTotalAmount().toString());
+        display->displaySuccess("Bill generated successfully with ID: " + 
+                              std::to_string(bill.getBillId()) + 
+                              " (Total: $" + bill.getTotalAmount().toString() + ")");
+    }
+    
+    void updateBillPaymentStatus(int billId, const std::string &status, const std::string &paymentMethod = "") {
+        OperationTimer timer(ServiceOperation::UpdateBillPaymentStatus);
+        std::unique_ptr<Bill> bill = billRepo->copyById(billId);
+        if (!bill) {
+            logger->logWarning("Failed to update: Bill not found with ID: " + std::to_string(billId));
+            display->displayError("Bill not found.");
+            return;
+        }
+
+        if (!inVocabulary(Vocabulary::PaymentStatus, status)) {
+            logger->logWarning("Failed to update bill: Invalid payment status: " + status);
+            display->displayError(vocabularyError(Vocabulary::PaymentStatus));
+            return;
+        }
+        if (!inVocabulary(Vocabulary::PaymentMethod, paymentMethod)) {
+            logger->logWarning("Failed to update bill: Invalid payment method: " + paymentMethod);
+            display->displayError(vocabularyError(Vocabulary::PaymentMethod));
+            return;
+        }
+        
+        billRepo->update(billId, [&](Bill &b) {
+            b.setPaymentStatus(status);
+            if (!paymentMethod.empty()) {
+                b.setPaymentMethod(paymentMethod);
+            }
+        });
+        
+        logger->logInfo("Updated bill payment status: ID " + std::to_string(billId) + 
+                       " to " + status + 
+                       (paymentMethod.empty() ? "" : " (Method: " + paymentMethod + ")"));
+        display->displaySuccess("Bill payment status updated successfully.");
+    }
+    
+    void listAllBills() const {
+        OperationTimer timer(ServiceOperation::ListAllBills);
+        displayRecords<Bill>(*display, [&](const auto &v) { billRepo->forEach(v); },
+                           "List of all bills:",
+                           "No bills found.");
+    }
+    
+    void listBillsByPatient(int patientId) const {
+        OperationTimer timer(ServiceOperation::ListBillsByPatient);
+        displayRecords<Bill>(*display, [&](const auto &v) { billRepo->forEachByPatientId(patientId, v); },
+                           "Bills for patient ID " + std::to_string(patientId) + ":",
+                           "No bills found for patient ID: " + std::to_string(patientId));
+    }
+    
+    void listBillsByPaymentStatus(const std::string &status) const {
+        OperationTimer timer(ServiceOperation::ListBillsByPaymentStatus);
+        displayRecords<Bill>(*display, [&](const auto &v) { billRepo->forEachByPaymentStatus(status, v); },
+                           "Bills with payment status '" + status + "':",
+                           "No bills found with payment status: " + status);
+    }
+    
+    Money getTotalRevenue() const {
+        OperationTimer timer(ServiceOperation::GetTotalRevenue);
+        Money total = billRepo->getTotalRevenue();
+        display->displayInfo("Total revenue: $" + total.toString());
+        return total;
+    }
+
+    // Shows revenue split by payment status and by payment method
+    void reportRevenueBreakdown() const {
+        OperationTimer timer(ServiceOperation::ReportRevenueBreakdown);
+        auto report = [&](const std::string &heading, const std::map<std::string, RevenueTotal> &groups) {
+            display->displayInfo(heading);
+            for (const auto &group : groups) {
+                display->displayInfo("  " + (group.first.empty() ? std::string("(none)") : group.first) + ": " +
+                                     std::to_string(group.second.bills) + " bills, $" +
+                                     group.second.amount.toString());
+            }
+        };
+        report("Revenue by payment status:", billRepo->getRevenueByPaymentStatus());
+        report("Revenue by payment method:", billRepo->getRevenueByPaymentMethod());
+    }
+
+    // Pending bills grouped by how many days old they are on the given date
+    // (today if empty)
+    void reportPendingAging(const std::string &asOfDate) const {
+        OperationTimer timer(ServiceOperation::ReportPendingAging);
+        int asOfDay = asOfDate.empty() ? todayDayNumber() : parseDayNumber(asOfDate);
+        if (asOfDay == InvalidDay) {
+            display->displayError("Invalid date. Please use the YYYY-MM-DD format.");
+            return;
+        }
+        static const std::vector<int> ageBounds = {0, 31, 61, 91};
+        static const char *const labels[] = {"0-30 days", "31-60 days", "61-90 days", "91+ days"};
+        std::vector<RevenueTotal> buckets = billRepo->getAging("Pending", asOfDay, ageBounds);
+        display->displayInfo("Pending payments by age as of " + formatDayNumber(asOfDay) + ":");
+        for (size_t i = 0; i < buckets.size(); ++i) {
+            std::ostringstream row;
+            row << "  " << std::left << std::setw(11) << labels[i] << ": " << buckets[i].bills << " bills, $"
+                << buckets[i].amount;
+            display->displayInfo(row.str());
+        }
+    }
+
+    RevenueTotal getPendingPayments() const {
+        OperationTimer timer(ServiceOperation::GetPendingPayments);
+        RevenueTotal pending = billRepo->getRevenueForPaymentStatus("Pending");
+        display->displayInfo("Pending payments: " + std::to_string(pending.bills) + " bills totalling $" +
+                             pending.amount.toString());
+        return pending;
+    }
+
+    // Lists the bills dated fromDate..toDate and returns their total
+    Money getRevenueInDateRange(const std::string &fromDate, const std::string &toDate) const {
+        OperationTimer timer(ServiceOperation::GetRevenueInDateRange);
+        int fromDay = parseDayNumber(fromDate);
+        int toDay = parseDayNumber(toDate);
+        if (fromDay == InvalidDay || toDay == InvalidDay) {
+            display->displayError("Invalid date. Please use the YYYY-MM-DD format.");
+            return Money();
+        }
+        Money total;
+        displayRecords<Bill>(*display, [&](const auto &v) {
+            billRepo->forEachInDateRange(fromDay, toDay, [&](const Bill &bill) {
+                total += bill.getTotalAmount();
+                v(bill);
+            });
+        }, "Bills from " + fromDate + " to " + toDate + ":",
+           "No bills found from " + fromDate + " to " + toDate);
+        display->displayInfo("Revenue from " + fromDate + " to " + toDate + ": $" + total.toString());
+        return total;
+    }
+    
+    std::unique_ptr<Bill> getBillById(int id) {
+        OperationTimer timer(ServiceOperation::GetBillById);
+        return billRepo->copyById(id);
+    }
+};
+
+// ------------------------------
+// Batch Commands
+// ------------------------------
+
+// One line of a batch script split on '|'. Fields point into the caller's
+// buffer: separators are overwritten with NULs, so parsing copies nothing.
+class CommandLine {
+private:
+    std::vector<const char*> fields;
+
+public:
+    // Splits [begin, end); *end must be writable and becomes a terminator
+    void parse(char *begin, char *end) {
+        fields.clear();
+        *end = '\0';
+        if (end > begin && end[-1] == '\r') end[-1] = '\0';
+        fields.push_back(begin);
+        for (char *c = begin; c < end; ++c) {
+            if (*c == '|') {
+                *c = '\0';
+                fields.push_back(c + 1);
+            }
+        }
+    }
+
+    size_t size() const { return fields.size(); }
+
+    // Missing trailing fields read as empty strings
+    const char *operator[](size_t i) const { return i < fields.size() ? fields[i] : ""; }
+
+    std::string text(size_t i) const { return (*this)[i]; }
+
+    // The whole of text must be a decimal integer in range
+    static bool parseInteger(const char *text, int &value) {
+        char *end = nullptr;
+        errno = 0;
+        long parsed = std::strtol(text, &end, 10);
+        if (end == text || *end != '\0' || errno == ERANGE ||
+            parsed < std::numeric_limits<int>::min() || parsed > std::numeric_limits<int>::max()) {
+            return false;
+        }
+        value = static_cast<int>(parsed);
+        return true;
+    }
+
+    int integer(size_t i) const {
+        const char *field = (*this)[i];
+        int value;
+        if (!parseInteger(field, value)) {
+            throw std::invalid_argument("field " + std::to_string(i) + " is not an integer: '" + field + "'");
+        }
+        return value;
+    }
+
+    // An empty field reads as zero
+    Money money(size_t i) const {
+        const char *field = (*this)[i];
+        Money value;
+        if (*field != '\0' && !Money::parse(field, value)) {
+            throw std::invalid_argument("field " + std::to_string(i) + " is not an amount of zero or more: '" +
+                                        field + "'");
+        }
+        return value;
+    }
+};
+
+// Executes batch commands by calling the services directly. Outcomes are
+// read back from a RecordingDisplayManager, so the services report errors
+// exactly as they do to the interactive menus.
+//
+//   add-patient|name|age|disease[|contact|address|blood group]
+//   add-doctor|name|specialization[|contact|email|fee]
+//   set-availability|doctor id|yes or no
+//   book|patient id|doctor id|date[|time slot]
+//   set-appointment-status|appointment id|status
+//   cancel|appointment id
+//   add-medication|name|dosage|price[|manufacturer|description]
+//   prescribe|patient id|doctor id|date|medication ids (comma separated)[|instructions]
+//   bill|patient id|date|consultation fee[|medication charges|other charges]
+//   pay|bill id|status[|payment method]
+//   add-user|username|password|role
+//   archive-appointments|date|archive file
+//
+// and the rest of the menu, for remote sessions:
+//
+//   update-patient|id|name|age|disease[|contact|address|blood group]
+//   remove-patient|id
+//   list-patients
+//   find-patients-by-disease|disease
+//   find-patients-by-age|min age|max age
+//   update-doctor|id|name|specialization[|contact|email|fee]
+//   remove-doctor|id
+//   list-doctors
+//   list-available-doctors
+//   find-doctors-by-specialization|specialization
+//   update-appointment|appointment id|date|time slot|status[|notes]
+//   list-appointments
+//   list-appointments-by-patient|patient id
+//   list-appointments-by-doctor|doctor id
+//   list-appointments-by-date|date
+//   list-appointments-in-range|from date|to date
+//   list-free-slots|doctor id|date
+//   update-medication|id|name|dosage|price[|manufacturer|description]
+//   remove-medication|id
+//   list-medications
+//   update-prescription|prescription id|medication ids (comma separated)[|instructions]
+//   remove-prescription|prescription id
+//   list-prescriptions-by-patient|patient id
+//   list-bills-by-patient|patient id
+//   list-bills-by-status|status
+//   list-users
+//   set-user-active|user id|yes or no
+//   revenue
+//   pending-payments
+//   revenue-in-range|from date|to date
+//   pending-aging[|as of date]
+//   metrics
+//   export-metrics[|file]
+//
+// List and report commands print to std::cout. add-user, archive-appointments,
+// list-users, set-user-active and the report and metrics commands are
+// admin-only for remote sessions (see requiredPermission); a batch script runs
+// with full rights. Blank lines and lines starting with '#' are ignored.
+class CommandProcessor {
+private:
+    AuthenticationService &authService;
+    PatientService &patientService;
+    DoctorService &doctorService;
+    AppointmentService &appointmentService;
+    MedicationService &medicationService;
+    PrescriptionService &prescriptionService;
+    BillingService &billingService;
+    std::shared_ptr<RecordingDisplayManager> recorder;
+    CommandLine command;
+
+    typedef void (CommandProcessor::*Handler)(const CommandLine &);
+    struct CommandSpec {
+        const char *name;
+        size_t minFields; // Including the command name
+        Handler handler;
+        Permission permission; // Checked for remote sessions only
+    };
+
+    static const CommandSpec *findCommand(const char *name) {
+        static const CommandSpec commands[] = {
+            {"add-patient", 4, &CommandProcessor::addPatient, Permission::FrontDesk},
+            {"add-doctor", 3, &CommandProcessor::addDoctor, Permission::FrontDesk},
+            {"set-availability", 3, &CommandProcessor::setAvailability, Permission::FrontDesk},
+            {"book", 4, &CommandProcessor::book, Permission::FrontDesk},
+            {"set-appointment-status", 3, &CommandProcessor::setAppointmentStatus, Permission::FrontDesk},
+            {"cancel", 2, &CommandProcessor::cancel, Permission::FrontDesk},
+            {"add-medication", 4, &CommandProcessor::addMedication, Permission::FrontDesk},
+            {"prescribe", 5, &CommandProcessor::prescribe, Permission::FrontDesk},
+            {"bill", 4, &CommandProcessor::bill, Permission::FrontDesk},
+            {"pay", 3, &CommandProcessor::pay, Permission::FrontDesk},
+            {"add-user", 4, &CommandProcessor::addUser, Permission::ManageUsers},
+            {"archive-appointments", 3, &CommandProcessor::archiveAppointments, Permission::ArchiveRecords},
+            {"update-patient", 5, &CommandProcessor::updatePatient, Permission::FrontDesk},
+            {"remove-patient", 2, &CommandProcessor::removePatient, Permission::FrontDesk},
+            {"list-patients", 1, &CommandProcessor::listPatients, Permission::FrontDesk},
+            {"find-patients-by-disease", 2, &CommandProcessor::findPatientsByDisease, Permission::FrontDesk},
+            {"find-patients-by-age", 3, &CommandProcessor::findPatientsByAge, Permission::FrontDesk},
+            {"update-doctor", 4, &CommandProcessor::updateDoctor, Permission::FrontDesk},
+            {"remove-doctor", 2, &CommandProcessor::removeDoctor, Permission::FrontDesk},
+            {"list-doctors", 1, &CommandProcessor::listDoctors, Permission::FrontDesk},
+            {"list-available-doctors", 1, &CommandProcessor::listAvailableDoctors, Permission::FrontDesk},
+            {"find-doctors-by-specialization", 2, &CommandProcessor::findDoctorsBySpecialization, Permission::FrontDesk},
+            {"update-appointment", 5, &CommandProcessor::updateAppointment, Permission::FrontDesk},
+            {"list-appointments", 1, &CommandProcessor::listAppointments, Permission::FrontDesk},
+            {"list-appointments-by-patient", 2, &CommandProcessor::listAppointmentsByPatient, Permission::FrontDesk},
+            {"list-appointments-by-doctor", 2, &CommandProcessor::listAppointmentsByDoctor, Permission::FrontDesk},
+            {"list-appointments-by-date", 2, &CommandProcessor::listAppointmentsByDate, Permission::FrontDesk},
+            {"list-appointments-in-range", 3, &CommandProcessor::listAppointmentsInRange, Permission::FrontDesk},
+            {"list-free-slots", 3, &CommandProcessor::listFreeSlots, Permission::FrontDesk},
+            {"update-medication", 5, &CommandProcessor::updateMedication, Permission::FrontDesk},
+            {"remove-medication", 2, &CommandProcessor::removeMedication, Permission::FrontDesk},
+            {"list-medications", 1, &CommandProcessor::listMedications, Permission::FrontDesk},
+            {"update-prescription", 3, &CommandProcessor::updatePrescription, Permission::FrontDesk},
+            {"remove-prescription", 2, &CommandProcessor::removePrescription, Permission::FrontDesk},
+            {"list-prescriptions-by-patient", 2, &CommandProcessor::listPrescriptionsByPatient, Permission::FrontDesk},
+            {"list-bills-by-patient", 2, &CommandProcessor::listBillsByPatient, Permission::FrontDesk},
+            {"list-bills-by-status", 2, &CommandProcessor::listBillsByStatus, Permission::FrontDesk},
+            {"list-users", 1, &CommandProcessor::listUsers, Permission::ManageUsers},
+            {"set-user-active", 3, &CommandProcessor::setUserActive, Permission::ManageUsers},
+            {"revenue", 1, &CommandProcessor::revenue, Permission::ViewFinances},
+            {"pending-payments", 1, &CommandProcessor::pendingPayments, Permission::ViewFinances},
+            {"revenue-in-range", 3, &CommandProcessor::revenueInRange, Permission::ViewFinances},
+            {"pending-aging", 1, &CommandProcessor::pendingAging, Permission::ViewFinances},
+            {"metrics", 1, &CommandProcessor::showMetrics, Permission::ViewLogsAndMetrics},
+            {"export-metrics", 1, &CommandProcessor::exportMetrics, Permission::ViewLogsAndMetrics},
+        };
+        for (const auto &spec : commands) {
+            if (std::strcmp(spec.name, name) == 0) return &spec;
+        }
+        return nullptr;
+    }
+
+    void addPatient(const CommandLine &c) {
+        patientService.addPatient(c.text(1), c.integer(2), c.text(3), c.text(4), c.text(5), c.text(6));
+    }
+
+    void addDoctor(const CommandLine &c) {
+        doctorService.addDoctor(c.text(1), c.text(2), c.text(3), c.text(4), c.money(5));
+    }
+
+    static bool yesNo(const CommandLine &c, size_t i, const char *what) {
+        std::string value = c.text(i);
+        if (value != "yes" && value != "no") throw std::invalid_argument(std::string(what) + " must be yes or no");
+        return value == "yes";
+    }
+
+    static std::vector<int> idList(const CommandLine &c, size_t i) {
+        std::vector<int> ids;
+        std::istringstream fields(c.text(i));
+        std::string id;
+        while (std::getline(fields, id, ',')) {
+            if (id.empty()) continue;
+            int value;
+            if (!CommandLine::parseInteger(id.c_str(), value)) {
+                throw std::invalid_argument("field " + std::to_string(i) + " has an ID that is not an integer: '" +
+                                            id + "'");
+            }
+            ids.push_back(value);
+        }
+        return ids;
+    }
+
+    void setAvailability(const CommandLine &c) {
+        doctorService.setDoctorAvailability(c.integer(1), yesNo(c, 2, "availability"));
+    }
+
+    void book(const CommandLine &c) {
+        std::string timeSlot = *c[4] ? c.text(4) : TimeSlots[0];
+        appointmentService.bookAppointment(c.integer(1), c.integer(2), c.text(3), timeSlot);
+    }
+
+    void setAppointmentStatus(const CommandLine &c) {
+        appointmentService.updateAppointmentStatus(c.integer(1), c.text(2));
+    }
+
+    void cancel(const CommandLine &c) {
+        appointmentService.cancelAppointment(c.integer(1));
+    }
+
+    void addMedication(const CommandLine &c) {
+        medicationService.addMedication(c.text(1), c.text(2), c.money(3), c.text(4), c.text(5));
+    }
+
+    void prescribe(const CommandLine &c) {
+        prescriptionService.createPrescription(c.integer(1), c.integer(2), c.text(3), idList(c, 4), c.text(5));
+    }
+
+    void bill(const CommandLine &c) {
+        billingService.generateBill(c.integer(1), c.text(2), c.money(3), c.money(4), c.money(5));
+    }
+
+    void pay(const CommandLine &c) {
+        billingService.updateBillPaymentStatus(c.integer(1), c.text(2), c.text(3));
+    }
+
+    void addUser(const CommandLine &c) {
+        if (!inVocabulary(Vocabulary::Role, c.text(3))) {
+            recorder->displayError(vocabularyError(Vocabulary::Role));
+        } else if (!authService.registerUser(c.text(1), c.text(2), c.text(3))) {
+            recorder->displayError("Username already exists.");
+        }
+    }
+
+    void archiveAppointments(const CommandLine &c) {
+        appointmentService.archiveAppointmentsBefore(c.text(1), c.text(2));
+    }
+
+    void updatePatient(const CommandLine &c) {
+        patientService.updatePatient(c.integer(1), c.text(2), c.integer(3), c.text(4), c.text(5), c.text(6), c.text(7));
+    }
+
+    void removePatient(const CommandLine &c) { patientService.removePatient(c.integer(1)); }
+    void listPatients(const CommandLine &) { patientService.listPatients(); }
+    void findPatientsByDisease(const CommandLine &c) { patientService.findPatientsByDisease(c.text(1)); }
+    void findPatientsByAge(const CommandLine &c) { patientService.findPatientsByAgeRange(c.integer(1), c.integer(2)); }
+
+    void updateDoctor(const CommandLine &c) {
+        doctorService.updateDoctor(c.integer(1), c.text(2), c.text(3), c.text(4), c.text(5), c.money(6));
+    }
+
+    void removeDoctor(const CommandLine &c) { doctorService.removeDoctor(c.integer(1)); }
+    void listDoctors(const CommandLine &) { doctorService.listDoctors(); }
+    void listAvailableDoctors(const CommandLine &) { doctorService.listAvailableDoctors(); }
+    void findDoctorsBySpecialization(const CommandLine &c) { doctorService.findDoctorsBySpecialization(c.text(1)); }
+
+    void updateAppointment(const CommandLine &c) {
+        appointmentService.updateAppointmentDetails(c.integer(1), c.text(2), c.text(3), c.text(4), c.text(5));
+    }
+
+    void listAppointments(const CommandLine &) { appointmentService.listAllAppointments(); }
+    void listAppointmentsByPatient(const CommandLine &c) { appointmentService.listAppointmentsByPatient(c.integer(1)); }
+    void listAppointmentsByDoctor(const CommandLine &c) { appointmentService.listAppointmentsByDoctor(c.integer(1)); }
+    void listAppointmentsByDate(const CommandLine &c) { appointmentService.listAppointmentsByDate(c.text(1)); }
+    void listAppointmentsInRange(const CommandLine &c) {
+        appointmentService.listAppointmentsInDateRange(c.text(1), c.text(2));
+    }
+    void listFreeSlots(const CommandLine &c) { appointmentService.listFreeSlots(c.integer(1), c.text(2)); }
+
+    void updateMedication(const CommandLine &c) {
+        medicationService.updateMedication(c.integer(1), c.text(2), c.text(3), c.money(4), c.text(5), c.text(6));
+    }
+
+    void removeMedication(const CommandLine &c) { medicationService.removeMedication(c.integer(1)); }
+    void listMedications(const CommandLine &) { medicationService.listAllMedications(); }
+
+    void updatePrescription(const CommandLine &c) {
+        prescriptionService.updatePrescription(c.integer(1), idList(c, 2), c.text(3));
+    }
+
+    void removePrescription(const CommandLine &c) { prescriptionService.removePrescription(c.integer(1)); }
+    void listPrescriptionsByPatient(const CommandLine &c) {
+        prescriptionService.listPrescriptionsByPatient(c.integer(1));
+    }
+
+    void listBillsByPatient(const CommandLine &c) { billingService.listBillsByPatient(c.integer(1)); }
+    void listBillsByStatus(const CommandLine &c) { billingService.listBillsByPaymentStatus(c.text(1)); }
+
+    void listUsers(const CommandLine &) {
+        displayRecords<User>(*recorder, [&](const auto &v) { authService.forEachUser(v); },
+                             "List of all users:", "No users registered.");
+    }
+
+    void setUserActive(const CommandLine &c) {
+        if (!authService.updateUserStatus(c.integer(1), yesNo(c, 2, "active"))) {
+            recorder->displayError("User not found.");
+        }
+    }
+
+    void revenue(const CommandLine &) {
+        billingService.getTotalRevenue();
+        billingService.reportRevenueBreakdown();
+    }
+
+    void pendingPayments(const CommandLine &) { billingService.getPendingPayments(); }
+    void revenueInRange(const CommandLine &c) { billingService.getRevenueInDateRange(c.text(1), c.text(2)); }
+    void pendingAging(const CommandLine &c) { billingService.reportPendingAging(c.text(1)); }
+
+    void showMetrics(const CommandLine &) {
+        displayMetricsSummary(*recorder);
+    }
+
+    void exportMetrics(const CommandLine &c) {
+        std::string path = *c[1] ? c.text(1) : "hospital_metrics.prom";
+        std::string error;
+        if (!writeMetricsFile(path, error)) {
+            recorder->displayError(error);
+            return;
+        }
+        recorder->displaySuccess("Metrics exported to " + path);
+    }
+
+public:
+    CommandProcessor(AuthenticationService &auth, PatientService &ps, DoctorService &ds,
+                     AppointmentService &as, MedicationService &ms, PrescriptionService &prs,
+                     BillingService &bs, std::shared_ptr<RecordingDisplayManager> rec)
+        : authService(auth), patientService(ps), doctorService(ds), appointmentService(as),
+          medicationService(ms), prescriptionService(prs), billingService(bs), recorder(rec) {}
+
+    // Splits a request into fields, ignoring leading blanks; *end must be
+    // writable. execute() and the server's permission check both parse
+    // through here, so they always agree on which command a line names.
+    // Returns false for blank and comment lines.
+    static bool parseRequest(char *begin, char *end, CommandLine &line) {
+        while (begin < end && (*begin == ' ' || *begin == '\t')) ++begin;
+        if (begin == end || *begin == '#' || *begin == '\r') return false;
+        line.parse(begin, end);
+        return true;
+    }
+
+    // What a remote session must be allowed to run the named command.
+    // Returns false for unknown commands, which remote sessions may not run.
+    static bool requiredPermission(const char *name, Permission &permission) {
+        const CommandSpec *spec = findCommand(name);
+        if (!spec) return false;
+        permission = spec->permission;
+        return true;
+    }
+
+    // Executes an already parsed request. Returns false and sets error on
+    // failure.
+    bool execute(const CommandLine &line, std::string &error) {
+        const CommandSpec *spec = findCommand(line[0]);
+        if (!spec) {
+            error = std::string("unknown command '") + line[0] + "'";
+            return false;
+        }
+        if (line.size() < spec->minFields) {
+            error = std::string("too few fields for '") + spec->name + "'";
+            return false;
+        }
+
+        size_t errorsBefore = recorder->getErrorCount();
+        try {
+            (this->*spec->handler)(line);
+        } catch (const std::exception &e) {
+            error = e.what();
+            return false;
+        }
+        if (recorder->getErrorCount() != errorsBefore) {
+            error = recorder->getLastError();
+            return false;
+        }
+        return true;
+    }
+
+    // Executes the command in [begin, end), modifying the buffer in place;
+    // *end must be writable. Returns false and sets error on failure. Blank
+    // and comment lines succeed without doing anything.
+    bool execute(char *begin, char *end, std::string &error) {
+        if (!parseRequest(begin, end, command)) return true;
+        return execute(command, error);
+    }
+
+    bool execute(std::string line, std::string &error) {
+        line.push_back('\0');
+        return execute(&line[0], &line[line.size() - 1], error);
+    }
+};
+
+struct BatchSummary {
+    size_t lines = 0;
+    size_t failed = 0;
+};
+
+// Feeds a command stream to the processor in large blocks, executing each
+// complete line straight out of the read buffer. Failures are written to
+// the error stream with their line numbers, up to maxReported of them.
+inline BatchSummary runCommandStream(std::istream &in, CommandProcessor &processor,
+                                     std::ostream &errors, size_t maxReported = 20) {
+    const size_t BlockSize = 1 << 20;
+    BatchSummary summary;
+    std::vector<char> buffer(BlockSize + 1);
+    size_t carried = 0; // Bytes of an unfinished line kept from the last block
+    std::string error;
+
+    auto executeLine = [&](char *begin, char *end) {
+        ++summary.lines;
+        if (!processor.execute(begin, end, error)) {
+            if (summary.failed++ < maxReported) {
+                errors << "line " << summary.lines << ": " << error << "\n";
+            }
+        }
+    };
+
+    while (in) {
+        if (carried == buffer.size() - 1) buffer.resize(buffer.size() * 2); // Very long line
+        in.read(buffer.data() + carried, static_cast<std::streamsize>(buffer.size() - 1 - carried));
+        size_t filled = carried + static_cast<size_t>(in.gcount());
+        char *begin = buffer.data();
+        char *limit = buffer.data() + filled;
+        while (char *newline = static_cast<char*>(std::memchr(begin, '\n', limit - begin))) {
+            executeLine(begin, newline);
+            begin = newline + 1;
+        }
+        carried = static_cast<size_t>(limit - begin);
+        std::memmove(buffer.data(), begin, carried);
+    }
+    if (carried > 0) executeLine(buffer.data(), buffer.data() + carried);
+    if (summary.failed > maxReported) {
+        errors << "... " << summary.failed - maxReported << " more failures not shown\n";
+    }
+    return summary;
+}
+
+// ------------------------------
+// Server
+// ------------------------------
+
+// Remote sessions exchange frames: a 4-byte big-endian payload length, then
+// the payload. A request is one command line in the batch syntax (see
+// CommandProcessor) or a session command:
+//
+//   login|username|password
+//   logout
+//
+// A response starts with a status line, "OK" (for login, "OK <role>") or
+// "ERR <message>", followed by whatever the command printed. Requests on a
+// connection are answered in order, so a client may pipeline them. A request
+// longer than MaxRequestBytes closes the connection.
+const uint32_t MaxRequestBytes = 64 * 1024;
+
+inline void appendFrame(std::string &out, const std::string &payload) {
+    uint32_t length = static_cast<uint32_t>(payload.size());
+    const char header[4] = {static_cast<char>(length >> 24), static_cast<char>(length >> 16),
+                            static_cast<char>(length >> 8), static_cast<char>(length)};
+    out.append(header, sizeof(header));
+    out += payload;
+}
+
+// Only write(), so it is safe in a signal handler
+inline void wakeEventFd(int fd) {
+    uint64_t one = 1;
+    ssize_t written = ::write(fd, &one, sizeof(one));
+    (void)written;
+}
+
+inline uint32_t frameLength(const char *header) {
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(header);
+    return (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | bytes[3];
+}
+
+// Where a server listens: a Unix socket path, or host:port for TCP on the
+// loopback interface, where host is empty, "localhost" or "127.0.0.1"
+struct ServerAddress {
+    bool tcp = false;
+    std::string path;
+    uint16_t port = 0;
+
+    static ServerAddress parse(const std::string &text) {
+        ServerAddress address;
+        size_t colon = text.rfind(':');
+        if (colon == std::string::npos || text.find('/') != std::string::npos) {
+            if (text.empty() || text.size() >= sizeof(sockaddr_un().sun_path)) {
+                throw std::invalid_argument("Bad socket path: '" + text + "'");
+            }
+            address.path = text;
+            return address;
+        }
+        std::string host = text.substr(0, colon);
+        if (!host.empty() && host != "localhost" && host != "127.0.0.1") {
+            throw std::invalid_argument("The server only listens on localhost, not '" + host + "'");
+        }
+        int port = std::atoi(text.c_str() + colon + 1);
+        if (port <= 0 || port > 65535) throw std::invalid_argument("Bad port in '" + text + "'");
+        address.tcp = true;
+        address.port = static_cast<uint16_t>(port);
+        return address;
+    }
+
+    // Opens a socket of the right family and fills in the address for it
+    int open(sockaddr_storage &storage, socklen_t &length) const {
+        std::memset(&storage, 0, sizeof(storage));
+        if (tcp) {
+            sockaddr_in *in = reinterpret_cast<sockaddr_in*>(&storage);
+            in->sin_family = AF_INET;
+            in->sin_port = htons(port);
+            in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            length = sizeof(sockaddr_in);
+        } else {
+            sockaddr_un *un = reinterpret_cast<sockaddr_un*>(&storage);
+            un->sun_family = AF_UNIX;
+            std::memcpy(un->sun_path, path.c_str(), path.size() + 1);
+            length = sizeof(sockaddr_un);
+        }
+        int fd = ::socket(tcp ? AF_INET : AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) throw std::runtime_error(std::string("Cannot create socket: ") + std::strerror(errno));
+        return fd;
+    }
+};
+
+// Opens a blocking connection to a server; throws if it is not listening
+inline int connectToServer(const ServerAddress &address) {
+    sockaddr_storage storage;
+    socklen_t length;
+    int fd = address.open(storage, length);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&storage), length) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw std::runtime_error(std::string("Cannot connect to server: ") + std::strerror(error));
+    }
+    if (address.tcp) {
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+// Serves the command set to many clients from one thread. An epoll loop
+// reads whatever has arrived on each connection, runs every complete
+// request in order, and queues the responses, writing them as the socket
+// accepts them. Each connection logs in separately and holds its own
+// session token; closing the connection ends the session. Requests run one at a time on the loop
+// thread, so the services, the command processor and std::cout (captured
+// into each response) are never shared between threads. Passwords are the
+// exception: they are checked on the verification pool, and the loop keeps
+// serving other clients until the outcome comes back. New users' passwords
+// are hashed there too.
+class HospitalServer {
+private:
+    struct Session {
+        int fd;
+        uint64_t serial;  // Tells this connection from a later one given the same descriptor
+        std::string in;   // Bytes received but not yet run as requests
+        std::string out;  // Responses not yet written
+        size_t written = 0;
+        uint32_t events = EPOLLIN; // What the connection is watched for
+        bool queued = false; // In the backlog of sessions with requests left to run
+        bool passwordPending = false; // Later requests wait until a password is checked or hashed
+        SessionToken token; // Null until the client logs in
+
+        Session(int fd, uint64_t serial) : fd(fd), serial(serial) {}
+    };
+
+    // A login checked on the verification pool, or a new user's password
+    // hashed there
+    struct PasswordOutcome {
+        int fd;
+        uint64_t serial;
+        SessionToken token; // Of the login
+        LoginFailure failure;
+        bool registration;  // Adds the user below rather than logging in
+        std::string username;
+        std::string passwordHash;
+        std::string role;
+    };
+
+    // Work done on the verification pool, handed back to the loop. Shared
+    // with the work still running, so it outlives the server.
+    struct CheckedPasswords {
+        std::mutex mutex;
+        std::vector<PasswordOutcome> outcomes;
+        int eventFd;
+
+        CheckedPasswords() : eventFd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+            if (eventFd < 0) throw std::runtime_error(std::string("eventfd failed: ") + std::strerror(errno));
+        }
+        ~CheckedPasswords() { ::close(eventFd); }
+    };
+
+    // Sends std::cout into a buffer for the lifetime of the capture
+    class ConsoleCapture {
+    private:
+        std::streambuf *console;
+
+    public:
+        explicit ConsoleCapture(std::ostringstream &buffer) : console(std::cout.rdbuf(buffer.rdbuf())) {}
+        ~ConsoleCapture() { std::cout.rdbuf(console); }
+    };
+
+    CommandProcessor &processor;
+    AuthenticationService &auth;
+    std::shared_ptr<ILogger> logger;
+    ServerAddress address;
+    int listenFd = -1;
+    int epollFd = -1;
+    int wakeFd = -1;
+    std::unordered_map<int, std::unique_ptr<Session>> sessions;
+    uint64_t nextSerial = 1;
+    std::shared_ptr<CheckedPasswords> checkedPasswords;
+    std::ostringstream captured;
+    std::vector<char> readBuffer;
+    std::vector<std::pair<int, uint64_t>> backlog; // Sessions (fd, serial) with runnable requests left over
+
+    // One client must not hold the loop or its memory: each wakeup reads a
+    // bounded amount and runs a bounded number of requests, nothing more is
+    // read while a full request is already buffered, and nothing is read or
+    // run while a client leaves OutputHighWater bytes of responses unread
+    static const size_t InputLimit = MaxRequestBytes + 4;
+    static const size_t ReadBudget = 256 * 1024;
+    static const size_t RequestsPerTurn = 64;
+    static const size_t OutputHighWater = 4 << 20;
+
+    static size_t unsent(const Session &session) { return session.out.size() - session.written; }
+
+    static bool hasCompleteRequest(const Session &session) {
+        return session.in.size() >= 4 && session.in.size() - 4 >= frameLength(session.in.data());
+    }
+
+    void watch(int fd, uint32_t events, int op) {
+        epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = events;
+        event.data.fd = fd;
+        if (::epoll_ctl(epollFd, op, fd, &event) != 0) {
+            throw std::runtime_error(std::string("epoll_ctl failed: ") + std::strerror(errno));
+        }
+    }
+
+    void acceptClients() {
+        for (;;) {
+            int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    logger->logWarning(std::string("accept failed: ") + std::strerror(errno));
+                }
+                return;
+            }
+            if (address.tcp) {
+                int one = 1;
+                ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            }
+            sessions[fd].reset(new Session(fd, nextSerial++));
+            watch(fd, EPOLLIN, EPOLL_CTL_ADD);
+        }
+    }
+
+    void closeSession(int fd) {
+        auto found = sessions.find(fd);
+        if (found != sessions.end()) auth.logout(found->second->token);
+        ::epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        sessions.erase(fd);
+    }
+
+    std::string respond(Session &session, const std::string &request) {
+        std::string fields = request;
+        fields.push_back('\0');
+        CommandLine line;
+        if (!CommandProcessor::parseRequest(&fields[0], &fields[fields.size() - 1], line)) return "OK\n";
+        std::string name = line[0];
+
+        if (name == "login") {
+            startLogin(session, line.text(1), line.text(2));
+            return std::string(); // Answered once the password is checked
+        }
+        if (name == "logout") {
+            auth.logout(session.token);
+            session.token = SessionToken();
+            return "OK\n";
+        }
+        Permission needed;
+        if (!CommandProcessor::requiredPermission(name.c_str(), needed)) {
+            if (session.token.isNull()) return "ERR Please log in first.\n";
+            return "ERR unknown command '" + name + "'\n";
+        }
+        if (!auth.allows(session.token, needed)) {
+            if (session.token.isNull()) return "ERR Please log in first.\n";
+            if (!auth.isLoggedIn(session.token)) {
+                session.token = SessionToken();
+                return "ERR Your session has ended. Please log in again.\n";
+            }
+            return "ERR Access denied. Admin privileges required.\n";
+        }
+        if (name == "add-user") return startRegistration(session, line);
+
+        captured.str("");
+        std::string error;
+        bool succeeded;
+        {
+            ConsoleCapture capture(captured);
+            succeeded = processor.execute(line, error); // The same fields the check above saw
+        }
+        return (succeeded ? std::string("OK\n") : "ERR " + error + "\n") + captured.str();
+    }
+
+    // Hands the password to the verification pool; the outcome comes back
+    // through checkedPasswords and is answered by finishPasswords
+    void startLogin(Session &session, const std::string &username, const std::string &password) {
+        auth.logout(session.token);
+        session.token = SessionToken();
+        session.passwordPending = true;
+        std::shared_ptr<CheckedPasswords> checked = checkedPasswords;
+        int fd = session.fd;
+        uint64_t serial = session.serial;
+        auth.loginAsync(username, password, [checked, fd, serial](SessionToken token, LoginFailure failure) {
+            {
+                std::lock_guard<std::mutex> lock(checked->mutex);
+                checked->outcomes.push_back(PasswordOutcome{fd, serial, token, failure, false, "", "", ""});
+            }
+            wakeEventFd(checked->eventFd);
+        });
+    }
+
+    // Has the new user's password hashed on the verification pool; the user
+    // is added by finishPasswords. Returns the response if there is one to
+    // give at once.
+    std::string startRegistration(Session &session, const CommandLine &line) {
+        if (line.size() < 4) return "ERR too few fields for 'add-user'\n";
+        std::string username = line.text(1);
+        std::string role = line.text(3);
+        if (!inVocabulary(Vocabulary::Role, role)) return "ERR " + vocabularyError(Vocabulary::Role) + "\n";
+        if (auth.usernameTaken(username)) return "ERR Username already exists.\n";
+        std::shared_ptr<CheckedPasswords> checked = checkedPasswords;
+        int fd = session.fd;
+        uint64_t serial = session.serial;
+        bool queued = auth.hashPasswordAsync(line.text(2), [checked, fd, serial, username, role](std::string hash) {
+            {
+                std::lock_guard<std::mutex> lock(checked->mutex);
+                checked->outcomes.push_back(
+                    PasswordOutcome{fd, serial, SessionToken(), LoginFailure::None, true, username, hash, role});
+            }
+            wakeEventFd(checked->eventFd);
+        });
+        if (!queued) return "ERR Too many passwords are being checked. Please try again shortly.\n";
+        session.passwordPending = true;
+        return std::string(); // Answered once the password is hashed
+    }
+
+    std::string loginResponse(const PasswordOutcome &outcome) {
+        SessionInfo info;
+        if (auth.getSession(outcome.token, info)) return "OK " + symbols().name(info.role) + "\n";
+        if (outcome.failure == LoginFailure::Busy) {
+            return "ERR Too many logins are being checked. Please try again shortly.\n";
+        }
+        return "ERR Login failed. Invalid username or password.\n";
+    }
+
+    // Answers the logins the pool has checked and adds the users whose
+    // passwords it has hashed, then runs whatever their clients sent while
+    // they waited
+    void finishPasswords() {
+        uint64_t count;
+        ssize_t drained = ::read(checkedPasswords->eventFd, &count, sizeof(count));
+        (void)drained;
+        std::vector<PasswordOutcome> outcomes;
+        {
+            std::lock_guard<std::mutex> lock(checkedPasswords->mutex);
+            outcomes.swap(checkedPasswords->outcomes);
+        }
+        for (const PasswordOutcome &outcome : outcomes) {
+            auto found = sessions.find(outcome.fd);
+            bool connected = found != sessions.end() && found->second->serial == outcome.serial;
+            std::string response;
+            if (outcome.registration) {
+                // Added even if the client has hung up, as any request it sent would be
+                bool added = auth.registerHashedUser(outcome.username, outcome.passwordHash, outcome.role);
+                response = added ? "OK\n" : "ERR Username already exists.\n";
+            } else if (connected) {
+                found->second->token = outcome.token;
+                response = loginResponse(outcome);
+            } else {
+                auth.logout(outcome.token); // The client hung up before its login was checked
+            }
+            if (!connected) continue;
+            Session &session = *found->second;
+            session.passwordPending = false;
+            appendFrame(session.out, response);
+            if (!runRequests(session)) closeSession(outcome.fd);
+        }
+    }
+
+    // Reads what has arrived, up to the input limit and the per-wakeup
+    // budget, and runs each complete request; false once the connection
+    // should be closed
+    bool readRequests(Session &session) {
+        size_t budget = ReadBudget;
+        while (budget > 0 && session.in.size() < InputLimit) {
+            size_t room = std::min(std::min(budget, InputLimit - session.in.size()), readBuffer.size());
+            ssize_t n = ::recv(session.fd, readBuffer.data(), room, 0);
+            if (n > 0) {
+                session.in.append(readBuffer.data(), static_cast<size_t>(n));
+                budget -= static_cast<size_t>(n);
+                continue;
+            }
+            if (n == 0) return false;
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        return runRequests(session);
+    }
+
+    // Runs each complete request received, pausing while a password is
+    // being checked or hashed so the requests behind it see the outcome, then writes the
+    // responses; false once the connection should be closed
+    bool runRequests(Session &session) {
+        size_t offset = 0;
+        for (size_t handled = 0; !session.passwordPending && session.in.size() - offset >= 4; ++handled) {
+            if (handled == RequestsPerTurn || unsent(session) >= OutputHighWater) break;
+            uint32_t length = frameLength(session.in.data() + offset);
+            if (length > MaxRequestBytes) {
+                logger->logWarning("Closing connection that sent a " + std::to_string(length) + "-byte request");
+                return false;
+            }
+            if (session.in.size() - offset - 4 < length) break;
+            std::string response = respond(session, session.in.substr(offset + 4, length));
+            if (!session.passwordPending) appendFrame(session.out, response);
+            offset += 4 + length;
+        }
+        session.in.erase(0, offset);
+        return writeResponses(session);
+    }
+
+    // Writes queued responses until done or the socket is full, then
+    // rearms the connection; false on a broken connection
+    bool writeResponses(Session &session) {
+        while (session.written < session.out.size()) {
+            ssize_t n = ::send(session.fd, session.out.data() + session.written,
+                               session.out.size() - session.written, MSG_NOSIGNAL);
+            if (n >= 0) {
+                session.written += static_cast<size_t>(n);
+            } else if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            } else {
+                return false;
+            }
+        }
+        if (session.written == session.out.size()) {
+            session.out.clear();
+            session.written = 0;
+        }
+        rearm(session);
+        return true;
+    }
+
+    // Watches for input only while the client keeps up with its responses
+    // and has room for more requests, and for output while any is unsent.
+    // Requests left over from a capped turn go to the backlog.
+    void rearm(Session &session) {
+        bool keepingUp = unsent(session) < OutputHighWater;
+        uint32_t events = 0;
+        if (keepingUp && session.in.size() < InputLimit) events |= EPOLLIN;
+        if (unsent(session) > 0) events |= EPOLLOUT;
+        if (events != session.events) {
+            watch(session.fd, events, EPOLL_CTL_MOD);
+            session.events = events;
+        }
+        if (keepingUp && !session.passwordPending && !session.queued && hasCompleteRequest(session)) {
+            session.queued = true;
+            backlog.emplace_back(session.fd, session.serial);
+        }
+    }
+
+    // Gives each session in the backlog another turn
+    void runBacklog() {
+        std::vector<std::pair<int, uint64_t>> turn;
+        turn.swap(backlog);
+        for (const auto &entry : turn) {
+            auto found = sessions.find(entry.first);
+            if (found == sessions.end() || found->second->serial != entry.second) continue;
+            found->second->queued = false;
+            if (!runRequests(*found->second)) closeSession(entry.first);
+        }
+    }
+
+public:
+    HospitalServer(CommandProcessor &processor, AuthenticationService &auth, std::shared_ptr<ILogger> logger)
+        : processor(processor), auth(auth), logger(logger), checkedPasswords(std::make_shared<CheckedPasswords>()),
+          readBuffer(64 * 1024) {
+        wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wakeFd < 0) throw std::runtime_error(std::string("eventfd failed: ") + std::strerror(errno));
+    }
+
+    HospitalServer(const HospitalServer &) = delete;
+    HospitalServer &operator=(const HospitalServer &) = delete;
+
+    ~HospitalServer() {
+        for (auto &session : sessions) {
+            auth.logout(session.second->token);
+            ::close(session.first);
+        }
+        if (listenFd >= 0) {
+            ::close(listenFd);
+            if (!address.tcp) ::unlink(address.path.c_str());
+        }
+        if (epollFd >= 0) ::close(epollFd);
+        ::close(wakeFd);
+    }
+
+    // Binds the address; clients may connect as soon as this returns. A
+    // stale Unix socket left by an earlier run is replaced.
+    void listen(const std::string &where) {
+        address = ServerAddress::parse(where);
+        sockaddr_storage storage;
+        socklen_t length;
+        listenFd = address.open(storage, length);
+        if (address.tcp) {
+            int one = 1;
+            ::setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        } else {
+            struct stat info;
+            if (::stat(address.path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) ::unlink(address.path.c_str());
+        }
+        if (::bind(listenFd, reinterpret_cast<sockaddr*>(&storage), length) != 0 ||
+            ::listen(listenFd, SOMAXCONN) != 0) {
+            int error = errno;
+            ::close(listenFd);
+            listenFd = -1;
+            throw std::runtime_error("Cannot listen on " + where + ": " + std::strerror(error));
+        }
+        int flags = ::fcntl(listenFd, F_GETFL, 0);
+        ::fcntl(listenFd, F_SETFL, flags | O_NONBLOCK);
+
+        epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd < 0) throw std::runtime_error(std::string("epoll_create1 failed: ") + std::strerror(errno));
+        watch(listenFd, EPOLLIN, EPOLL_CTL_ADD);
+        watch(wakeFd, EPOLLIN, EPOLL_CTL_ADD);
+        watch(checkedPasswords->eventFd, EPOLLIN, EPOLL_CTL_ADD);
+        logger->logInfo("Server listening on " + where);
+    }
+
+    // Serves clients until stop() is called
+    void run() {
+        std::vector<epoll_event> events(256);
+        for (;;) {
+            int timeout = backlog.empty() ? 1000 : 0;
+            int ready = ::epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), timeout);
+            if (ready < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error(std::string("epoll_wait failed: ") + std::strerror(errno));
+            }
+            if (ready == 0 && timeout > 0) {
+                // Quiet second: close sessions left idle on connections nobody is using
+                auth.sessionStore().expireIdle();
+                continue;
+            }
+            for (int i = 0; i < ready; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == wakeFd) {
+                    logger->logInfo("Server stopped with " + std::to_string(sessions.size()) + " clients connected");
+                    return;
+                }
+                if (fd == listenFd) {
+                    acceptClients();
+                    continue;
+                }
+                if (fd == checkedPasswords->eventFd) {
+                    finishPasswords();
+                    continue;
+                }
+                auto found = sessions.find(fd);
+                if (found == sessions.end()) continue;
+                Session &session = *found->second;
+                bool open = true;
+                if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                    open = false; // Reported even while input is not watched
+                } else if (events[i].events & EPOLLIN) {
+                    open = readRequests(session);
+                }
+                if (open && (events[i].events & EPOLLOUT)) open = writeResponses(session);
+                if (!open) closeSession(fd);
+            }
+            runBacklog();
+        }
+    }
+
+    // Makes run() return; safe from any thread
+    void stop() { wakeEventFd(wakeFd); }
+
+    // Writing to this descriptor stops the server too; for signal handlers,
+    // which cannot reach the object
+    int stopDescriptor() const { return wakeFd; }
+};
+
+const size_t HospitalServer::InputLimit;
+const size_t HospitalServer::ReadBudget;
+const size_t HospitalServer::RequestsPerTurn;
+const size_t HospitalServer::OutputHighWater;
+
+// ------------------------------
+// Application / User Interface
+// ------------------------------
+
+// Console input, shared by the local menus and the remote client
+
+inline std::string readConsoleLine() {
+    std::string input;
+    std::getline(std::cin, input);
+    return input;
+}
+
+// Asks again until the input is a number
+inline int readConsoleInt(IDisplayManager &display) {
+    int value;
+    while (!(std::cin >> value)) {
+        std::cin.clear();
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        display.displayError("Invalid input. Please enter a number.");
+        std::cout << "Enter a number: ";
+    }
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    return value;
+}
+
+// Asks again until the input is an amount with at most two decimals
+inline Money readConsoleMoney(IDisplayManager &display) {
+    std::string text;
+    Money value;
+    while (!(std::cin >> text) || !Money::parse(text.c_str(), value)) {
+        std::cin.clear();
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        display.displayError("Invalid input. Please enter an amount such as 12.50.");
+        std::cout << "Enter an amount: ";
+    }
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    return value;
+}
+
+// Offers the time slots by number; out-of-range choices pick the first
+inline std::string readConsoleTimeSlot(IDisplayManager &display) {
+    std::cout << "Available time slots:\n";
+    for (int i = 0; i < TimeSlotCount; ++i) {
+        std::cout << (i + 1) << ". " << TimeSlots[i] << "\n";
+    }
+    std::cout << "Enter your choice (1-" << TimeSlotCount << "): ";
+    
+    int choice = readConsoleInt(display);
+    if (choice < 1 || choice > TimeSlotCount) choice = 1;
+    return TimeSlots[choice - 1];
+}
+
+// The main menu; admin options are shown only to admins
+inline void printMainMenu(bool showAdmin) {
+    std::cout << "\n----- Hospital Management System Menu -----\n";
+    
+    if (showAdmin) {
+        std::cout << "==== Admin Functions ====\n";
+        std::cout << "1. User Management\n";
+        std::cout << "2. System Logs and Metrics\n";
+        std::cout << "3. Financial Reports\n";
+        std::cout << "40. Archive Old Appointments\n";
+    }
+    
+    std::cout << "==== Patient Management ====\n";
+    std::cout << "4. Add Patient\n";
+    std::cout << "5. Update Patient\n";
+    std::cout << "6. Remove Patient\n";
+    std::cout << "7. List All Patients\n";
+    std::cout << "8. Find Patients by Disease\n";
+    std::cout << "9. Find Patients by Age Range\n";
+    
+    std::cout << "==== Doctor Management ====\n";
+    std::cout << "10. Add Doctor\n";
+    std::cout << "11. Update Doctor\n";
+    std::cout << "12. Remove Doctor\n";
+    std::cout << "13. List All Doctors\n";
+    std::cout << "14. List Available Doctors\n";
+    std::cout << "15. Find Doctors by Specialization\n";
+    std::cout << "16. Set Doctor Availability\n";
+    
+    std::cout << "==== Appointment Management ====\n";
+    std::cout << "17. Book Appointment\n";
+    std::cout << "18. Update Appointment\n";
+    std::cout << "19. Cancel Appointment\n";
+    std::cout << "20. List All Appointments\n";
+    std::cout << "21. List Appointments by Patient\n";
+    std::cout << "22. List Appointments by Doctor\n";
+    std::cout << "23. List Appointments by Date\n";
+    std::cout << "38. List Free Slots for a Doctor\n";
+    std::cout << "39. List Appointments in Date Range\n";
+    
+    std::cout << "==== Medication Management ====\n";
+    std::cout << "24. Add Medication\n";
+    std::cout << "25. Update Medication\n";
+    std::cout << "26. Remove Medication\n";
+    std::cout << "27. List All Medications\n";
+    
+    std::cout << "==== Prescription Management ====\n";
+    std::cout << "28. Create Prescription\n";
+    std::cout << "29. Update Prescription\n";
+    std::cout << "30. Remove Prescription\n";
+    std::cout << "31. List Prescriptions by Patient\n";
+    
+    std::cout << "==== Billing Management ====\n";
+    std::cout << "32. Generate Bill\n";
+    std::cout << "33. Update Payment Status\n";
+    std::cout << "34. List Bills by Patient\n";
+    std::cout << "35. List Bills by Payment Status\n";
+    
+    std::cout << "==== System ====\n";
+    std::cout << "36. Logout\n";
+    std::cout << "37. Exit\n";
+    
+    std::cout << "Enter your choice: ";
+}
+
+// Startup configuration for the application
+struct AppOptions {
+    std::string walPath = "hospital_data.wal"; // Empty disables persistence
+    std::string snapshotPath = "hospital_snapshot.bin";
+    WalOptions walOptions;
+    bool concurrentRepositories = false; // Sharded, lock-protected storage
+    std::string batchPath;               // Command script to run; "-" for stdin
+    std::string serveAddress;            // Serve clients on this socket path or host:port
+    bool demoData = false;               // Seed the demo accounts and records if nothing was recovered
+    AuthenticationOptions auth;
+};
+
+class HospitalManagementApp {
+private:
+    // Cross-cutting concerns
+    std::shared_ptr<ILogger> logger;
+    std::shared_ptr<RecordingDisplayManager> recorder; // Batch mode only
+    std::shared_ptr<IDisplayManager> display;
+    
+    // Repositories
+    std::shared_ptr<IPatientRepository> patientRepo;
+    std::shared_ptr<IDoctorRepository> doctorRepo;
+    std::shared_ptr<IAppointmentRepository> appointmentRepo;
+    std::shared_ptr<IMedicationRepository> medicationRepo;
+    std::shared_ptr<IPrescriptionRepository> prescriptionRepo;
+    std::shared_ptr<IBillRepository> billRepo;
+    std::shared_ptr<IUserRepository> userRepo;
+    
+    // Persistence (null when running purely in memory)
+    std::shared_ptr<WriteAheadLog> wal;
+    std::string snapshotPath;
+    
+    // Services
+    AuthenticationService authService;
+    PatientService patientService;
+    DoctorService doctorService;
+    AppointmentService appointmentService;
+    MedicationService medicationService;
+    PrescriptionService prescriptionService;
+    BillingService billingService;
+    
+    SessionToken session; // Null while nobody is logged in
+
+    // Helper function to read a line of text
+    std::string readLine() { return readConsoleLine(); }
+
+    // Helper function to read an integer
+    int readInt() { return readConsoleInt(*display); }
+    
+    // Helper function to read an amount of money
+    Money readMoney() { return readConsoleMoney(*display); }
+    
+    // Helper function to get date input
+    std::string getDateInput(const std::string &prompt = "Enter Date (YYYY-MM-DD): ") {
+        std::cout << prompt;
+        return readLine();
+    }
+    
+    // Helper function to get time slot input
+    std::string getTimeSlotInput() { return readConsoleTimeSlot(*display); }
+
+    // Publishes a repository's size as a gauge, counted when metrics are read
+    template <typename Repository>
+    static void exposeRecordCount(const char *name, const std::shared_ptr<Repository> &repo) {
+        std::weak_ptr<Repository> weak = repo;
+        metrics().setGauge(std::string("hms_repository_records{repository=\"") + name + "\"}",
+                           "Records held by each repository.", [weak] {
+                               auto repo = weak.lock();
+                               return repo ? static_cast<double>(repo->size()) : 0.0;
+                           });
+    }
+
+    void displayLoginMenu() {
+        std::cout << "\n----- Hospital Management System Login -----\n";
+        std::cout << "1. Login\n";
+        std::cout << "2. Exit\n";
+        std::cout << "Enter your choice: ";
+    }
+
+    void displayMainMenu() {
+        printMainMenu(authService.allows(session, Permission::ManageUsers));
+    }
+
+    bool login() {
+        std::cout << "Enter username: ";
+        std::string username = readLine();
+        std::cout << "Enter password: ";
+        std::string password = readLine();
+        
+        LoginFailure failure;
+        session = authService.login(username, password, &failure);
+        if (!session.isNull()) {
+            display->displaySuccess("Login successful. Welcome, " + username + "!");
+            return true;
+        } else if (failure == LoginFailure::Busy) {
+            display->displayError("Too many logins are being checked. Please try again shortly.");
+            return false;
+        } else {
+            display->displayError("Login failed. Invalid username or password.");
+            return false;
+        }
+    }
+    
+    void logout() {
+        authService.logout(session);
+        session = SessionToken();
+        display->displayInfo("You have been logged out.");
+    }
+    
+    void setupTestData() {
+        // Create an admin user
+        authService.registerUser("admin", "admin123", "Admin");
+        authService.registerUser("doctor", "doctor123", "Doctor");
+        authService.registerUser("reception", "reception123", "Reception");
+        
+        // Add some sample doctors
+        doctorService.addDoctor("Dr. John Smith", "Cardiology", "123-456-7890", "john@hospital.com", Money::fromCents(10000));
+        doctorService.addDoctor("Dr. Jane Doe", "Neurology", "987-654-3210", "jane@hospital.com", Money::fromCents(15000));
+        doctorService.addDoctor("Dr. Robert Johnson", "Pediatrics", "555-123-4567", "robert@hospital.com", Money::fromCents(8000));
+        
+        // Add some sample patients
+        patientService.addPatient("Alice Brown", 35, "Hypertension", "111-222-3333", "123 Main St", "O+");
+        patientService.addPatient("Bob Wilson", 42, "Diabetes", "444-555-6666", "456 Oak Ave", "A-");
+        patientService.addPatient("Carol Martinez", 28, "Asthma", "777-888-9999", "789 Pine Blvd", "B+");
+        
+        // Add some medications
+        medicationService.addMedication("Aspirin", "100mg", Money::fromCents(599), "Bayer", "Pain reliever and anti-inflammatory");
+        medicationService.addMedication("Amoxicillin", "500mg", Money::fromCents(1550), "Generic", "Antibiotic");
+        medicationService.addMedication("Lisinopril", "10mg", Money::fromCents(875), "Generic", "Blood pressure medication");
+        
+        logger->logInfo("Test data has been set up successfully.");
+    }
+    // Rebuilds every repository from the write-ahead log and moves the
+    // services' ID counters past the highest restored IDs
+    size_t recoverFromLog(const std::string &path) {
+        int maxIds[static_cast<int>(EntityKind::User) + 1] = {0};
+        size_t records = WriteAheadLog::replay(path, [&](EntityKind kind, WalOp op, BinaryReader &in) {
+            int id = 0;
+            switch (kind) {
+                case EntityKind::Patient: id = applyJournalRecord<Patient>(*patientRepo, op, in); break;
+                case EntityKind::Doctor: id = applyJournalRecord<Doctor>(*doctorRepo, op, in); break;
+                case EntityKind::Appointment: id = applyJournalRecord<Appointment>(*appointmentRepo, op, in); break;
+                case EntityKind::Medication: id = applyJournalRecord<Medication>(*medicationRepo, op, in); break;
+                case EntityKind::Prescription: id = applyJournalRecord<Prescription>(*prescriptionRepo, op, in); break;
+                case EntityKind::Bill: id = applyJournalRecord<Bill>(*billRepo, op, in); break;
+                case EntityKind::User: id = applyJournalRecord<User>(*userRepo, op, in); break;
+                default: throw std::runtime_error("Unknown record type in write-ahead log " + path);
+            }
+            int &maxId = maxIds[static_cast<int>(kind)];
+            maxId = std::max(maxId, id);
+        });
+        
+        authService.resumeIdsAfter(maxIds[static_cast<int>(EntityKind::User)]);
+        patientService.resumeIdsAfter(maxIds[static_cast<int>(EntityKind::Patient)]);
+        doctorService.resumeIdsAfter(maxIds[static_cast<int>(EntityKind::Doctor)]);
+        appointmentService.resumeIdsAfter(maxIds[static_cast<int>(EntityKind::Appointment)]);
+        medicationService.resumeIdsAfter(maxIds[static_cast<int>(EntityKind::Medication)]);
+        prescriptionService.resumeIdsAfter(maxIds[static_cast<int>(EntityKind::Prescription)]);
+        billingService.resumeIdsAfter(maxIds[static_cast<int>(EntityKind::Bill)]);
+        return records;
+    }
+    
+    // Loads the last checkpoint, if any; returns the number of records loaded
+    size_t loadSnapshot(const std::string &path) {
+        if (::access(path.c_str(), F_OK) != 0) return 0;
+        MappedSnapshot snapshot(path);
+        size_t records = snapshot.loadInto<Patient>(*patientRepo) +
+                         snapshot.loadInto<Doctor>(*doctorRepo) +
+                         snapshot.loadInto<Appointment>(*appointmentRepo) +
+                         snapshot.loadInto<Medication>(*medicationRepo) +
+                         snapshot.loadInto<Prescription>(*prescriptionRepo) +
+                         snapshot.loadInto<Bill>(*billRepo) +
+                         snapshot.loadInto<User>(*userRepo);
+        
+        authService.resumeIdsAfter(snapshot.nextId(EntityKind::User) - 1);
+        patientService.resumeIdsAfter(snapshot.nextId(EntityKind::Patient) - 1);
+        doctorService.resumeIdsAfter(snapshot.nextId(EntityKind::Doctor) - 1);
+        appointmentService.resumeIdsAfter(snapshot.nextId(EntityKind::Appointment) - 1);
+        medicationService.resumeIdsAfter(snapshot.nextId(EntityKind::Medication) - 1);
+        prescriptionService.resumeIdsAfter(snapshot.nextId(EntityKind::Prescription) - 1);
+        billingService.resumeIdsAfter(snapshot.nextId(EntityKind::Bill) - 1);
+        return records;
+    }
+    
+    void attachJournal(std::shared_ptr<IJournal> journal) {
+        patientRepo->attachJournal(journal);
+        doctorRepo->attachJournal(journal);
+        appointmentRepo->attachJournal(journal);
+        medicationRepo->attachJournal(journal);
+        prescriptionRepo->attachJournal(journal);
+        billRepo->attachJournal(journal);
+        userRepo->attachJournal(journal);
+    }
+
+public:
+    HospitalManagementApp(const AppOptions &options = AppOptions())
+        : // Initialize cross-cutting concerns
+          logger(std::make_shared<AsyncFileLogger>()),
+          recorder(!options.batchPath.empty() ? std::make_shared<RecordingDisplayManager>()
+                   : !options.serveAddress.empty()
+                       ? std::make_shared<RecordingDisplayManager>(std::make_shared<ConsoleDisplayManager>())
+                       : nullptr),
+          display(recorder ? std::shared_ptr<IDisplayManager>(recorder) : std::make_shared<ConsoleDisplayManager>()),
+          
+          // Initialize repositories
+          patientRepo(makeRepository<IPatientRepository, ConcurrentPatientRepository, InMemoryPatientRepository>(
+              options.concurrentRepositories)),
+          doctorRepo(makeRepository<IDoctorRepository, ConcurrentDoctorRepository, InMemoryDoctorRepository>(
+              options.concurrentRepositories)),
+          appointmentRepo(makeRepository<IAppointmentRepository, ConcurrentAppointmentRepository, InMemoryAppointmentRepository>(
+              options.concurrentRepositories)),
+          medicationRepo(makeRepository<IMedicationRepository, ConcurrentMedicationRepository, InMemoryMedicationRepository>(
+              options.concurrentRepositories)),
+          prescriptionRepo(makeRepository<IPrescriptionRepository, ConcurrentPrescriptionRepository, InMemoryPrescriptionRepository>(
+              options.concurrentRepositories)),
+          billRepo(makeRepository<IBillRepository, ConcurrentBillRepository, InMemoryBillRepository>(
+              options.concurrentRepositories)),
+          userRepo(makeRepository<IUserRepository, ConcurrentUserRepository, InMemoryUserRepository>(
+              options.concurrentRepositories)),
+          
+          // Initialize services
+          authService(userRepo, logger, options.auth),
+          patientService(patientRepo, logger, display),
+          doctorService(doctorRepo, logger, display),
+          appointmentService(appointmentRepo, patientService, doctorService, logger, display),
+          medicationService(medicationRepo, logger, display),
+          prescriptionService(prescriptionRepo, patientService, doctorService, medicationService, logger, display),
+          billingService(billRepo, patientService, doctorService, logger, display) {
+        
+        exposeRecordCount("patients", patientRepo);
+        exposeRecordCount("doctors", doctorRepo);
+        exposeRecordCount("appointments", appointmentRepo);
+        exposeRecordCount("medications", medicationRepo);
+        exposeRecordCount("prescriptions", prescriptionRepo);
+        exposeRecordCount("bills", billRepo);
+        exposeRecordCount("users", userRepo);
+
+        size_t recovered = 0;
+        if (!options.walPath.empty()) {
+            snapshotPath = options.snapshotPath;
+            if (!snapshotPath.empty()) {
+                recovered += loadSnapshot(snapshotPath);
+            }
+            recovered += recoverFromLog(options.walPath);
+            wal = std::make_shared<WriteAheadLog>(options.walPath, options.walOptions);
+            attachJournal(wal);
+        }
+        
+        if (recovered > 0) {
+            logger->logInfo("Recovered " + std::to_string(recovered) + " records from disk");
+            authService.requireDistinctUsernames();
+            authService.upgradeLegacyPasswords(); // Journaled, so it happens once
+        } else if (options.demoData) {
+            // Setup test data
+            setupTestData();
+        }
+    }
+
+    // Writes every repository to a fresh snapshot and empties the log. The
+    // log is only emptied once the snapshot is durable; on failure it is kept,
+    // so the next startup replays it, and false is returned.
+    bool checkpoint() {
+        if (!wal || snapshotPath.empty()) return true;
+        try {
+            writeCheckpoint();
+        } catch (const std::exception &e) {
+            logger->logError(std::string("Checkpoint failed, keeping the write-ahead log: ") + e.what());
+            return false;
+        }
+        logger->logInfo("Checkpoint written to " + snapshotPath);
+        return true;
+    }
+
+    void writeCheckpoint() {
+        wal->sync();
+        SnapshotWriter writer;
+        writer.addTable(patientRepo->getAll());
+        writer.addTable(doctorRepo->getAll());
+        writer.addTable(appointmentRepo->getAll());
+        writer.addTable(medicationRepo->getAll());
+        writer.addTable(prescriptionRepo->getAll());
+        writer.addTable(billRepo->getAll());
+        writer.addTable(userRepo->getAll());
+        writer.setNextId(EntityKind::User, authService.peekNextId());
+        writer.setNextId(EntityKind::Patient, patientService.peekNextId());
+        writer.setNextId(EntityKind::Doctor, doctorService.peekNextId());
+        writer.setNextId(EntityKind::Appointment, appointmentService.peekNextId());
+        writer.setNextId(EntityKind::Medication, medicationService.peekNextId());
+        writer.setNextId(EntityKind::Prescription, prescriptionService.peekNextId());
+        writer.setNextId(EntityKind::Bill, billingService.peekNextId());
+        writer.write(snapshotPath);
+        wal->reset();
+    }
+
+    // Runs a command script without prompts, then checkpoints; returns the
+    // process exit status (non-zero if any command failed)
+    int runBatch(std::istream &in) {
+        if (!recorder) throw std::logic_error("Batch mode was not enabled in AppOptions");
+        CommandProcessor processor(authService, patientService, doctorService, appointmentService,
+                                   medicationService, prescriptionService, billingService, recorder);
+        auto start = std::chrono::steady_clock::now();
+        BatchSummary summary = runCommandStream(in, processor, std::cerr);
+        double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        bool saved = checkpoint();
+
+        logger->logInfo("Batch run: " + std::to_string(summary.lines) + " lines, " +
+                        std::to_string(summary.failed) + " failed");
+        std::cout << "Processed " << summary.lines << " lines in " << std::fixed << std::setprecision(1)
+                  << ns / 1e6 << " ms (" << std::setprecision(0) << summary.lines / (ns / 1e9)
+                  << " lines/sec), " << summary.failed << " failed" << std::endl;
+        if (!saved) return 1;
+        return summary.failed == 0 ? 0 : 2;
+    }
+
+    // Serves remote clients until SIGINT or SIGTERM, then checkpoints.
+    // Service messages are echoed to the console, which the server captures
+    // into each response.
+    int runServer(const std::string &address) {
+        if (!recorder) throw std::logic_error("Server mode was not enabled in AppOptions");
+        CommandProcessor processor(authService, patientService, doctorService, appointmentService,
+                                   medicationService, prescriptionService, billingService, recorder);
+        HospitalServer server(processor, authService, logger);
+        server.listen(address);
+        if (userRepo->size() == 0) {
+            std::cerr << "No user accounts exist, so nobody can log in. Add one with --batch (add-user) "
+                         "or start with --demo-data yes." << std::endl;
+        }
+
+        static std::atomic<int> stopFd(-1);
+        stopFd = server.stopDescriptor();
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_handler = [](int) { wakeEventFd(stopFd.load()); };
+        sigaction(SIGINT, &action, nullptr);
+        sigaction(SIGTERM, &action, nullptr);
+
+        std::cout << "Serving on " << address << " (Ctrl+C to stop)" << std::endl;
+        server.run();
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        bool saved = checkpoint();
+        std::cout << "Server stopped." << std::endl;
+        return saved ? 0 : 1;
+    }
+
+    void run() {
+        // First handle login
+        bool exitProgram = false;
+        while (!exitProgram && session.isNull()) {
+            displayLoginMenu();
+            int choice = readInt();
+            
+            switch (choice) {
+                case 1:
+                    if (login()) {
+                        runMainApplication();
+                    }
+                    break;
+                case 2:
+                    exitProgram = true;
+                    if (!checkpoint()) {
+                        display->displayError("Could not save a snapshot; changes remain in the write-ahead log.");
+                    }
+                    display->displayInfo("Exiting program. Goodbye!");
+                    break;
+                default:
+                    display->displayError("Invalid choice. Please try again.");
+            }
+        }
+    }
+
+    void runMainApplication() {
+        int choice = 0;
+        while (!session.isNull() && choice != 37) {
+            displayMainMenu();
+            choice = readInt();
+            
+            // Process the menu choice
+            processMenuChoice(choice);
+        }
+    }
+    
+    // What a menu choice requires; everything but the admin functions is front-desk work
+    static Permission menuPermission(int choice) {
+        switch (choice) {
+            case 1: return Permission::ManageUsers;
+            case 2: return Permission::ViewLogsAndMetrics;
+            case 3: return Permission::ViewFinances;
+            case 40: return Permission::ArchiveRecords;
+            default: return Permission::FrontDesk;
+        }
+    }
+
+    void processMenuChoice(int choice) {
+        if (!authService.allows(session, menuPermission(choice))) {
+            if (!authService.isLoggedIn(session)) {
+                session = SessionToken();
+                display->displayError("Your session has ended. Please log in again.");
+            } else {
+                display->displayError("Access denied. Admin privileges required.");
+            }
+            return;
+        }
+        
+        switch (choice) {
+            // Admin Functions
+            case 1: manageUsers(); break;
+            case 40: archiveOldAppointments(); break;
+            case 2: viewSystemLogsAndMetrics(); break;
+            case 3: generateFinancialReports(); break;
+            
+            // Patient Management
+            case 4: addPatient(); break;
+            case 5: updatePatient(); break;
+            case 6: removePatient(); break;
+            case 7: listAllPatients(); break;
+            case 8: findPatientsByDisease(); break;
+            case 9: findPatientsByAgeRange(); break;
+            
+            // Doctor Management
+            case 10: addDoctor(); break;
+            case 11: updateDoctor(); break;
+            case 12: removeDoctor(); break;
+            case 13: listAllDoctors(); break;
+            case 14: listAvailableDoctors(); break;
+            case 15: findDoctorsBySpecialization(); break;
+            case 16: setDoctorAvailability(); break;
+            
+            // Appointment Management
+            case 17: bookAppointment(); break;
+            case 18: updateAppointment(); break;
+            case 19: cancelAppointment(); break;
+            case 20: listAllAppointments(); break;
+            case 21: listAppointmentsByPatient(); break;
+            case 22: listAppointmentsByDoctor(); break;
+            case 23: listAppointmentsByDate(); break;
+            case 38: listFreeSlots(); break;
+            case 39: listAppointmentsInDateRange(); break;
+            
+            // Medication Management
+            case 24: addMedication(); break;
+            case 25: updateMedication(); break;
+            case 26: removeMedication(); break;
+            case 27: listAllMedications(); break;
+            
+            // Prescription Management
+            case 28: createPrescription(); break;
+            case 29: updatePrescription(); break;
+            case 30: removePrescription(); break;
+            case 31: listPrescriptionsByPatient(); break;
+            
+            // Billing Management
+            case 32: generateBill(); break;
+            case 33: updateBillPaymentStatus(); break;
+            case 34: listBillsByPatient(); break;
+            case 35: listBillsByPaymentStatus(); break;
+            
+            // System
+            case 36: logout(); break;
+            case 37: 
+                logout();
+                display->displayInfo("Exiting application. Goodbye!");
+                break;
+            default:
+                display->displayError("Invalid choice. Please try again.");
+        }
+    }
+    
+    // Admin Functions
+    void manageUsers() {
+        std::cout << "\n----- User Management -----\n";
+        std::cout << "1. Add User\n";
+        std::cout << "2. List All Users\n";
+        std::cout << "3. Enable/Disable User\n";
+        std::cout << "4. Back to Main Menu\n";
+        std::cout << "Enter your choice: ";
+        
+        int choice = readInt();
+        switch (choice) {
+            case 1: {
+                std::cout << "Enter username: ";
+                std::string username = readLine();
+                std::cout << "Enter password: ";
+                std::string password = readLine();
+                std::cout << "Enter role (Admin, Doctor, Reception): ";
+                std::string role = readLine();
+                
+                if (!inVocabulary(Vocabulary::Role, role)) {
+                    display->displayError(vocabularyError(Vocabulary::Role));
+                } else if (authService.registerUser(username, password, role)) {
+                    display->displaySuccess("User added successfully.");
+                } else {
+                    display->displayError("Failed to add user. Username may already exist.");
+                }
+                break;
+            }
+            case 2: {
+                displayRecords<User>(*display, [&](const auto &v) { authService.forEachUser(v); },
+                                     "List of all users:", "No users registered.");
+                break;
+            }
+            case 3: {
+                std::cout << "Enter user ID: ";
+                int userId = readInt();
+                std::cout << "Enable user? (1: Yes, 0: No): ";
+                int enable = readInt();
+                
+                if (authService.updateUserStatus(userId, enable == 1)) {
+                    display->displaySuccess("User status updated successfully.");
+                } else {
+                    display->displayError("Failed to update user status. User not found.");
+                }
+                break;
+            }
+            case 4:
+                return;
+            default:
+                display->displayError("Invalid choice. Please try again.");
+        }
+    }
+    
+    void viewSystemLogsAndMetrics() {
+        std::cout << "\n----- System Logs and Metrics -----\n";
+        std::cout << "1. Log File Location\n";
+        std::cout << "2. Show Metrics\n";
+        std::cout << "3. Export Metrics (Prometheus text format)\n";
+        std::cout << "4. Back to Main Menu\n";
+        std::cout << "Enter your choice: ";
+
+        int choice = readInt();
+        switch (choice) {
+            case 1:
+                std::cout << "System logs are stored in hospital_log.txt\n";
+                display->displayInfo("Please check the log file for detailed system logs.");
+                break;
+            case 2:
+                displayMetricsSummary(*display);
+                break;
+            case 3: {
+                std::cout << "Enter file name (blank for hospital_metrics.prom): ";
+                std::string path = readLine();
+                if (path.empty()) path = "hospital_metrics.prom";
+                std::string error;
+                if (!writeMetricsFile(path, error)) {
+                    display->displayError(error);
+                    break;
+                }
+                logger->logInfo("Metrics exported to " + path);
+                display->displaySuccess("Metrics exported to " + path);
+                break;
+            }
+            case 4:
+                return;
+            default:
+                display->displayError("Invalid choice. Please try again.");
+        }
+    }
+    
+    void generateFinancialReports() {
+        std::cout << "\n----- Financial Reports -----\n";
+        std::cout << "1. Total Revenue\n";
+        std::cout << "2. Pending Payments\n";
+        std::cout << "3. Revenue for a Date Range\n";
+        std::cout << "4. Pending Payments by Age\n";
+        std::cout << "5. Back to Main Menu\n";
+        std::cout << "Enter your choice: ";
+        
+        int choice = readInt();
+        switch (choice) {
+            case 1:
+                billingService.getTotalRevenue();
+                billingService.reportRevenueBreakdown();
+                break;
+            case 2:
+                billingService.getPendingPayments();
+                break;
+            case 3: {
+                std::string fromDate = getDateInput("Enter From Date (YYYY-MM-DD): ");
+                std::string toDate = getDateInput("Enter To Date (YYYY-MM-DD): ");
+                billingService.getRevenueInDateRange(fromDate, toDate);
+                break;
+            }
+            case 4:
+                billingService.reportPendingAging(getDateInput("As of Date (YYYY-MM-DD, blank for today): "));
+                break;
+            case 5:
+                return;
+            default:
+                display->displayError("Invalid choice. Please try again.");
+        }
+    }
+    
+    // Patient Management
+    void addPatient() {
+        std::cout << "Enter Patient Name: ";
+        std::string name = readLine();
+        std::cout << "Enter Age: ";
+        int age = readInt();
+        std::cout << "Enter Disease: ";
+        std::string disease = readLine();
+        std::cout << "Enter Contact Number (optional): ";
+        std::string contact = readLine();
+        std::cout << "Enter Address (optional): ";
+        std::string address = readLine();
+        std::cout << "Enter Blood Group (optional): ";
+        std::string bloodGroup = readLine();
+        
+        patientService.addPatient(name, age, disease, contact, address, bloodGroup);
+    }
+    
+    void updatePatient() {
+        std::cout << "Enter Patient ID to update: ";
+        int id = readInt();
+        std::cout << "Enter new Name: ";
+        std::string name = readLine();
+        std::cout << "Enter new Age: ";
+        int age = readInt();
+        std::cout << "Enter new Disease: ";
+        std::string disease = readLine();
+        std::cout << "Enter new Contact Number (optional): ";
+        std::string contact = readLine();
+        std::cout << "Enter new Address (optional): ";
+        std::string address = readLine();
+        std::cout << "Enter new Blood Group (optional): ";
+        std::string bloodGroup = readLine();
+        
+        patientService.updatePatient(id, name, age, disease, contact, address, bloodGroup);
+    }
+    
+    void removePatient() {
+        std::cout << "Enter Patient ID to remove: ";
+        int id = readInt();
+        patientService.removePatient(id);
+    }
+    
+    void listAllPatients() {
+        patientService.listPatients();
+    }
+    
+    void findPatientsByDisease() {
+        std::cout << "Enter disease to search for: ";
+        std::string disease = readLine();
+        patientService.findPatientsByDisease(disease);
+    }
+    
+    void findPatientsByAgeRange() {
+        std::cout << "Enter minimum age: ";
+        int minAge = readInt();
+        std::cout << "Enter maximum age: ";
+        int maxAge = readInt();
+        patientService.findPatientsByAgeRange(minAge, maxAge);
+    }
+    
+    // Doctor Management
+    void addDoctor() {
+        std::cout << "Enter Doctor Name: ";
+        std::string name = readLine();
+        std::cout << "Enter Specialization: ";
+        std::string spec = readLine();
+        std::cout << "Enter Contact Number (optional): ";
         std::string contact = readLine();
         std::cout << "Enter Email (optional): ";
         std::string email = readLine();
         std::cout << "Enter Consultation Fee: ";
-        double fee = readDouble();
+        Money fee = readMoney();
         
         doctorService.addDoctor(name, spec, contact, email, fee);
     }
@@ -2205,7 +8602,7 @@ public:
         std::cout << "Enter new Email (optional): ";
         std::string email = readLine();
         std::cout << "Enter new Consultation Fee: ";
-        double fee = readDouble();
+        Money fee = readMoney();
         
         doctorService.updateDoctor(id, name, spec, contact, email, fee);
     }
@@ -2246,202 +8643,2204 @@ public:
         std::cout << "Enter Doctor ID: ";
         int doctorId = readInt();
         std::string date = getDateInput();
-        std::string timeSlot = getTimeSlotInput();
+        std::string timeSlot = getTimeSlotInput();
+        
+        appointmentService.bookAppointment(patientId, doctorId, date, timeSlot);
+    }
+    
+    void updateAppointment() {
+        std::cout << "Enter Appointment ID to update: ";
+        int apptId = readInt();
+        std::string date = getDateInput("Enter new Date (YYYY-MM-DD): ");
+        std::string timeSlot = getTimeSlotInput();
+        
+        std::cout << "Enter new status (Scheduled, Completed, Cancelled): ";
+        std::string status = readLine();
+        
+        std::cout << "Enter notes (optional): ";
+        std::string notes = readLine();
+        
+        appointmentService.updateAppointmentDetails(apptId, date, timeSlot, status, notes);
+    }
+    
+    void cancelAppointment() {
+        std::cout << "Enter Appointment ID to cancel: ";
+        int apptId = readInt();
+        appointmentService.cancelAppointment(apptId);
+    }
+    
+    void listAllAppointments() {
+        appointmentService.listAllAppointments();
+    }
+    
+    void listAppointmentsByPatient() {
+        std::cout << "Enter Patient ID: ";
+        int patientId = readInt();
+        appointmentService.listAppointmentsByPatient(patientId);
+    }
+    
+    void listAppointmentsByDoctor() {
+        std::cout << "Enter Doctor ID: ";
+        int doctorId = readInt();
+        appointmentService.listAppointmentsByDoctor(doctorId);
+    }
+    
+    void listAppointmentsByDate() {
+        std::string date = getDateInput();
+        appointmentService.listAppointmentsByDate(date);
+    }
+    
+    void listAppointmentsInDateRange() {
+        std::string fromDate = getDateInput("Enter From Date (YYYY-MM-DD): ");
+        std::string toDate = getDateInput("Enter To Date (YYYY-MM-DD): ");
+        appointmentService.listAppointmentsInDateRange(fromDate, toDate);
+    }
+
+    // Archived appointments go to hospital_archive_<date>.bin, a snapshot
+    // file holding only the appointment table
+    void archiveOldAppointments() {
+        std::string date = getDateInput("Archive appointments dated before (YYYY-MM-DD): ");
+        appointmentService.archiveAppointmentsBefore(date, "hospital_archive_" + date + ".bin");
+    }
+
+    void listFreeSlots() {
+        std::cout << "Enter Doctor ID: ";
+        int doctorId = readInt();
+        std::string date = getDateInput();
+        appointmentService.listFreeSlots(doctorId, date);
+    }
+    
+    // Medication Management
+    void addMedication() {
+        std::cout << "Enter Medication Name: ";
+        std::string name = readLine();
+        std::cout << "Enter Dosage: ";
+        std::string dosage = readLine();
+        std::cout << "Enter Price: ";
+        Money price = readMoney();
+        std::cout << "Enter Manufacturer (optional): ";
+        std::string manufacturer = readLine();
+        std::cout << "Enter Description (optional): ";
+        std::string description = readLine();
+        
+        medicationService.addMedication(name, dosage, price, manufacturer, description);
+    }
+    
+    void updateMedication() {
+        std::cout << "Enter Medication ID to update: ";
+        int id = readInt();
+        std::cout << "Enter new Name: ";
+        std::string name = readLine();
+        std::cout << "Enter new Dosage: ";
+        std::string dosage = readLine();
+        std::cout << "Enter new Price: ";
+        Money price = readMoney();
+        std::cout << "Enter new Manufacturer (optional): ";
+        std::string manufacturer = readLine();
+        std::cout << "Enter new Description (optional): ";
+        std::string description = readLine();
+        
+        medicationService.updateMedication(id, name, dosage, price, manufacturer, description);
+    }
+    
+    void removeMedication() {
+        std::cout << "Enter Medication ID to remove: ";
+        int id = readInt();
+        medicationService.removeMedication(id);
+    }
+    
+    void listAllMedications() {
+        medicationService.listAllMedications();
+    }
+    
+    // Prescription Management
+    void createPrescription() {
+        std::cout << "Enter Patient ID: ";
+        int patientId = readInt();
+        std::cout << "Enter Doctor ID: ";
+        int doctorId = readInt();
+        std::string date = getDateInput();
+        
+        std::vector<int> medicationIds;
+        bool addMore = true;
+        while (addMore) {
+            std::cout << "Enter Medication ID: ";
+            int medId = readInt();
+            medicationIds.push_back(medId);
+            
+            std::cout << "Add another medication? (1: Yes, 0: No): ";
+            int more = readInt();
+            addMore = (more == 1);
+        }
+        
+        std::cout << "Enter Instructions (optional): ";
+        std::string instructions = readLine();
+        
+        prescriptionService.createPrescription(patientId, doctorId, date, medicationIds, instructions);
+    }
+    
+    void updatePrescription() {
+        std::cout << "Enter Prescription ID to update: ";
+        int prescId = readInt();
+        
+        std::vector<int> medicationIds;
+        bool addMore = true;
+        while (addMore) {
+            std::cout << "Enter Medication ID: ";
+            int medId = readInt();
+            medicationIds.push_back(medId);
+            
+            std::cout << "Add another medication? (1: Yes, 0: No): ";
+            int more = readInt();
+            addMore = (more == 1);
+        }
+        
+        std::cout << "Enter Instructions (optional): ";
+        std::string instructions = readLine();
+        
+        prescriptionService.updatePrescription(prescId, medicationIds, instructions);
+    }
+    
+    void removePrescription() {
+        std::cout << "Enter Prescription ID to remove: ";
+        int id = readInt();
+        prescriptionService.removePrescription(id);
+    }
+    
+    void listPrescriptionsByPatient() {
+        std::cout << "Enter Patient ID: ";
+        int patientId = readInt();
+        prescriptionService.listPrescriptionsByPatient(patientId);
+    }
+    
+    // Billing Management
+    void generateBill() {
+        std::cout << "Enter Patient ID: ";
+        int patientId = readInt();
+        std::string date = getDateInput();
+        std::cout << "Enter Consultation Fee: ";
+        Money consultationFee = readMoney();
+        std::cout << "Enter Medication Charges: ";
+        Money medicationCharges = readMoney();
+        std::cout << "Enter Other Charges: ";
+        Money otherCharges = readMoney();
         
-        appointmentService.bookAppointment(patientId, doctorId, date, timeSlot);
+        billingService.generateBill(patientId, date, consultationFee, medicationCharges, otherCharges);
     }
     
-    void updateAppointment() {
-        std::cout << "Enter Appointment ID to update: ";
-        int apptId = readInt();
-        std::string date = getDateInput("Enter new Date (YYYY-MM-DD): ");
-        std::string timeSlot = getTimeSlotInput();
-        
-        std::cout << "Enter new status (Scheduled, Completed, Cancelled): ";
+    void updateBillPaymentStatus() {
+        std::cout << "Enter Bill ID: ";
+        int billId = readInt();
+        std::cout << "Enter new Payment Status (Paid, Pending, Overdue): ";
         std::string status = readLine();
+        std::cout << "Enter Payment Method (Cash, Card, Insurance) (optional): ";
+        std::string method = readLine();
         
-        std::cout << "Enter notes (optional): ";
-        std::string notes = readLine();
-        
-        appointmentService.updateAppointmentDetails(apptId, date, timeSlot, status, notes);
+        billingService.updateBillPaymentStatus(billId, status, method);
     }
     
-    void cancelAppointment() {
-        std::cout << "Enter Appointment ID to cancel: ";
-        int apptId = readInt();
-        appointmentService.cancelAppointment(apptId);
+    void listBillsByPatient() {
+        std::cout << "Enter Patient ID: ";
+        int patientId = readInt();
+        billingService.listBillsByPatient(patientId);
     }
     
-    void listAllAppointments() {
-        appointmentService.listAllAppointments();
+    void listBillsByPaymentStatus() {
+        std::cout << "Enter Payment Status (Paid, Pending, Overdue): ";
+        std::string status = readLine();
+        billingService.listBillsByPaymentStatus(status);
     }
-    
-    void listAppointmentsByPatient() {
-        std::cout << "Enter Patient ID: ";
-        int patientId = readInt();
-        appointmentService.listAppointmentsByPatient(patientId);
+};
+
+// Thin client for a server started with --serve: shows the same menus and
+// prompts as the local application, turns each answer into a command line,
+// and prints what the server sends back
+class RemoteMenuClient {
+private:
+    enum class Input { Text, Number, Amount, Slot, YesNo, MedicationIds };
+
+    struct Prompt {
+        Input input;
+        const char *text;
+    };
+
+    struct MenuCommand {
+        int choice;
+        const char *title; // Shown in submenus; the main menu has its own text
+        const char *command;
+        std::vector<Prompt> prompts;
+    };
+
+    struct Submenu {
+        const char *heading;
+        std::vector<MenuCommand> commands;
+    };
+
+    ConsoleDisplayManager display;
+    int fd;
+    std::string role;
+
+    static const std::vector<MenuCommand> &mainCommands() {
+        static const char *const enterPatientId = "Enter Patient ID: ";
+        static const char *const enterDoctorId = "Enter Doctor ID: ";
+        static const char *const enterDate = "Enter Date (YYYY-MM-DD): ";
+        static const std::vector<MenuCommand> commands = {
+            {4, "", "add-patient", {{Input::Text, "Enter Patient Name: "}, {Input::Number, "Enter Age: "},
+                                    {Input::Text, "Enter Disease: "},
+                                    {Input::Text, "Enter Contact Number (optional): "},
+                                    {Input::Text, "Enter Address (optional): "},
+                                    {Input::Text, "Enter Blood Group (optional): "}}},
+            {5, "", "update-patient", {{Input::Number, "Enter Patient ID to update: "},
+                                       {Input::Text, "Enter new Name: "}, {Input::Number, "Enter new Age: "},
+                                       {Input::Text, "Enter new Disease: "},
+                                       {Input::Text, "Enter new Contact Number (optional): "},
+                                       {Input::Text, "Enter new Address (optional): "},
+                                       {Input::Text, "Enter new Blood Group (optional): "}}},
+            {6, "", "remove-patient", {{Input::Number, "Enter Patient ID to remove: "}}},
+            {7, "", "list-patients", {}},
+            {8, "", "find-patients-by-disease", {{Input::Text, "Enter disease to search for: "}}},
+            {9, "", "find-patients-by-age", {{Input::Number, "Enter minimum age: "},
+                                             {Input::Number, "Enter maximum age: "}}},
+            {10, "", "add-doctor", {{Input::Text, "Enter Doctor Name: "}, {Input::Text, "Enter Specialization: "},
+                                    {Input::Text, "Enter Contact Number (optional): "},
+                                    {Input::Text, "Enter Email (optional): "},
+                                    {Input::Amount, "Enter Consultation Fee: "}}},
+            {11, "", "update-doctor", {{Input::Number, "Enter Doctor ID to update: "},
+                                       {Input::Text, "Enter new Name: "},
+                                       {Input::Text, "Enter new Specialization: "},
+                                       {Input::Text, "Enter new Contact Number (optional): "},
+                                       {Input::Text, "Enter new Email (optional): "},
+                                       {Input::Amount, "Enter new Consultation Fee: "}}},
+            {12, "", "remove-doctor", {{Input::Number, "Enter Doctor ID to remove: "}}},
+            {13, "", "list-doctors", {}},
+            {14, "", "list-available-doctors", {}},
+            {15, "", "find-doctors-by-specialization", {{Input::Text, "Enter specialization to search for: "}}},
+            {16, "", "set-availability", {{Input::Number, enterDoctorId},
+                                          {Input::YesNo, "Set as available? (1: Yes, 0: No): "}}},
+            {17, "", "book", {{Input::Number, enterPatientId}, {Input::Number, enterDoctorId},
+                              {Input::Text, enterDate}, {Input::Slot, ""}}},
+            {18, "", "update-appointment", {{Input::Number, "Enter Appointment ID to update: "},
+                                            {Input::Text, "Enter new Date (YYYY-MM-DD): "}, {Input::Slot, ""},
+                                            {Input::Text, "Enter new status (Scheduled, Completed, Cancelled): "},
+                                            {Input::Text, "Enter notes (optional): "}}},
+            {19, "", "cancel", {{Input::Number, "Enter Appointment ID to cancel: "}}},
+            {20, "", "list-appointments", {}},
+            {21, "", "list-appointments-by-patient", {{Input::Number, enterPatientId}}},
+            {22, "", "list-appointments-by-doctor", {{Input::Number, enterDoctorId}}},
+            {23, "", "list-appointments-by-date", {{Input::Text, enterDate}}},
+            {38, "", "list-free-slots", {{Input::Number, enterDoctorId}, {Input::Text, enterDate}}},
+            {39, "", "list-appointments-in-range", {{Input::Text, "Enter From Date (YYYY-MM-DD): "},
+                                                    {Input::Text, "Enter To Date (YYYY-MM-DD): "}}},
+            {24, "", "add-medication", {{Input::Text, "Enter Medication Name: "}, {Input::Text, "Enter Dosage: "},
+                                        {Input::Amount, "Enter Price: "},
+                                        {Input::Text, "Enter Manufacturer (optional): "},
+                                        {Input::Text, "Enter Description (optional): "}}},
+            {25, "", "update-medication", {{Input::Number, "Enter Medication ID to update: "},
+                                           {Input::Text, "Enter new Name: "}, {Input::Text, "Enter new Dosage: "},
+                                           {Input::Amount, "Enter new Price: "},
+                                           {Input::Text, "Enter new Manufacturer (optional): "},
+                                           {Input::Text, "Enter new Description (optional): "}}},
+            {26, "", "remove-medication", {{Input::Number, "Enter Medication ID to remove: "}}},
+            {27, "", "list-medications", {}},
+            {28, "", "prescribe", {{Input::Number, enterPatientId}, {Input::Number, enterDoctorId},
+                                   {Input::Text, enterDate}, {Input::MedicationIds, ""},
+                                   {Input::Text, "Enter Instructions (optional): "}}},
+            {29, "", "update-prescription", {{Input::Number, "Enter Prescription ID to update: "},
+                                             {Input::MedicationIds, ""},
+                                             {Input::Text, "Enter Instructions (optional): "}}},
+            {30, "", "remove-prescription", {{Input::Number, "Enter Prescription ID to remove: "}}},
+            {31, "", "list-prescriptions-by-patient", {{Input::Number, enterPatientId}}},
+            {32, "", "bill", {{Input::Number, enterPatientId}, {Input::Text, enterDate},
+                              {Input::Amount, "Enter Consultation Fee: "},
+                              {Input::Amount, "Enter Medication Charges: "},
+                              {Input::Amount, "Enter Other Charges: "}}},
+            {33, "", "pay", {{Input::Number, "Enter Bill ID: "},
+                             {Input::Text, "Enter new Payment Status (Paid, Pending, Overdue): "},
+                             {Input::Text, "Enter Payment Method (Cash, Card, Insurance) (optional): "}}},
+            {34, "", "list-bills-by-patient", {{Input::Number, enterPatientId}}},
+            {35, "", "list-bills-by-status", {{Input::Text, "Enter Payment Status (Paid, Pending, Overdue): "}}},
+        };
+        return commands;
+    }
+
+    static const Submenu *adminSubmenu(int choice) {
+        static const Submenu users = {"User Management", {
+            {1, "Add User", "add-user", {{Input::Text, "Enter username: "}, {Input::Text, "Enter password: "},
+                                         {Input::Text, "Enter role (Admin, Doctor, Reception): "}}},
+            {2, "List All Users", "list-users", {}},
+            {3, "Enable/Disable User", "set-user-active", {{Input::Number, "Enter user ID: "},
+                                                           {Input::YesNo, "Enable user? (1: Yes, 0: No): "}}},
+        }};
+        static const Submenu monitoring = {"System Logs and Metrics", {
+            {1, "Log File Location", "", {}},
+            {2, "Show Metrics", "metrics", {}},
+            {3, "Export Metrics (Prometheus text format)", "export-metrics",
+             {{Input::Text, "Enter file name on the server (blank for hospital_metrics.prom): "}}},
+        }};
+        static const Submenu reports = {"Financial Reports", {
+            {1, "Total Revenue", "revenue", {}},
+            {2, "Pending Payments", "pending-payments", {}},
+            {3, "Revenue for a Date Range", "revenue-in-range", {{Input::Text, "Enter From Date (YYYY-MM-DD): "},
+                                                                 {Input::Text, "Enter To Date (YYYY-MM-DD): "}}},
+            {4, "Pending Payments by Age", "pending-aging",
+             {{Input::Text, "As of Date (YYYY-MM-DD, blank for today): "}}},
+        }};
+        switch (choice) {
+            case 1: return &users;
+            case 2: return &monitoring;
+            case 3: return &reports;
+            default: return nullptr;
+        }
+    }
+
+    // Sends one request and waits for its response
+    std::string request(const std::string &line) {
+        std::string frame;
+        appendFrame(frame, line);
+        for (size_t sent = 0; sent < frame.size();) {
+            ssize_t n = ::send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) throw std::runtime_error("Lost the connection to the server");
+            sent += static_cast<size_t>(n);
+        }
+        char header[4];
+        receive(header, sizeof(header));
+        std::string response(frameLength(header), '\0');
+        if (!response.empty()) receive(&response[0], response.size());
+        return response;
+    }
+
+    void receive(char *data, size_t size) {
+        while (size > 0) {
+            ssize_t n = ::recv(fd, data, size, 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) throw std::runtime_error("Lost the connection to the server");
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+    }
+
+    // Runs a command and prints its output. Errors the command printed
+    // itself are not repeated.
+    void execute(const std::string &line) {
+        std::string response = request(line);
+        size_t newline = response.find('\n');
+        std::string status = response.substr(0, newline);
+        std::string output = newline == std::string::npos ? "" : response.substr(newline + 1);
+        std::cout << output;
+        if (status.compare(0, 4, "ERR ") == 0 && output.empty()) display.displayError(status.substr(4));
+    }
+
+    // Asks each prompt and joins the answers into a command line; false if
+    // an answer cannot be sent
+    bool buildCommand(const MenuCommand &command, std::string &line) {
+        line = command.command;
+        for (const Prompt &prompt : command.prompts) {
+            std::cout << prompt.text;
+            std::string value;
+            switch (prompt.input) {
+                case Input::Text: value = readConsoleLine(); break;
+                case Input::Number: value = std::to_string(readConsoleInt(display)); break;
+                case Input::Amount: value = readConsoleMoney(display).toString(); break;
+                case Input::Slot: value = readConsoleTimeSlot(display); break;
+                case Input::YesNo: value = readConsoleInt(display) == 1 ? "yes" : "no"; break;
+                case Input::MedicationIds:
+                    for (bool more = true; more;) {
+                        std::cout << "Enter Medication ID: ";
+                        value += (value.empty() ? "" : ",") + std::to_string(readConsoleInt(display));
+                        std::cout << "Add another medication? (1: Yes, 0: No): ";
+                        more = readConsoleInt(display) == 1;
+                    }
+                    break;
+            }
+            if (value.find('|') != std::string::npos) {
+                display.displayError("Answers cannot contain '|'.");
+                return false;
+            }
+            line += "|" + value;
+        }
+        return true;
+    }
+
+    void runSubmenu(const Submenu &submenu) {
+        std::cout << "\n----- " << submenu.heading << " -----\n";
+        for (const MenuCommand &command : submenu.commands) {
+            std::cout << command.choice << ". " << command.title << "\n";
+        }
+        int back = static_cast<int>(submenu.commands.size()) + 1;
+        std::cout << back << ". Back to Main Menu\n";
+        std::cout << "Enter your choice: ";
+
+        int picked = readConsoleInt(display);
+        if (picked == back) return;
+        for (const MenuCommand &command : submenu.commands) {
+            if (command.choice != picked) continue;
+            std::string line;
+            if (*command.command == '\0') {
+                std::cout << "System logs are stored in hospital_log.txt on the server\n";
+            } else if (buildCommand(command, line)) {
+                execute(line);
+            }
+            return;
+        }
+        display.displayError("Invalid choice. Please try again.");
+    }
+
+    // Returns false when the user chose to exit
+    bool runMainMenu() {
+        for (;;) {
+            bool admin = role == "Admin";
+            printMainMenu(admin);
+            int choice = readConsoleInt(display);
+            if (choice == 36 || choice == 37) {
+                execute("logout");
+                if (choice == 36) {
+                    display.displayInfo("You have been logged out.");
+                    return true;
+                }
+                display.displayInfo("Exiting application. Goodbye!");
+                return false;
+            }
+            if ((choice >= 1 && choice <= 3) || choice == 40) {
+                if (!admin) {
+                    display.displayError("Access denied. Admin privileges required.");
+                } else if (choice == 40) {
+                    std::cout << "Archive appointments dated before (YYYY-MM-DD): ";
+                    std::string date = readConsoleLine();
+                    if (date.find('|') != std::string::npos) {
+                        display.displayError("Answers cannot contain '|'.");
+                    } else {
+                        execute("archive-appointments|" + date + "|hospital_archive_" + date + ".bin");
+                    }
+                } else {
+                    runSubmenu(*adminSubmenu(choice));
+                }
+                continue;
+            }
+            const MenuCommand *picked = nullptr;
+            for (const MenuCommand &command : mainCommands()) {
+                if (command.choice == choice) picked = &command;
+            }
+            std::string line;
+            if (!picked) {
+                display.displayError("Invalid choice. Please try again.");
+            } else if (buildCommand(*picked, line)) {
+                execute(line);
+            }
+        }
+    }
+
+public:
+    explicit RemoteMenuClient(const std::string &address) : fd(connectToServer(ServerAddress::parse(address))) {}
+    RemoteMenuClient(const RemoteMenuClient &) = delete;
+    RemoteMenuClient &operator=(const RemoteMenuClient &) = delete;
+    ~RemoteMenuClient() { ::close(fd); }
+
+    void run() {
+        for (;;) {
+            std::cout << "\n----- Hospital Management System Login -----\n";
+            std::cout << "1. Login\n";
+            std::cout << "2. Exit\n";
+            std::cout << "Enter your choice: ";
+            int choice = readConsoleInt(display);
+            if (choice == 2) {
+                display.displayInfo("Exiting program. Goodbye!");
+                return;
+            }
+            if (choice != 1) {
+                display.displayError("Invalid choice. Please try again.");
+                continue;
+            }
+            std::cout << "Enter username: ";
+            std::string username = readConsoleLine();
+            std::cout << "Enter password: ";
+            std::string password = readConsoleLine();
+            std::string response = (username + password).find('|') == std::string::npos
+                ? request("login|" + username + "|" + password) : "";
+            if (response.compare(0, 3, "OK ") != 0) {
+                display.displayError("Login failed. Invalid username or password.");
+                continue;
+            }
+            role = response.substr(3, response.find('\n') - 3);
+            display.displaySuccess("Login successful. Welcome, " + username + "!");
+            if (!runMainMenu()) return;
+        }
+    }
+};
+
+// ------------------------------
+// Benchmarks
+// ------------------------------
+
+// Options shared by the benchmarks; only the suite reads most of them
+struct BenchmarkOptions {
+    int scale = 10000;         // Patients in the generated dataset
+    uint32_t seed = 42;
+    bool concurrentRepositories = false;
+    std::string jsonPath;      // Empty prints results only
+    int threads = 4;           // Load generator sessions
+    int durationSeconds = 10;
+    int rate = 0;              // Load generator ops/sec over all sessions; 0 runs flat out
+    std::string mix;           // Load generator weights, e.g. "login=10,book=25"; empty uses the default
+    int clients = 200;         // Server benchmark connections
+    uint32_t passwordIterations = 0; // Work factor of generated accounts; 0 picks 1000, so large datasets build
+                                     // fast, except for the logins benchmark, which uses the application's
+    size_t loginWorkers = 0;   // Password check workers; 0 uses the application default
+    bool smoke = false;        // Runs each benchmark at a token size, only to check that it still works
+};
+
+// A fixed-size benchmark's size: as given, or a token share of it in a smoke run
+int benchmarkSize(const BenchmarkOptions &options, int full) {
+    return options.smoke ? std::max(full / 10000, 1) : full;
+}
+
+// Times a callable and returns the elapsed wall-clock nanoseconds
+template <typename Fn>
+double measureNanoseconds(Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+}
+
+// getById latency as the patient repository grows; should stay flat
+void runLookupBenchmark(const BenchmarkOptions &options) {
+    const int lookups = benchmarkSize(options, 1000000);
+    std::cout << "Repository size | ns per getById\n";
+    for (int fullSize : {1000, 10000, 100000, 1000000}) {
+        const int size = benchmarkSize(options, fullSize);
+        InMemoryPatientRepository repo;
+        for (int id = 1; id <= size; ++id) {
+            repo.add(Patient(id, "Patient " + std::to_string(id), id % 90, "Flu"));
+        }
+
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> pick(1, size);
+        std::vector<int> ids(lookups);
+        for (auto &id : ids) id = pick(rng);
+
+        long long checksum = 0;
+        double ns = measureNanoseconds([&] {
+            for (int id : ids) {
+                Patient* p = repo.getById(id);
+                if (p) checksum += p->getAge();
+            }
+        });
+        std::cout << std::setw(15) << size << " | " << std::fixed << std::setprecision(1)
+                  << ns / lookups << "  (checksum " << checksum << ")\n";
+    }
+}
+
+// Write-ahead log commit throughput for each fsync policy and thread count
+void runWalBenchmark(const BenchmarkOptions &benchmark) {
+    const std::string path = "wal_benchmark.tmp";
+    std::string payload;
+    BinaryWriter out(payload);
+    EntityCodec<Patient>::encode(out, Patient(1, "Benchmark Patient", 42, "Hypertension",
+                                              "555-0100", "1 Main St", "O+"));
+
+    struct Mode { const char *name; FsyncPolicy policy; int commitsPerThread; };
+    const Mode modes[] = {
+        {"always", FsyncPolicy::Always, 2000},
+        {"interval", FsyncPolicy::Interval, 200000},
+        {"never", FsyncPolicy::Never, 200000},
+    };
+
+    std::cout << "fsync mode | threads | commits/sec\n";
+    for (const auto &mode : modes) {
+        for (int threads : {1, 8}) {
+            std::remove(path.c_str());
+            const int commitsPerThread = benchmarkSize(benchmark, mode.commitsPerThread);
+            WalOptions options;
+            options.policy = mode.policy;
+            double ns = measureNanoseconds([&] {
+                WriteAheadLog log(path, options);
+                std::vector<std::thread> workers;
+                for (int t = 0; t < threads; ++t) {
+                    workers.emplace_back([&] {
+                        for (int i = 0; i < commitsPerThread; ++i) {
+                            log.recordPut(EntityKind::Patient, payload);
+                        }
+                    });
+                }
+                for (auto &w : workers) w.join();
+            }); // Includes the final flush performed on close
+            double commits = static_cast<double>(threads) * commitsPerThread;
+            std::cout << std::setw(10) << mode.name << " | " << std::setw(7) << threads << " | "
+                      << std::fixed << std::setprecision(0) << commits / (ns / 1e9) << "\n";
+        }
+    }
+    std::remove(path.c_str());
+}
+
+// Startup cost for 1M patients: mapped snapshot vs. replaying the log
+void runSnapshotBenchmark(const BenchmarkOptions &benchmark) {
+    const int patients = benchmarkSize(benchmark, 1000000);
+    const std::string walPath = "snapshot_benchmark.wal";
+    const std::string snapPath = "snapshot_benchmark.bin";
+    std::remove(walPath.c_str());
+
+    {
+        InMemoryPatientRepository repo;
+        WalOptions options;
+        options.policy = FsyncPolicy::Never;
+        auto log = std::make_shared<WriteAheadLog>(walPath, options);
+        repo.attachJournal(log);
+        for (int id = 1; id <= patients; ++id) {
+            repo.add(Patient(id, "Patient " + std::to_string(id), id % 90, "Disease " + std::to_string(id % 50),
+                             "555-0100", "1 Main St", "O+"));
+        }
+        repo.attachJournal(nullptr);
+        SnapshotWriter writer;
+        writer.addTable(repo.getAll());
+        writer.setNextId(EntityKind::Patient, patients + 1);
+        double ns = measureNanoseconds([&] { writer.write(snapPath); });
+        std::cout << "Checkpoint write:             " << std::fixed << std::setprecision(1) << ns / 1e6 << " ms\n";
+    }
+
+    double openNs = measureNanoseconds([&] { MappedSnapshot snapshot(snapPath, false); });
+    std::cout << "Map snapshot (header only):   " << openNs / 1e6 << " ms\n";
+    double verifyNs = measureNanoseconds([&] { MappedSnapshot snapshot(snapPath, true); });
+    std::cout << "Map snapshot + verify CRCs:   " << verifyNs / 1e6 << " ms\n";
+
+    {
+        MappedSnapshot snapshot(snapPath, false);
+        std::unique_ptr<Patient> found;
+        const int lookups = benchmarkSize(benchmark, 100000);
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<int> pick(1, patients);
+        long long checksum = 0;
+        double ns = measureNanoseconds([&] {
+            for (int i = 0; i < lookups; ++i) {
+                if (snapshot.findById<Patient>(pick(rng), found)) checksum += found->getAge();
+            }
+        });
+        std::cout << "Query mapped file by ID:      " << ns / lookups << " ns/lookup (checksum " << checksum << ")\n";
+    }
+
+    double hydrateNs = measureNanoseconds([&] {
+        InMemoryPatientRepository repo;
+        MappedSnapshot snapshot(snapPath, true);
+        snapshot.loadInto<Patient>(repo);
+    });
+    std::cout << "Hydrate repository from map:  " << hydrateNs / 1e6 << " ms\n";
+
+    double replayNs = measureNanoseconds([&] {
+        InMemoryPatientRepository repo;
+        WriteAheadLog::replay(walPath, [&](EntityKind, WalOp op, BinaryReader &in) {
+            applyJournalRecord<Patient>(repo, op, in);
+        });
+    });
+    std::cout << "Replay write-ahead log:       " << replayNs / 1e6 << " ms\n";
+
+    std::remove(walPath.c_str());
+    std::remove(snapPath.c_str());
+}
+
+// Front-desk throughput on shared sharded repositories: each thread plays a
+// session mixing bookings, bills and lookups against the same services
+void runConcurrencyBenchmark(const BenchmarkOptions &options) {
+    const int patients = benchmarkSize(options, 20000);
+    const int doctors = benchmarkSize(options, 500);
+    const int opsPerThread = benchmarkSize(options, 200000);
+
+    std::vector<std::string> dates;
+    for (int month = 1; month <= 12; ++month) {
+        for (int day = 1; day <= 28; ++day) {
+            std::ostringstream date;
+            date << "2026-" << std::setw(2) << std::setfill('0') << month << '-'
+                 << std::setw(2) << std::setfill('0') << day;
+            dates.push_back(date.str());
+        }
+    }
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "Hardware threads: " << cores << "\n";
+    std::cout << "threads | ops/sec    | speedup | booked | checksum\n";
+    double baseline = 0.0;
+    for (int threads : {1, 2, 4, 8}) {
+        auto logger = std::make_shared<NullLogger>();
+        auto display = std::make_shared<SilentDisplayManager>();
+        auto patientRepo = std::make_shared<ConcurrentPatientRepository>();
+        auto doctorRepo = std::make_shared<ConcurrentDoctorRepository>();
+        auto apptRepo = std::make_shared<ConcurrentAppointmentRepository>();
+        auto billRepo = std::make_shared<ConcurrentBillRepository>();
+        PatientService patientService(patientRepo, logger, display);
+        DoctorService doctorService(doctorRepo, logger, display);
+        AppointmentService appointmentService(apptRepo, patientService, doctorService, logger, display);
+        BillingService billingService(billRepo, patientService, doctorService, logger, display);
+        for (int i = 0; i < patients; ++i) patientService.addPatient("Patient", 20 + i % 60, "Flu");
+        for (int i = 0; i < doctors; ++i) doctorService.addDoctor("Doctor", "General", "", "", Money::fromCents(10000));
+
+        std::atomic<long long> checksumTotal(0);
+        double ns = measureNanoseconds([&] {
+            std::vector<std::thread> sessions;
+            for (int t = 0; t < threads; ++t) {
+                sessions.emplace_back([&, t] {
+                    std::mt19937 rng(1000 + t);
+                    std::uniform_int_distribution<int> pickPatient(1, patients);
+                    std::uniform_int_distribution<int> pickDoctor(1, doctors);
+                    std::uniform_int_distribution<size_t> pickDate(0, dates.size() - 1);
+                    std::uniform_int_distribution<int> pickSlot(0, TimeSlotCount - 1);
+                    std::uniform_int_distribution<int> pickOp(0, 9);
+                    long long checksum = 0;
+                    for (int i = 0; i < opsPerThread; ++i) {
+                        int op = pickOp(rng);
+                        if (op < 3) {
+                            appointmentService.bookAppointment(pickPatient(rng), pickDoctor(rng),
+                                                               dates[pickDate(rng)], TimeSlots[pickSlot(rng)]);
+                        } else if (op < 5) {
+                            billingService.generateBill(pickPatient(rng), dates[pickDate(rng)], Money::fromCents(10000),
+                                                         Money::fromCents(2500));
+                        } else if (op < 8) {
+                            patientRepo->inspect(pickPatient(rng), [&](const Patient &p) { checksum += p.getAge(); });
+                        } else {
+                            checksum += apptRepo->findFreeSlots(pickDoctor(rng), dates[pickDate(rng)]).size();
+                        }
+                    }
+                    checksumTotal.fetch_add(checksum, std::memory_order_relaxed);
+                });
+            }
+            for (auto &s : sessions) s.join();
+        });
+
+        double opsPerSec = static_cast<double>(threads) * opsPerThread / (ns / 1e9);
+        if (threads == 1) baseline = opsPerSec;
+        std::cout << std::setw(7) << threads << " | " << std::setw(10) << std::fixed << std::setprecision(0)
+                  << opsPerSec << " | " << std::setw(6) << std::setprecision(2) << opsPerSec / baseline
+                  << "x | " << std::setw(6) << apptRepo->getAll().size() << " | " << checksumTotal.load() << "\n";
+    }
+}
+
+#ifdef HMS_COUNT_ALLOCATIONS
+// Counts every heap allocation in the process, for the allocation benchmark
+std::atomic<size_t> heapAllocationCount(0);
+
+void *operator new(std::size_t size) {
+    heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+// GCC cannot tell these replace the global operators and flags the free()
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+#pragma GCC diagnostic pop
+
+inline size_t heapAllocations() { return heapAllocationCount.load(std::memory_order_relaxed); }
+const bool CountingAllocations = true;
+#else
+inline size_t heapAllocations() { return 0; }
+const bool CountingAllocations = false;
+#endif
+
+// Heap allocations per scan-style query on the in-memory repositories,
+// visiting in place versus the copying find* helpers
+void runAllocationBenchmark(const BenchmarkOptions &options) {
+    const int records = benchmarkSize(options, 100000);
+    const int iterations = benchmarkSize(options, 20);
+    if (!CountingAllocations) {
+        std::cout << "Built without -DHMS_COUNT_ALLOCATIONS; allocation counts will read 0.\n";
+    }
+
+    InMemoryPatientRepository patients;
+    InMemoryDoctorRepository doctors;
+    InMemoryAppointmentRepository appointments;
+    InMemoryMedicationRepository medications;
+    InMemoryPrescriptionRepository prescriptions;
+    InMemoryBillRepository bills;
+    InMemoryUserRepository users;
+    const char *const diseases[] = {"Hypertension", "Diabetes", "Asthma", "Influenza", "Migraine"};
+    const char *const specializations[] = {"Cardiology", "Neurology", "Pediatrics", "Oncology"};
+    const char *const statuses[] = {"Scheduled", "Completed", "Cancelled"};
+    const char *const roles[] = {"Admin", "Doctor", "Reception"};
+    for (int id = 1; id <= records; ++id) {
+        std::string date = "2026-03-" + std::string(id % 28 < 9 ? "0" : "") + std::to_string(id % 28 + 1);
+        patients.add(Patient(id, "Patient number " + std::to_string(id), id % 90, diseases[id % 5],
+                             "555-0100", "1 Main Street, Springfield", "O+"));
+        appointments.add(Appointment(id, id, id % 500 + 1, date, TimeSlots[id % TimeSlotCount],
+                                     statuses[id % 3], "Follow-up visit"));
+        prescriptions.add(Prescription(id, id, id % 500 + 1, date, {1, 2, 3}, "Twice daily after meals"));
+        bills.add(Bill(id, id, date, Money::fromCents(10000), Money::fromCents(2000), Money::fromCents(500),
+                       id % 2 ? "Paid" : "Pending", "Card"));
+        if (id <= 500) {
+            doctors.add(Doctor(id, "Doctor number " + std::to_string(id), specializations[id % 4],
+                               "555-0101", "doctor@hospital.example", Money::fromCents(10000)));
+            medications.add(Medication(id, "Medication number " + std::to_string(id), "10mg", Money::fromCents(450)));
+            users.add(User(id, "user-account-" + std::to_string(id), "hash", roles[id % 3]));
+        }
+    }
+
+    const std::string disease = "Asthma", specialization = "Neurology", date = "2026-03-14";
+    const std::string status = "Completed", paymentStatus = "Pending", role = "Doctor";
+    const std::string username = "user-account-499", medication = "Medication number 499";
+    long long checksum = 0;
+    struct Query {
+        const char *name;
+        std::function<void()> visit;
+        std::function<void()> copy;
+    };
+    const Query queries[] = {
+        {"patients by disease",
+         [&] { patients.forEachByDisease(disease, [&](const Patient &p) { checksum += p.getId(); }); },
+         [&] { checksum += patients.findByDisease(disease).size(); }},
+        {"patients by age range",
+         [&] { patients.forEachInAgeRange(30, 40, [&](const Patient &p) { checksum += p.getId(); }); },
+         [&] { checksum += patients.findByAgeRange(30, 40).size(); }},
+        {"doctors by specialization",
+         [&] { doctors.forEachBySpecialization(specialization, [&](const Doctor &d) { checksum += d.getId(); }); },
+         [&] { checksum += doctors.findBySpecialization(specialization).size(); }},
+        {"available doctors",
+         [&] { doctors.forEachAvailable([&](const Doctor &d) { checksum += d.getId(); }); },
+         [&] { checksum += doctors.findAvailableDoctors().size(); }},
+        {"appointments by patient",
+         [&] { appointments.forEachByPatientId(777, [&](const Appointment &a) { checksum += a.getAppointmentId(); }); },
+         [&] { checksum += appointments.findByPatientId(777).size(); }},
+        {"appointments by date",
+         [&] { appointments.forEachByDate(date, [&](const Appointment &a) { checksum += a.getAppointmentId(); }); },
+         [&] { checksum += appointments.findByDate(date).size(); }},
+        {"appointments by status",
+         [&] { appointments.forEachByStatus(status, [&](const Appointment &a) { checksum += a.getAppointmentId(); }); },
+         [&] { checksum += appointments.findByStatus(status).size(); }},
+        {"prescriptions by doctor",
+         [&] { prescriptions.forEachByDoctorId(42, [&](const Prescription &p) { checksum += p.getPrescriptionId(); }); },
+         [&] { checksum += prescriptions.findByDoctorId(42).size(); }},
+        {"bills by payment status",
+         [&] { bills.forEachByPaymentStatus(paymentStatus, [&](const Bill &b) { checksum += b.getBillId(); }); },
+         [&] { checksum += bills.findByPaymentStatus(paymentStatus).size(); }},
+        {"users by role",
+         [&] { users.forEachByRole(role, [&](const User &u) { checksum += u.getUserId(); }); },
+         [&] { checksum += users.findByRole(role).size(); }},
+        {"user by username",
+         [&] { checksum += users.findByUsername(username) != nullptr; },
+         [&] { checksum += users.findByUsername(username) != nullptr; }},
+        {"medication by name",
+         [&] { checksum += medications.findByName(medication) != nullptr; },
+         [&] { checksum += medications.findByName(medication) != nullptr; }},
+        {"total revenue",
+         [&] { checksum += bills.getTotalRevenue().getCents(); },
+         [&] { checksum += bills.getTotalRevenue().getCents(); }},
+    };
+
+    std::cout << "Query                     | allocs (visit) | allocs (copy) | us/query (visit)\n";
+    for (const auto &query : queries) {
+        size_t before = heapAllocations();
+        double ns = measureNanoseconds([&] {
+            for (int i = 0; i < iterations; ++i) query.visit();
+        });
+        size_t visitAllocs = heapAllocations() - before;
+        before = heapAllocations();
+        for (int i = 0; i < iterations; ++i) query.copy();
+        size_t copyAllocs = heapAllocations() - before;
+        std::cout << std::left << std::setw(25) << query.name << std::right << " | "
+                  << std::setw(14) << visitAllocs / iterations << " | "
+                  << std::setw(13) << copyAllocs / iterations << " | "
+                  << std::fixed << std::setprecision(1) << ns / iterations / 1e3 << "\n";
+    }
+    std::cout << "(checksum " << checksum << ")\n";
+}
+
+// Summing bill amounts as doubles versus as integer cents: speed, and
+// whether the total depends on the order the amounts are added in
+void runMoneyBenchmark(const BenchmarkOptions &options) {
+    const size_t count = static_cast<size_t>(benchmarkSize(options, 10000000));
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int64_t> pickCents(1, 500000);
+    std::uniform_int_distribution<uint32_t> pickStatus(0, 2);
+    std::vector<int64_t> cents(count);
+    std::vector<double> amounts(count);
+    std::vector<uint32_t> statuses(count);
+    for (size_t i = 0; i < count; ++i) {
+        cents[i] = pickCents(rng);
+        amounts[i] = Money::fromCents(cents[i]).toDouble();
+        statuses[i] = pickStatus(rng);
+    }
+
+    double forward = 0.0, backward = 0.0;
+    int64_t exact = 0, matching = 0;
+    double forwardNs = measureNanoseconds([&] {
+        for (size_t i = 0; i < count; ++i) forward += amounts[i];
+    });
+    double backwardNs = measureNanoseconds([&] {
+        for (size_t i = count; i-- > 0;) backward += amounts[i];
+    });
+    double exactNs = measureNanoseconds([&] { exact = sumCents(cents.data(), count); });
+    double matchingNs = measureNanoseconds([&] {
+        matching = sumCentsWhere(cents.data(), statuses.data(), 1, count);
+    });
+
+    std::cout << "Summing " << count << " amounts\n" << std::fixed << std::setprecision(2);
+    std::cout << "double, forward:     " << std::setw(8) << forwardNs / 1e6 << " ms  total "
+              << std::setprecision(6) << forward << std::setprecision(2) << "\n";
+    std::cout << "double, backward:    " << std::setw(8) << backwardNs / 1e6 << " ms  total "
+              << std::setprecision(6) << backward << std::setprecision(2) << "\n";
+    std::cout << "cents:               " << std::setw(8) << exactNs / 1e6 << " ms  total "
+              << Money::fromCents(exact) << "\n";
+    std::cout << "cents, one status:   " << std::setw(8) << matchingNs / 1e6 << " ms  total "
+              << Money::fromCents(matching) << "\n";
+}
+
+// Finance scans over 10M bills: the row-by-row loop over stored Bill
+// objects that getTotalRevenue used to run, against the columnar store's
+// scalar and AVX2 kernels
+void runColumnarBenchmark(const BenchmarkOptions &options) {
+    const int count = benchmarkSize(options, 10000000);
+    const int firstDay = parseDayNumber("2016-01-01"), lastDay = parseDayNumber("2025-12-31");
+    const Symbol pending = symbols().intern("Pending");
+    const char *const paymentStatuses[] = {"Paid", "Pending", "Overdue"};
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> pickDay(firstDay, lastDay);
+    std::uniform_int_distribution<int64_t> pickCents(1000, 50000);
+
+    IdIndexedStore<Bill> rows;
+    BillColumns columns;
+    columns.reserve(count);
+    for (int id = 1; id <= count; ++id) {
+        Bill bill(id, id % 100000 + 1, pickDay(rng), Money::fromCents(pickCents(rng)),
+                  Money::fromCents(pickCents(rng) / 10), Money(), paymentStatuses[id % 3]);
+        rows.add(id, bill);
+        columns.upsert(bill);
+    }
+
+    const DayRange allDays = {InvalidDay + 1, std::numeric_limits<int32_t>::max()};
+    const DayRange lastQuarter = {lastDay - 89, lastDay};
+    const std::vector<int> ageBounds = {0, 31, 61, 91, 181, 366};
+    const std::vector<DayRange> aging = agingRanges(lastDay, ageBounds);
+
+    struct Query {
+        const char *name;
+        StatusSelect select;
+        std::vector<DayRange> ranges;
+    };
+    const Query queries[] = {
+        {"total revenue", StatusSelect::any(), {allDays}},
+        {"pending, last 90 days", StatusSelect::only(pending), {lastQuarter}},
+        {"pending aging (6 buckets)", StatusSelect::only(pending), aging},
+    };
+
+    std::cout << "Query                      | rows (ms) | columns scalar (ms) | columns AVX2 (ms)\n";
+    for (const Query &query : queries) {
+        std::vector<ColumnTotal> byRow(query.ranges.size()), scalar(query.ranges.size()), simd(query.ranges.size());
+        double rowNs = measureNanoseconds([&] {
+            for (const Bill &bill : rows) {
+                if ((bill.getPaymentStatusSymbol() & query.select.mask) != query.select.value) continue;
+                for (size_t r = 0; r < query.ranges.size(); ++r) {
+                    if (bill.getDay() >= query.ranges[r].from && bill.getDay() <= query.ranges[r].to) {
+                        byRow[r].count += 1;
+                        byRow[r].cents += bill.getTotalAmount().getCents();
+                    }
+                }
+            }
+        });
+        double scalarNs = measureNanoseconds([&] {
+            sumByDayRangesScalar(columns.view(), query.select, query.ranges.data(), query.ranges.size(),
+                                 scalar.data());
+        });
+        double simdNs = -1.0;
+#ifdef HMS_HAVE_AVX2
+        if (cpuHasAvx2()) {
+            simdNs = measureNanoseconds([&] {
+                sumByDayRanges(columns.view(), query.select, query.ranges.data(), query.ranges.size(), simd.data());
+            });
+        }
+#endif
+        bool agree = true;
+        for (size_t r = 0; r < query.ranges.size(); ++r) {
+            agree = agree && byRow[r].cents == scalar[r].cents && byRow[r].count == scalar[r].count &&
+                    (simdNs < 0 || (simd[r].cents == scalar[r].cents && simd[r].count == scalar[r].count));
+        }
+        std::cout << std::left << std::setw(26) << query.name << std::right << " | " << std::fixed
+                  << std::setprecision(1) << std::setw(9) << rowNs / 1e6 << " | " << std::setw(19)
+                  << scalarNs / 1e6 << " | ";
+        if (simdNs < 0) {
+            std::cout << std::setw(17) << "n/a";
+        } else {
+            std::cout << std::setw(17) << simdNs / 1e6;
+        }
+        std::cout << "  total $" << Money::fromCents(scalar[0].cents) << (agree ? "" : "  MISMATCH") << "\n";
+    }
+}
+
+// Random numbers for generated data. Only the engine's raw output is used,
+// never the standard distributions, whose results differ between library
+// implementations, so a seed gives the same dataset everywhere.
+class DatasetRandom {
+private:
+    std::mt19937 engine;
+
+public:
+    explicit DatasetRandom(uint32_t seed) : engine(seed) {}
+
+    uint32_t below(uint32_t bound) { return static_cast<uint32_t>((uint64_t(engine()) * bound) >> 32); }
+    int between(int low, int high) { return low + static_cast<int>(below(static_cast<uint32_t>(high - low + 1))); }
+    double unit() { return engine() / 4294967296.0; }
+    bool chance(double probability) { return unit() < probability; }
+};
+
+// Picks ranks 0..n-1 with probability proportional to 1 / (rank + 1)^exponent,
+// so a handful of ranks get most of the picks
+class ZipfPicker {
+private:
+    std::vector<double> cumulative;
+
+public:
+    ZipfPicker(size_t count, double exponent) : cumulative(count) {
+        double total = 0.0;
+        for (size_t rank = 0; rank < count; ++rank) {
+            total += 1.0 / std::pow(static_cast<double>(rank + 1), exponent);
+            cumulative[rank] = total;
+        }
+    }
+
+    size_t operator()(DatasetRandom &random) const {
+        double target = random.unit() * cumulative.back();
+        size_t rank = std::upper_bound(cumulative.begin(), cumulative.end(), target) - cumulative.begin();
+        return std::min(rank, cumulative.size() - 1);
+    }
+};
+
+// Record counts for a generated hospital, proportional to its patient count
+struct DatasetScale {
+    int patients, doctors, medications, appointments, prescriptions, bills, users;
+
+    static DatasetScale forPatients(int patients) {
+        DatasetScale scale;
+        scale.patients = std::max(patients, 10);
+        scale.doctors = std::max(scale.patients / 100, 3);
+        scale.medications = std::max(scale.patients / 50, 3);
+        scale.appointments = scale.patients * 3;
+        scale.prescriptions = scale.patients;
+        scale.bills = scale.patients * 2;
+        scale.users = scale.doctors + std::max(scale.patients / 1000, 2) + 1;
+        return scale;
+    }
+};
+
+struct HospitalRepositories {
+    std::shared_ptr<IPatientRepository> patients;
+    std::shared_ptr<IDoctorRepository> doctors;
+    std::shared_ptr<IAppointmentRepository> appointments;
+    std::shared_ptr<IMedicationRepository> medications;
+    std::shared_ptr<IPrescriptionRepository> prescriptions;
+    std::shared_ptr<IBillRepository> bills;
+    std::shared_ptr<IUserRepository> users;
+
+    explicit HospitalRepositories(bool concurrent)
+        : patients(makeRepository<IPatientRepository, ConcurrentPatientRepository, InMemoryPatientRepository>(concurrent)),
+          doctors(makeRepository<IDoctorRepository, ConcurrentDoctorRepository, InMemoryDoctorRepository>(concurrent)),
+          appointments(makeRepository<IAppointmentRepository, ConcurrentAppointmentRepository,
+                                      InMemoryAppointmentRepository>(concurrent)),
+          medications(makeRepository<IMedicationRepository, ConcurrentMedicationRepository,
+                                     InMemoryMedicationRepository>(concurrent)),
+          prescriptions(makeRepository<IPrescriptionRepository, ConcurrentPrescriptionRepository,
+                                       InMemoryPrescriptionRepository>(concurrent)),
+          bills(makeRepository<IBillRepository, ConcurrentBillRepository, InMemoryBillRepository>(concurrent)),
+          users(makeRepository<IUserRepository, ConcurrentUserRepository, InMemoryUserRepository>(concurrent)) {}
+};
+
+// Fills repositories with a synthetic hospital. The same seed and scale
+// always give the same records. Popularity is skewed as in a real hospital:
+// a few diseases, specializations, doctors, medications and frequent
+// patients account for most records. IDs run from 1 in each repository.
+class HospitalDataGenerator {
+public:
+    // Dates span two years from this day
+    static const char *firstDate() { return "2025-01-01"; }
+    static const int Days = 730;
+
+    static const std::vector<std::string> &diseases() {
+        static const std::vector<std::string> names = {
+            "Hypertension", "Diabetes", "Asthma", "Flu", "Migraine", "Arthritis", "Bronchitis",
+            "Allergy", "Anemia", "Back Pain", "Depression", "Eczema", "Gastritis", "Insomnia",
+            "Obesity", "Pneumonia", "Sinusitis", "Tonsillitis", "Thyroid Disorder", "Fracture"};
+        return names;
+    }
+
+    static const std::vector<std::string> &specializations() {
+        static const std::vector<std::string> names = {
+            "General Medicine", "Pediatrics", "Cardiology", "Orthopedics", "Dermatology", "Neurology",
+            "Gynecology", "Psychiatry", "Ophthalmology", "ENT", "Oncology", "Endocrinology"};
+        return names;
+    }
+
+    HospitalDataGenerator(uint32_t seed, const DatasetScale &scale, uint32_t passwordIterations = 1000)
+        : seed(seed), scale(scale), passwordIterations(passwordIterations) {}
+
+    void populate(HospitalRepositories &repos) const {
+        DatasetRandom random(seed);
+        const int firstDay = parseDayNumber(firstDate());
+        ZipfPicker pickDisease(diseases().size(), 1.1);
+        ZipfPicker pickSpecialization(specializations().size(), 1.0);
+        ZipfPicker pickDoctor(scale.doctors, 0.8);
+        ZipfPicker pickPatient(scale.patients, 0.6);
+        ZipfPicker pickMedication(scale.medications, 1.0);
+
+        static const char *const bloodGroups[] = {"O+", "A+", "B+", "AB+", "O-", "A-", "B-", "AB-"};
+        static const double bloodGroupShare[] = {0.38, 0.34, 0.09, 0.03, 0.07, 0.06, 0.02, 0.01};
+        for (int id = 1; id <= scale.patients; ++id) {
+            // Children, adults and the elderly, weighted toward adults
+            double band = random.unit();
+            int age = band < 0.2 ? random.between(0, 17) : band < 0.75 ? random.between(18, 64) : random.between(65, 99);
+            double bloodDraw = random.unit();
+            size_t blood = 0;
+            while (blood + 1 < 8 && bloodDraw >= bloodGroupShare[blood]) bloodDraw -= bloodGroupShare[blood++];
+            repos.patients->add(Patient(id, "Patient " + std::to_string(id), age, diseases()[pickDisease(random)],
+                                        "555-" + std::to_string(1000000 + id), std::to_string(id) + " Main St",
+                                        bloodGroups[blood]));
+        }
+
+        for (int id = 1; id <= scale.doctors; ++id) {
+            Doctor doctor(id, "Dr. Generated " + std::to_string(id), specializations()[pickSpecialization(random)],
+                          "555-" + std::to_string(2000000 + id), "doctor" + std::to_string(id) + "@hospital.example",
+                          Money::fromCents(random.between(10, 60) * 500));
+            doctor.setAvailability(random.chance(0.9));
+            repos.doctors->add(doctor);
+        }
+
+        for (int id = 1; id <= scale.medications; ++id) {
+            repos.medications->add(Medication(id, "Medication " + std::to_string(id),
+                                              std::to_string(random.between(1, 20) * 25) + "mg",
+                                              Money::fromCents(random.between(100, 20000)), "Generic"));
+        }
+
+        // Busy doctors fill up, so a booking retries a few other slots first
+        static const char *const appointmentStatuses[] = {"Scheduled", "Completed", "Cancelled"};
+        int appointmentId = 0;
+        for (int n = 0; n < scale.appointments; ++n) {
+            int doctorId = static_cast<int>(pickDoctor(random)) + 1;
+            int patientId = static_cast<int>(pickPatient(random)) + 1;
+            for (int attempt = 0; attempt < 8; ++attempt) {
+                int day = firstDay + random.between(0, Days - 1);
+                int slot = random.between(0, TimeSlotCount - 1);
+                std::string date = formatDayNumber(day);
+                if (repos.appointments->isSlotBooked(doctorId, date, TimeSlots[slot])) continue;
+                double draw = random.unit();
+                const char *status = appointmentStatuses[draw < 0.6 ? 0 : draw < 0.9 ? 1 : 2];
+                repos.appointments->add(Appointment(++appointmentId, patientId, doctorId, day, slot, status));
+                break;
+            }
+        }
+
+        for (int id = 1; id <= scale.prescriptions; ++id) {
+            std::vector<int> medicationIds;
+            for (int count = random.between(1, 4); count > 0; --count) {
+                medicationIds.push_back(static_cast<int>(pickMedication(random)) + 1);
+            }
+            repos.prescriptions->add(Prescription(id, static_cast<int>(pickPatient(random)) + 1,
+                                                  static_cast<int>(pickDoctor(random)) + 1,
+                                                  firstDay + random.between(0, Days - 1), medicationIds,
+                                                  "Take as directed"));
+        }
+
+        static const char *const methods[] = {"Card", "Cash", "Insurance"};
+        for (int id = 1; id <= scale.bills; ++id) {
+            double draw = random.unit();
+            const char *status = draw < 0.7 ? "Paid" : draw < 0.92 ? "Pending" : "Overdue";
+            double methodDraw = random.unit();
+            const char *method = (draw >= 0.7) ? "" : methods[methodDraw < 0.5 ? 0 : methodDraw < 0.7 ? 1 : 2];
+            repos.bills->add(Bill(id, static_cast<int>(pickPatient(random)) + 1, firstDay + random.between(0, Days - 1),
+                                  Money::fromCents(random.between(10, 60) * 500),
+                                  Money::fromCents(random.chance(0.6) ? random.between(100, 30000) : 0),
+                                  Money::fromCents(random.chance(0.2) ? random.between(500, 100000) : 0),
+                                  status, method));
+        }
+
+        // One admin, one account per doctor, the rest receptionists
+        for (int id = 1; id <= scale.users; ++id) {
+            const char *role = id == 1 ? "Admin" : id <= scale.doctors + 1 ? "Doctor" : "Receptionist";
+            std::string username = id == 1 ? "admin" : std::string(role == std::string("Doctor") ? "doctor" : "reception") +
+                                                        std::to_string(id);
+            // Salted from the seed too, so a seed still gives identical data
+            std::string salt;
+            while (salt.size() < PasswordSaltSize) salt.push_back(static_cast<char>(random.below(256)));
+            repos.users->add(User(id, username, hashPasswordWithSalt("password" + std::to_string(id), salt,
+                                                                     passwordIterations), role));
+        }
+    }
+
+private:
+    uint32_t seed;
+    DatasetScale scale;
+    uint32_t passwordIterations;
+};
+
+const int HospitalDataGenerator::Days;
+
+// Services over generated repositories, wired as the application wires them
+// but with silent logging and, unless told otherwise, a silent display
+struct BenchmarkHospital {
+    HospitalRepositories repos;
+    DatasetScale scale;
+    std::shared_ptr<NullLogger> logger;
+    std::shared_ptr<IDisplayManager> display;
+    AuthenticationService authService;
+    PatientService patientService;
+    DoctorService doctorService;
+    AppointmentService appointmentService;
+    MedicationService medicationService;
+    PrescriptionService prescriptionService;
+    BillingService billingService;
+
+    static uint32_t generatedPasswordIterations(const BenchmarkOptions &options) {
+        return options.passwordIterations > 0 ? options.passwordIterations : 1000;
+    }
+
+    static AuthenticationOptions authenticationOptions(const BenchmarkOptions &options) {
+        AuthenticationOptions auth;
+        auth.passwordIterations = generatedPasswordIterations(options);
+        auth.verifierThreads = options.loginWorkers;
+        return auth;
+    }
+
+    BenchmarkHospital(const BenchmarkOptions &options,
+                      std::shared_ptr<IDisplayManager> display = std::make_shared<SilentDisplayManager>())
+        : repos(options.concurrentRepositories), scale(DatasetScale::forPatients(options.scale)),
+          logger(std::make_shared<NullLogger>()), display(display),
+          authService(repos.users, logger, authenticationOptions(options)),
+          patientService(repos.patients, logger, display),
+          doctorService(repos.doctors, logger, display),
+          appointmentService(repos.appointments, patientService, doctorService, logger, display),
+          medicationService(repos.medications, logger, display),
+          prescriptionService(repos.prescriptions, patientService, doctorService, medicationService, logger, display),
+          billingService(repos.bills, patientService, doctorService, logger, display) {
+        HospitalDataGenerator(options.seed, scale, generatedPasswordIterations(options)).populate(repos);
+        authService.resumeIdsAfter(scale.users);
+        patientService.resumeIdsAfter(scale.patients);
+        doctorService.resumeIdsAfter(scale.doctors);
+        appointmentService.resumeIdsAfter(scale.appointments);
+        medicationService.resumeIdsAfter(scale.medications);
+        prescriptionService.resumeIdsAfter(scale.prescriptions);
+        billingService.resumeIdsAfter(scale.bills);
+    }
+};
+
+struct BenchmarkResult {
+    std::string group;
+    std::string name;
+    long long iterations;
+    double nsPerOp;
+};
+
+// Times one operation at a time. Iterations grow until a run lasts at least
+// minNanoseconds, and that run is reported. Operations fold their results
+// into sink so the compiler cannot drop them.
+class MicroBenchmarkRunner {
+private:
+    std::vector<BenchmarkResult> results;
+    double minNanoseconds;
+
+public:
+    long long sink = 0;
+
+    explicit MicroBenchmarkRunner(double minNanoseconds = 2e8) : minNanoseconds(minNanoseconds) {}
+
+    template <typename Op>
+    void run(const char *group, const std::string &name, Op op) {
+        long long iterations = 1;
+        double ns = 0.0;
+        for (;;) {
+            ns = measureNanoseconds([&] {
+                for (long long i = 0; i < iterations; ++i) op(i);
+            });
+            if (ns >= minNanoseconds || iterations >= (1LL << 32)) break;
+            iterations *= ns * 50 < minNanoseconds ? 10 : 2;
+        }
+        results.push_back(BenchmarkResult{group, name, iterations, ns / iterations});
+        std::cout << std::left << std::setw(11) << group << std::setw(44) << name << std::right
+                  << std::setw(12) << std::fixed << std::setprecision(1) << ns / iterations << " ns/op\n";
     }
-    
-    void listAppointmentsByDoctor() {
-        std::cout << "Enter Doctor ID: ";
-        int doctorId = readInt();
-        appointmentService.listAppointmentsByDoctor(doctorId);
+
+    const std::vector<BenchmarkResult> &getResults() const { return results; }
+};
+
+inline std::string jsonEscape(const std::string &text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        } else {
+            escaped += c;
+        }
     }
-    
-    void listAppointmentsByDate() {
-        std::string date = getDateInput();
-        appointmentService.listAppointmentsByDate(date);
+    return escaped;
+}
+
+void writeSuiteJson(std::ostream &out, const BenchmarkOptions &options, const DatasetScale &scale,
+                    const std::vector<BenchmarkResult> &results) {
+    out << "{\n"
+        << "  \"benchmark\": \"suite\",\n"
+        << "  \"seed\": " << options.seed << ",\n"
+        << "  \"repositories\": \"" << (options.concurrentRepositories ? "concurrent" : "inmemory") << "\",\n"
+        << "  \"dataset\": {\"patients\": " << scale.patients << ", \"doctors\": " << scale.doctors
+        << ", \"medications\": " << scale.medications << ", \"appointments\": " << scale.appointments
+        << ", \"prescriptions\": " << scale.prescriptions << ", \"bills\": " << scale.bills
+        << ", \"users\": " << scale.users << "},\n"
+        << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult &r = results[i];
+        out << "    {\"group\": \"" << jsonEscape(r.group) << "\", \"name\": \"" << jsonEscape(r.name)
+            << "\", \"iterations\": " << r.iterations << ", \"ns_per_op\": " << std::fixed
+            << std::setprecision(2) << r.nsPerOp << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+// Microbenchmarks for every repository query and the main service
+// operations, over a generated hospital of --scale patients
+void runSuiteBenchmark(const BenchmarkOptions &options) {
+    std::cout << "Generating dataset (seed " << options.seed << ", " << options.scale << " patients)...\n";
+    BenchmarkHospital hospital(options);
+    const DatasetScale &scale = hospital.scale;
+    HospitalRepositories &repos = hospital.repos;
+    MicroBenchmarkRunner runner(options.smoke ? 0.0 : 2e8); // A smoke run times each operation once
+    long long &sink = runner.sink;
+
+    // Spreads consecutive iterations over the ID space
+    auto pick = [](long long i, int count) { return static_cast<int>((uint64_t(i) * 2654435761u) % count) + 1; };
+    const int firstDay = parseDayNumber(HospitalDataGenerator::firstDate());
+    std::vector<std::string> dates;
+    for (int d = 0; d < HospitalDataGenerator::Days; ++d) dates.push_back(formatDayNumber(firstDay + d));
+    auto dateFor = [&](long long i) -> const std::string & { return dates[pick(i, HospitalDataGenerator::Days) - 1]; };
+    auto count = [&](const auto &) { ++sink; };
+    const std::string &topDisease = HospitalDataGenerator::diseases()[0];
+    const std::string &topSpecialization = HospitalDataGenerator::specializations()[0];
+
+    runner.run("repository", "patients.getById", [&](long long i) { sink += repos.patients->getById(pick(i, scale.patients)) != nullptr; });
+    runner.run("repository", "patients.inspect", [&](long long i) {
+        repos.patients->inspect(pick(i, scale.patients), [&](const Patient &p) { sink += p.getAge(); });
+    });
+    runner.run("repository", "patients.forEachByDisease (most common)", [&](long long) { repos.patients->forEachByDisease(topDisease, count); });
+    runner.run("repository", "patients.forEachByDisease (rarest)", [&](long long) {
+        repos.patients->forEachByDisease(HospitalDataGenerator::diseases().back(), count);
+    });
+    runner.run("repository", "patients.forEachInAgeRange (30-34)", [&](long long) { repos.patients->forEachInAgeRange(30, 34, count); });
+    runner.run("repository", "patients.countByAgeRange (18-64)", [&](long long) { sink += repos.patients->countByAgeRange(18, 64); });
+    runner.run("repository", "patients.update", [&](long long i) {
+        repos.patients->update(pick(i, scale.patients), [&](Patient &p) { p.setAge(p.getAge() % 100); });
+    });
+
+    runner.run("repository", "doctors.getById", [&](long long i) { sink += repos.doctors->getById(pick(i, scale.doctors)) != nullptr; });
+    runner.run("repository", "doctors.forEachBySpecialization", [&](long long) {
+        repos.doctors->forEachBySpecialization(topSpecialization, count);
+    });
+    runner.run("repository", "doctors.forEachAvailable", [&](long long) { repos.doctors->forEachAvailable(count); });
+
+    runner.run("repository", "appointments.getById", [&](long long i) {
+        sink += repos.appointments->getById(pick(i, scale.appointments)) != nullptr;
+    });
+    runner.run("repository", "appointments.forEachByPatientId", [&](long long i) {
+        repos.appointments->forEachByPatientId(pick(i, scale.patients), count);
+    });
+    runner.run("repository", "appointments.forEachByDoctorId (busiest)", [&](long long) {
+        repos.appointments->forEachByDoctorId(1, count);
+    });
+    runner.run("repository", "appointments.forEachByDate", [&](long long i) { repos.appointments->forEachByDate(dateFor(i), count); });
+    runner.run("repository", "appointments.forEachByStatus (Cancelled)", [&](long long) {
+        repos.appointments->forEachByStatus("Cancelled", count);
+    });
+    runner.run("repository", "appointments.forEachInDateRange (7 days)", [&](long long i) {
+        int day = firstDay + pick(i, HospitalDataGenerator::Days - 7);
+        repos.appointments->forEachInDateRange(day, day + 6, count);
+    });
+    runner.run("repository", "appointments.isSlotBooked", [&](long long i) {
+        sink += repos.appointments->isSlotBooked(pick(i, scale.doctors), dateFor(i), TimeSlots[i % TimeSlotCount]);
+    });
+    runner.run("repository", "appointments.findFreeSlots", [&](long long i) {
+        sink += repos.appointments->findFreeSlots(pick(i, scale.doctors), dateFor(i)).size();
+    });
+
+    runner.run("repository", "medications.getById", [&](long long i) {
+        sink += repos.medications->getById(pick(i, scale.medications)) != nullptr;
+    });
+    runner.run("repository", "medications.findByName", [&](long long i) {
+        sink += repos.medications->findByName("Medication " + std::to_string(pick(i, scale.medications))) != nullptr;
+    });
+
+    runner.run("repository", "prescriptions.forEachByPatientId", [&](long long i) {
+        repos.prescriptions->forEachByPatientId(pick(i, scale.patients), count);
+    });
+    runner.run("repository", "prescriptions.forEachByDoctorId", [&](long long i) {
+        repos.prescriptions->forEachByDoctorId(pick(i, scale.doctors), count);
+    });
+
+    runner.run("repository", "bills.forEachByPatientId", [&](long long i) { repos.bills->forEachByPatientId(pick(i, scale.patients), count); });
+    runner.run("repository", "bills.forEachByPaymentStatus (Overdue)", [&](long long) {
+        repos.bills->forEachByPaymentStatus("Overdue", count);
+    });
+    runner.run("repository", "bills.getTotalRevenue", [&](long long) { sink += repos.bills->getTotalRevenue().getCents(); });
+    runner.run("repository", "bills.getRevenueByPaymentStatus", [&](long long) { sink += repos.bills->getRevenueByPaymentStatus().size(); });
+    runner.run("repository", "bills.getRevenueForDateRange (30 days)", [&](long long i) {
+        int day = firstDay + pick(i, HospitalDataGenerator::Days - 30);
+        sink += repos.bills->getRevenueForDateRange(day, day + 29).bills;
+    });
+    runner.run("repository", "bills.getRevenueWhere (Pending, 30 days)", [&](long long i) {
+        int day = firstDay + pick(i, HospitalDataGenerator::Days - 30);
+        sink += repos.bills->getRevenueWhere("Pending", day, day + 29).bills;
+    });
+    runner.run("repository", "bills.getAging (Pending)", [&](long long) {
+        sink += repos.bills->getAging("Pending", firstDay + HospitalDataGenerator::Days, {0, 31, 61, 91}).size();
+    });
+
+    runner.run("repository", "users.findByUsername", [&](long long i) {
+        int id = pick(i, scale.users);
+        sink += repos.users->findByUsername(id == 1 ? "admin" : id <= scale.doctors + 1 ? "doctor" + std::to_string(id)
+                                                                                        : "reception" + std::to_string(id)) != nullptr;
+    });
+    runner.run("repository", "users.forEachByRole (Admin)", [&](long long) { repos.users->forEachByRole("Admin", count); });
+
+    runner.run("service", "patients.addPatient", [&](long long i) {
+        hospital.patientService.addPatient("Benchmark Patient", static_cast<int>(i % 90), topDisease);
+    });
+    // Every booking takes a slot that is still free, on an available doctor
+    // after the generated dates, so the run times successful bookings rather
+    // than conflicts with the ones made before it
+    std::vector<int> availableDoctors;
+    repos.doctors->forEachAvailable([&](const Doctor &d) { availableDoctors.push_back(d.getId()); });
+    std::vector<std::string> openDates;
+    long long bookings = 0;
+    if (!availableDoctors.empty()) runner.run("service", "appointments.bookAppointment", [&](long long i) {
+        long long n = bookings++;
+        size_t doctor = static_cast<size_t>(n % availableDoctors.size());
+        long long slot = n / static_cast<long long>(availableDoctors.size());
+        size_t day = static_cast<size_t>(slot / TimeSlotCount);
+        while (day >= openDates.size()) {
+            openDates.push_back(formatDayNumber(firstDay + HospitalDataGenerator::Days + static_cast<int>(openDates.size())));
+        }
+        hospital.appointmentService.bookAppointment(pick(i, scale.patients), availableDoctors[doctor], openDates[day],
+                                                    TimeSlots[slot % TimeSlotCount]);
+    });
+    runner.run("service", "appointments.updateAppointmentStatus", [&](long long i) {
+        hospital.appointmentService.updateAppointmentStatus(pick(i, scale.appointments), i % 2 ? "Completed" : "Scheduled");
+    });
+    runner.run("service", "prescriptions.createPrescription", [&](long long i) {
+        hospital.prescriptionService.createPrescription(pick(i, scale.patients), pick(i, scale.doctors), dateFor(i),
+                                                        {pick(i, scale.medications)}, "Take as directed");
+    });
+    runner.run("service", "billing.generateBill", [&](long long i) {
+        hospital.billingService.generateBill(pick(i, scale.patients), dateFor(i), Money::fromCents(10000),
+                                             Money::fromCents(2500));
+    });
+    runner.run("service", "billing.updateBillPaymentStatus", [&](long long i) {
+        hospital.billingService.updateBillPaymentStatus(pick(i, scale.bills), i % 2 ? "Paid" : "Pending", "Card");
+    });
+    runner.run("service", "auth.login+logout", [&](long long) {
+        SessionToken token = hospital.authService.login("admin", "password1");
+        sink += !token.isNull();
+        hospital.authService.logout(token);
+    });
+
+    std::cout << "(checksum " << sink << ")\n";
+    if (!options.jsonPath.empty()) {
+        std::ofstream json(options.jsonPath);
+        if (!json) throw std::runtime_error("Cannot write benchmark results to " + options.jsonPath);
+        writeSuiteJson(json, options, scale, runner.getResults());
+        std::cout << "Results written to " << options.jsonPath << "\n";
     }
-    
-    // Medication Management
-    void addMedication() {
-        std::cout << "Enter Medication Name: ";
-        std::string name = readLine();
-        std::cout << "Enter Dosage: ";
-        std::string dosage = readLine();
-        std::cout << "Enter Price: ";
-        double price = readDouble();
-        std::cout << "Enter Manufacturer (optional): ";
-        std::string manufacturer = readLine();
-        std::cout << "Enter Description (optional): ";
-        std::string description = readLine();
-        
-        medicationService.addMedication(name, dosage, price, manufacturer, description);
+}
+
+// Front-desk operations the load generator issues
+enum class LoadOperation { Login, Book, Prescription, Bill, Lookup, Count };
+
+inline const char *loadOperationName(LoadOperation op) {
+    static const char *const names[] = {"login", "book", "prescription", "bill", "lookup"};
+    return names[static_cast<int>(op)];
+}
+
+// Relative weights of each operation, parsed from "login=10,book=25,..."
+class LoadMix {
+private:
+    int weights[static_cast<int>(LoadOperation::Count)];
+    int total = 0;
+
+public:
+    LoadMix() : weights{10, 25, 15, 15, 35} { total = 100; }
+
+    static LoadMix parse(const std::string &spec) {
+        LoadMix mix;
+        std::fill(std::begin(mix.weights), std::end(mix.weights), 0);
+        std::istringstream fields(spec);
+        std::string field;
+        while (std::getline(fields, field, ',')) {
+            size_t eq = field.find('=');
+            int op = 0;
+            while (op < static_cast<int>(LoadOperation::Count) &&
+                   field.compare(0, eq, loadOperationName(static_cast<LoadOperation>(op))) != 0) {
+                ++op;
+            }
+            if (eq == std::string::npos || op == static_cast<int>(LoadOperation::Count)) {
+                throw std::invalid_argument("Bad operation mix entry: " + field);
+            }
+            mix.weights[op] = std::stoi(field.substr(eq + 1));
+            if (mix.weights[op] < 0) throw std::invalid_argument("Negative weight in operation mix: " + field);
+        }
+        mix.total = 0;
+        for (int weight : mix.weights) mix.total += weight;
+        if (mix.total == 0) throw std::invalid_argument("Operation mix has no weight: " + spec);
+        return mix;
     }
-    
-    void updateMedication() {
-        std::cout << "Enter Medication ID to update: ";
-        int id = readInt();
-        std::cout << "Enter new Name: ";
-        std::string name = readLine();
-        std::cout << "Enter new Dosage: ";
-        std::string dosage = readLine();
-        std::cout << "Enter new Price: ";
-        double price = readDouble();
-        std::cout << "Enter new Manufacturer (optional): ";
-        std::string manufacturer = readLine();
-        std::cout << "Enter new Description (optional): ";
-        std::string description = readLine();
-        
-        medicationService.updateMedication(id, name, dosage, price, manufacturer, description);
+
+    LoadOperation pick(DatasetRandom &random) const {
+        int draw = static_cast<int>(random.below(static_cast<uint32_t>(total)));
+        int op = 0;
+        while (draw >= weights[op]) draw -= weights[op++];
+        return static_cast<LoadOperation>(op);
     }
-    
-    void removeMedication() {
-        std::cout << "Enter Medication ID to remove: ";
-        int id = readInt();
-        medicationService.removeMedication(id);
+
+    std::string describe() const {
+        std::string text;
+        for (int op = 0; op < static_cast<int>(LoadOperation::Count); ++op) {
+            if (!text.empty()) text += ',';
+            text += std::string(loadOperationName(static_cast<LoadOperation>(op))) + "=" + std::to_string(weights[op]);
+        }
+        return text;
     }
-    
-    void listAllMedications() {
-        medicationService.listAllMedications();
+};
+
+struct LoadWorkerResult {
+    LatencyHistogram histograms[static_cast<int>(LoadOperation::Count)];
+};
+
+// Drives the services from --threads sessions for --duration seconds and
+// reports per-operation latency percentiles and throughput. The sessions
+// share one AuthenticationService and its session store, as terminals do.
+//
+// With --rate, operations are issued on a fixed schedule and latency is
+// measured from each operation's scheduled start, so a stall also counts
+// against the operations queued behind it instead of hiding them
+// (coordinated omission). Without it every session runs flat out.
+void runLoadBenchmark(const BenchmarkOptions &requested) {
+    // The in-memory repositories are single-threaded
+    BenchmarkOptions options = requested;
+    if (options.threads > 1 && !options.concurrentRepositories) {
+        std::cout << "Using concurrent repositories for " << options.threads << " threads.\n";
+        options.concurrentRepositories = true;
+    }
+    const LoadMix mix = options.mix.empty() ? LoadMix() : LoadMix::parse(options.mix);
+    std::cout << "Generating dataset (seed " << options.seed << ", " << options.scale << " patients)...\n";
+    BenchmarkHospital hospital(options);
+    const DatasetScale scale = hospital.scale;
+    const int firstDay = parseDayNumber(HospitalDataGenerator::firstDate());
+    std::vector<std::string> dates;
+    for (int d = 0; d < HospitalDataGenerator::Days; ++d) dates.push_back(formatDayNumber(firstDay + d));
+    std::vector<std::string> usernames(scale.users + 1);
+    for (int id = 1; id <= scale.users; ++id) {
+        usernames[id] = id == 1 ? "admin" : id <= scale.doctors + 1 ? "doctor" + std::to_string(id)
+                                                                    : "reception" + std::to_string(id);
+    }
+    ZipfPicker pickPatient(scale.patients, 0.6);
+    ZipfPicker pickDoctor(scale.doctors, 0.8);
+
+    std::cout << "Load: " << options.threads << " threads, " << options.durationSeconds << " s, "
+              << (options.rate > 0 ? std::to_string(options.rate) + " ops/sec" : std::string("unthrottled"))
+              << ", mix " << mix.describe() << "\n";
+
+    typedef std::chrono::steady_clock Clock;
+    std::vector<LoadWorkerResult> results(options.threads);
+    std::atomic<long long> checksum{0};
+    const auto start = Clock::now();
+    const auto deadline = start + std::chrono::seconds(options.durationSeconds);
+    std::vector<std::thread> sessions;
+    for (int t = 0; t < options.threads; ++t) {
+        sessions.emplace_back([&, t] {
+            DatasetRandom random(options.seed + 1000 + t);
+            LoadWorkerResult &result = results[t];
+            // Rates past one operation per nanosecond per session still advance the schedule
+            const auto interval = options.rate > 0
+                ? std::chrono::nanoseconds(std::max(1LL, static_cast<long long>(1e9 * options.threads / options.rate)))
+                : std::chrono::nanoseconds(0);
+            // Sessions start staggered across one interval so their schedules interleave
+            auto scheduled = start + interval * t / options.threads;
+            long long localSum = 0;
+            for (;;) {
+                Clock::time_point began;
+                if (options.rate > 0) {
+                    if (scheduled >= deadline) break;
+                    // Timer wakeups run tens of microseconds late, which would read as
+                    // latency, so the last stretch is spent yielding instead
+                    std::this_thread::sleep_until(scheduled - std::chrono::microseconds(200));
+                    while (Clock::now() < scheduled) std::this_thread::yield();
+                    began = scheduled;
+                    scheduled += interval;
+                } else {
+                    began = Clock::now();
+                    if (began >= deadline) break;
+                }
+
+                LoadOperation op = mix.pick(random);
+                int patientId = static_cast<int>(pickPatient(random)) + 1;
+                int doctorId = static_cast<int>(pickDoctor(random)) + 1;
+                const std::string &date = dates[random.below(static_cast<uint32_t>(dates.size()))];
+                switch (op) {
+                case LoadOperation::Login: {
+                    int userId = static_cast<int>(random.below(static_cast<uint32_t>(scale.users))) + 1;
+                    SessionToken token = hospital.authService.login(usernames[userId],
+                                                                   "password" + std::to_string(userId));
+                    localSum += !token.isNull();
+                    hospital.authService.logout(token);
+                    break;
+                }
+                case LoadOperation::Book:
+                    hospital.appointmentService.bookAppointment(patientId, doctorId, date,
+                                                                TimeSlots[random.below(TimeSlotCount)]);
+                    break;
+                case LoadOperation::Prescription:
+                    hospital.prescriptionService.updatePrescription(
+                        static_cast<int>(random.below(static_cast<uint32_t>(scale.prescriptions))) + 1,
+                        {static_cast<int>(random.below(static_cast<uint32_t>(scale.medications))) + 1},
+                        "Take as directed");
+                    break;
+                case LoadOperation::Bill:
+                    hospital.billingService.generateBill(patientId, date, Money::fromCents(random.between(10, 60) * 500),
+                                                         Money::fromCents(random.between(0, 30000)));
+                    break;
+                default:
+                    localSum += hospital.patientService.getPatientById(patientId) != nullptr;
+                    localSum += hospital.billingService.getBillById(
+                                    static_cast<int>(random.below(static_cast<uint32_t>(scale.bills))) + 1) != nullptr;
+                    break;
+                }
+                auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - began).count();
+                result.histograms[static_cast<int>(op)].record(static_cast<uint64_t>(latency));
+            }
+            checksum += localSum;
+        });
     }
-    
-    // Prescription Management
-    void createPrescription() {
-        std::cout << "Enter Patient ID: ";
-        int patientId = readInt();
-        std::cout << "Enter Doctor ID: ";
-        int doctorId = readInt();
-        std::string date = getDateInput();
-        
-        std::vector<int> medicationIds;
-        bool addMore = true;
-        while (addMore) {
-            std::cout << "Enter Medication ID: ";
-            int medId = readInt();
-            medicationIds.push_back(medId);
-            
-            std::cout << "Add another medication? (1: Yes, 0: No): ";
-            int more = readInt();
-            addMore = (more == 1);
+    for (auto &s : sessions) s.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    LatencyHistogram merged[static_cast<int>(LoadOperation::Count)];
+    LatencyHistogram overall;
+    for (const LoadWorkerResult &result : results) {
+        for (int op = 0; op < static_cast<int>(LoadOperation::Count); ++op) {
+            merged[op].merge(result.histograms[op]);
+            overall.merge(result.histograms[op]);
         }
-        
-        std::cout << "Enter Instructions (optional): ";
-        std::string instructions = readLine();
-        
-        prescriptionService.createPrescription(patientId, doctorId, date, medicationIds, instructions);
     }
-    
-    void updatePrescription() {
-        std::cout << "Enter Prescription ID to update: ";
-        int prescId = readInt();
-        
-        std::vector<int> medicationIds;
-        bool addMore = true;
-        while (addMore) {
-            std::cout << "Enter Medication ID: ";
-            int medId = readInt();
-            medicationIds.push_back(medId);
-            
-            std::cout << "Add another medication? (1: Yes, 0: No): ";
-            int more = readInt();
-            addMore = (more == 1);
+
+    auto micros = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+    std::cout << "operation    |      ops |  ops/sec |  mean us |   p50 us |   p90 us |   p99 us | p99.9 us |   max us\n";
+    auto printRow = [&](const char *name, const LatencyHistogram &h) {
+        std::cout << std::left << std::setw(12) << name << std::right << " | " << std::setw(8) << h.count() << " | "
+                  << std::fixed << std::setprecision(0) << std::setw(8) << h.count() / elapsed << std::setprecision(1);
+        for (double value : {h.mean() / 1000.0, micros(h.percentile(0.5)), micros(h.percentile(0.9)),
+                             micros(h.percentile(0.99)), micros(h.percentile(0.999)), micros(h.max())}) {
+            std::cout << " | " << std::setw(8) << value;
         }
-        
-        std::cout << "Enter Instructions (optional): ";
-        std::string instructions = readLine();
-        
-        prescriptionService.updatePrescription(prescId, medicationIds, instructions);
+        std::cout << "\n";
+    };
+    for (int op = 0; op < static_cast<int>(LoadOperation::Count); ++op) {
+        if (merged[op].count()) printRow(loadOperationName(static_cast<LoadOperation>(op)), merged[op]);
     }
-    
-    void removePrescription() {
-        std::cout << "Enter Prescription ID to remove: ";
-        int id = readInt();
-        prescriptionService.removePrescription(id);
+    printRow("all", overall);
+    std::cout << "(checksum " << checksum.load() << ")\n";
+
+    if (!options.jsonPath.empty()) {
+        std::ofstream json(options.jsonPath);
+        if (!json) throw std::runtime_error("Cannot write benchmark results to " + options.jsonPath);
+        json << "{\n  \"benchmark\": \"load\",\n  \"seed\": " << options.seed << ",\n  \"threads\": " << options.threads
+             << ",\n  \"rate\": " << options.rate << ",\n  \"mix\": \"" << mix.describe() << "\",\n  \"seconds\": "
+             << std::fixed << std::setprecision(3) << elapsed << ",\n  \"operations\": [\n";
+        for (int op = 0; op <= static_cast<int>(LoadOperation::Count); ++op) {
+            bool all = op == static_cast<int>(LoadOperation::Count);
+            const LatencyHistogram &h = all ? overall : merged[op];
+            json << "    {\"name\": \"" << (all ? "all" : loadOperationName(static_cast<LoadOperation>(op)))
+                 << "\", \"count\": " << h.count() << ", \"ops_per_sec\": " << h.count() / elapsed
+                 << ", \"mean_ns\": " << h.mean() << ", \"p50_ns\": " << h.percentile(0.5)
+                 << ", \"p90_ns\": " << h.percentile(0.9) << ", \"p99_ns\": " << h.percentile(0.99)
+                 << ", \"p999_ns\": " << h.percentile(0.999) << ", \"max_ns\": " << h.max() << "}"
+                 << (all ? "" : ",") << "\n";
+        }
+        json << "  ]\n}\n";
+        std::cout << "Results written to " << options.jsonPath << "\n";
     }
-    
-    void listPrescriptionsByPatient() {
-        std::cout << "Enter Patient ID: ";
-        int patientId = readInt();
-        prescriptionService.listPrescriptionsByPatient(patientId);
+}
+
+// Requests/sec and latency for --clients simulated workstations talking to
+// a server on a Unix socket. Each client logs in, then sends one request at
+// a time from a front-desk mix and sends the next as soon as the answer
+// arrives. The server runs on its own thread; the clients share another,
+// multiplexed with epoll like the server.
+void runServerBenchmark(const BenchmarkOptions &options) {
+    static const char *const kinds[] = {"book", "bill", "free-slots", "set-status", "prescribe"};
+    const int kindCount = 5;
+    const int clientCount = options.clients;
+
+    std::cout << "Generating dataset (seed " << options.seed << ", " << options.scale << " patients)...\n";
+    auto recorder = std::make_shared<RecordingDisplayManager>(std::make_shared<ConsoleDisplayManager>());
+    BenchmarkHospital hospital(options, recorder);
+    const DatasetScale scale = hospital.scale;
+    CommandProcessor processor(hospital.authService, hospital.patientService, hospital.doctorService,
+                               hospital.appointmentService, hospital.medicationService,
+                               hospital.prescriptionService, hospital.billingService, recorder);
+    HospitalServer server(processor, hospital.authService, hospital.logger);
+    const std::string address = "/tmp/hms_benchmark_" + std::to_string(::getpid()) + ".sock";
+    server.listen(address);
+    std::thread serving([&] { server.run(); });
+
+    struct Client {
+        int fd;
+        DatasetRandom random;
+        std::string in;
+        int kind = -1; // Of the request in flight; -1 while logging in
+        std::chrono::steady_clock::time_point sentAt;
+        explicit Client(int fd, uint32_t seed) : fd(fd), random(seed) {}
+    };
+    const int firstDay = parseDayNumber(HospitalDataGenerator::firstDate());
+    auto nextRequest = [&](Client &client) {
+        DatasetRandom &random = client.random;
+        int patientId = static_cast<int>(random.below(static_cast<uint32_t>(scale.patients))) + 1;
+        int doctorId = static_cast<int>(random.below(static_cast<uint32_t>(scale.doctors))) + 1;
+        std::string date = formatDayNumber(firstDay + random.between(0, HospitalDataGenerator::Days - 1));
+        uint32_t draw = random.below(100);
+        client.kind = draw < 30 ? 0 : draw < 50 ? 1 : draw < 80 ? 2 : draw < 90 ? 3 : 4;
+        switch (client.kind) {
+            case 0: return "book|" + std::to_string(patientId) + "|" + std::to_string(doctorId) + "|" + date + "|" +
+                           TimeSlots[random.below(TimeSlotCount)];
+            case 1: return "bill|" + std::to_string(patientId) + "|" + date + "|100.00|" +
+                           std::to_string(random.between(0, 300)) + ".00";
+            case 2: return "list-free-slots|" + std::to_string(doctorId) + "|" + date;
+            case 3: return "set-appointment-status|" +
+                           std::to_string(random.below(static_cast<uint32_t>(scale.appointments)) + 1) + "|" +
+                           (random.chance(0.5) ? "Completed" : "Scheduled");
+            default: return "prescribe|" + std::to_string(patientId) + "|" + std::to_string(doctorId) + "|" + date +
+                            "|" + std::to_string(random.below(static_cast<uint32_t>(scale.medications)) + 1);
+        }
+    };
+    auto send = [](Client &client, const std::string &payload) {
+        std::string frame;
+        appendFrame(frame, payload);
+        // One small request in flight per client, so the socket always has room
+        if (::send(client.fd, frame.data(), frame.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(frame.size())) {
+            throw std::runtime_error("Benchmark client could not send a request");
+        }
+        client.sentAt = std::chrono::steady_clock::now();
+    };
+
+    int epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    std::vector<std::unique_ptr<Client>> clients;
+    for (int i = 0; i < clientCount; ++i) {
+        clients.emplace_back(new Client(connectToServer(ServerAddress::parse(address)), options.seed + i));
+        epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.u32 = static_cast<uint32_t>(i);
+        ::epoll_ctl(epollFd, EPOLL_CTL_ADD, clients.back()->fd, &event);
+        send(*clients.back(), "login|admin|password1");
     }
-    
-    // Billing Management
-    void generateBill() {
-        std::cout << "Enter Patient ID: ";
-        int patientId = readInt();
-        std::string date = getDateInput();
-        std::cout << "Enter Consultation Fee: ";
-        double consultationFee = readDouble();
-        std::cout << "Enter Medication Charges: ";
-        double medicationCharges = readDouble();
-        std::cout << "Enter Other Charges: ";
-        double otherCharges = readDouble();
-        
-        billingService.generateBill(patientId, date, consultationFee, medicationCharges, otherCharges);
+
+    std::vector<LatencyHistogram> histograms(kindCount);
+    LatencyHistogram overall;
+    size_t failed = 0;
+    std::vector<char> buffer(64 * 1024);
+    std::vector<epoll_event> events(256);
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + std::chrono::seconds(options.durationSeconds);
+    int outstanding = clientCount;
+    while (outstanding > 0) {
+        int ready = ::epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), 1000);
+        if (ready < 0 && errno != EINTR) throw std::runtime_error("epoll_wait failed in benchmark client");
+        auto now = std::chrono::steady_clock::now();
+        for (int e = 0; e < ready; ++e) {
+            Client &client = *clients[events[e].data.u32];
+            ssize_t n = ::recv(client.fd, buffer.data(), buffer.size(), MSG_DONTWAIT);
+            if (n <= 0) {
+                if (n < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+                throw std::runtime_error("Server closed a benchmark connection");
+            }
+            client.in.append(buffer.data(), static_cast<size_t>(n));
+            if (client.in.size() < 4 || client.in.size() - 4 < frameLength(client.in.data())) continue;
+            bool succeeded = client.in.compare(4, 2, "OK") == 0;
+            bool busy = client.in.compare(4, 12, "ERR Too many") == 0;
+            client.in.clear();
+            if (client.kind < 0) {
+                if (busy) {
+                    // Every client logs in at once, more than the verification queue holds
+                    send(client, "login|admin|password1");
+                    continue;
+                }
+                if (!succeeded) throw std::runtime_error("Benchmark client could not log in");
+            } else {
+                auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(now - client.sentAt).count();
+                histograms[client.kind].record(static_cast<uint64_t>(latency));
+                overall.record(static_cast<uint64_t>(latency));
+                failed += !succeeded;
+            }
+            if (now < deadline) {
+                send(client, nextRequest(client));
+            } else {
+                --outstanding;
+            }
+        }
     }
-    
-    void updateBillPaymentStatus() {
-        std::cout << "Enter Bill ID: ";
-        int billId = readInt();
-        std::cout << "Enter new Payment Status (Paid, Pending, Overdue): ";
-        std::string status = readLine();
-        std::cout << "Enter Payment Method (Cash, Card, Insurance) (optional): ";
-        std::string method = readLine();
-        
-        billingService.updateBillPaymentStatus(billId, status, method);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (auto &client : clients) ::close(client->fd);
+    ::close(epollFd);
+    server.stop();
+    serving.join();
+
+    std::cout << clientCount << " clients for " << std::fixed << std::setprecision(1) << seconds << " s: "
+              << std::setprecision(0) << overall.count() / seconds << " requests/sec, " << failed
+              << " answered with an error (booked slots and the like)\n";
+    std::cout << "request    |  requests |  p50 us |  p99 us | p99.9 us |   max us\n";
+    auto row = [&](const char *name, const LatencyHistogram &h) {
+        std::cout << std::left << std::setw(10) << name << std::right << " | " << std::setw(9) << h.count()
+                  << std::setprecision(1) << " | " << std::setw(7) << h.percentile(0.5) / 1000.0 << " | "
+                  << std::setw(7) << h.percentile(0.99) / 1000.0 << " | " << std::setw(8)
+                  << h.percentile(0.999) / 1000.0 << " | " << std::setw(8) << h.max() / 1000.0 << "\n";
+    };
+    for (int kind = 0; kind < kindCount; ++kind) row(kinds[kind], histograms[kind]);
+    row("all", overall);
+}
+
+// Permission checks with thousands of sessions open at once, against the
+// single-user check it replaced (resolve the logged-in user, compare its
+// role), and the cost of opening and closing a session
+void runSessionBenchmark(const BenchmarkOptions &options) {
+    const int checks = benchmarkSize(options, 1000000);
+    std::cout << "open sessions | ns per role check (one user) | ns per allows() | ns per open+close\n";
+    for (int fullSize : {1000, 10000, 100000}) {
+        const int size = benchmarkSize(options, fullSize);
+        InMemoryUserRepository users;
+        SessionStore store;
+        std::vector<SessionToken> tokens;
+        std::vector<SlotHandle> handles;
+        for (int id = 1; id <= size; ++id) {
+            users.add(User(id, "user" + std::to_string(id), "password", id % 10 == 0 ? "Admin" : "Reception"));
+            SessionInfo info;
+            info.user = users.getHandle(id);
+            info.userId = id;
+            info.username = "user" + std::to_string(id);
+            info.role = users.resolve(info.user)->getRoleSymbol();
+            info.permissions = PermissionSet::forRole(info.role);
+            tokens.push_back(store.open(info));
+            handles.push_back(info.user);
+        }
+
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> pick(0, size - 1);
+        std::vector<int> picks(checks);
+        for (auto &i : picks) i = pick(rng);
+
+        long long allowed = 0;
+        double roleNs = measureNanoseconds([&] {
+            for (int i : picks) {
+                User* user = users.resolve(handles[i]);
+                allowed += user && user->getRoleSymbol() == known().admin;
+            }
+        });
+        double allowsNs = measureNanoseconds([&] {
+            for (int i : picks) allowed += store.allows(tokens[i], Permission::ViewFinances);
+        });
+        const int cycles = benchmarkSize(options, 20000);
+        SessionInfo info;
+        info.permissions = PermissionSet::forRole(known().admin);
+        double cycleNs = measureNanoseconds([&] {
+            for (int i = 0; i < cycles; ++i) store.close(store.open(info));
+        });
+        std::cout << std::setw(13) << size << " | " << std::fixed << std::setprecision(1) << std::setw(28)
+                  << roleNs / checks << " | " << std::setw(15) << allowsNs / checks << " | " << std::setw(17)
+                  << cycleNs / cycles << "  (allowed " << allowed << ")\n";
     }
-    
-    void listBillsByPatient() {
-        std::cout << "Enter Patient ID: ";
-        int patientId = readInt();
-        billingService.listBillsByPatient(patientId);
+}
+
+// Bulk registration of staff accounts and login throughput against the
+// username index, plus how often the Bloom filter lets an unknown name
+// through to the index
+void runUserBenchmark(const BenchmarkOptions &options) {
+    std::cout << "accounts | ns per registration | ns per login | ns per unknown name | filter false positives\n";
+    for (int fullSize : {1000, 10000, 100000}) {
+        const int size = benchmarkSize(options, fullSize);
+        auto repo = std::make_shared<InMemoryUserRepository>();
+        // One PBKDF2 iteration: this measures the index, not key derivation (see --benchmark logins)
+        AuthenticationOptions cheapHashing;
+        cheapHashing.passwordIterations = 1;
+        AuthenticationService auth(repo, std::make_shared<NullLogger>(), cheapHashing);
+        std::vector<std::string> names;
+        for (int i = 0; i < size; ++i) names.push_back("staff" + std::to_string(i));
+
+        int registered = 0;
+        double registerNs = measureNanoseconds([&] {
+            for (const auto &name : names) registered += auth.registerUser(name, "secret", "Reception");
+        });
+
+        // Typed the way people type them: some with a capital first letter
+        const int logins = benchmarkSize(options, 200000);
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> pick(0, size - 1);
+        std::vector<std::string> typed(logins);
+        for (int i = 0; i < logins; ++i) {
+            typed[i] = names[pick(rng)];
+            if (i % 2) typed[i][0] = 'S';
+        }
+        int accepted = 0;
+        double loginNs = measureNanoseconds([&] {
+            for (const auto &name : typed) {
+                SessionToken token = auth.login(name, "secret");
+                accepted += !token.isNull();
+                auth.logout(token);
+            }
+        });
+
+        std::vector<std::string> unknown(logins);
+        for (int i = 0; i < logins; ++i) unknown[i] = "visitor" + std::to_string(i);
+        int found = 0;
+        double unknownNs = measureNanoseconds([&] {
+            for (const auto &name : unknown) found += repo->findByUsername(name) != nullptr;
+        });
+
+        // The repository sizes its filter for twice the accounts it holds
+        BloomFilter filter(std::max<size_t>(1024, names.size() * 2));
+        for (const auto &name : names) filter.insert(usernameHash(name));
+        int passed = 0;
+        for (const auto &name : unknown) passed += filter.mayContain(usernameHash(name));
+
+        std::cout << std::setw(8) << size << " | " << std::fixed << std::setprecision(1) << std::setw(19)
+                  << registerNs / size << " | " << std::setw(12) << loginNs / logins << " | " << std::setw(19)
+                  << unknownNs / logins << " | " << std::setw(21) << std::setprecision(3)
+                  << 100.0 * passed / logins << "%  (" << registered << " registered, " << accepted
+                  << " logins, " << found << " found)\n";
     }
-    
-    void listBillsByPaymentStatus() {
-        std::cout << "Enter Payment Status (Paid, Pending, Overdue): ";
-        std::string status = readLine();
-        billingService.listBillsByPaymentStatus(status);
+}
+
+// The login rate the verification pool sustains at the real work factor,
+// and what a flood of logins does to bookings made alongside it. For each
+// pool size, bookings run alone for a second, then beside a driver that
+// keeps the pool's queue full; finally a burst of logins several times
+// the queue's size shows how many are turned away.
+void runLoginBenchmark(const BenchmarkOptions &requested) {
+    BenchmarkOptions options = requested;
+    if (options.passwordIterations == 0) options.passwordIterations = DefaultPasswordIterations;
+    options.scale = std::min(options.scale, 2000); // Every account is hashed at the full work factor
+    std::cout << "PBKDF2-SHA256 with " << options.passwordIterations << " iterations, " << options.durationSeconds
+              << " s per pool size\n";
+    std::cout << "workers | logins/sec | booking p50/p99 us alone | booking p50/p99 us beside logins"
+                 " | burst turned away\n";
+
+    for (size_t workers : {1, 2, 4}) {
+        options.loginWorkers = workers;
+        BenchmarkHospital hospital(options);
+        const DatasetScale scale = hospital.scale;
+        const int firstDay = parseDayNumber(HospitalDataGenerator::firstDate());
+        PasswordVerifier &verifier = hospital.authService.passwordVerifier();
+        const size_t window = verifier.getQueueLimit() + verifier.threadCount();
+
+        // Bookings from their own thread, into whichever histogram is current
+        LatencyHistogram alone, beside;
+        std::atomic<LatencyHistogram*> bookingInto{&alone};
+        std::atomic<bool> stopBooking{false};
+        std::thread booking([&] {
+            DatasetRandom random(options.seed);
+            while (!stopBooking.load()) {
+                int patientId = static_cast<int>(random.below(static_cast<uint32_t>(scale.patients))) + 1;
+                int doctorId = static_cast<int>(random.below(static_cast<uint32_t>(scale.doctors))) + 1;
+                std::string date = formatDayNumber(firstDay + random.between(0, HospitalDataGenerator::Days - 1));
+                auto started = std::chrono::steady_clock::now();
+                hospital.appointmentService.bookAppointment(patientId, doctorId, date,
+                                                            TimeSlots[random.below(TimeSlotCount)]);
+                auto elapsed = std::chrono::steady_clock::now() - started;
+                bookingInto.load()->record(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+                std::this_thread::sleep_for(std::chrono::microseconds(200)); // A busy front desk, not a flood
+            }
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(options.smoke ? 100 : 1000));
+
+        // Keep the pool's queue full with logins as admin
+        std::atomic<size_t> inFlight{0};
+        std::atomic<size_t> succeeded{0};
+        auto finished = [&](SessionToken token, LoginFailure) {
+            if (!token.isNull()) {
+                hospital.authService.logout(token);
+                ++succeeded;
+            }
+            --inFlight;
+        };
+        bookingInto.store(&beside);
+        auto start = std::chrono::steady_clock::now();
+        auto deadline = start + std::chrono::seconds(options.durationSeconds);
+        while (std::chrono::steady_clock::now() < deadline) {
+            if (inFlight.load() < window) {
+                ++inFlight;
+                hospital.authService.loginAsync("admin", "password1", finished);
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        size_t sustained = succeeded.load();
+        while (inFlight.load() > 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        stopBooking.store(true);
+        booking.join();
+
+        const size_t burst = window * 4;
+        std::atomic<size_t> turnedAway{0};
+        for (size_t i = 0; i < burst; ++i) {
+            ++inFlight;
+            hospital.authService.loginAsync("admin", "password1", [&](SessionToken token, LoginFailure failure) {
+                if (failure == LoginFailure::Busy) ++turnedAway;
+                hospital.authService.logout(token);
+                --inFlight;
+            });
+        }
+        while (inFlight.load() > 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        std::cout << std::setw(7) << workers << " | " << std::fixed << std::setprecision(1) << std::setw(10)
+                  << sustained / seconds << " | " << std::setw(11) << alone.percentile(0.5) / 1000.0 << " / "
+                  << std::setw(10) << alone.percentile(0.99) / 1000.0 << " | " << std::setw(15)
+                  << beside.percentile(0.5) / 1000.0 << " / " << std::setw(14) << beside.percentile(0.99) / 1000.0
+                  << " | " << turnedAway.load() << " of " << burst << "\n";
     }
+}
+
+struct BenchmarkEntry {
+    const char *name;
+    const char *description;
+    void (*run)(const BenchmarkOptions &options);
+};
+
+const BenchmarkEntry Benchmarks[] = {
+    {"lookup", "getById latency vs. repository size", runLookupBenchmark},
+    {"wal", "write-ahead log commits/sec per fsync mode", runWalBenchmark},
+    {"snapshot", "startup cost for 1M patients: snapshot vs. log replay", runSnapshotBenchmark},
+    {"concurrent", "mixed front-desk ops/sec on 1-8 threads", runConcurrencyBenchmark},
+    {"allocations", "heap allocations per query", runAllocationBenchmark},
+    {"money", "summing 10M amounts as doubles vs. integer cents", runMoneyBenchmark},
+    {"columnar", "finance scans over 10M bills: rows vs. columns", runColumnarBenchmark},
+    {"suite", "every repository query and service operation on generated data", runSuiteBenchmark},
+    {"load", "latency percentiles for a front-desk operation mix", runLoadBenchmark},
+    {"server", "requests/sec from hundreds of clients over the socket protocol", runServerBenchmark},
+    {"sessions", "permission checks and session open/close with up to 100k sessions", runSessionBenchmark},
+    {"users", "bulk registration of up to 100k accounts and login throughput", runUserBenchmark},
+    {"logins", "login rate the password verification pool sustains, and bookings beside it", runLoginBenchmark},
 };
 
+int runBenchmark(const std::string &name, const BenchmarkOptions &options) {
+    for (const BenchmarkEntry &entry : Benchmarks) {
+        if (name == entry.name) {
+            entry.run(options);
+            return 0;
+        }
+    }
+    std::cerr << "Unknown benchmark: " << name << "\nAvailable:\n";
+    for (const BenchmarkEntry &entry : Benchmarks) {
+        std::cerr << "  " << std::left << std::setw(12) << entry.name << entry.description << "\n";
+    }
+    return 1;
+}
+
 // ------------------------------
 // Main Function
 // ------------------------------
 
-int main() {
+int main(int argc, char *argv[]) {
     try {
-        HospitalManagementApp app;
+        if (argc >= 3 && std::string(argv[1]) == "--benchmark") {
+            BenchmarkOptions options;
+            for (int i = 3; i < argc; i += 2) {
+                std::string flag = argv[i];
+                if (i + 1 == argc) throw std::invalid_argument("Option " + flag + " needs a value");
+                std::string value = argv[i + 1];
+                if (flag == "--scale") {
+                    options.scale = std::stoi(value);
+                } else if (flag == "--seed") {
+                    options.seed = static_cast<uint32_t>(std::stoul(value));
+                } else if (flag == "--threads") {
+                    options.threads = std::max(std::stoi(value), 1);
+                } else if (flag == "--duration") {
+                    options.durationSeconds = std::max(std::stoi(value), 1);
+                } else if (flag == "--rate") {
+                    options.rate = std::max(std::stoi(value), 0);
+                } else if (flag == "--password-iterations") {
+                    options.passwordIterations = static_cast<uint32_t>(std::max(std::stol(value), 1L));
+                } else if (flag == "--login-workers") {
+                    options.loginWorkers = static_cast<size_t>(std::max(std::stoi(value), 1));
+                } else if (flag == "--clients") {
+                    options.clients = std::max(std::stoi(value), 1);
+                } else if (flag == "--mix") {
+                    options.mix = value;
+                } else if (flag == "--json") {
+                    options.jsonPath = value;
+                } else if (flag == "--smoke") {
+                    if (value != "yes" && value != "no") throw std::invalid_argument("--smoke takes yes or no");
+                    options.smoke = value == "yes";
+                } else if (flag == "--repositories") {
+                    if (value == "concurrent") options.concurrentRepositories = true;
+                    else if (value == "inmemory") options.concurrentRepositories = false;
+                    else throw std::invalid_argument("Unknown repository kind: " + value);
+                } else {
+                    throw std::invalid_argument("Unknown benchmark option: " + flag);
+                }
+            }
+            return runBenchmark(argv[2], options);
+        }
+        
+        AppOptions options;
+        std::string connectAddress; // Run as a client of another process's server
+        std::string demoData;       // Unset seeds an empty store only in the interactive menus
+        for (int i = 1; i < argc; i += 2) {
+            std::string flag = argv[i];
+            if (i + 1 == argc) throw std::invalid_argument("Option " + flag + " needs a value");
+            std::string value = argv[i + 1];
+            if (flag == "--wal") {
+                options.walPath = (value == "none") ? "" : value;
+            } else if (flag == "--snapshot") {
+                options.snapshotPath = (value == "none") ? "" : value;
+            } else if (flag == "--batch") {
+                options.batchPath = value;
+            } else if (flag == "--serve") {
+                options.serveAddress = value;
+            } else if (flag == "--session-timeout") {
+                options.auth.sessionTimeout = std::chrono::minutes(std::max(std::stoi(value), 1));
+            } else if (flag == "--password-iterations") {
+                options.auth.passwordIterations = static_cast<uint32_t>(std::max(std::stol(value), 1L));
+            } else if (flag == "--login-workers") {
+                options.auth.verifierThreads = static_cast<size_t>(std::max(std::stoi(value), 1));
+            } else if (flag == "--connect") {
+                connectAddress = value;
+            } else if (flag == "--demo-data") {
+                if (value != "yes" && value != "no") throw std::invalid_argument("--demo-data takes yes or no");
+                demoData = value;
+            } else if (flag == "--repositories") {
+                if (value == "concurrent") options.concurrentRepositories = true;
+                else if (value == "inmemory") options.concurrentRepositories = false;
+                else throw std::invalid_argument("Unknown repository kind: " + value);
+            } else if (flag == "--fsync") {
+                if (value == "always") options.walOptions.policy = FsyncPolicy::Always;
+                else if (value == "interval") options.walOptions.policy = FsyncPolicy::Interval;
+                else if (value == "never") options.walOptions.policy = FsyncPolicy::Never;
+                else throw std::invalid_argument("Unknown fsync mode: " + value);
+            } else {
+                throw std::invalid_argument("Unknown option: " + flag);
+            }
+        }
+        
+        if (!connectAddress.empty()) {
+            RemoteMenuClient(connectAddress).run();
+            return 0;
+        }
+
+        bool interactive = options.serveAddress.empty() && options.batchPath.empty();
+        options.demoData = demoData.empty() ? interactive : demoData == "yes";
+        HospitalManagementApp app(options);
+        if (!options.serveAddress.empty()) {
+            return app.runServer(options.serveAddress);
+        }
+        if (options.batchPath == "-") {
+            return app.runBatch(std::cin);
+        } else if (!options.batchPath.empty()) {
+            std::ifstream script(options.batchPath, std::ios::binary);
+            if (!script) throw std::runtime_error("Cannot open batch file: " + options.batchPath);
+            return app.runBatch(script);
+        }
         app.run();
     } catch (const std::exception &e) {
         std::cerr << "An error occurred: " << e.what() << std::endl;
@@ -0,0 +1,650 @@
+// Regression checks for main.cpp, which they include with its main()
+// renamed, so they need nothing else to build:
+//
+//   g++ -std=c++14 -pthread tests/hms_tests.cpp -o hms_tests && ./hms_tests
+//
+// Exits non-zero if any check fails.
+
+#define main hms_main
+#include "../main.cpp"
+#undef main
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition)                                                                  \
+    do {                                                                                  \
+        if (!(condition)) {                                                               \
+            ++failures;                                                                   \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition "\n"; \
+        }                                                                                 \
+    } while (0)
+
+// Runs body and reports whether it threw std::exception
+template <typename Body>
+bool throws(Body body) {
+    try {
+        body();
+    } catch (const std::exception &) {
+        return true;
+    }
+    return false;
+}
+
+// IDs a repository query visits, in visiting order
+template <typename T, typename Query>
+std::vector<int> idsFrom(Query query) {
+    std::vector<int> ids;
+    query([&](const T &item) { ids.push_back(EntityCodec<T>::id(item)); });
+    return ids;
+}
+
+// IDs of every item the predicate accepts, by a full scan in ID order
+template <typename T, typename Predicate>
+std::vector<int> idsByScan(const IRepository<T> &repo, Predicate accept) {
+    std::vector<int> ids;
+    repo.forEach([&](const T &item) {
+        if (accept(item)) ids.push_back(EntityCodec<T>::id(item));
+    });
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+std::vector<int> sorted(std::vector<int> ids) {
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+const char *const Diseases[] = {"Flu", "Asthma", "Diabetes", "Migraine"};
+
+// Every index query on patients against a full scan
+void checkPatientIndexes(const InMemoryPatientRepository &repo) {
+    for (const char *disease : Diseases) {
+        CHECK(sorted(idsFrom<Patient>([&](const auto &v) { repo.forEachByDisease(disease, v); })) ==
+              idsByScan(repo, [&](const Patient &p) { return p.getDisease() == disease; }));
+    }
+    for (int low : {0, 18, 40, 65}) {
+        for (int high : {17, 39, 64, 120}) {
+            std::vector<int> scanned = idsByScan(repo, [&](const Patient &p) {
+                return p.getAge() >= low && p.getAge() <= high;
+            });
+            CHECK(sorted(idsFrom<Patient>([&](const auto &v) { repo.forEachInAgeRange(low, high, v); })) == scanned);
+            CHECK(repo.countByAgeRange(low, high) == scanned.size());
+        }
+    }
+}
+
+// The template keeps every index of an IndexSet current through add,
+// add over an existing ID, update and remove
+void testRepositoryTemplate() {
+    InMemoryPatientRepository repo;
+    std::mt19937 rng(25);
+    auto pick = [&](int n) { return static_cast<int>(rng() % static_cast<uint32_t>(n)); };
+    for (int round = 0; round < 2000; ++round) {
+        int id = pick(200) + 1;
+        switch (pick(4)) {
+        case 0:
+        case 1: // A new patient, or a replacement for an existing one
+            repo.add(Patient(id, "Patient " + std::to_string(id), pick(100), Diseases[pick(4)]));
+            break;
+        case 2:
+            repo.update(id, [&](Patient &p) {
+                p.setAge(pick(100));
+                if (pick(2)) p.setDisease(Diseases[pick(4)]);
+            });
+            break;
+        default:
+            repo.remove(id);
+            break;
+        }
+        if (round % 100 == 99) checkPatientIndexes(repo);
+    }
+    CHECK(repo.size() == idsByScan(repo, [](const Patient &) { return true; }).size());
+    for (int id = 1; id <= 200; ++id) CHECK((repo.getById(id) != nullptr) == repo.inspect(id, [](const Patient &) {}));
+
+    // The empty IndexSet still stores, replaces and removes
+    InMemoryMedicationRepository medications;
+    medications.add(Medication(1, "Aspirin", "100mg", Money::fromCents(599), "Bayer"));
+    medications.add(Medication(1, "Aspirin", "300mg", Money::fromCents(899), "Bayer"));
+    CHECK(medications.size() == 1);
+    CHECK(medications.getById(1) && medications.getById(1)->getDosage() == "300mg");
+    CHECK(medications.remove(1));
+    CHECK(!medications.remove(1));
+    CHECK(medications.size() == 0);
+}
+
+// A fresh directory for one test's files, removed with them afterwards
+class ScratchDirectory {
+private:
+    std::string path;
+
+public:
+    ScratchDirectory() {
+        char name[] = "/tmp/hms_tests.XXXXXX";
+        if (!::mkdtemp(name)) throw std::runtime_error("Cannot create a scratch directory");
+        path = name;
+    }
+
+    ~ScratchDirectory() {
+        for (const char *file : {"/data.wal", "/snapshot.bin"}) std::remove((path + file).c_str());
+        ::rmdir(path.c_str());
+    }
+
+    std::string file(const char *name) const { return path + "/" + name; }
+};
+
+std::string readFile(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string &path, const std::string &data) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << data;
+}
+
+size_t replayPatients(const std::string &path, InMemoryPatientRepository &repo) {
+    return WriteAheadLog::replay(path, [&](EntityKind, WalOp op, BinaryReader &in) {
+        applyJournalRecord<Patient>(repo, op, in);
+    });
+}
+
+void testWalReplay() {
+    ScratchDirectory dir;
+    const std::string path = dir.file("data.wal");
+    {
+        auto wal = std::make_shared<WriteAheadLog>(path);
+        InMemoryPatientRepository repo;
+        repo.attachJournal(wal);
+        repo.add(Patient(1, "Alice Brown", 35, "Hypertension"));
+        repo.add(Patient(2, "Bob Wilson", 42, "Diabetes", "444-555-6666", "456 Oak Ave", "A-"));
+        repo.update(1, [](Patient &p) { p.setAge(36); });
+        repo.remove(2);
+        repo.add(Patient(3, "Carol Martinez", 28, "Asthma"));
+        wal->sync();
+    }
+    const size_t intact = readFile(path).size();
+
+    InMemoryPatientRepository restored;
+    CHECK(replayPatients(path, restored) == 5);
+    CHECK(restored.size() == 2);
+    CHECK(restored.getById(1) && restored.getById(1)->getAge() == 36);
+    CHECK(!restored.getById(2));
+    CHECK(restored.getById(3) && restored.getById(3)->getName() == "Carol Martinez");
+
+    // A record torn by a crash is cut away and the rest still replays
+    writeFile(path, readFile(path) + std::string("\x40\0\0\0\x12\x34", 6));
+    InMemoryPatientRepository afterCrash;
+    CHECK(replayPatients(path, afterCrash) == 5);
+    CHECK(afterCrash.size() == 2);
+    CHECK(readFile(path).size() == intact);
+
+    writeFile(path, "not a log at all");
+    InMemoryPatientRepository ignored;
+    CHECK(throws([&] { replayPatients(path, ignored); }));
+}
+
+void testSnapshotCorruption() {
+    ScratchDirectory dir;
+    const std::string path = dir.file("snapshot.bin");
+    InMemoryPatientRepository repo;
+    for (int id = 1; id <= 50; ++id) repo.add(Patient(id, "Patient " + std::to_string(id), 20 + id, "Flu"));
+    SnapshotWriter writer;
+    writer.addTable(repo.getAll());
+    writer.setNextId(EntityKind::Patient, 51);
+    writer.write(path);
+
+    {
+        MappedSnapshot snapshot(path);
+        InMemoryPatientRepository loaded;
+        CHECK(snapshot.loadInto<Patient>(loaded) == 50);
+        CHECK(loaded.getById(50) && loaded.getById(50)->getName() == "Patient 50");
+        CHECK(snapshot.nextId(EntityKind::Patient) == 51);
+    }
+    const std::string good = readFile(path);
+
+    // A flipped bit in the records fails the table checksum
+    std::string damaged = good;
+    damaged[damaged.size() - 10] ^= 1;
+    writeFile(path, damaged);
+    CHECK(throws([&] { MappedSnapshot snapshot(path); }));
+
+    writeFile(path, good.substr(0, good.size() / 2));
+    CHECK(throws([&] { MappedSnapshot snapshot(path); }));
+
+    // Without the checksum pass, a string reaching past the heap is still refused
+    damaged = good;
+    SnapshotTableEntry entry;
+    std::memcpy(&entry, &damaged[sizeof(SnapshotHeader)], sizeof(entry));
+    PatientRecord record;
+    std::memcpy(&record, &damaged[entry.recordsOffset], sizeof(record));
+    record.name.length = 0x7fffffff;
+    std::memcpy(&damaged[entry.recordsOffset], &record, sizeof(record));
+    writeFile(path, damaged);
+    CHECK(throws([&] {
+        MappedSnapshot snapshot(path, false);
+        InMemoryPatientRepository loaded;
+        snapshot.loadInto<Patient>(loaded);
+    }));
+}
+
+void testMoneyParsing() {
+    struct Case {
+        const char *text;
+        bool valid;
+        int64_t cents;
+    };
+    const Case cases[] = {
+        {"12", true, 1200},   {"12.5", true, 1250},   {"12.50", true, 1250}, {"0.07", true, 7},
+        {"+3", true, 300},    {".5", true, 50},       {"0", true, 0},        {"-1", false, 0},
+        {"1.234", false, 0},  {"", false, 0},         {".", false, 0},       {"12a", false, 0},
+        {"1e3", false, 0},    {" 5", false, 0},       {"1234567890123456", false, 0},
+    };
+    for (const Case &c : cases) {
+        Money amount = Money::fromCents(-1);
+        bool parsed = Money::parse(c.text, amount);
+        CHECK(parsed == c.valid);
+        if (parsed && c.valid) CHECK(amount.getCents() == c.cents);
+    }
+    CHECK(Money::fromCents(123456).toString() == "1234.56");
+    CHECK(Money::fromCents(5).toString() == "0.05");
+}
+
+AuthenticationOptions quickAuthentication() {
+    AuthenticationOptions options;
+    options.passwordIterations = 1000;
+    options.verifierThreads = 1;
+    return options;
+}
+
+void testPermissions() {
+    AuthenticationService auth(std::make_shared<InMemoryUserRepository>(), std::make_shared<NullLogger>(),
+                               quickAuthentication());
+    CHECK(auth.registerUser("admin", "admin123", "Admin"));
+    CHECK(auth.registerUser("reception", "reception123", "Reception"));
+    CHECK(!auth.registerUser("RECEPTION", "other", "Reception"));
+    CHECK(!auth.registerUser("nurse", "nurse123", "Nurse"));
+
+    SessionToken admin = auth.login("admin", "admin123");
+    SessionToken reception = auth.login("Reception", "reception123");
+    CHECK(!admin.isNull());
+    CHECK(!reception.isNull());
+    for (uint32_t p = 0; p < static_cast<uint32_t>(Permission::Count); ++p) {
+        CHECK(auth.allows(admin, static_cast<Permission>(p)));
+    }
+    CHECK(auth.allows(reception, Permission::FrontDesk));
+    CHECK(!auth.allows(reception, Permission::ManageUsers));
+    CHECK(!auth.allows(reception, Permission::ViewFinances));
+    CHECK(!auth.allows(reception, Permission::ArchiveRecords));
+
+    LoginFailure failure = LoginFailure::None;
+    CHECK(auth.login("admin", "wrong", &failure).isNull());
+    CHECK(failure == LoginFailure::BadCredentials);
+    CHECK(auth.login("nobody", "admin123").isNull());
+    CHECK(!auth.allows(SessionToken(), Permission::FrontDesk));
+
+    // Disabling an account ends its sessions and refuses new ones
+    CHECK(auth.updateUserStatus(2, false));
+    CHECK(!auth.allows(reception, Permission::FrontDesk));
+    CHECK(auth.login("reception", "reception123").isNull());
+
+    auth.logout(admin);
+    CHECK(!auth.allows(admin, Permission::FrontDesk));
+}
+
+void testSessionExpiry() {
+    AuthenticationOptions options = quickAuthentication();
+    options.sessionTimeout = std::chrono::seconds(2); // Deadlines are kept in whole seconds
+    AuthenticationService auth(std::make_shared<InMemoryUserRepository>(), std::make_shared<NullLogger>(), options);
+    CHECK(auth.registerUser("doctor", "doctor123", "Doctor"));
+    SessionToken idle = auth.login("doctor", "doctor123");
+    SessionToken active = auth.login("doctor", "doctor123");
+    CHECK(auth.isLoggedIn(idle));
+    for (int i = 0; i < 6; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        CHECK(auth.isLoggedIn(active)); // Each use pushes the deadline back
+    }
+    CHECK(!auth.isLoggedIn(idle));
+    CHECK(!auth.allows(idle, Permission::FrontDesk));
+}
+
+std::string pbkdf2Hex(const std::string &password, const std::string &salt, uint32_t iterations) {
+    uint8_t key[Sha256::DigestSize];
+    pbkdf2Sha256(password, salt, iterations, key);
+    return toHex(key, sizeof(key));
+}
+
+// PBKDF2-HMAC-SHA256 vectors, the first 32 bytes of each derived key
+void testPbkdf2Vectors() {
+    CHECK(pbkdf2Hex("password", "salt", 1) == "120fb6cffcf8b32c43e7225256c4f837a86548c92ccc35480805987cb70be17b");
+    CHECK(pbkdf2Hex("password", "salt", 2) == "ae4d0c95af6b46d32d0adff928f06dd02a303f8ef3c251dfd6e2d85a95474c43");
+    CHECK(pbkdf2Hex("password", "salt", 4096) == "c5e478d59288c841aa530db6845c4c8d962893a001ce4e11a4963873aa98134a");
+    CHECK(pbkdf2Hex("passwordPASSWORDpassword", "saltSALTsaltSALTsaltSALTsaltSALTsalt", 4096) ==
+          "348c89dbcbd32b2f32d814b8116e84cf2b17347ebc1800181c4e2a1fb8dd53e1");
+    CHECK(pbkdf2Hex("passwd", "salt", 1) == "55ac046e56e3089fec1691c22544b605f94185216dde0465e68b9d57c20dacbc");
+
+    CHECK(hashPasswordWithSalt("password", "salt", 2) ==
+          "pbkdf2-sha256$2$73616c74$ae4d0c95af6b46d32d0adff928f06dd02a303f8ef3c251dfd6e2d85a95474c43");
+    std::string stored = hashPassword("secret", 1000);
+    CHECK(isPasswordHash(stored));
+    CHECK(stored != hashPassword("secret", 1000)); // Salted afresh each time
+}
+
+const char *const AppointmentStatuses[] = {"Scheduled", "Completed", "Cancelled"};
+
+// Whether an appointment other than exceptId holds the slot, by a full scan
+bool slotHeldByScan(const InMemoryAppointmentRepository &repo, int doctorId, int day, int slot, int exceptId = 0) {
+    bool held = false;
+    repo.forEach([&](const Appointment &a) {
+        held = held || (a.getAppointmentId() != exceptId && a.getStatus() != "Cancelled" &&
+                        a.getDoctorId() == doctorId && a.getDay() == day && a.getSlot() == slot);
+    });
+    return held;
+}
+
+void checkBookedSlots(const InMemoryAppointmentRepository &repo, int firstDay) {
+    for (int doctorId = 1; doctorId <= 3; ++doctorId) {
+        for (int day = firstDay; day < firstDay + 3; ++day) {
+            const std::string date = formatDayNumber(day);
+            std::vector<std::string> free;
+            for (int slot = 0; slot < TimeSlotCount; ++slot) {
+                bool held = slotHeldByScan(repo, doctorId, day, slot);
+                CHECK(repo.isSlotBooked(doctorId, date, TimeSlots[slot]) == held);
+                if (!held) free.push_back(TimeSlots[slot]);
+            }
+            CHECK(repo.findFreeSlots(doctorId, date) == free);
+        }
+    }
+}
+
+// Booking, cancelling and rescheduling keep the booked slots in step with
+// the appointments that hold them
+void testBookedSlots() {
+    InMemoryAppointmentRepository repo;
+    const int firstDay = parseDayNumber("2026-03-02");
+    std::mt19937 rng(4);
+    auto pick = [&](int n) { return static_cast<int>(rng() % static_cast<uint32_t>(n)); };
+    int nextId = 1;
+    for (int round = 0; round < 3000; ++round) {
+        int doctorId = pick(3) + 1;
+        int day = firstDay + pick(3);
+        int slot = pick(TimeSlotCount);
+        int id = pick(nextId) + 1;
+        bool exists = repo.getById(id) != nullptr;
+        switch (pick(4)) {
+        case 0: { // Book
+            bool expected = !slotHeldByScan(repo, doctorId, day, slot);
+            CHECK(repo.addIfSlotFree(Appointment(nextId, 1, doctorId, day, slot)) == expected);
+            if (expected) ++nextId;
+            break;
+        }
+        case 1: { // Reschedule
+            const Appointment *current = repo.getById(id);
+            bool expected = exists && (current->getStatus() == "Cancelled" ||
+                                       !slotHeldByScan(repo, current->getDoctorId(), day, slot, id));
+            CHECK(repo.updateIfSlotFree(id, [&](Appointment &a) {
+                a.setDate(formatDayNumber(day));
+                a.setTimeSlot(TimeSlots[slot]);
+            }) == expected);
+            break;
+        }
+        case 2: { // Cancel, complete or restore
+            const std::string status = AppointmentStatuses[pick(3)];
+            const Appointment *current = repo.getById(id);
+            bool expected = exists && (status == "Cancelled" ||
+                                       !slotHeldByScan(repo, current->getDoctorId(), current->getDay(),
+                                                       current->getSlot(), id));
+            CHECK(repo.updateIfSlotFree(id, [&](Appointment &a) { a.setStatus(status); }) == expected);
+            break;
+        }
+        default:
+            CHECK(repo.remove(id) == exists);
+            break;
+        }
+        if (round % 100 == 99) checkBookedSlots(repo, firstDay);
+    }
+    checkBookedSlots(repo, firstDay);
+}
+
+// IDs a day-range query should visit, by a full scan: by day, then ID
+template <typename T>
+std::vector<int> idsInDayRangeByScan(const IRepository<T> &repo, int fromDay, int toDay) {
+    std::vector<std::pair<int, int>> keyed;
+    repo.forEach([&](const T &item) {
+        if (item.getDay() >= fromDay && item.getDay() <= toDay) keyed.emplace_back(item.getDay(), EntityCodec<T>::id(item));
+    });
+    std::sort(keyed.begin(), keyed.end());
+    std::vector<int> ids;
+    for (const auto &entry : keyed) ids.push_back(entry.second);
+    return ids;
+}
+
+// Keyed indexes follow a changed key through update() and through add()
+// over an existing ID
+void testKeyedIndexUpdates() {
+    const char *const specializations[] = {"Cardiology", "Neurology", "Pediatrics"};
+    const char *const paymentStatuses[] = {"Pending", "Paid", "Overdue"};
+    const int firstDay = parseDayNumber("2026-03-02");
+    InMemoryDoctorRepository doctors;
+    InMemoryAppointmentRepository appointments;
+    InMemoryBillRepository bills;
+    std::mt19937 rng(5);
+    auto pick = [&](int n) { return static_cast<int>(rng() % static_cast<uint32_t>(n)); };
+    for (int id = 1; id <= 100; ++id) {
+        doctors.add(Doctor(id, "Doctor " + std::to_string(id), specializations[pick(3)]));
+        appointments.add(Appointment(id, id, pick(10) + 1, firstDay + pick(5), pick(TimeSlotCount),
+                                     AppointmentStatuses[pick(3)]));
+        bills.add(Bill(id, id, firstDay + pick(5), Money::fromCents(100 * id), Money(), Money(), paymentStatuses[pick(3)]));
+    }
+    for (int round = 0; round < 1000; ++round) {
+        int id = pick(100) + 1;
+        int day = firstDay + pick(5);
+        doctors.update(id, [&](Doctor &d) { d.setSpecialization(specializations[pick(3)]); });
+        appointments.update(id, [&](Appointment &a) {
+            if (pick(2)) a.setStatus(AppointmentStatuses[pick(3)]);
+            if (pick(2)) a.setDate(formatDayNumber(day));
+        });
+        if (pick(2)) {
+            bills.update(id, [&](Bill &b) { b.setPaymentStatus(paymentStatuses[pick(3)]); });
+        } else {
+            bills.add(Bill(id, id, day, Money::fromCents(100 * id), Money(), Money(), paymentStatuses[pick(3)]));
+        }
+        if (round % 100 != 99) continue;
+
+        for (const char *specialization : specializations) {
+            CHECK(sorted(idsFrom<Doctor>([&](const auto &v) { doctors.forEachBySpecialization(specialization, v); })) ==
+                  idsByScan(doctors, [&](const Doctor &d) { return d.getSpecialization() == specialization; }));
+        }
+        for (const char *status : AppointmentStatuses) {
+            CHECK(sorted(idsFrom<Appointment>([&](const auto &v) { appointments.forEachByStatus(status, v); })) ==
+                  idsByScan(appointments, [&](const Appointment &a) { return a.getStatus() == status; }));
+        }
+        for (const char *status : paymentStatuses) {
+            CHECK(sorted(idsFrom<Bill>([&](const auto &v) { bills.forEachByPaymentStatus(status, v); })) ==
+                  idsByScan(bills, [&](const Bill &b) { return b.getPaymentStatus() == status; }));
+        }
+        for (int from = firstDay; from < firstDay + 5; ++from) {
+            CHECK(sorted(idsFrom<Appointment>([&](const auto &v) { appointments.forEachByDate(formatDayNumber(from), v); })) ==
+                  idsByScan(appointments, [&](const Appointment &a) { return a.getDay() == from; }));
+            for (int to = from; to < firstDay + 5; ++to) {
+                CHECK(idsFrom<Appointment>([&](const auto &v) { appointments.forEachInDateRange(from, to, v); }) ==
+                      idsInDayRangeByScan(appointments, from, to));
+                CHECK(idsFrom<Bill>([&](const auto &v) { bills.forEachInDateRange(from, to, v); }) ==
+                      idsInDayRangeByScan(bills, from, to));
+            }
+        }
+    }
+}
+
+// The age index follows setAge, ages outside 0..150 included: range
+// queries visit by age then ID and counts match a full scan
+void testAgeIndex() {
+    InMemoryPatientRepository repo;
+    std::mt19937 rng(6);
+    auto randomAge = [&] { return static_cast<int>(rng() % 181u) - 15; }; // -15..165
+    for (int id = 1; id <= 300; ++id) repo.add(Patient(id, "Patient " + std::to_string(id), randomAge(), "Flu"));
+    const int bounds[] = {std::numeric_limits<int>::min(), -15, -1, 0, 1, 17, 64, 149, 150, 151, 165,
+                          std::numeric_limits<int>::max()};
+    for (int round = 0; round < 20; ++round) {
+        for (int i = 0; i < 50; ++i) {
+            int id = static_cast<int>(rng() % 300u) + 1;
+            repo.update(id, [&](Patient &p) { p.setAge(randomAge()); });
+        }
+        for (int low : bounds) {
+            for (int high : bounds) {
+                std::vector<std::pair<int, int>> keyed;
+                repo.forEach([&](const Patient &p) {
+                    if (p.getAge() >= low && p.getAge() <= high) keyed.emplace_back(p.getAge(), p.getId());
+                });
+                std::sort(keyed.begin(), keyed.end());
+                std::vector<int> scanned;
+                for (const auto &entry : keyed) scanned.push_back(entry.second);
+                CHECK(idsFrom<Patient>([&](const auto &v) { repo.forEachInAgeRange(low, high, v); }) == scanned);
+                CHECK(repo.countByAgeRange(low, high) == scanned.size());
+            }
+        }
+    }
+}
+
+bool sameTotal(const RevenueTotal &a, const RevenueTotal &b) {
+    return a.bills == b.bills && a.amount == b.amount;
+}
+
+bool sameTotals(const std::map<std::string, RevenueTotal> &a, const std::map<std::string, RevenueTotal> &b) {
+    return a.size() == b.size() &&
+           std::equal(a.begin(), a.end(), b.begin(), [](const auto &x, const auto &y) {
+               return x.first == y.first && sameTotal(x.second, y.second);
+           });
+}
+
+// Revenue totals against a full scan
+void checkRevenue(const IBillRepository &repo, int firstDay) {
+    const char *const paymentStatuses[] = {"Pending", "Paid", "Overdue"};
+    RevenueTotal overall;
+    std::map<std::string, RevenueTotal> byStatus, byMethod;
+    repo.forEach([&](const Bill &b) {
+        RevenueTotal one;
+        one.bills = 1;
+        one.amount = b.getTotalAmount();
+        overall += one;
+        byStatus[b.getPaymentStatus()] += one;
+        byMethod[b.getPaymentMethod()] += one;
+    });
+    CHECK(repo.getTotalRevenue() == overall.amount);
+    CHECK(sameTotals(repo.getRevenueByPaymentStatus(), byStatus));
+    CHECK(sameTotals(repo.getRevenueByPaymentMethod(), byMethod));
+    for (const char *status : paymentStatuses) {
+        CHECK(sameTotal(repo.getRevenueForPaymentStatus(status), byStatus[status]));
+    }
+    for (int from = firstDay; from < firstDay + 5; ++from) {
+        for (int to = from; to < firstDay + 5; ++to) {
+            for (const char *status : {"", "Pending", "Paid", "Overdue"}) {
+                RevenueTotal scanned;
+                repo.forEach([&](const Bill &b) {
+                    if (b.getDay() < from || b.getDay() > to || (*status && b.getPaymentStatus() != status)) return;
+                    ++scanned.bills;
+                    scanned.amount += b.getTotalAmount();
+                });
+                CHECK(sameTotal(repo.getRevenueWhere(status, from, to), scanned));
+                if (!*status) CHECK(sameTotal(repo.getRevenueForDateRange(from, to), scanned));
+            }
+        }
+    }
+}
+
+// The revenue ledger follows bills whose status, method or charges change,
+// in both the plain and the sharded repository
+void testRevenueLedger() {
+    const char *const paymentStatuses[] = {"Pending", "Paid", "Overdue"};
+    const char *const paymentMethods[] = {"", "Cash", "Card", "Insurance"};
+    const int firstDay = parseDayNumber("2026-03-02");
+    InMemoryBillRepository plain;
+    ConcurrentBillRepository sharded;
+    IBillRepository *const repos[] = {&plain, &sharded};
+    for (IBillRepository *repo : repos) {
+        std::mt19937 rng(15);
+        auto pick = [&](int n) { return static_cast<int>(rng() % static_cast<uint32_t>(n)); };
+        auto randomBill = [&](int id) {
+            return Bill(id, id, firstDay + pick(5), Money::fromCents(pick(50000)), Money::fromCents(pick(5000)),
+                        Money(), paymentStatuses[pick(3)], paymentMethods[pick(4)]);
+        };
+        for (int id = 1; id <= 200; ++id) repo->add(randomBill(id));
+        for (int round = 0; round < 2000; ++round) {
+            int id = pick(250) + 1;
+            switch (pick(5)) {
+            case 0:
+                repo->update(id, [&](Bill &b) { b.setPaymentStatus(paymentStatuses[pick(3)]); });
+                break;
+            case 1:
+                repo->update(id, [&](Bill &b) { b.setPaymentMethod(paymentMethods[pick(4)]); });
+                break;
+            case 2:
+                repo->update(id, [&](Bill &b) { b.setOtherCharges(Money::fromCents(pick(2000))); });
+                break;
+            case 3:
+                repo->add(randomBill(id));
+                break;
+            default:
+                repo->remove(id);
+                break;
+            }
+            if (round % 200 == 199) checkRevenue(*repo, firstDay);
+        }
+    }
+}
+
+// Every benchmark runs to completion at a token size, so a change to the
+// vocabularies or services cannot leave one broken until someone times it
+void testBenchmarkSmoke() {
+    BenchmarkOptions options;
+    options.smoke = true;
+    options.scale = 200;
+    options.durationSeconds = 1;
+    options.threads = 2;
+    options.clients = 4;
+    options.passwordIterations = 1000;
+    std::ostringstream output;
+    std::streambuf *console = std::cout.rdbuf(output.rdbuf());
+    for (const BenchmarkEntry &entry : Benchmarks) {
+        bool ran = false;
+        try {
+            ran = runBenchmark(entry.name, options) == 0;
+        } catch (const std::exception &e) {
+            std::cerr << "benchmark " << entry.name << ": " << e.what() << "\n";
+        }
+        CHECK(ran);
+    }
+    std::cout.rdbuf(console);
+}
+
+} // namespace
+
+int main() {
+    const std::pair<const char *, void (*)()> tests[] = {
+        {"repository template indexes", testRepositoryTemplate},
+        {"write-ahead log replay", testWalReplay},
+        {"snapshot corruption", testSnapshotCorruption},
+        {"money parsing", testMoneyParsing},
+        {"permission checks", testPermissions},
+        {"session expiry", testSessionExpiry},
+        {"PBKDF2 vectors", testPbkdf2Vectors},
+        {"booked slots", testBookedSlots},
+        {"keyed index updates", testKeyedIndexUpdates},
+        {"age index", testAgeIndex},
+        {"revenue ledger", testRevenueLedger},
+        {"benchmark smoke run", testBenchmarkSmoke},
+    };
+    for (const auto &test : tests) {
+        int before = failures;
+        try {
+            test.second();
+        } catch (const std::exception &e) {
+            ++failures;
+            std::cerr << test.first << ": unexpected exception: " << e.what() << "\n";
+        }
+        std::cout << (failures == before ? "PASS " : "FAIL ") << test.first << "\n";
+    }
+    std::cout << (failures == 0 ? "All tests passed.\n" : std::to_string(failures) + " check(s) failed.\n");
+    return failures == 0 ? 0 : 1;
+}